@@ -37,6 +37,8 @@ struct WasmObjectHeader {
 struct WasmSignature {
   std::vector<uint8_t> ParamTypes;
   uint8_t ReturnType;
+  // The results after the first, for multivalue signatures.
+  std::vector<uint8_t> ExtraReturnTypes;
 };
 
 struct WasmExport {
@@ -234,6 +236,14 @@ enum : unsigned {
   WASM_NAMES_LOCAL    = 0x2,
 };
 
+// Format byte leading the Snax name tables (.imports, .snax_actions and
+// .snax_notify) when they are written as an entry count followed by the
+// entries in sorted order.  Older tables have no header and start with the
+// length of a name, which is never empty.
+enum : unsigned {
+  WASM_SNAX_TABLE_SORTED = 0x0,
+};
+
 // Kind codes used in the custom "linking" section
 enum : unsigned {
   WASM_SEGMENT_INFO   = 0x5,
@@ -276,7 +286,8 @@ enum : unsigned {
 
 // Useful comparison operators
 inline bool operator==(const WasmSignature &LHS, const WasmSignature &RHS) {
-  return LHS.ReturnType == RHS.ReturnType && LHS.ParamTypes == RHS.ParamTypes;
+  return LHS.ReturnType == RHS.ReturnType && LHS.ParamTypes == RHS.ParamTypes &&
+         LHS.ExtraReturnTypes == RHS.ExtraReturnTypes;
 }
 
 inline bool operator!=(const WasmSignature &LHS, const WasmSignature &RHS) {
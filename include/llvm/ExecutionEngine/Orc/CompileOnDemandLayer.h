@@ -16,6 +16,8 @@
 #define LLVM_EXECUTIONENGINE_ORC_COMPILEONDEMANDLAYER_H
 
 #include "llvm/ADT/APInt.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/Twine.h"
@@ -23,9 +25,11 @@
 #include "llvm/ExecutionEngine/Orc/Core.h"
 #include "llvm/ExecutionEngine/Orc/IndirectionUtils.h"
 #include "llvm/ExecutionEngine/Orc/LambdaResolver.h"
+#include "llvm/ExecutionEngine/Orc/Legacy.h"
 #include "llvm/ExecutionEngine/Orc/OrcError.h"
 #include "llvm/ExecutionEngine/RuntimeDyld.h"
 #include "llvm/IR/Attributes.h"
+#include "llvm/IR/CallSite.h"
 #include "llvm/IR/Constant.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DataLayout.h"
@@ -41,11 +45,15 @@
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Utils/ValueMapper.h"
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <condition_variable>
+#include <deque>
 #include <functional>
 #include <iterator>
 #include <list>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <string>
 #include <utility>
@@ -64,6 +72,10 @@ namespace orc {
 /// added to the layer below. When a stub is called it triggers the extraction
 /// of the function body from the original module. The extracted body is then
 /// compiled and executed.
+///
+///   Optionally, the layer can speculatively compile the functions that a
+/// newly compiled function calls directly, so that they're ready (and their
+/// stubs updated) before they're first called. See setSpeculationDispatcher.
 template <typename BaseLayerT,
           typename CompileCallbackMgrT = JITCompileCallbackManager,
           typename IndirectStubsMgrT = IndirectStubsManager>
@@ -209,6 +221,10 @@ public:
   using SymbolResolverSetter =
       std::function<void(VModuleKey K, std::shared_ptr<SymbolResolver> R)>;
 
+  /// Runs a speculative compilation task, e.g. on a background thread.
+  using SpeculationDispatcherFtor =
+      std::function<void(std::function<void()> Task)>;
+
   /// Construct a compile-on-demand layer instance.
   CompileOnDemandLayer(ExecutionSession &ES, BaseLayerT &BaseLayer,
                        SymbolResolverGetter GetSymbolResolver,
@@ -225,6 +241,13 @@ public:
         CloneStubsIntoPartitions(CloneStubsIntoPartitions) {}
 
   ~CompileOnDemandLayer() {
+    // Drop any pending speculation and wait for a task in flight to finish.
+    {
+      std::unique_lock<std::recursive_mutex> Lock(LayerMutex);
+      SpeculationQueue.clear();
+      SpeculationDone.wait(Lock, [this]() { return !SpeculationRunning; });
+    }
+
     // FIXME: Report error on log.
     while (!LogicalDylibs.empty())
       consumeError(removeModule(LogicalDylibs.begin()->first));
@@ -232,7 +255,7 @@ public:
 
   /// Add a module to the compile-on-demand layer.
   Error addModule(VModuleKey K, std::unique_ptr<Module> M) {
-
+    std::lock_guard<std::recursive_mutex> Lock(LayerMutex);
     assert(!LogicalDylibs.count(K) && "VModuleKey K already in use");
     auto I = LogicalDylibs.insert(
         LogicalDylibs.end(),
@@ -244,6 +267,7 @@ public:
 
   /// Add extra modules to an existing logical module.
   Error addExtraModule(VModuleKey K, std::unique_ptr<Module> M) {
+    std::lock_guard<std::recursive_mutex> Lock(LayerMutex);
     return addLogicalModule(LogicalDylibs[K], std::move(M));
   }
 
@@ -252,8 +276,13 @@ public:
   ///   This will remove all modules in the layers below that were derived from
   /// the module represented by K.
   Error removeModule(VModuleKey K) {
+    std::lock_guard<std::recursive_mutex> Lock(LayerMutex);
     auto I = LogicalDylibs.find(K);
     assert(I != LogicalDylibs.end() && "VModuleKey K not valid here");
+    SpeculationQueue.erase(
+        std::remove_if(SpeculationQueue.begin(), SpeculationQueue.end(),
+                       [K](const SpeculationEntry &S) { return S.K == K; }),
+        SpeculationQueue.end());
     auto Err = I->second.removeModulesFromBaseLayer(BaseLayer);
     LogicalDylibs.erase(I);
     return Err;
@@ -264,6 +293,7 @@ public:
   /// @param ExportedSymbolsOnly If true, search only for exported symbols.
   /// @return A handle for the given named symbol, if it exists.
   JITSymbol findSymbol(StringRef Name, bool ExportedSymbolsOnly) {
+    std::lock_guard<std::recursive_mutex> Lock(LayerMutex);
     for (auto &KV : LogicalDylibs) {
       if (auto Sym = KV.second.StubsMgr->findStub(Name, ExportedSymbolsOnly))
         return Sym;
@@ -279,10 +309,41 @@ public:
   ///        below this one.
   JITSymbol findSymbolIn(VModuleKey K, const std::string &Name,
                          bool ExportedSymbolsOnly) {
+    std::lock_guard<std::recursive_mutex> Lock(LayerMutex);
     assert(LogicalDylibs.count(K) && "VModuleKey K is not valid here");
     return LogicalDylibs[K].findSymbol(BaseLayer, Name, ExportedSymbolsOnly);
   }
 
+  /// Enable speculative compilation.
+  ///
+  ///   Whenever a function is compiled, the functions it calls directly that
+  /// haven't been compiled yet are queued, and Dispatch is asked to run a task
+  /// that compiles them and points their stubs at the new bodies. Callees with
+  /// a zero entry count in their profile data are skipped. The rest are queued
+  /// by entry count, or by number of call sites if there's no profile, with
+  /// the callees of the most recently compiled function first. The callees of
+  /// speculatively compiled functions are queued in turn, up to Depth calls
+  /// away from a function that has actually been called.
+  ///
+  ///   Speculative and lazy compilation are serialized by the layer, and a
+  /// speculation task gives way to waiting lazy compiles between functions.
+  /// The base layer and symbol resolvers will be used from whichever thread
+  /// Dispatch runs the task on. Dispatch is called without the layer's lock
+  /// held, so it may run the task in place. It must run every task it's
+  /// given: the layer's destructor waits for the last one to finish.
+  void setSpeculationDispatcher(SpeculationDispatcherFtor Dispatch,
+                                unsigned Depth = 1) {
+    std::lock_guard<std::recursive_mutex> Lock(LayerMutex);
+    DispatchSpeculation = std::move(Dispatch);
+    SpeculationDepth = Depth;
+  }
+
+  /// Return the number of functions that have been compiled speculatively.
+  unsigned getNumSpeculativelyCompiled() const {
+    std::lock_guard<std::recursive_mutex> Lock(LayerMutex);
+    return NumSpeculativelyCompiled;
+  }
+
   /// Update the stub for the given function to point at FnBodyAddr.
   /// This can be used to support re-optimization.
   /// @return true if the function exists and the stub is updated, false
@@ -350,13 +411,28 @@ private:
         // and set the compile action to compile the partition containing the
         // function.
         auto CompileAction = [this, &LD, LMId, &F]() -> JITTargetAddress {
-          if (auto FnImplAddrOrErr = this->extractAndCompile(LD, LMId, F))
-            return *FnImplAddrOrErr;
-          else {
-            // FIXME: Report error, return to 'abort' or something similar.
-            consumeError(FnImplAddrOrErr.takeError());
-            return 0;
+          JITTargetAddress FnImplAddr = 0;
+          SpeculationDispatcherFtor StartSpeculation;
+          {
+            // Let a running speculation task know that we're waiting, so
+            // that it gives way between functions.
+            ++this->NumWaitingLazyCompiles;
+            std::lock_guard<std::recursive_mutex> Lock(this->LayerMutex);
+            if (--this->NumWaitingLazyCompiles == 0)
+              this->LazyCompilesStarted.notify_all();
+            if (auto FnImplAddrOrErr = this->extractAndCompile(LD, LMId, F))
+              FnImplAddr = *FnImplAddrOrErr;
+            else {
+              // FIXME: Report error, return to 'abort' or something similar.
+              consumeError(FnImplAddrOrErr.takeError());
+            }
+            StartSpeculation = this->takeSpeculationStart();
           }
+          // Start speculating without the lock held, so the task can give it
+          // up between functions even if Dispatch runs it right here.
+          if (StartSpeculation)
+            StartSpeculation([this]() { this->runSpeculation(); });
+          return FnImplAddr;
         };
         if (auto CCAddr =
                 CompileCallbackMgr.getCompileCallback(std::move(CompileAction)))
@@ -503,18 +579,33 @@ private:
   Expected<JITTargetAddress>
   extractAndCompile(LogicalDylib &LD,
                     typename LogicalDylib::SourceModuleHandle LMId,
-                    Function &F) {
+                    Function &F, unsigned Depth = 0) {
     Module &SrcM = LD.getSourceModule(LMId);
 
-    // If F is a declaration we must already have compiled it.
-    if (F.isDeclaration())
+    // If F is a declaration we must already have compiled it. This happens if
+    // F was compiled speculatively after its stub had already been entered.
+    if (F.isDeclaration()) {
+      std::string FnName = mangle(F.getName(), SrcM.getDataLayout());
+      for (auto BLK : LD.BaseLayerVModuleKeys)
+        if (auto FnBodySym = BaseLayer.findSymbolIn(BLK, FnName, false))
+          return FnBodySym.getAddress();
+        else if (auto Err = FnBodySym.takeError())
+          return std::move(Err);
       return 0;
+    }
 
     // Grab the name of the function being called here.
     std::string CalledFnName = mangle(F.getName(), SrcM.getDataLayout());
 
     JITTargetAddress CalledAddr = 0;
     auto Part = Partition(F);
+
+    // Find the callees to speculate on before the bodies are moved out of
+    // the source module.
+    std::vector<Function *> Callees;
+    if (DispatchSpeculation && Depth < SpeculationDepth)
+      Callees = getSpeculationCandidates(LD, SrcM, Part);
+
     if (auto PartKeyOrErr = emitPartition(LD, LMId, Part)) {
       auto &PartKey = *PartKeyOrErr;
       for (auto *SubF : Part) {
@@ -544,9 +635,111 @@ private:
     } else
       return PartKeyOrErr.takeError();
 
+    if (!Callees.empty())
+      speculate(LD, LMId, Callees, Depth + 1);
+
     return CalledAddr;
   }
 
+  // Return the functions called directly from Part that are defined in SrcM
+  // and still have to be compiled, most likely to be called first.
+  template <typename PartitionT>
+  std::vector<Function *> getSpeculationCandidates(LogicalDylib &LD,
+                                                   Module &SrcM,
+                                                   const PartitionT &Part) {
+    MapVector<Function *, uint64_t> CallSites;
+    for (auto *F : Part)
+      for (auto &BB : *F)
+        for (auto &I : BB) {
+          CallSite CS(&I);
+          if (!CS)
+            continue;
+          auto *Callee =
+              dyn_cast<Function>(CS.getCalledValue()->stripPointerCasts());
+          if (Callee && !Callee->isDeclaration() && !Part.count(Callee))
+            ++CallSites[Callee];
+        }
+
+    std::vector<std::pair<uint64_t, Function *>> Weighted;
+    for (auto &KV : CallSites) {
+      Function *Callee = KV.first;
+      uint64_t Weight = KV.second;
+      if (auto Count = Callee->getEntryCount()) {
+        // The profile says this function is never called.
+        if (Count.getCount() == 0)
+          continue;
+        Weight = Count.getCount();
+      }
+      // Weak definitions that were already provided elsewhere have no stub.
+      if (!LD.StubsMgr->findStub(mangle(Callee->getName(),
+                                        SrcM.getDataLayout()),
+                                 false))
+        continue;
+      Weighted.push_back(std::make_pair(Weight, Callee));
+    }
+    std::stable_sort(Weighted.begin(), Weighted.end(),
+                     [](const std::pair<uint64_t, Function *> &LHS,
+                        const std::pair<uint64_t, Function *> &RHS) {
+                       return LHS.first > RHS.first;
+                     });
+
+    std::vector<Function *> Candidates;
+    for (auto &W : Weighted)
+      Candidates.push_back(W.second);
+    return Candidates;
+  }
+
+  // Queue Callees for speculative compilation. The caller must hold
+  // LayerMutex, and start a task with takeSpeculationStart once it has
+  // released it.
+  void speculate(LogicalDylib &LD,
+                 typename LogicalDylib::SourceModuleHandle LMId,
+                 ArrayRef<Function *> Callees, unsigned Depth) {
+    std::vector<SpeculationEntry> Entries;
+    for (auto *Callee : Callees)
+      Entries.push_back({LD.K, LMId, Callee, Depth});
+    SpeculationQueue.insert(SpeculationQueue.begin(), Entries.begin(),
+                            Entries.end());
+  }
+
+  // If there's queued speculation and no task to run it, return the
+  // dispatcher to start one with, and mark it running. The caller must hold
+  // LayerMutex.
+  SpeculationDispatcherFtor takeSpeculationStart() {
+    if (SpeculationRunning || SpeculationQueue.empty() || !DispatchSpeculation)
+      return SpeculationDispatcherFtor();
+    SpeculationRunning = true;
+    return DispatchSpeculation;
+  }
+
+  // Compile the queued functions until the queue is empty. The task must not
+  // be started with LayerMutex held: it waits for lazy compiles between
+  // functions, and can only give them the lock if it's the sole holder.
+  void runSpeculation() {
+    std::unique_lock<std::recursive_mutex> Lock(LayerMutex);
+    while (!SpeculationQueue.empty()) {
+      SpeculationEntry S = SpeculationQueue.front();
+      SpeculationQueue.pop_front();
+
+      // Skip functions that have been compiled since they were queued.
+      auto I = LogicalDylibs.find(S.K);
+      if (I != LogicalDylibs.end() && !S.F->isDeclaration()) {
+        if (auto FnImplAddrOrErr =
+                extractAndCompile(I->second, S.LMId, *S.F, S.Depth))
+          ++NumSpeculativelyCompiled;
+        else
+          ES.reportError(FnImplAddrOrErr.takeError());
+      }
+
+      // Unlocking and relocking wouldn't let a waiting thread in, so wait
+      // until the lazy compiles that are waiting have taken the lock.
+      LazyCompilesStarted.wait(
+          Lock, [this]() { return NumWaitingLazyCompiles == 0; });
+    }
+    SpeculationRunning = false;
+    SpeculationDone.notify_all();
+  }
+
   template <typename PartitionT>
   Expected<VModuleKey>
   emitPartition(LogicalDylib &LD,
@@ -656,6 +849,25 @@ private:
 
   std::map<VModuleKey, LogicalDylib> LogicalDylibs;
   bool CloneStubsIntoPartitions;
+
+  struct SpeculationEntry {
+    VModuleKey K;
+    typename LogicalDylib::SourceModuleHandle LMId;
+    Function *F;
+    unsigned Depth;
+  };
+
+  // Guards the layer's state, and serializes lazy and speculative compiles.
+  mutable std::recursive_mutex LayerMutex;
+  SpeculationDispatcherFtor DispatchSpeculation;
+  unsigned SpeculationDepth = 0;
+  std::deque<SpeculationEntry> SpeculationQueue;
+  bool SpeculationRunning = false;
+  std::condition_variable_any SpeculationDone;
+  // The number of lazy compiles waiting for LayerMutex.
+  std::atomic<unsigned> NumWaitingLazyCompiles{0};
+  std::condition_variable_any LazyCompilesStarted;
+  unsigned NumSpeculativelyCompiled = 0;
 };
 
 } // end namespace orc
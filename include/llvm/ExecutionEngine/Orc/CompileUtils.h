@@ -26,6 +26,7 @@
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetMachine.h"
 #include <algorithm>
+#include <functional>
 #include <memory>
 
 namespace llvm {
@@ -114,6 +115,36 @@ private:
   ObjectCache *ObjCache = nullptr;
 };
 
+/// Thread-safe compile functor: like SimpleCompiler, but creates a fresh
+///        TargetMachine for each module, since a TargetMachine can't be used
+///        by two compiles at once. Use this with an ExecutionSession that
+///        materializes on a thread pool. The ObjectCache, if any, must be
+///        thread-safe too.
+class ConcurrentIRCompiler {
+public:
+  using CompileResult = SimpleCompiler::CompileResult;
+
+  /// Creates the TargetMachine for one compile.
+  using TargetMachineBuilder = std::function<std::unique_ptr<TargetMachine>()>;
+
+  ConcurrentIRCompiler(TargetMachineBuilder BuildTM,
+                       ObjectCache *ObjCache = nullptr)
+      : BuildTM(std::move(BuildTM)), ObjCache(ObjCache) {}
+
+  /// Compile a Module to an ObjectFile.
+  CompileResult operator()(Module &M) {
+    std::unique_ptr<TargetMachine> TM = BuildTM();
+    if (!TM)
+      return nullptr;
+    SimpleCompiler C(*TM, ObjCache);
+    return C(M);
+  }
+
+private:
+  TargetMachineBuilder BuildTM;
+  ObjectCache *ObjCache = nullptr;
+};
+
 } // end namespace orc
 
 } // end namespace llvm
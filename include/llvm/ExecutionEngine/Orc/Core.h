@@ -25,6 +25,9 @@
 #include <vector>
 
 namespace llvm {
+
+class ThreadPool;
+
 namespace orc {
 
 // Forward declare some classes.
@@ -282,6 +285,16 @@ public:
     return *this;
   }
 
+  /// Materialize units on the given ThreadPool, so that independent units are
+  /// compiled concurrently. A pool thread that blocks in a lookup while
+  /// materializing runs units that are still queued itself, since the units
+  /// it's waiting for may be queued behind it. Outstanding work must be
+  /// finished (e.g. by destroying the pool) before the session is destroyed.
+  ///
+  /// Without LLVM_ENABLE_THREADS this is the same as materializing on the
+  /// current thread.
+  ExecutionSessionBase &setDispatchMaterializationToThreadPool(ThreadPool &TP);
+
   /// Report a error for this execution session.
   ///
   /// Unhandled errors can be sent here to log them.
@@ -318,6 +331,9 @@ private:
     MU->doMaterialize(V);
   }
 
+  // Guards the symbol tables of every VSO and the queries waiting on them.
+  // It isn't split per VSO because a lookup or a resolution updates several
+  // VSOs and queries at once. Materialization runs without it.
   mutable std::recursive_mutex SessionMutex;
   std::shared_ptr<SymbolStringPool> SSP;
   VModuleKey LastKey = 0;
@@ -24,6 +24,7 @@
 #include "llvm/Support/Process.h"
 #include "llvm/Transforms/Utils/ValueMapper.h"
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstdint>
 #include <functional>
@@ -257,8 +258,15 @@ public:
     auto I = StubIndexes.find(Name);
     assert(I != StubIndexes.end() && "No stub pointer for symbol");
     auto Key = I->second.first;
-    *IndirectStubsInfos[Key.first].getPtr(Key.second) =
-        reinterpret_cast<void *>(static_cast<uintptr_t>(NewAddr));
+    // The stub may be running on another thread, e.g. if the body was
+    // compiled in the background. Publish the pointer with a release store
+    // so that a thread that jumps through it sees the finished body.
+    static_assert(sizeof(std::atomic<void *>) == sizeof(void *),
+                  "Stub pointers can't be updated atomically");
+    reinterpret_cast<std::atomic<void *> *>(
+        IndirectStubsInfos[Key.first].getPtr(Key.second))
+        ->store(reinterpret_cast<void *>(static_cast<uintptr_t>(NewAddr)),
+                std::memory_order_release);
     return Error::success();
   }
 
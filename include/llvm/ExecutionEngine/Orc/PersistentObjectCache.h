@@ -0,0 +1,88 @@
+//===- PersistentObjectCache.h - On-disk object cache for ORC ---*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// An ObjectCache that keeps compiled objects in a directory, so that they
+// survive restarts of the JIT.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_ORC_PERSISTENTOBJECTCACHE_H
+#define LLVM_EXECUTIONENGINE_ORC_PERSISTENTOBJECTCACHE_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/Support/CachePruning.h"
+#include "llvm/Support/Error.h"
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace llvm {
+
+class TargetMachine;
+
+namespace orc {
+
+/// An ObjectCache that stores objects in a directory on disk.
+///
+///   Entries are keyed by a hash of the module's bitcode together with the
+/// target triple, CPU, features, optimization level and TargetOptions of the
+/// TargetMachine the cache was created for, so a cache directory can be shared
+/// by JITs with different configurations. Cached objects are memory-mapped
+/// when they're loaded, and entries that were cut short are ignored. The
+/// directory is pruned with the given CachePruningPolicy when the cache is
+/// created, and again after stores once the policy's interval has passed.
+///
+///   The cache is thread-safe, so it can be used with ConcurrentIRCompiler.
+class PersistentObjectCache : public ObjectCache {
+public:
+  /// Create a cache in CacheDir, creating the directory if needed, for objects
+  /// compiled by TM or by TargetMachines configured the same way.
+  static Expected<std::unique_ptr<PersistentObjectCache>>
+  Create(StringRef CacheDir, const TargetMachine &TM,
+         CachePruningPolicy Policy = CachePruningPolicy());
+
+  /// Store the object compiled for M.
+  void notifyObjectCompiled(const Module *M, MemoryBufferRef Obj) override;
+
+  /// Return the cached object for M, or null if there's none.
+  std::unique_ptr<MemoryBuffer> getObject(const Module *M) override;
+
+  /// Return the number of objects that have been found in the cache.
+  unsigned getNumHits() const { return NumHits; }
+
+  /// Return the number of objects that have been added to the cache.
+  unsigned getNumStores() const { return NumStores; }
+
+private:
+  PersistentObjectCache(std::string CacheDir, std::string TargetKey,
+                        CachePruningPolicy Policy);
+
+  std::string getKey(const Module &M) const;
+  std::string getEntryPath(StringRef Key) const;
+  void pruneIfDue();
+
+  std::mutex CacheMutex;
+  std::string CacheDir;
+  std::string TargetKey;
+  CachePruningPolicy Policy;
+  std::chrono::steady_clock::time_point NextPrune;
+  // Codegen may change a module before it's passed back to
+  // notifyObjectCompiled, so remember the key each module was looked up with.
+  DenseMap<const Module *, std::string> PendingKeys;
+  unsigned NumHits = 0;
+  unsigned NumStores = 0;
+};
+
+} // end namespace orc
+} // end namespace llvm
+
+#endif // LLVM_EXECUTIONENGINE_ORC_PERSISTENTOBJECTCACHE_H
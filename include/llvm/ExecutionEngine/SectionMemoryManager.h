@@ -38,6 +38,10 @@ namespace llvm {
 /// in the JITed object.  Permissions can be applied either by calling
 /// MCJIT::finalizeObject or by calling SectionMemoryManager::finalizeMemory
 /// directly.  Clients of MCJIT should call MCJIT::finalizeObject.
+///
+/// By default memory is requested from the system as each section needs it.
+/// Long-running JITs can instead have it reserved in large slabs, which keeps
+/// the number of mappings down and the code close together.
 class SectionMemoryManager : public RTDyldMemoryManager {
 public:
   /// This enum describes the various reasons to allocate pages from
@@ -103,10 +107,38 @@ public:
     virtual ~MemoryMapper();
   };
 
+  /// Statistics about the memory held by a SectionMemoryManager.
+  struct MemoryStats {
+    /// The number of blocks requested from the MemoryMapper.
+    unsigned NumMappings = 0;
+    /// The total size of those blocks.
+    size_t MappedBytes = 0;
+    /// The number of bytes handed out for sections.
+    size_t AllocatedBytes = 0;
+    /// The number of bytes still available for new sections.
+    size_t FreeBytes = 0;
+    /// The number of times permissions were changed by finalizeMemory.
+    unsigned NumProtectCalls = 0;
+
+    /// Return the number of mapped bytes that can't be used, because they were
+    /// skipped to align sections or to apply permissions to whole pages.
+    size_t getWastedBytes() const {
+      return MappedBytes - AllocatedBytes - FreeBytes;
+    }
+  };
+
   /// Creates a SectionMemoryManager instance with \p MM as the associated
   /// memory mapper.  If \p MM is nullptr then a default memory mapper is used
   /// that directly calls into the operating system.
-  SectionMemoryManager(MemoryMapper *MM = nullptr);
+  ///
+  /// If \p SlabSize is nonzero, memory is requested from the mapper at least
+  /// \p SlabSize bytes at a time, and sections of the same kind are carved out
+  /// of these slabs until they're used up.  If \p UseHugePages is true, the
+  /// memory is requested with sys::Memory::MF_HUGE_HINT, and every request is
+  /// rounded up to a multiple of sys::Memory::HugePageSize, since smaller
+  /// blocks can't be backed by huge pages.
+  SectionMemoryManager(MemoryMapper *MM = nullptr, size_t SlabSize = 0,
+                       bool UseHugePages = false);
   SectionMemoryManager(const SectionMemoryManager &) = delete;
   void operator=(const SectionMemoryManager &) = delete;
   ~SectionMemoryManager() override;
@@ -151,6 +183,9 @@ public:
   /// This method is called from finalizeMemory.
   virtual void invalidateInstructionCache();
 
+  /// Return statistics about the memory mapped so far and how it's used.
+  MemoryStats getMemoryStats() const;
+
 private:
   struct FreeMemBlock {
     // The actual block of free memory
@@ -188,6 +223,10 @@ private:
   MemoryGroup RWDataMem;
   MemoryGroup RODataMem;
   MemoryMapper &MMapper;
+  size_t SlabSize;
+  bool UseHugePages;
+  size_t AllocatedBytes = 0;
+  unsigned NumProtectCalls = 0;
 };
 
 } // end namespace llvm
@@ -51,6 +51,9 @@ public:
   bool MCUseDwarfDirectory : 1;
   bool MCIncrementalLinkerCompatible : 1;
   bool MCPIECopyRelocations : 1;
+  /// Write wasm objects as final, non-relocatable modules: relocated LEBs at
+  /// their minimal width and no linking or reloc.* sections.
+  bool MCWasmCompactObject : 1;
   bool ShowMCEncoding : 1;
   bool ShowMCInst : 1;
   bool AsmVerbose : 1;
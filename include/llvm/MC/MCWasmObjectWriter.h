@@ -21,9 +21,10 @@ class raw_pwrite_stream;
 
 class MCWasmObjectTargetWriter : public MCObjectTargetWriter {
   const unsigned Is64Bit : 1;
+  const unsigned IsCompact : 1;
 
 protected:
-  explicit MCWasmObjectTargetWriter(bool Is64Bit_);
+  explicit MCWasmObjectTargetWriter(bool Is64Bit_, bool IsCompact_ = false);
 
 public:
   virtual ~MCWasmObjectTargetWriter();
@@ -39,6 +40,9 @@ public:
   /// \name Accessors
   /// @{
   bool is64Bit() const { return Is64Bit; }
+  /// Whether to write a final module, with every relocation resolved in place
+  /// at its minimal width and no linking or reloc.* sections.
+  bool isCompact() const { return IsCompact; }
   /// @}
 };
 
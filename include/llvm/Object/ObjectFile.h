@@ -332,7 +332,7 @@ public:
                         uint32_t UniversalIndex = 0);
 
   static Expected<std::unique_ptr<WasmObjectFile>>
-  createWasmObjectFile(MemoryBufferRef Object);
+  createWasmObjectFile(MemoryBufferRef Object, bool Lazy = false);
 };
 
 // Inline function definitions.
@@ -18,6 +18,7 @@
 #define LLVM_OBJECT_WASM_H
 
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/Optional.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/BinaryFormat/Wasm.h"
@@ -25,6 +26,7 @@
 #include "llvm/Object/Binary.h"
 #include "llvm/Object/ObjectFile.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include <cstddef>
 #include <cstdint>
@@ -110,10 +112,37 @@ struct WasmSegment {
   wasm::WasmDataSegment Data;
 };
 
+/// One of the Snax name tables (.imports, .snax_actions, .snax_notify).
+/// Lookups binary search the entries, which the WebAssembly backend writes in
+/// sorted order.  For tables from other producers a sorted index is built
+/// when the section is parsed, so lookups never modify the table.
+class WasmSnaxTable {
+public:
+  ArrayRef<StringRef> entries() const { return Entries; }
+
+  /// Returns the position of \p Name in entries(), if it is present.
+  Optional<uint32_t> find(StringRef Name) const;
+  bool contains(StringRef Name) const { return find(Name).hasValue(); }
+
+private:
+  friend class WasmObjectFile;
+
+  void buildIndex();
+
+  std::vector<StringRef> Entries;
+  // Positions of Entries in name order; empty if Entries is sorted.
+  std::vector<uint32_t> Index;
+};
+
 class WasmObjectFile : public ObjectFile {
 
 public:
-  WasmObjectFile(MemoryBufferRef Object, Error &Err);
+  /// In lazy mode the constructor only indexes the section headers, which is
+  /// all that section iteration needs.  The bodies stay in \p Object, which
+  /// may be a memory-mapped file, until parseModuleSections() or
+  /// parseAllSections() decodes them.  Reading anything they decode before
+  /// that is a fatal error.
+  WasmObjectFile(MemoryBufferRef Object, Error &Err, bool Lazy = false);
 
   const wasm::WasmObjectHeader &getHeader() const;
   const WasmSymbol &getWasmSymbol(const DataRefImpl &Symb) const;
@@ -123,27 +152,112 @@ public:
 
   static bool classof(const Binary *v) { return v->isWasm(); }
 
-  ArrayRef<wasm::WasmSignature> types() const { return Signatures; }
-  ArrayRef<uint32_t> functionTypes() const { return FunctionTypes; }
-  ArrayRef<wasm::WasmImport> imports() const { return Imports; }
-  ArrayRef<wasm::WasmTable> tables() const { return Tables; }
-  ArrayRef<wasm::WasmLimits> memories() const { return Memories; }
-  ArrayRef<wasm::WasmGlobal> globals() const { return Globals; }
-  ArrayRef<wasm::WasmExport> exports() const { return Exports; }
-  ArrayRef<WasmSymbol> syms() const { return Symbols; }
-  const wasm::WasmLinkingData& linkingData() const { return LinkingData; }
-  uint32_t getNumberOfSymbols() const { return Symbols.size(); }
-  ArrayRef<wasm::WasmElemSegment> elements() const { return ElemSegments; }
-  ArrayRef<WasmSegment> dataSegments() const { return DataSegments; }
-  ArrayRef<wasm::WasmFunction> functions() const { return Functions; }
-  ArrayRef<wasm::WasmFunctionName> debugNames() const { return DebugNames; }
-  ArrayRef<StringRef> allowed_imports() const { return AllowedImports; }
-  ArrayRef<StringRef> actions() const { return Actions; }
-  ArrayRef<StringRef> notify() const { return Notify; }
-  StringRef get_snax_abi() const { return snax_abi; }
-  uint32_t startFunction() const { return StartFunction; }
-  uint32_t getNumImportedGlobals() const { return NumImportedGlobals; }
-  uint32_t getNumImportedFunctions() const { return NumImportedFunctions; }
+  ArrayRef<wasm::WasmSignature> types() const {
+    requireModuleSections();
+    return Signatures;
+  }
+  ArrayRef<uint32_t> functionTypes() const {
+    requireModuleSections();
+    return FunctionTypes;
+  }
+  ArrayRef<wasm::WasmImport> imports() const {
+    requireModuleSections();
+    return Imports;
+  }
+  ArrayRef<wasm::WasmTable> tables() const {
+    requireModuleSections();
+    return Tables;
+  }
+  ArrayRef<wasm::WasmLimits> memories() const {
+    requireModuleSections();
+    return Memories;
+  }
+  ArrayRef<wasm::WasmGlobal> globals() const {
+    requireModuleSections();
+    return Globals;
+  }
+  ArrayRef<wasm::WasmExport> exports() const {
+    requireModuleSections();
+    return Exports;
+  }
+  ArrayRef<WasmSymbol> syms() const {
+    requireAllSections();
+    return Symbols;
+  }
+  const wasm::WasmLinkingData& linkingData() const {
+    requireAllSections();
+    return LinkingData;
+  }
+  uint32_t getNumberOfSymbols() const {
+    requireAllSections();
+    return Symbols.size();
+  }
+  ArrayRef<wasm::WasmElemSegment> elements() const {
+    requireModuleSections();
+    return ElemSegments;
+  }
+  ArrayRef<WasmSegment> dataSegments() const {
+    requireAllSections();
+    return DataSegments;
+  }
+  ArrayRef<wasm::WasmFunction> functions() const {
+    requireAllSections();
+    return Functions;
+  }
+  ArrayRef<wasm::WasmFunctionName> debugNames() const {
+    requireAllSections();
+    return DebugNames;
+  }
+  ArrayRef<StringRef> allowed_imports() const {
+    requireModuleSections();
+    return AllowedImports.entries();
+  }
+  ArrayRef<StringRef> actions() const {
+    requireModuleSections();
+    return Actions.entries();
+  }
+  ArrayRef<StringRef> notify() const {
+    requireModuleSections();
+    return Notify.entries();
+  }
+  bool isAllowedImport(StringRef Name) const {
+    requireModuleSections();
+    return AllowedImports.contains(Name);
+  }
+  Optional<uint32_t> findAction(StringRef Name) const {
+    requireModuleSections();
+    return Actions.find(Name);
+  }
+  Optional<uint32_t> findNotify(StringRef Name) const {
+    requireModuleSections();
+    return Notify.find(Name);
+  }
+  StringRef get_snax_abi() const {
+    requireModuleSections();
+    return snax_abi;
+  }
+  uint32_t startFunction() const {
+    requireModuleSections();
+    return StartFunction;
+  }
+  uint32_t getNumImportedGlobals() const {
+    requireModuleSections();
+    return NumImportedGlobals;
+  }
+  uint32_t getNumImportedFunctions() const {
+    requireModuleSections();
+    return NumImportedFunctions;
+  }
+
+  /// Decodes the module-level sections of a lazily constructed object:
+  /// types, imports, exports, the Snax tables and everything else that
+  /// doesn't describe the code or data.  Does nothing if they are decoded
+  /// already.
+  Error parseModuleSections();
+  /// Decodes all the remaining sections.  Functions, data segments, symbols
+  /// and relocations need this: the linking section refers into the code and
+  /// data, so even the symbol table takes a full decode.
+  Error parseAllSections();
 
   void moveSymbolNext(DataRefImpl &Symb) const override;
 
@@ -219,7 +333,18 @@ private:
   const wasm::WasmRelocation &getWasmRelocation(DataRefImpl Ref) const;
 
   const uint8_t *getPtr(size_t Offset) const;
-  Error parseSection(WasmSection &Sec);
+  // Reading a table that hasn't been decoded would quietly give empty
+  // results, so it's fatal in every build.
+  void requireModuleSections() const {
+    if (!ModuleParsed)
+      report_fatal_error("module sections of a lazy wasm object not decoded");
+  }
+  void requireAllSections() const {
+    if (!AllParsed)
+      report_fatal_error("sections of a lazy wasm object not decoded");
+  }
+  Error parseSections(bool All);
+  Error parseSection(uint32_t Index);
   Error parseCustomSection(WasmSection &Sec, ReadContext &Ctx);
 
   // Standard section types
@@ -237,9 +362,8 @@ private:
 
   // Custom section types
   Error parseNameSection(ReadContext &Ctx);
-  Error parseAllowedSection(ReadContext &Ctx);
-  Error parseActionsSection(ReadContext &Ctx);
-  Error parseNotifySection(ReadContext &Ctx);
+  Error parseSnaxTable(ReadContext &Ctx, WasmSnaxTable &Table,
+                       StringRef SectionName);
   Error parseLinkingSection(ReadContext &Ctx);
   Error parseLinkingSectionSymtab(ReadContext &Ctx);
   Error parseLinkingSectionComdat(ReadContext &Ctx);
@@ -254,9 +378,9 @@ private:
   std::vector<wasm::WasmLimits> Memories;
   std::vector<wasm::WasmGlobal> Globals;
   std::vector<wasm::WasmImport> Imports;
-  std::vector<StringRef> AllowedImports;
-  std::vector<StringRef> Actions;
-  std::vector<StringRef> Notify;
+  WasmSnaxTable AllowedImports;
+  WasmSnaxTable Actions;
+  WasmSnaxTable Notify;
   std::vector<wasm::WasmExport> Exports;
   std::vector<wasm::WasmElemSegment> ElemSegments;
   std::vector<WasmSegment> DataSegments;
@@ -272,6 +396,9 @@ private:
   uint32_t CodeSection = 0;
   uint32_t DataSection = 0;
   uint32_t GlobalSection = 0;
+  bool ModuleParsed = false;
+  bool AllParsed = false;
+  bool ParseFailed = false;
 };
 
 } // end namespace object
@@ -33,6 +33,8 @@ template <> struct DenseMapInfo<wasm::WasmSignature> {
     unsigned H = hash_value(Sig.ReturnType);
     for (int32_t Param : Sig.ParamTypes)
       H = hash_combine(H, Param);
+    for (int32_t Return : Sig.ExtraReturnTypes)
+      H = hash_combine(H, Return);
     return H;
   }
   static bool isEqual(const wasm::WasmSignature &LHS,
@@ -128,6 +128,7 @@ struct Signature {
   SignatureForm Form = wasm::WASM_TYPE_FUNC;
   std::vector<ValueType> ParamTypes;
   ValueType ReturnType;
+  std::vector<ValueType> ExtraReturnTypes;
 };
 
 struct SymbolInfo {
@@ -48,9 +48,19 @@ namespace sys {
     enum ProtectionFlags {
       MF_READ  = 0x1000000,
       MF_WRITE = 0x2000000,
-      MF_EXEC  = 0x4000000
+      MF_EXEC  = 0x4000000,
+      MF_RWE_MASK = 0x7000000,
+      /// Ask for the block to be backed by huge pages if the system supports
+      /// it. This is only a hint, and only allocateMappedMemory looks at it.
+      /// Only whole, aligned huge pages of the block can be backed by them, so
+      /// the hint has no effect on blocks smaller than HugePageSize. Larger
+      /// blocks are aligned to HugePageSize where the hint is supported.
+      MF_HUGE_HINT = 0x0000001
     };
 
+    /// The size, and alignment, of the huge pages MF_HUGE_HINT asks for.
+    enum : size_t { HugePageSize = 2 * 1024 * 1024 };
+
     /// This method allocates a block of memory that is suitable for loading
     /// dynamically generated code (e.g. JIT). An attempt to allocate
     /// \p NumBytes bytes of virtual memory is made.
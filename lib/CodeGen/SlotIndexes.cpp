@@ -12,6 +12,7 @@
 #include "llvm/CodeGen/MachineFunction.h"
 #include "llvm/Config/llvm-config.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Support/raw_ostream.h"
 
 using namespace llvm;
@@ -161,21 +162,61 @@ void SlotIndexes::renumberIndexes() {
 
 // Renumber indexes locally after curItr was inserted, but failed to get a new
 // index.
+//
+// This looks for the smallest range of entries around curItr that is sparse
+// enough, doubling it each time it isn't, and spreads the range's entries
+// evenly over the indexes it spans. Larger ranges have to be sparser, so that
+// after a range has been spread each half of it has room for a proportional
+// number of insertions before it needs renumbering again. This keeps the
+// amortized cost of an insertion logarithmic, even when a pass inserts many
+// instructions at the same point; renumbering everything up to the next large
+// gap would make that quadratic.
 void SlotIndexes::renumberIndexes(IndexList::iterator curItr) {
-  // Number indexes with half the default spacing so we can catch up quickly.
-  const unsigned Space = SlotIndex::InstrDist/2;
-  static_assert((Space & 3) == 0, "InstrDist must be a multiple of 2*NUM");
-
-  IndexList::iterator startItr = std::prev(curItr);
-  unsigned index = startItr->getIndex();
-  do {
-    curItr->setIndex(index += Space);
-    ++curItr;
-    // If the next index is bigger, we have caught up.
-  } while (curItr != indexList.end() && curItr->getIndex() <= index);
-
-  LLVM_DEBUG(dbgs() << "\n*** Renumbered SlotIndexes " << startItr->getIndex()
-                    << '-' << index << " ***\n");
+  // A range of 2^Level entries needs Slot_Count + Level between entries on
+  // average, which is InstrDist for ranges of a few thousand entries.
+  auto spacing = [](unsigned Level) -> uint64_t {
+    return SlotIndex::Slot_Count + Level;
+  };
+
+  // The range is [startItr, endItr), bounded by the entries on either side.
+  IndexList::iterator startItr = curItr, endItr = std::next(curItr);
+  uint64_t numEntries = 1;
+  unsigned level = 0;
+  while (endItr != indexList.end()) {
+    uint64_t span = endItr->getIndex() - std::prev(startItr)->getIndex();
+    if (span >= (numEntries + 1) * spacing(level))
+      break;
+    // Grow the range by half its size in each direction, or by all of it in
+    // the one direction left.
+    uint64_t back = (numEntries + 1) / 2, forward = numEntries - back;
+    for (; back && std::prev(startItr) != indexList.begin(); --back) {
+      --startItr;
+      ++numEntries;
+    }
+    for (forward += back; forward && endItr != indexList.end(); --forward) {
+      ++endItr;
+      ++numEntries;
+    }
+    ++level;
+  }
+
+  uint64_t base = std::prev(startItr)->getIndex();
+  if (endItr == indexList.end()) {
+    // Nothing bounds the range from above.
+    uint64_t step = alignTo(spacing(level), SlotIndex::Slot_Count);
+    for (IndexList::iterator I = startItr; I != endItr; ++I)
+      I->setIndex(base += step);
+  } else {
+    uint64_t span = endItr->getIndex() - base;
+    uint64_t n = 0;
+    for (IndexList::iterator I = startItr; I != endItr; ++I)
+      I->setIndex(alignDown(base + span * ++n / (numEntries + 1),
+                            SlotIndex::Slot_Count));
+  }
+
+  LLVM_DEBUG(dbgs() << "\n*** Renumbered SlotIndexes "
+                    << std::prev(startItr)->getIndex() << '-'
+                    << std::prev(endItr)->getIndex() << " ***\n");
   ++NumLocalRenum;
 }
 
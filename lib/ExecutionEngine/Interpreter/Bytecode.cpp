@@ -0,0 +1,950 @@
+//===-- Bytecode.cpp - Decode functions into bytecode and run them --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file decodes functions into the register bytecode defined in
+//  Bytecode.h, and contains the dispatch loop that runs it.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Interpreter.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/GetElementPtrTypeIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Intrinsics.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/MathExtras.h"
+#include <cmath>
+#include <cstring>
+using namespace llvm;
+
+#define DEBUG_TYPE "interpreter"
+
+STATISTIC(NumBytecodeInsts, "Number of bytecode instructions executed");
+
+static cl::opt<bool> UseBytecode("interpreter-bytecode", cl::Hidden,
+    cl::init(true),
+    cl::desc("Decode functions into bytecode the first time they're called"));
+
+extern cl::opt<bool> PrintVolatile;
+
+static uint64_t maskTo(unsigned Width) { return ~0ULL >> (64 - Width); }
+
+//===----------------------------------------------------------------------===//
+//                              Decoding
+//===----------------------------------------------------------------------===//
+
+namespace {
+
+class Decoder {
+  BytecodeFunction &BF;
+  const DataLayout &DL;
+  function_ref<RawValue(Constant *)> GetConstant;
+
+  DenseMap<const Value *, unsigned> Regs;
+  DenseMap<const BasicBlock *, unsigned> BlockStart;
+  std::vector<const BasicBlock *> EdgeTargets;
+  bool Failed = false;
+
+public:
+  Decoder(BytecodeFunction &BF, const DataLayout &DL,
+          function_ref<RawValue(Constant *)> GetConstant)
+      : BF(BF), DL(DL), GetConstant(GetConstant) {}
+
+  bool decode(Function &F);
+
+private:
+  // isRawType - Whether values of type Ty fit in a register.
+  bool isRawType(Type *Ty) const {
+    if (Ty->isIntegerTy())
+      return Ty->getIntegerBitWidth() <= 64;
+    if (Ty->isPointerTy())
+      return DL.getPointerTypeSizeInBits(Ty) == sizeof(void *) * 8;
+    return Ty->isFloatTy() || Ty->isDoubleTy();
+  }
+
+  unsigned reg(Value *V);
+  unsigned edge(BasicBlock *From, BasicBlock *To);
+  BytecodeInst &emit(BytecodeOp Op, unsigned Dst, unsigned A = 0,
+                     unsigned B = 0, unsigned C = 0, uint64_t Imm = 0);
+  void decode(Instruction &I, unsigned Dst);
+  void decodeCast(CastInst &I, unsigned Dst);
+  void decodeGEP(GetElementPtrInst &I, unsigned Dst);
+  void decodeCall(CallInst &I, unsigned Dst);
+};
+
+} // end anonymous namespace
+
+// reg - The register holding V. Constants get a register the first time
+// they're used.
+unsigned Decoder::reg(Value *V) {
+  auto It = Regs.find(V);
+  if (It != Regs.end())
+    return It->second;
+
+  Constant *C = dyn_cast<Constant>(V);
+  if (!C || !isRawType(C->getType())) {
+    Failed = true;
+    return 0;
+  }
+  unsigned Reg = BF.NumValues + BF.Constants.size();
+  Regs[V] = Reg;
+  BF.Constants.push_back(GetConstant(C));
+  return Reg;
+}
+
+// edge - Add the edge from From to To, with the moves for To's PHI nodes.
+unsigned Decoder::edge(BasicBlock *From, BasicBlock *To) {
+  BytecodeFunction::Edge E;
+  E.Target = 0;
+  E.FirstMove = BF.Moves.size();
+  E.Parallel = false;
+  for (PHINode &PN : To->phis()) {
+    unsigned Src = reg(PN.getIncomingValueForBlock(From));
+    for (unsigned i = E.FirstMove, e = BF.Moves.size(); i != e; ++i)
+      if (BF.Moves[i].Dst == Src)
+        E.Parallel = true;
+    BF.Moves.push_back({reg(&PN), Src});
+  }
+  E.NumMoves = BF.Moves.size() - E.FirstMove;
+  BF.Edges.push_back(E);
+  EdgeTargets.push_back(To);
+  return BF.Edges.size() - 1;
+}
+
+BytecodeInst &Decoder::emit(BytecodeOp Op, unsigned Dst, unsigned A,
+                            unsigned B, unsigned C, uint64_t Imm) {
+  BF.Code.push_back({Op, 0, Dst, A, B, C, Imm});
+  return BF.Code.back();
+}
+
+bool Decoder::decode(Function &F) {
+  BF.RetTy = F.getReturnType();
+  if (!BF.RetTy->isVoidTy() && !isRawType(BF.RetTy))
+    return false;
+
+  // Number the arguments and the instructions before decoding anything, as
+  // values can be used above their definition.
+  for (Argument &A : F.args()) {
+    if (!isRawType(A.getType()))
+      return false;
+    Regs[&A] = BF.NumValues++;
+  }
+  for (BasicBlock &BB : F)
+    for (Instruction &I : BB)
+      if (!I.getType()->isVoidTy()) {
+        if (!isRawType(I.getType()))
+          return false;
+        Regs[&I] = BF.NumValues++;
+      }
+
+  // PHI nodes are run by the edges into their block.
+  for (BasicBlock &BB : F) {
+    BlockStart[&BB] = BF.Code.size();
+    for (Instruction &I : BB) {
+      if (isa<PHINode>(I))
+        continue;
+      decode(I, I.getType()->isVoidTy() ? BytecodeFunction::NoReg
+                                        : Regs.lookup(&I));
+      if (Failed)
+        return false;
+    }
+  }
+
+  for (unsigned i = 0, e = BF.Edges.size(); i != e; ++i)
+    BF.Edges[i].Target = BlockStart.lookup(EdgeTargets[i]);
+  BF.NumRegs = BF.NumValues + BF.Constants.size();
+  return true;
+}
+
+void Decoder::decode(Instruction &I, unsigned Dst) {
+  BasicBlock *BB = I.getParent();
+  switch (I.getOpcode()) {
+  default:
+    Failed = true;
+    return;
+
+  case Instruction::Add:
+  case Instruction::Sub:
+  case Instruction::Mul:
+  case Instruction::UDiv:
+  case Instruction::SDiv:
+  case Instruction::URem:
+  case Instruction::SRem:
+  case Instruction::And:
+  case Instruction::Or:
+  case Instruction::Xor:
+  case Instruction::Shl:
+  case Instruction::LShr:
+  case Instruction::AShr: {
+    BytecodeOp Op;
+    switch (I.getOpcode()) {
+    default: llvm_unreachable("Not an integer operator!");
+    case Instruction::Add:  Op = BC_Add; break;
+    case Instruction::Sub:  Op = BC_Sub; break;
+    case Instruction::Mul:  Op = BC_Mul; break;
+    case Instruction::UDiv: Op = BC_UDiv; break;
+    case Instruction::SDiv: Op = BC_SDiv; break;
+    case Instruction::URem: Op = BC_URem; break;
+    case Instruction::SRem: Op = BC_SRem; break;
+    case Instruction::And:  Op = BC_And; break;
+    case Instruction::Or:   Op = BC_Or; break;
+    case Instruction::Xor:  Op = BC_Xor; break;
+    case Instruction::Shl:  Op = BC_Shl; break;
+    case Instruction::LShr: Op = BC_LShr; break;
+    case Instruction::AShr: Op = BC_AShr; break;
+    }
+    unsigned Width = I.getType()->getIntegerBitWidth();
+    // Shift amounts of at least the width wrap like they do in visitShl.
+    BytecodeInst &BI = emit(Op, Dst, reg(I.getOperand(0)),
+                            reg(I.getOperand(1)), NextPowerOf2(Width - 1) - 1,
+                            maskTo(Width));
+    BI.Bits = 64 - Width;
+    return;
+  }
+
+  case Instruction::FAdd:
+  case Instruction::FSub:
+  case Instruction::FMul:
+  case Instruction::FDiv:
+  case Instruction::FRem: {
+    bool IsDouble = I.getType()->isDoubleTy();
+    BytecodeOp Op;
+    switch (I.getOpcode()) {
+    default: llvm_unreachable("Not a floating point operator!");
+    case Instruction::FAdd: Op = IsDouble ? BC_FAddD : BC_FAddF; break;
+    case Instruction::FSub: Op = IsDouble ? BC_FSubD : BC_FSubF; break;
+    case Instruction::FMul: Op = IsDouble ? BC_FMulD : BC_FMulF; break;
+    case Instruction::FDiv: Op = IsDouble ? BC_FDivD : BC_FDivF; break;
+    case Instruction::FRem: Op = IsDouble ? BC_FRemD : BC_FRemF; break;
+    }
+    emit(Op, Dst, reg(I.getOperand(0)), reg(I.getOperand(1)));
+    return;
+  }
+
+  case Instruction::ICmp: {
+    ICmpInst &CI = cast<ICmpInst>(I);
+    Type *Ty = CI.getOperand(0)->getType();
+    // Pointers compare as unsigned whatever the predicate, as they do in
+    // executeICMP_SLT and friends.
+    ICmpInst::Predicate Pred = CI.getPredicate();
+    if (Ty->isPointerTy())
+      Pred = CI.getUnsignedPredicate();
+    BytecodeOp Op;
+    switch (Pred) {
+    default: llvm_unreachable("Invalid icmp predicate!");
+    case ICmpInst::ICMP_EQ:  Op = BC_ICmpEQ; break;
+    case ICmpInst::ICMP_NE:  Op = BC_ICmpNE; break;
+    case ICmpInst::ICMP_ULT: Op = BC_ICmpULT; break;
+    case ICmpInst::ICMP_ULE: Op = BC_ICmpULE; break;
+    case ICmpInst::ICMP_UGT: Op = BC_ICmpUGT; break;
+    case ICmpInst::ICMP_UGE: Op = BC_ICmpUGE; break;
+    case ICmpInst::ICMP_SLT: Op = BC_ICmpSLT; break;
+    case ICmpInst::ICMP_SLE: Op = BC_ICmpSLE; break;
+    case ICmpInst::ICMP_SGT: Op = BC_ICmpSGT; break;
+    case ICmpInst::ICMP_SGE: Op = BC_ICmpSGE; break;
+    }
+    BytecodeInst &BI =
+        emit(Op, Dst, reg(CI.getOperand(0)), reg(CI.getOperand(1)));
+    if (Ty->isIntegerTy())
+      BI.Bits = 64 - Ty->getIntegerBitWidth();
+    return;
+  }
+
+  case Instruction::FCmp: {
+    FCmpInst &CI = cast<FCmpInst>(I);
+    BytecodeOp Op =
+        CI.getOperand(0)->getType()->isDoubleTy() ? BC_FCmpD : BC_FCmpF;
+    BytecodeInst &BI =
+        emit(Op, Dst, reg(CI.getOperand(0)), reg(CI.getOperand(1)));
+    BI.Bits = CI.getPredicate();
+    return;
+  }
+
+  case Instruction::Select:
+    emit(BC_Select, Dst, reg(I.getOperand(0)), reg(I.getOperand(1)),
+         reg(I.getOperand(2)));
+    return;
+
+  case Instruction::Trunc:
+  case Instruction::ZExt:
+  case Instruction::SExt:
+  case Instruction::FPTrunc:
+  case Instruction::FPExt:
+  case Instruction::UIToFP:
+  case Instruction::SIToFP:
+  case Instruction::FPToUI:
+  case Instruction::FPToSI:
+  case Instruction::PtrToInt:
+  case Instruction::IntToPtr:
+  case Instruction::BitCast:
+    decodeCast(cast<CastInst>(I), Dst);
+    return;
+
+  case Instruction::Alloca: {
+    AllocaInst &AI = cast<AllocaInst>(I);
+    unsigned TypeSize = DL.getTypeAllocSize(AI.getAllocatedType());
+    unsigned Align = std::max<unsigned>(AI.getAlignment(), alignof(long double));
+    if (ConstantInt *Size = dyn_cast<ConstantInt>(AI.getArraySize())) {
+      unsigned NumElements = Size->getZExtValue();
+      emit(BC_Alloca, Dst, 0, 0, Align,
+           std::max(1U, NumElements * TypeSize));
+    } else {
+      emit(BC_AllocaN, Dst, reg(AI.getArraySize()), 0, Align, TypeSize);
+    }
+    return;
+  }
+
+  case Instruction::Load:
+  case Instruction::Store: {
+    bool IsLoad = isa<LoadInst>(I);
+    Type *Ty = IsLoad ? I.getType() : I.getOperand(0)->getType();
+    if (!isRawType(Ty)) {
+      Failed = true;
+      return;
+    }
+    unsigned Bytes = DL.getTypeStoreSize(Ty);
+    unsigned Kind;
+    switch (Bytes) {
+    case 1: Kind = 0; break;
+    case 2: Kind = 1; break;
+    case 4: Kind = 2; break;
+    case 8: Kind = 3; break;
+    default: Kind = 4; break;
+    }
+    if (IsLoad) {
+      static const BytecodeOp Ops[] = {BC_Load8, BC_Load16, BC_Load32,
+                                       BC_Load64, BC_LoadN};
+      uint64_t Mask = Ty->isIntegerTy() ? maskTo(Ty->getIntegerBitWidth())
+                                        : maskTo(Bytes * 8);
+      emit(Ops[Kind], Dst, reg(I.getOperand(0)), Bytes, 0, Mask);
+    } else {
+      static const BytecodeOp Ops[] = {BC_Store8, BC_Store16, BC_Store32,
+                                       BC_Store64, BC_StoreN};
+      emit(Ops[Kind], Dst, reg(I.getOperand(0)), reg(I.getOperand(1)), Bytes);
+    }
+    bool Volatile = IsLoad ? cast<LoadInst>(I).isVolatile()
+                           : cast<StoreInst>(I).isVolatile();
+    if (Volatile) {
+      BF.Volatiles.push_back(&I);
+      emit(BC_Volatile, BytecodeFunction::NoReg, 0, BF.Volatiles.size() - 1);
+    }
+    return;
+  }
+
+  case Instruction::GetElementPtr:
+    decodeGEP(cast<GetElementPtrInst>(I), Dst);
+    return;
+
+  case Instruction::Br: {
+    BranchInst &BI = cast<BranchInst>(I);
+    if (BI.isUnconditional()) {
+      emit(BC_Br, Dst, edge(BB, BI.getSuccessor(0)));
+    } else {
+      unsigned Cond = reg(BI.getCondition());
+      unsigned True = edge(BB, BI.getSuccessor(0));
+      unsigned False = edge(BB, BI.getSuccessor(1));
+      emit(BC_CondBr, Dst, Cond, True, False);
+    }
+    return;
+  }
+
+  case Instruction::Switch: {
+    SwitchInst &SI = cast<SwitchInst>(I);
+    unsigned Cond = reg(SI.getCondition());
+    BytecodeFunction::Switch S;
+    for (auto Case : SI.cases())
+      S.Cases.push_back({Case.getCaseValue()->getZExtValue(),
+                         edge(BB, Case.getCaseSuccessor())});
+    S.DefaultEdge = edge(BB, SI.getDefaultDest());
+    BF.Switches.push_back(std::move(S));
+    emit(BC_Switch, Dst, Cond, BF.Switches.size() - 1);
+    return;
+  }
+
+  case Instruction::Ret: {
+    ReturnInst &RI = cast<ReturnInst>(I);
+    if (Value *V = RI.getReturnValue())
+      emit(BC_Ret, Dst, reg(V));
+    else
+      emit(BC_RetVoid, Dst);
+    return;
+  }
+
+  case Instruction::Unreachable:
+    emit(BC_Unreachable, Dst);
+    return;
+
+  case Instruction::Call:
+    decodeCall(cast<CallInst>(I), Dst);
+    return;
+  }
+}
+
+void Decoder::decodeCast(CastInst &I, unsigned Dst) {
+  Type *SrcTy = I.getSrcTy();
+  Type *DstTy = I.getDestTy();
+  unsigned Src = reg(I.getOperand(0));
+  switch (I.getOpcode()) {
+  default:
+    llvm_unreachable("Unexpected cast!");
+  case Instruction::Trunc:
+    emit(BC_Trunc, Dst, Src, 0, 0, maskTo(DstTy->getIntegerBitWidth()));
+    return;
+  case Instruction::ZExt:
+  case Instruction::IntToPtr:
+    // Integers are kept zero-extended, and pointers are as wide as the
+    // biggest integer.
+    emit(BC_Copy, Dst, Src);
+    return;
+  case Instruction::SExt:
+    emit(BC_SExt, Dst, Src, 0, 0, maskTo(DstTy->getIntegerBitWidth())).Bits =
+        64 - SrcTy->getIntegerBitWidth();
+    return;
+  case Instruction::FPTrunc:
+    emit(BC_FPTrunc, Dst, Src);
+    return;
+  case Instruction::FPExt:
+    emit(BC_FPExt, Dst, Src);
+    return;
+  case Instruction::UIToFP:
+    emit(DstTy->isFloatTy() ? BC_UIToF : BC_UIToD, Dst, Src);
+    return;
+  case Instruction::SIToFP:
+    emit(DstTy->isFloatTy() ? BC_SIToF : BC_SIToD, Dst, Src).Bits =
+        64 - SrcTy->getIntegerBitWidth();
+    return;
+  case Instruction::FPToUI:
+  case Instruction::FPToSI: {
+    unsigned Width = DstTy->getIntegerBitWidth();
+    emit(SrcTy->isFloatTy() ? BC_FToI : BC_DToI, Dst, Src, 0, 0,
+         maskTo(Width)).Bits = Width;
+    return;
+  }
+  case Instruction::PtrToInt:
+    emit(BC_Trunc, Dst, Src, 0, 0, maskTo(DstTy->getIntegerBitWidth()));
+    return;
+  case Instruction::BitCast:
+    if (SrcTy->isFloatTy() && DstTy->isIntegerTy())
+      emit(BC_FToBits, Dst, Src);
+    else if (SrcTy->isIntegerTy() && DstTy->isFloatTy())
+      emit(BC_BitsToF, Dst, Src);
+    else
+      emit(BC_Copy, Dst, Src);
+    return;
+  }
+}
+
+void Decoder::decodeGEP(GetElementPtrInst &I, unsigned Dst) {
+  // Fold the constant indices into one offset, and scale the others one at a
+  // time into Dst.
+  unsigned Base = reg(I.getPointerOperand());
+  uint64_t Offset = 0;
+  for (gep_type_iterator GTI = gep_type_begin(I), E = gep_type_end(I);
+       GTI != E; ++GTI) {
+    Value *Idx = GTI.getOperand();
+    if (StructType *STy = GTI.getStructTypeOrNull()) {
+      unsigned Field = cast<ConstantInt>(Idx)->getZExtValue();
+      Offset += DL.getStructLayout(STy)->getElementOffset(Field);
+      continue;
+    }
+    if (!Idx->getType()->isIntegerTy() ||
+        Idx->getType()->getIntegerBitWidth() > 64) {
+      Failed = true;
+      return;
+    }
+    uint64_t Size = DL.getTypeAllocSize(GTI.getIndexedType());
+    if (ConstantInt *CI = dyn_cast<ConstantInt>(Idx)) {
+      Offset += Size * CI->getSExtValue();
+      continue;
+    }
+    emit(BC_GEPIndex, Dst, Base, reg(Idx), 0, Size).Bits =
+        64 - Idx->getType()->getIntegerBitWidth();
+    Base = Dst;
+  }
+  if (Offset || Base != Dst)
+    emit(BC_GEPOffset, Dst, Base, 0, 0, Offset);
+}
+
+void Decoder::decodeCall(CallInst &I, unsigned Dst) {
+  if (I.isInlineAsm()) {
+    Failed = true;
+    return;
+  }
+
+  // Intrinsics that need lowering are left to the IR interpreter, which
+  // lowers them the first time they run.
+  Function *Callee = I.getCalledFunction();
+  if (Callee && Callee->isIntrinsic()) {
+    switch (Callee->getIntrinsicID()) {
+    default:
+      Failed = true;
+      return;
+    case Intrinsic::dbg_declare:
+    case Intrinsic::dbg_value:
+    case Intrinsic::dbg_label:
+    case Intrinsic::lifetime_start:
+    case Intrinsic::lifetime_end:
+    case Intrinsic::assume:
+      return;
+    case Intrinsic::memcpy:
+    case Intrinsic::memmove:
+    case Intrinsic::memset: {
+      BytecodeOp Op = BC_Memset;
+      if (Callee->getIntrinsicID() == Intrinsic::memcpy)
+        Op = BC_Memcpy;
+      else if (Callee->getIntrinsicID() == Intrinsic::memmove)
+        Op = BC_Memmove;
+      emit(Op, Dst, reg(I.getArgOperand(0)), reg(I.getArgOperand(1)),
+           reg(I.getArgOperand(2)));
+      return;
+    }
+    }
+  }
+
+  BytecodeFunction::Call C;
+  C.CI = &I;
+  C.Callee = Callee;
+  C.CalleeReg = Callee ? BytecodeFunction::NoReg : reg(I.getCalledValue());
+  for (Value *Arg : I.arg_operands())
+    C.Args.push_back(reg(Arg));
+  BF.Calls.push_back(std::move(C));
+  emit(BC_Call, Dst, 0, BF.Calls.size() - 1);
+}
+
+std::unique_ptr<BytecodeFunction>
+BytecodeFunction::decode(Function &F, const DataLayout &DL,
+                         function_ref<RawValue(Constant *)> GetConstant) {
+  // Registers and memory are accessed in host byte order.
+  if (F.isDeclaration() || F.isVarArg() ||
+      DL.isLittleEndian() != sys::IsLittleEndianHost)
+    return nullptr;
+
+  auto BF = llvm::make_unique<BytecodeFunction>();
+  if (!Decoder(*BF, DL, GetConstant).decode(F))
+    return nullptr;
+  return BF;
+}
+
+//===----------------------------------------------------------------------===//
+//                              Execution
+//===----------------------------------------------------------------------===//
+
+static int64_t signExtend(uint64_t V, unsigned Bits) {
+  return int64_t(V << Bits) >> Bits;
+}
+
+static void *toPointer(RawValue R) {
+  return reinterpret_cast<void *>(uintptr_t(R.I));
+}
+
+template <typename T> static bool compareFP(unsigned Pred, T L, T R) {
+  bool Unordered = std::isnan(L) || std::isnan(R);
+  switch (Pred) {
+  default: llvm_unreachable("Invalid fcmp predicate!");
+  case FCmpInst::FCMP_FALSE: return false;
+  case FCmpInst::FCMP_OEQ:   return L == R;
+  case FCmpInst::FCMP_OGT:   return L > R;
+  case FCmpInst::FCMP_OGE:   return L >= R;
+  case FCmpInst::FCMP_OLT:   return L < R;
+  case FCmpInst::FCMP_OLE:   return L <= R;
+  case FCmpInst::FCMP_ONE:   return !Unordered && L != R;
+  case FCmpInst::FCMP_ORD:   return !Unordered;
+  case FCmpInst::FCMP_UNO:   return Unordered;
+  case FCmpInst::FCMP_UEQ:   return Unordered || L == R;
+  case FCmpInst::FCMP_UGT:   return Unordered || L > R;
+  case FCmpInst::FCMP_UGE:   return Unordered || L >= R;
+  case FCmpInst::FCMP_ULT:   return Unordered || L < R;
+  case FCmpInst::FCMP_ULE:   return Unordered || L <= R;
+  case FCmpInst::FCMP_UNE:   return L != R;
+  case FCmpInst::FCMP_TRUE:  return true;
+  }
+}
+
+// roundToInt - The integer D rounds to, as APIntOps::RoundDoubleToAPInt
+// computes it.
+static uint64_t roundToInt(double D, unsigned Width, uint64_t Mask) {
+  if (std::fabs(D) < 9223372036854775808.0)
+    return uint64_t(int64_t(D)) & Mask;
+  return APIntOps::RoundDoubleToAPInt(D, Width).getZExtValue();
+}
+
+// takeEdge - Make the PHI moves of edge E and return where it leads.
+static const BytecodeInst *takeEdge(const BytecodeFunction &BF, unsigned E,
+                                    RawValue *R) {
+  const BytecodeFunction::Edge &Edge = BF.Edges[E];
+  const BytecodeFunction::Move *Moves = BF.Moves.data() + Edge.FirstMove;
+  if (!Edge.Parallel) {
+    for (unsigned i = 0; i != Edge.NumMoves; ++i)
+      R[Moves[i].Dst] = R[Moves[i].Src];
+  } else {
+    SmallVector<RawValue, 8> Values;
+    for (unsigned i = 0; i != Edge.NumMoves; ++i)
+      Values.push_back(R[Moves[i].Src]);
+    for (unsigned i = 0; i != Edge.NumMoves; ++i)
+      R[Moves[i].Dst] = Values[i];
+  }
+  return BF.Code.data() + Edge.Target;
+}
+
+//===----------------------------------------------------------------------===//
+// getBytecode - Return the bytecode of F, decoding it if this is the first
+// call, or null if F has to be interpreted from its IR.
+//
+const BytecodeFunction *Interpreter::getBytecode(Function *F) {
+  if (!UseBytecode || F->isDeclaration())
+    return nullptr;
+  auto It = Bytecodes.find(F);
+  if (It != Bytecodes.end())
+    return It->second.get();
+
+  // Constants don't refer to the values of a frame.
+  ExecutionContext NoFrame;
+  std::unique_ptr<BytecodeFunction> Code = BytecodeFunction::decode(
+      *F, getDataLayout(), [&](Constant *C) {
+        return toRaw(getOperandValue(C, NoFrame), C->getType());
+      });
+  LLVM_DEBUG(dbgs() << (Code ? "Decoded " : "Interpreting the IR of ")
+                    << F->getName() << '\n');
+  return (Bytecodes[F] = std::move(Code)).get();
+}
+
+//===----------------------------------------------------------------------===//
+// enterBytecode - Make SF run Code from the start: give it registers and copy
+// in the constants. The caller fills in the arguments.
+//
+RawValue *Interpreter::enterBytecode(ExecutionContext &SF,
+                                     const BytecodeFunction &Code) {
+  SF.Code = &Code;
+  SF.PC = Code.Code.data();
+  SF.RegBase = RegTop;
+  RegTop += Code.NumRegs;
+  if (Registers.size() < RegTop)
+    Registers.resize(std::max<size_t>(RegTop, Registers.size() * 2));
+  RawValue *Regs = Registers.data() + SF.RegBase;
+  std::copy(Code.Constants.begin(), Code.Constants.end(),
+            Regs + Code.NumValues);
+  return Regs;
+}
+
+//===----------------------------------------------------------------------===//
+// setBytecodeCallResult - Store the result of a call made by the bytecode of
+// SF, which is waiting for it.
+//
+void Interpreter::setBytecodeCallResult(ExecutionContext &SF,
+                                        GenericValue Result) {
+  unsigned Dst = SF.PC[-1].Dst;
+  Registers[SF.RegBase + Dst] = toRaw(Result, SF.Caller.getType());
+}
+
+//===----------------------------------------------------------------------===//
+// runBytecode - Run the bytecode frame on top of the stack, and the bytecode
+// frames it calls or returns to, until the top frame isn't a bytecode one.
+//
+void Interpreter::runBytecode() {
+  ExecutionContext *SF;
+  const BytecodeFunction *BF;
+  const BytecodeInst *PC;
+  RawValue *R;
+  uint64_t Count = 0;
+
+  // Pick up the frame on top of the stack, which may have moved.
+  auto Resume = [&] {
+    SF = &ECStack.back();
+    BF = SF->Code;
+    PC = SF->PC;
+    R = Registers.data() + SF->RegBase;
+  };
+  Resume();
+
+  for (;;) {
+    const BytecodeInst &I = *PC++;
+    ++Count;
+
+    switch (I.Op) {
+    case BC_Add: R[I.Dst].I = (R[I.A].I + R[I.B].I) & I.Imm; break;
+    case BC_Sub: R[I.Dst].I = (R[I.A].I - R[I.B].I) & I.Imm; break;
+    case BC_Mul: R[I.Dst].I = (R[I.A].I * R[I.B].I) & I.Imm; break;
+    case BC_UDiv: R[I.Dst].I = R[I.A].I / R[I.B].I; break;
+    case BC_URem: R[I.Dst].I = R[I.A].I % R[I.B].I; break;
+    case BC_SDiv: {
+      int64_t L = signExtend(R[I.A].I, I.Bits);
+      int64_t Rhs = signExtend(R[I.B].I, I.Bits);
+      // Dividing the smallest value by -1 wraps, as it does for APInt.
+      R[I.Dst].I = (Rhs == -1 ? 0 - uint64_t(L) : uint64_t(L / Rhs)) & I.Imm;
+      break;
+    }
+    case BC_SRem: {
+      int64_t L = signExtend(R[I.A].I, I.Bits);
+      int64_t Rhs = signExtend(R[I.B].I, I.Bits);
+      R[I.Dst].I = (Rhs == -1 ? 0 : uint64_t(L % Rhs)) & I.Imm;
+      break;
+    }
+    case BC_And: R[I.Dst].I = R[I.A].I & R[I.B].I; break;
+    case BC_Or:  R[I.Dst].I = R[I.A].I | R[I.B].I; break;
+    case BC_Xor: R[I.Dst].I = R[I.A].I ^ R[I.B].I; break;
+    case BC_Shl:
+    case BC_LShr:
+    case BC_AShr: {
+      unsigned Width = 64 - I.Bits;
+      uint64_t Amount = R[I.B].I;
+      if (Amount >= Width)
+        Amount &= I.C;
+      uint64_t V = R[I.A].I;
+      if (I.Op == BC_AShr) {
+        int64_t S = signExtend(V, I.Bits);
+        V = Amount < Width ? S >> Amount : (S < 0 ? -1 : 0);
+      } else if (Amount >= Width) {
+        V = 0;
+      } else {
+        V = I.Op == BC_Shl ? V << Amount : V >> Amount;
+      }
+      R[I.Dst].I = V & I.Imm;
+      break;
+    }
+
+    case BC_FAddF: R[I.Dst].F = R[I.A].F + R[I.B].F; break;
+    case BC_FSubF: R[I.Dst].F = R[I.A].F - R[I.B].F; break;
+    case BC_FMulF: R[I.Dst].F = R[I.A].F * R[I.B].F; break;
+    case BC_FDivF: R[I.Dst].F = R[I.A].F / R[I.B].F; break;
+    case BC_FRemF: R[I.Dst].F = fmod(R[I.A].F, R[I.B].F); break;
+    case BC_FAddD: R[I.Dst].D = R[I.A].D + R[I.B].D; break;
+    case BC_FSubD: R[I.Dst].D = R[I.A].D - R[I.B].D; break;
+    case BC_FMulD: R[I.Dst].D = R[I.A].D * R[I.B].D; break;
+    case BC_FDivD: R[I.Dst].D = R[I.A].D / R[I.B].D; break;
+    case BC_FRemD: R[I.Dst].D = fmod(R[I.A].D, R[I.B].D); break;
+
+    case BC_ICmpEQ:  R[I.Dst].I = R[I.A].I == R[I.B].I; break;
+    case BC_ICmpNE:  R[I.Dst].I = R[I.A].I != R[I.B].I; break;
+    case BC_ICmpULT: R[I.Dst].I = R[I.A].I < R[I.B].I; break;
+    case BC_ICmpULE: R[I.Dst].I = R[I.A].I <= R[I.B].I; break;
+    case BC_ICmpUGT: R[I.Dst].I = R[I.A].I > R[I.B].I; break;
+    case BC_ICmpUGE: R[I.Dst].I = R[I.A].I >= R[I.B].I; break;
+    case BC_ICmpSLT:
+      R[I.Dst].I =
+          signExtend(R[I.A].I, I.Bits) < signExtend(R[I.B].I, I.Bits);
+      break;
+    case BC_ICmpSLE:
+      R[I.Dst].I =
+          signExtend(R[I.A].I, I.Bits) <= signExtend(R[I.B].I, I.Bits);
+      break;
+    case BC_ICmpSGT:
+      R[I.Dst].I =
+          signExtend(R[I.A].I, I.Bits) > signExtend(R[I.B].I, I.Bits);
+      break;
+    case BC_ICmpSGE:
+      R[I.Dst].I =
+          signExtend(R[I.A].I, I.Bits) >= signExtend(R[I.B].I, I.Bits);
+      break;
+    case BC_FCmpF:
+      R[I.Dst].I = compareFP(I.Bits, R[I.A].F, R[I.B].F);
+      break;
+    case BC_FCmpD:
+      R[I.Dst].I = compareFP(I.Bits, R[I.A].D, R[I.B].D);
+      break;
+
+    case BC_Select: R[I.Dst] = R[I.A].I ? R[I.B] : R[I.C]; break;
+
+    case BC_Copy:    R[I.Dst] = R[I.A]; break;
+    case BC_Trunc:   R[I.Dst].I = R[I.A].I & I.Imm; break;
+    case BC_SExt:
+      R[I.Dst].I = uint64_t(signExtend(R[I.A].I, I.Bits)) & I.Imm;
+      break;
+    case BC_FPTrunc: R[I.Dst].F = float(R[I.A].D); break;
+    case BC_FPExt:   R[I.Dst].D = double(R[I.A].F); break;
+    // Conversions to float go through double, like APIntOps::RoundAPIntToFloat.
+    case BC_UIToF:   R[I.Dst].F = float(double(R[I.A].I)); break;
+    case BC_UIToD:   R[I.Dst].D = double(R[I.A].I); break;
+    case BC_SIToF:
+      R[I.Dst].F = float(double(signExtend(R[I.A].I, I.Bits)));
+      break;
+    case BC_SIToD:
+      R[I.Dst].D = double(signExtend(R[I.A].I, I.Bits));
+      break;
+    case BC_FToI:
+      R[I.Dst].I = roundToInt(R[I.A].F, I.Bits, I.Imm);
+      break;
+    case BC_DToI:
+      R[I.Dst].I = roundToInt(R[I.A].D, I.Bits, I.Imm);
+      break;
+    case BC_FToBits: R[I.Dst].I = FloatToBits(R[I.A].F); break;
+    case BC_BitsToF:
+      R[I.Dst].F = BitsToFloat(uint32_t(R[I.A].I));
+      break;
+
+    case BC_Alloca:
+      R[I.Dst].I = uintptr_t(Allocas.allocate(I.Imm, I.C));
+      break;
+    case BC_AllocaN: {
+      unsigned NumElements = R[I.A].I;
+      unsigned Size = std::max(1U, NumElements * unsigned(I.Imm));
+      R[I.Dst].I = uintptr_t(Allocas.allocate(Size, I.C));
+      break;
+    }
+    case BC_Load8: {
+      uint8_t V;
+      memcpy(&V, toPointer(R[I.A]), 1);
+      R[I.Dst].I = V & I.Imm;
+      break;
+    }
+    case BC_Load16: {
+      uint16_t V;
+      memcpy(&V, toPointer(R[I.A]), 2);
+      R[I.Dst].I = V & I.Imm;
+      break;
+    }
+    case BC_Load32: {
+      uint32_t V;
+      memcpy(&V, toPointer(R[I.A]), 4);
+      R[I.Dst].I = V & I.Imm;
+      break;
+    }
+    case BC_Load64: {
+      uint64_t V;
+      memcpy(&V, toPointer(R[I.A]), 8);
+      R[I.Dst].I = V & I.Imm;
+      break;
+    }
+    case BC_LoadN: {
+      uint64_t V = 0;
+      memcpy(&V, toPointer(R[I.A]), I.B);
+      R[I.Dst].I = V & I.Imm;
+      break;
+    }
+    case BC_Store8: {
+      uint8_t V = R[I.A].I;
+      memcpy(toPointer(R[I.B]), &V, 1);
+      break;
+    }
+    case BC_Store16: {
+      uint16_t V = R[I.A].I;
+      memcpy(toPointer(R[I.B]), &V, 2);
+      break;
+    }
+    case BC_Store32: {
+      // A float's bits are the low half of the register.
+      uint32_t V;
+      memcpy(&V, &R[I.A], 4);
+      memcpy(toPointer(R[I.B]), &V, 4);
+      break;
+    }
+    case BC_Store64:
+      memcpy(toPointer(R[I.B]), &R[I.A], 8);
+      break;
+    case BC_StoreN:
+      memcpy(toPointer(R[I.B]), &R[I.A], I.C);
+      break;
+    case BC_Memcpy:
+      memcpy(toPointer(R[I.A]), toPointer(R[I.B]), R[I.C].I);
+      break;
+    case BC_Memmove:
+      memmove(toPointer(R[I.A]), toPointer(R[I.B]), R[I.C].I);
+      break;
+    case BC_Memset:
+      memset(toPointer(R[I.A]), int(R[I.B].I), R[I.C].I);
+      break;
+    case BC_Volatile:
+      if (PrintVolatile) {
+        const Instruction *VI = BF->Volatiles[I.B];
+        dbgs() << (isa<LoadInst>(VI) ? "Volatile load " : "Volatile store: ")
+               << *VI;
+      }
+      break;
+
+    case BC_GEPOffset: R[I.Dst].I = R[I.A].I + I.Imm; break;
+    case BC_GEPIndex:
+      R[I.Dst].I = R[I.A].I + uint64_t(signExtend(R[I.B].I, I.Bits)) * I.Imm;
+      break;
+
+    case BC_Br:
+      PC = takeEdge(*BF, I.A, R);
+      break;
+    case BC_CondBr:
+      PC = takeEdge(*BF, R[I.A].I ? I.B : I.C, R);
+      break;
+    case BC_Switch: {
+      const BytecodeFunction::Switch &S = BF->Switches[I.B];
+      unsigned Edge = S.DefaultEdge;
+      for (const auto &Case : S.Cases)
+        if (Case.first == R[I.A].I) {
+          Edge = Case.second;
+          break;
+        }
+      PC = takeEdge(*BF, Edge, R);
+      break;
+    }
+    case BC_Unreachable:
+      report_fatal_error("Program executed an 'unreachable' instruction!");
+
+    case BC_Ret:
+    case BC_RetVoid: {
+      RawValue Result = I.Op == BC_Ret ? R[I.A] : RawValue();
+      // Returning to bytecode only needs the register copied.
+      size_t Depth = ECStack.size();
+      if (Depth > 1 && ECStack[Depth - 2].Code) {
+        popStackFrame();
+        ExecutionContext &Caller = ECStack.back();
+        unsigned Dst = Caller.PC[-1].Dst;
+        if (Dst != BytecodeFunction::NoReg)
+          Registers[Caller.RegBase + Dst] = Result;
+        Caller.Caller = CallSite();
+        Resume();
+        break;
+      }
+      GenericValue Val;
+      if (I.Op == BC_Ret)
+        Val = fromRaw(Result, BF->RetTy);
+      popStackAndReturnValueToCaller(BF->RetTy, Val);
+      NumBytecodeInsts += Count;
+      return;
+    }
+
+    case BC_Call: {
+      const BytecodeFunction::Call &C = BF->Calls[I.B];
+      Function *F = C.Callee ? C.Callee : (Function *)toPointer(R[C.CalleeReg]);
+      SF->PC = PC;
+      SF->Caller = CallSite(C.CI);
+
+      // Calls between bytecode functions copy the arguments across.
+      const BytecodeFunction *Code = getBytecode(F);
+      if (Code && F->arg_size() == C.Args.size()) {
+        unsigned CallerBase = SF->RegBase;
+        ECStack.emplace_back();
+        ExecutionContext &Callee = ECStack.back();
+        Callee.CurFunction = F;
+        Callee.AllocaTop = Allocas.getTop();
+        RawValue *Args = enterBytecode(Callee, *Code);
+        const RawValue *CallerRegs = Registers.data() + CallerBase;
+        for (unsigned i = 0, e = C.Args.size(); i != e; ++i)
+          Args[i] = CallerRegs[C.Args[i]];
+        Resume();
+        break;
+      }
+
+      // Anything else goes through callFunction, which runs external
+      // functions on the spot.
+      std::vector<GenericValue> ArgVals;
+      ArgVals.reserve(C.Args.size());
+      for (unsigned i = 0, e = C.Args.size(); i != e; ++i)
+        ArgVals.push_back(
+            fromRaw(R[C.Args[i]], C.CI->getArgOperand(i)->getType()));
+      callFunction(F, ArgVals);
+      if (ECStack.empty() || !ECStack.back().Code) {
+        NumBytecodeInsts += Count;
+        return;
+      }
+      Resume();
+      break;
+    }
+    }
+  }
+}
@@ -0,0 +1,181 @@
+//===-- Bytecode.h - Decoded form of interpreted functions ------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the register bytecode the interpreter decodes functions
+// into the first time they're called. Functions that use anything the
+// bytecode can't express are interpreted from their IR instead.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_LIB_EXECUTIONENGINE_INTERPRETER_BYTECODE_H
+#define LLVM_LIB_EXECUTIONENGINE_INTERPRETER_BYTECODE_H
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ExecutionEngine/GenericValue.h"
+#include "llvm/IR/Type.h"
+#include "llvm/Support/DataTypes.h"
+#include <vector>
+
+namespace llvm {
+
+class CallInst;
+class Constant;
+class DataLayout;
+class Function;
+class Instruction;
+
+// RawValue - One bytecode register. Integers of up to 64 bits are kept
+// zero-extended in I, and so are pointers.
+//
+union RawValue {
+  uint64_t I;
+  float F;
+  double D;
+};
+
+// BytecodeOp - The bytecode operations. Integer operations that can carry out
+// of their type mask the result with Imm, and signed ones sign-extend their
+// operands by shifting them left and back by Bits.
+//
+enum BytecodeOp : uint8_t {
+  // Integer arithmetic: Dst = A op B.
+  BC_Add, BC_Sub, BC_Mul, BC_UDiv, BC_SDiv, BC_URem, BC_SRem,
+  BC_And, BC_Or, BC_Xor,
+  // Shifts, with C the mask for oversized shift amounts.
+  BC_Shl, BC_LShr, BC_AShr,
+
+  // Floating point arithmetic on float (F) and double (D).
+  BC_FAddF, BC_FSubF, BC_FMulF, BC_FDivF, BC_FRemF,
+  BC_FAddD, BC_FSubD, BC_FMulD, BC_FDivD, BC_FRemD,
+
+  // Comparisons. FCmp takes its predicate from Bits.
+  BC_ICmpEQ, BC_ICmpNE, BC_ICmpULT, BC_ICmpULE, BC_ICmpUGT, BC_ICmpUGE,
+  BC_ICmpSLT, BC_ICmpSLE, BC_ICmpSGT, BC_ICmpSGE,
+  BC_FCmpF, BC_FCmpD,
+
+  // Dst = A ? B : C.
+  BC_Select,
+
+  // Casts. Copy also covers the ones that don't change the register.
+  BC_Copy, BC_Trunc, BC_SExt, BC_FPTrunc, BC_FPExt,
+  BC_UIToF, BC_UIToD, BC_SIToF, BC_SIToD, BC_FToI, BC_DToI,
+  BC_FToBits, BC_BitsToF,
+
+  // Memory. Alloca allocates Imm bytes aligned to C; AllocaN allocates A
+  // elements of Imm bytes. Loads read Dst from A, and stores write A to B.
+  BC_Alloca, BC_AllocaN,
+  BC_Load8, BC_Load16, BC_Load32, BC_Load64, BC_LoadN,
+  BC_Store8, BC_Store16, BC_Store32, BC_Store64, BC_StoreN,
+  BC_Memcpy, BC_Memmove, BC_Memset,
+  BC_Volatile,
+
+  // Address arithmetic: Dst = A + Imm, and Dst = A + sext(B) * Imm.
+  BC_GEPOffset, BC_GEPIndex,
+
+  // Control flow. Branches name edges, which run the destination's PHI nodes.
+  BC_Br, BC_CondBr, BC_Switch, BC_Ret, BC_RetVoid, BC_Unreachable,
+
+  // Dst = call Calls[B].
+  BC_Call
+};
+
+// BytecodeInst - One bytecode instruction. A, B and C are registers unless
+// the operation says otherwise.
+//
+struct BytecodeInst {
+  BytecodeOp Op;
+  uint8_t Bits;
+  unsigned Dst, A, B, C;
+  uint64_t Imm;
+};
+
+// BytecodeFunction - The decoded form of one function. Its registers are the
+// arguments, then the instructions that produce a value, then the constants
+// it uses, which are copied into the frame when it's entered.
+//
+struct BytecodeFunction {
+  static const unsigned NoReg = ~0u;
+
+  // Edge - A control flow edge: the code to continue at, and the PHI moves
+  // to make on the way. Moves that read what an earlier one wrote are made
+  // in two passes.
+  struct Edge {
+    unsigned Target;
+    unsigned FirstMove, NumMoves;
+    bool Parallel;
+  };
+
+  struct Move {
+    unsigned Dst, Src;
+  };
+
+  // Call - A call: the function, or the register holding it, and the
+  // registers of the arguments.
+  struct Call {
+    CallInst *CI;
+    Function *Callee;
+    unsigned CalleeReg;
+    std::vector<unsigned> Args;
+  };
+
+  struct Switch {
+    std::vector<std::pair<uint64_t, unsigned>> Cases;
+    unsigned DefaultEdge;
+  };
+
+  std::vector<BytecodeInst> Code;
+  std::vector<Edge> Edges;
+  std::vector<Move> Moves;
+  std::vector<Call> Calls;
+  std::vector<Switch> Switches;
+  std::vector<const Instruction *> Volatiles;
+  std::vector<RawValue> Constants;
+  unsigned NumValues = 0;
+  unsigned NumRegs = 0;
+  Type *RetTy = nullptr;
+
+  /// decode - Decode F, or return null if it uses something the bytecode
+  /// can't express. GetConstant evaluates the constants it refers to.
+  static std::unique_ptr<BytecodeFunction>
+  decode(Function &F, const DataLayout &DL,
+         function_ref<RawValue(Constant *)> GetConstant);
+};
+
+/// toRaw - Convert Val, of type Ty, into a register.
+inline RawValue toRaw(const GenericValue &Val, Type *Ty) {
+  RawValue R;
+  R.I = 0;
+  if (Ty->isIntegerTy())
+    R.I = Val.IntVal.getZExtValue();
+  else if (Ty->isFloatTy())
+    R.F = Val.FloatVal;
+  else if (Ty->isDoubleTy())
+    R.D = Val.DoubleVal;
+  else
+    R.I = uintptr_t(Val.PointerVal);
+  return R;
+}
+
+/// fromRaw - Convert the register R, holding a Ty, back into a GenericValue.
+inline GenericValue fromRaw(RawValue R, Type *Ty) {
+  GenericValue Val;
+  if (Ty->isIntegerTy())
+    Val.IntVal = APInt(Ty->getIntegerBitWidth(), R.I);
+  else if (Ty->isFloatTy())
+    Val.FloatVal = R.F;
+  else if (Ty->isDoubleTy())
+    Val.DoubleVal = R.D;
+  else
+    Val.PointerVal = reinterpret_cast<void *>(uintptr_t(R.I));
+  return Val;
+}
+
+} // End llvm namespace
+
+#endif
@@ -32,7 +32,7 @@ using namespace llvm;
 
 STATISTIC(NumDynamicInsts, "Number of dynamic instructions executed");
 
-static cl::opt<bool> PrintVolatile("interpreter-print-volatile", cl::Hidden,
+cl::opt<bool> PrintVolatile("interpreter-print-volatile", cl::Hidden,
           cl::desc("make the interpreter print every volatile load and store"));
 
 //===----------------------------------------------------------------------===//
@@ -821,11 +821,22 @@ void Interpreter::exitCalled(GenericValue GV) {
   // runAtExitHandlers() assumes there are no stack frames, but
   // if exit() was called, then it had a stack frame. Blow away
   // the stack before interpreting atexit handlers.
-  ECStack.clear();
+  while (!ECStack.empty())
+    popStackFrame();
   runAtExitHandlers();
   exit(GV.IntVal.zextOrTrunc(32).getZExtValue());
 }
 
+/// Pop the last stack frame off of ECStack, releasing its allocas and its
+/// bytecode registers.
+void Interpreter::popStackFrame() {
+  ExecutionContext &SF = ECStack.back();
+  Allocas.reset(SF.AllocaTop);
+  if (SF.Code)
+    RegTop = SF.RegBase;
+  ECStack.pop_back();
+}
+
 /// Pop the last stack frame off of ECStack and then copy the result
 /// back into the result variable if we are not returning void. The
 /// result variable may be the ExitValue, or the Value of the calling
@@ -837,7 +848,7 @@ void Interpreter::exitCalled(GenericValue GV) {
 void Interpreter::popStackAndReturnValueToCaller(Type *RetTy,
                                                  GenericValue Result) {
   // Pop the current stack frame.
-  ECStack.pop_back();
+  popStackFrame();
 
   if (ECStack.empty()) {  // Finished main.  Put result into exit code...
     if (RetTy && !RetTy->isVoidTy()) {          // Nonvoid return type?
@@ -851,8 +862,12 @@ void Interpreter::popStackAndReturnValueToCaller(Type *RetTy,
     ExecutionContext &CallingSF = ECStack.back();
     if (Instruction *I = CallingSF.Caller.getInstruction()) {
       // Save result...
-      if (!CallingSF.Caller.getType()->isVoidTy())
-        SetValue(I, Result, CallingSF);
+      if (!CallingSF.Caller.getType()->isVoidTy()) {
+        if (CallingSF.Code)
+          setBytecodeCallResult(CallingSF, Result);
+        else
+          SetValue(I, Result, CallingSF);
+      }
       if (InvokeInst *II = dyn_cast<InvokeInst> (I))
         SwitchToNewBasicBlock (II->getNormalDest (), CallingSF);
       CallingSF.Caller = CallSite();          // We returned from the call...
@@ -970,22 +985,21 @@ void Interpreter::visitAllocaInst(AllocaInst &I) {
 
   unsigned TypeSize = (size_t)getDataLayout().getTypeAllocSize(Ty);
 
-  // Avoid malloc-ing zero bytes, use max()...
+  // Avoid allocating zero bytes, use max()...
   unsigned MemToAlloc = std::max(1U, NumElements * TypeSize);
 
-  // Allocate enough memory to hold the type...
-  void *Memory = safe_malloc(MemToAlloc);
+  // Allocate enough memory to hold the type, aligned at least as well as
+  // any scalar. It's released when the frame is popped.
+  unsigned Align = std::max<unsigned>(I.getAlignment(), alignof(long double));
+  void *Memory = Allocas.allocate(MemToAlloc, Align);
 
   LLVM_DEBUG(dbgs() << "Allocated Type: " << *Ty << " (" << TypeSize
                     << " bytes) x " << NumElements << " (Total: " << MemToAlloc
                     << ") at " << uintptr_t(Memory) << '\n');
 
   GenericValue Result = PTOGV(Memory);
-  assert(Result.PointerVal && "Null pointer returned by malloc!");
+  assert(Result.PointerVal && "Null pointer returned by the alloca stack!");
   SetValue(&I, Result, SF);
-
-  if (I.getOpcode() == Instruction::Alloca)
-    ECStack.back().Allocas.add(Memory);
 }
 
 // getElementOffset - The workhorse for getelementptr.
@@ -1090,6 +1104,13 @@ void Interpreter::visitCallSite(CallSite CS) {
       bool atBegin(Parent->begin() == me);
       if (!atBegin)
         --me;
+      // Frames further up the stack that are about to run the same call will
+      // run the instructions it's lowered to instead.
+      std::vector<ExecutionContext *> Waiting;
+      for (ExecutionContext &EC : ECStack)
+        if (&EC != &SF && EC.CurBB == Parent &&
+            EC.CurInst == BasicBlock::iterator(CS.getInstruction()))
+          Waiting.push_back(&EC);
       IL->LowerIntrinsicCall(cast<CallInst>(CS.getInstruction()));
 
       // Restore the CurInst pointer to the first instruction newly inserted, if
@@ -1100,6 +1121,8 @@ void Interpreter::visitCallSite(CallSite CS) {
         SF.CurInst = me;
         ++SF.CurInst;
       }
+      for (ExecutionContext *EC : Waiting)
+        EC->CurInst = SF.CurInst;
       return;
     }
 
@@ -2080,6 +2103,7 @@ void Interpreter::callFunction(Function *F, ArrayRef<GenericValue> ArgVals) {
   ECStack.emplace_back();
   ExecutionContext &StackFrame = ECStack.back();
   StackFrame.CurFunction = F;
+  StackFrame.AllocaTop = Allocas.getTop();
 
   // Special handling for external functions.
   if (F->isDeclaration()) {
@@ -2089,6 +2113,14 @@ void Interpreter::callFunction(Function *F, ArrayRef<GenericValue> ArgVals) {
     return;
   }
 
+  // Functions that could be decoded run as bytecode instead.
+  if (const BytecodeFunction *Code = getBytecode(F)) {
+    RawValue *Regs = enterBytecode(StackFrame, *Code);
+    for (Argument &A : F->args())
+      Regs[A.getArgNo()] = toRaw(ArgVals[A.getArgNo()], A.getType());
+    return;
+  }
+
   // Get pointers to first LLVM BB & Instruction in function.
   StackFrame.CurBB     = &F->front();
   StackFrame.CurInst   = StackFrame.CurBB->begin();
@@ -2113,6 +2145,10 @@ void Interpreter::run() {
   while (!ECStack.empty()) {
     // Interpret a single instruction & increment the "PC".
     ExecutionContext &SF = ECStack.back();  // Current stack frame
+    if (SF.Code) {
+      runBytecode();
+      continue;
+    }
     Instruction &I = *SF.CurInst++;         // Increment before execute
 
     // Track the number of dynamic instructions executed.
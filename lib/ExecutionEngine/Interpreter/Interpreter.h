@@ -14,6 +14,8 @@
 #ifndef LLVM_LIB_EXECUTIONENGINE_INTERPRETER_INTERPRETER_H
 #define LLVM_LIB_EXECUTIONENGINE_INTERPRETER_INTERPRETER_H
 
+#include "Bytecode.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/IR/CallSite.h"
@@ -22,6 +24,8 @@
 #include "llvm/IR/InstVisitor.h"
 #include "llvm/Support/DataTypes.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/MemAlloc.h"
 #include "llvm/Support/raw_ostream.h"
 namespace llvm {
 
@@ -31,26 +35,64 @@ class ConstantExpr;
 typedef generic_gep_type_iterator<User::const_op_iterator> gep_type_iterator;
 
 
-// AllocaHolder - Object to track all of the blocks of memory allocated by
-// alloca.  When the function returns, this object is popped off the execution
-// stack, which causes the dtor to be run, which frees all the alloca'd memory.
+// AllocaStack - Memory for allocas, handed out in LIFO order from large slabs.
+// Each stack frame remembers the top of the stack when it's pushed, and
+// everything allocated above that is released at once when it's popped. Slabs
+// are kept once allocated, so recursion and allocas in loops don't go back to
+// malloc.
 //
-class AllocaHolder {
-  std::vector<void *> Allocations;
+class AllocaStack {
+  static const size_t SlabSize = 64 * 1024;
+
+  struct Slab {
+    char *Begin;
+    size_t Size;
+  };
+  std::vector<Slab> Slabs;
+  unsigned CurSlab = 0;
+  size_t CurOffset = 0;
 
 public:
-  AllocaHolder() {}
+  struct Mark {
+    unsigned Slab = 0;
+    size_t Offset = 0;
+  };
+
+  AllocaStack() {}
+  AllocaStack(const AllocaStack &) = delete;
+  AllocaStack &operator=(const AllocaStack &) = delete;
+
+  ~AllocaStack() {
+    for (Slab &S : Slabs)
+      free(S.Begin);
+  }
 
-  // Make this type move-only.
-  AllocaHolder(AllocaHolder &&) = default;
-  AllocaHolder &operator=(AllocaHolder &&RHS) = default;
+  Mark getTop() const {
+    Mark M;
+    M.Slab = CurSlab;
+    M.Offset = CurOffset;
+    return M;
+  }
 
-  ~AllocaHolder() {
-    for (void *Allocation : Allocations)
-      free(Allocation);
+  void reset(Mark M) {
+    CurSlab = M.Slab;
+    CurOffset = M.Offset;
   }
 
-  void add(void *Mem) { Allocations.push_back(Mem); }
+  void *allocate(size_t Size, size_t Alignment) {
+    for (;; ++CurSlab, CurOffset = 0) {
+      if (CurSlab == Slabs.size()) {
+        size_t NewSize = std::max(SlabSize, Size + Alignment);
+        Slabs.push_back({static_cast<char *>(safe_malloc(NewSize)), NewSize});
+      }
+      Slab &S = Slabs[CurSlab];
+      uintptr_t Ptr = alignAddr(S.Begin + CurOffset, Alignment);
+      if (Ptr + Size <= uintptr_t(S.Begin + S.Size)) {
+        CurOffset = Ptr + Size - uintptr_t(S.Begin);
+        return reinterpret_cast<void *>(Ptr);
+      }
+    }
+  }
 };
 
 typedef std::vector<GenericValue> ValuePlaneTy;
@@ -66,9 +108,17 @@ struct ExecutionContext {
                                    // NULL if main func or debugger invoked fn
   std::map<Value *, GenericValue> Values; // LLVM values used in this invocation
   std::vector<GenericValue>  VarArgs; // Values passed through an ellipsis
-  AllocaHolder Allocas;            // Track memory allocated by alloca
+  AllocaStack::Mark AllocaTop;     // Top of the alloca stack on entry
+
+  // Frames of functions decoded into bytecode run Code from PC instead of
+  // CurInst, and keep their values in registers starting at RegBase.
+  const BytecodeFunction *Code;
+  const BytecodeInst   *PC;
+  unsigned             RegBase;
 
-  ExecutionContext() : CurFunction(nullptr), CurBB(nullptr), CurInst(nullptr) {}
+  ExecutionContext()
+      : CurFunction(nullptr), CurBB(nullptr), CurInst(nullptr), Code(nullptr),
+        PC(nullptr), RegBase(0) {}
 };
 
 // Interpreter - This class represents the entirety of the interpreter.
@@ -81,6 +131,18 @@ class Interpreter : public ExecutionEngine, public InstVisitor<Interpreter> {
   // function record.
   std::vector<ExecutionContext> ECStack;
 
+  // Allocas - The memory allocated by alloca in all stack frames.
+  AllocaStack Allocas;
+
+  // Bytecodes - The bytecode of each function called so far, or null for
+  // the ones that are interpreted from their IR.
+  DenseMap<const Function *, std::unique_ptr<BytecodeFunction>> Bytecodes;
+
+  // Registers - The registers of all bytecode frames. The ones from RegTop up
+  // are free.
+  std::vector<RawValue> Registers;
+  unsigned RegTop = 0;
+
   // AtExitHandlers - List of functions to call when the program exits,
   // registered with the atexit() library function.
   std::vector<Function*> AtExitHandlers;
@@ -89,6 +151,10 @@ public:
   explicit Interpreter(std::unique_ptr<Module> M);
   ~Interpreter() override;
 
+  /// removeModule - Forget the bytecode of the functions in M as well.
+  ///
+  bool removeModule(Module *M) override;
+
   /// runAtExitHandlers - Run any functions registered by the program's calls to
   /// atexit(3), which we intercept and store in AtExitHandlers.
   ///
@@ -226,8 +292,15 @@ private:  // Helper functions
                                   ExecutionContext &SF);
   GenericValue executeCastOperation(Instruction::CastOps opcode, Value *SrcVal, 
                                     Type *Ty, ExecutionContext &SF);
+  void popStackFrame();
   void popStackAndReturnValueToCaller(Type *RetTy, GenericValue Result);
 
+  // Bytecode execution, in Bytecode.cpp.
+  const BytecodeFunction *getBytecode(Function *F);
+  RawValue *enterBytecode(ExecutionContext &SF, const BytecodeFunction &Code);
+  void setBytecodeCallResult(ExecutionContext &SF, GenericValue Result);
+  void runBytecode();
+
 };
 
 } // End llvm namespace
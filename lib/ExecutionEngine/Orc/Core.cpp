@@ -10,10 +10,15 @@
 #include "llvm/ExecutionEngine/Orc/Core.h"
 #include "llvm/Config/llvm-config.h"
 #include "llvm/ExecutionEngine/Orc/OrcError.h"
+#include "llvm/Support/Compiler.h"
 #include "llvm/Support/Format.h"
+#include "llvm/Support/ThreadPool.h"
 
 #if LLVM_ENABLE_THREADS
+#include <condition_variable>
+#include <deque>
 #include <future>
+#include <mutex>
 #endif
 
 namespace llvm {
@@ -124,6 +129,104 @@ void SymbolsNotFound::log(raw_ostream &OS) const {
   OS << "Symbols not found: " << Symbols;
 }
 
+#if LLVM_ENABLE_THREADS
+namespace {
+
+/// Units dispatched to a ThreadPool that no thread has started on yet.
+///
+/// Each dispatched unit is queued here and a pool task is started to run
+/// whichever unit is at the front. A pool thread that blocks in a lookup
+/// keeps taking units from the queue while it waits, so a lookup made by a
+/// materializer can't deadlock waiting for a unit that is stuck behind it in
+/// the pool. A unit is only ever run by the thread that takes it off the
+/// queue, so pool tasks that find the queue empty just return.
+class PendingMaterializations {
+public:
+  void push(VSO &V, std::unique_ptr<MaterializationUnit> MU) {
+    std::lock_guard<std::mutex> Lock(M);
+    Units.push_back(std::make_pair(&V, std::move(MU)));
+    CV.notify_all();
+  }
+
+  /// Run the unit at the front of the queue, if there is one.
+  void runOne() {
+    std::unique_lock<std::mutex> Lock(M);
+    if (!Units.empty())
+      runFront(Lock);
+  }
+
+  /// Run queued units until Done returns true. Done is checked with the
+  /// queue's lock held, and whatever makes it true must call notify()
+  /// afterwards.
+  void runUntil(function_ref<bool()> Done) {
+    std::unique_lock<std::mutex> Lock(M);
+    while (!Done()) {
+      if (Units.empty())
+        CV.wait(Lock);
+      else
+        runFront(Lock);
+    }
+  }
+
+  /// Wake up any thread waiting in runUntil.
+  void notify() {
+    std::lock_guard<std::mutex> Lock(M);
+    CV.notify_all();
+  }
+
+private:
+  void runFront(std::unique_lock<std::mutex> &Lock);
+
+  std::mutex M;
+  std::condition_variable CV;
+  std::deque<std::pair<VSO *, std::unique_ptr<MaterializationUnit>>> Units;
+};
+
+} // end anonymous namespace
+
+/// The queue of the pool whose unit this thread is materializing, if any.
+static LLVM_THREAD_LOCAL PendingMaterializations *CurrentPendingQueue = nullptr;
+
+void PendingMaterializations::runFront(std::unique_lock<std::mutex> &Lock) {
+  VSO &V = *Units.front().first;
+  auto MU = std::move(Units.front().second);
+  Units.pop_front();
+  Lock.unlock();
+
+  auto *PrevQueue = CurrentPendingQueue;
+  CurrentPendingQueue = this;
+  MU->doMaterialize(V);
+  CurrentPendingQueue = PrevQueue;
+
+  Lock.lock();
+}
+
+/// Wait for F to become ready, running units from Queue meanwhile if there is
+/// one.
+template <typename T>
+static void waitForFuture(PendingMaterializations *Queue, std::future<T> &F) {
+  if (!Queue)
+    return F.wait();
+  Queue->runUntil([&]() {
+    return F.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+  });
+}
+#endif
+
+ExecutionSessionBase &
+ExecutionSessionBase::setDispatchMaterializationToThreadPool(ThreadPool &TP) {
+#if LLVM_ENABLE_THREADS
+  auto Queue = std::make_shared<PendingMaterializations>();
+  return setDispatchMaterialization(
+      [&TP, Queue](VSO &V, std::unique_ptr<MaterializationUnit> MU) {
+        Queue->push(V, std::move(MU));
+        TP.async([Queue]() { Queue->runOne(); });
+      });
+#else
+  return setDispatchMaterialization(materializeOnCurrentThread);
+#endif
+}
+
 void ExecutionSessionBase::failQuery(AsynchronousSymbolQuery &Q, Error Err) {
   bool DeliveredError = true;
   runSessionLocked([&]() -> void {
@@ -944,14 +1047,19 @@ Expected<SymbolMap> blockingLookup(ExecutionSessionBase &ES,
                                    MaterializationResponsibility *MR) {
 
 #if LLVM_ENABLE_THREADS
-  // In the threaded case we use promises to return the results.
+  // In the threaded case we use promises to return the results. If this is a
+  // thread pool thread materializing a unit, it runs other pending units
+  // while it waits (see PendingMaterializations), and needs waking when the
+  // promises are fulfilled. The callbacks capture Queue by value, since the
+  // waiter may return as soon as a promise is set.
+  auto *Queue = CurrentPendingQueue;
   std::promise<SymbolMap> PromisedResult;
   std::mutex ErrMutex;
   Error ResolutionError = Error::success();
   std::promise<void> PromisedReady;
   Error ReadyError = Error::success();
   auto OnResolve =
-      [&](Expected<AsynchronousSymbolQuery::ResolutionResult> Result) {
+      [&, Queue](Expected<AsynchronousSymbolQuery::ResolutionResult> Result) {
         if (Result) {
           if (MR)
             MR->addDependencies(Result->Dependencies);
@@ -964,17 +1072,21 @@ Expected<SymbolMap> blockingLookup(ExecutionSessionBase &ES,
           }
           PromisedResult.set_value(SymbolMap());
         }
+        if (Queue)
+          Queue->notify();
       };
 
   std::function<void(Error)> OnReady;
   if (WaitUntilReady) {
-    OnReady = [&](Error Err) {
+    OnReady = [&, Queue](Error Err) {
       if (Err) {
         ErrorAsOutParameter _(&ReadyError);
         std::lock_guard<std::mutex> Lock(ErrMutex);
         ReadyError = std::move(Err);
       }
       PromisedReady.set_value();
+      if (Queue)
+        Queue->notify();
     };
   } else {
     OnReady = [&](Error Err) {
@@ -1026,6 +1138,7 @@ Expected<SymbolMap> blockingLookup(ExecutionSessionBase &ES,
 
 #if LLVM_ENABLE_THREADS
   auto ResultFuture = PromisedResult.get_future();
+  waitForFuture(Queue, ResultFuture);
   auto Result = ResultFuture.get();
 
   {
@@ -1039,6 +1152,7 @@ Expected<SymbolMap> blockingLookup(ExecutionSessionBase &ES,
 
   if (WaitUntilReady) {
     auto ReadyFuture = PromisedReady.get_future();
+    waitForFuture(Queue, ReadyFuture);
     ReadyFuture.get();
 
     {
@@ -0,0 +1,247 @@
+//===--- PersistentObjectCache.cpp - On-disk object cache for ORC ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/Orc/PersistentObjectCache.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SHA1.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+
+namespace {
+
+using namespace llvm;
+
+/// Bump this whenever the format of the keys or entries changes.
+const char CacheVersion[] = "orc-object-cache-v2";
+
+/// Each entry is the object followed by a trailer holding this magic and the
+/// size of the object, so entries that were cut short can be told apart.
+const char EntryMagic[8] = {'O', 'R', 'C', 'C', 'A', 'C', 'H', 'E'};
+const size_t EntryTrailerSize = sizeof(EntryMagic) + sizeof(uint64_t);
+
+/// A cached object: the entry's buffer, without the trailer.
+class CachedObjectBuffer : public MemoryBuffer {
+public:
+  CachedObjectBuffer(std::unique_ptr<MemoryBuffer> Entry, size_t ObjectSize)
+      : Entry(std::move(Entry)) {
+    const char *Start = this->Entry->getBufferStart();
+    init(Start, Start + ObjectSize, /*RequiresNullTerminator=*/false);
+  }
+
+  StringRef getBufferIdentifier() const override {
+    return Entry->getBufferIdentifier();
+  }
+
+  BufferKind getBufferKind() const override { return Entry->getBufferKind(); }
+
+private:
+  std::unique_ptr<MemoryBuffer> Entry;
+};
+
+/// Feeds everything written to it into a SHA1 hash.
+class SHA1Stream : public raw_ostream {
+public:
+  SHA1Stream(SHA1 &Hasher) : Hasher(Hasher) { SetUnbuffered(); }
+
+private:
+  void write_impl(const char *Ptr, size_t Size) override {
+    Hasher.update(ArrayRef<uint8_t>(reinterpret_cast<const uint8_t *>(Ptr),
+                                    Size));
+    Pos += Size;
+  }
+
+  uint64_t current_pos() const override { return Pos; }
+
+  SHA1 &Hasher;
+  uint64_t Pos = 0;
+};
+
+} // end anonymous namespace
+
+namespace llvm {
+namespace orc {
+
+Expected<std::unique_ptr<PersistentObjectCache>>
+PersistentObjectCache::Create(StringRef CacheDir, const TargetMachine &TM,
+                              CachePruningPolicy Policy) {
+  if (std::error_code EC = sys::fs::create_directories(CacheDir))
+    return errorCodeToError(EC);
+
+  // Everything else that determines the object code comes from the
+  // TargetMachine.
+  const TargetOptions &Opts = TM.Options;
+  const MCTargetOptions &MCOpts = Opts.MCOptions;
+  std::string TargetKey;
+  raw_string_ostream KeyOS(TargetKey);
+  KeyOS << CacheVersion << '\0' << TM.getTargetTriple().str() << '\0'
+        << TM.getTargetCPU() << '\0' << TM.getTargetFeatureString() << '\0'
+        << static_cast<int>(TM.getOptLevel()) << '\0'
+        << static_cast<int>(TM.getRelocationModel()) << '\0'
+        << static_cast<int>(TM.getCodeModel()) << '\0';
+  for (unsigned Flag : std::initializer_list<unsigned>{
+           Opts.UnsafeFPMath, Opts.NoInfsFPMath, Opts.NoNaNsFPMath,
+           Opts.NoTrappingFPMath, Opts.NoSignedZerosFPMath,
+           Opts.HonorSignDependentRoundingFPMathOption, Opts.NoZerosInBSS,
+           Opts.GuaranteedTailCallOpt, Opts.StackSymbolOrdering,
+           Opts.EnableFastISel, Opts.EnableGlobalISel, Opts.UseInitArray,
+           Opts.RelaxELFRelocations, Opts.FunctionSections, Opts.DataSections,
+           Opts.UniqueSectionNames, Opts.TrapUnreachable, Opts.EmulatedTLS,
+           Opts.EnableIPRA, Opts.EmitStackSizeSection, MCOpts.SanitizeAddress,
+           MCOpts.MCRelaxAll, MCOpts.MCNoExecStack,
+           MCOpts.MCIncrementalLinkerCompatible, MCOpts.MCPIECopyRelocations,
+           MCOpts.MCWasmCompactObject})
+    KeyOS << Flag;
+  KeyOS << '\0' << Opts.StackAlignmentOverride << '\0'
+        << static_cast<int>(Opts.CompressDebugSections) << '\0'
+        << static_cast<int>(Opts.FloatABIType) << '\0'
+        << static_cast<int>(Opts.AllowFPOpFusion) << '\0'
+        << static_cast<int>(Opts.ThreadModel) << '\0'
+        << static_cast<int>(Opts.EABIVersion) << '\0'
+        << static_cast<int>(Opts.DebuggerTuning) << '\0'
+        << static_cast<int>(Opts.FPDenormalMode) << '\0'
+        << static_cast<int>(Opts.ExceptionModel) << '\0'
+        << MCOpts.DwarfVersion << '\0' << MCOpts.ABIName;
+  KeyOS.flush();
+
+  auto Cache = std::unique_ptr<PersistentObjectCache>(
+      new PersistentObjectCache(CacheDir, std::move(TargetKey), Policy));
+  Cache->pruneIfDue();
+  return std::move(Cache);
+}
+
+PersistentObjectCache::PersistentObjectCache(std::string CacheDir,
+                                             std::string TargetKey,
+                                             CachePruningPolicy Policy)
+    : CacheDir(std::move(CacheDir)), TargetKey(std::move(TargetKey)),
+      Policy(std::move(Policy)) {}
+
+std::string PersistentObjectCache::getKey(const Module &M) const {
+  // The module identifier isn't written to bitcode, so modules that only
+  // differ in what the JIT happened to call them share an entry. The source
+  // file name is, since it ends up in the object's symbol table.
+  SHA1 Hasher;
+  Hasher.update(TargetKey);
+  {
+    SHA1Stream OS(Hasher);
+    WriteBitcodeToFile(M, OS);
+  }
+  return toHex(Hasher.result());
+}
+
+void PersistentObjectCache::pruneIfDue() {
+  if (!Policy.Interval)
+    return;
+
+  // CachePruning throttles itself with a timestamp file in the directory, but
+  // there's no need to look at it after every store.
+  auto Now = std::chrono::steady_clock::now();
+  {
+    std::lock_guard<std::mutex> Lock(CacheMutex);
+    if (Now < NextPrune)
+      return;
+    NextPrune = Now + *Policy.Interval;
+  }
+  pruneCache(CacheDir, Policy);
+}
+
+std::string PersistentObjectCache::getEntryPath(StringRef Key) const {
+  // CachePruning only considers files starting with "llvmcache-".
+  SmallString<128> Path(CacheDir);
+  sys::path::append(Path, "llvmcache-" + Key);
+  return Path.str();
+}
+
+void PersistentObjectCache::notifyObjectCompiled(const Module *M,
+                                                 MemoryBufferRef Obj) {
+  std::string Key;
+  {
+    std::lock_guard<std::mutex> Lock(CacheMutex);
+    auto I = PendingKeys.find(M);
+    if (I != PendingKeys.end()) {
+      Key = std::move(I->second);
+      PendingKeys.erase(I);
+    }
+  }
+  if (Key.empty())
+    Key = getKey(*M);
+
+  // Write the object to a temporary file and move it into place, so that
+  // other processes sharing the directory never see a partial entry. Failing
+  // to write the cache isn't an error, we just compile again next time.
+  SmallString<128> TempModel(CacheDir);
+  sys::path::append(TempModel, "Tmp-%%%%%%.tmp.o");
+  Expected<sys::fs::TempFile> Temp = sys::fs::TempFile::create(TempModel);
+  if (!Temp) {
+    consumeError(Temp.takeError());
+    return;
+  }
+  {
+    raw_fd_ostream OS(Temp->FD, /*shouldClose=*/false);
+    char Size[sizeof(uint64_t)];
+    support::endian::write64le(Size, Obj.getBufferSize());
+    OS << Obj.getBuffer() << StringRef(EntryMagic, sizeof(EntryMagic))
+       << StringRef(Size, sizeof(Size));
+    OS.flush();
+    if (OS.has_error()) {
+      OS.clear_error();
+      consumeError(Temp->discard());
+      return;
+    }
+  }
+  if (Error Err = Temp->keep(getEntryPath(Key))) {
+    consumeError(std::move(Err));
+    consumeError(Temp->discard());
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> Lock(CacheMutex);
+    ++NumStores;
+  }
+  pruneIfDue();
+}
+
+std::unique_ptr<MemoryBuffer>
+PersistentObjectCache::getObject(const Module *M) {
+  std::string Key = getKey(*M);
+
+  // Objects don't need a null terminator, so large ones can be mapped.
+  auto Buf = MemoryBuffer::getFile(getEntryPath(Key), /*FileSize=*/-1,
+                                   /*RequiresNullTerminator=*/false);
+
+  // Treat an entry with a missing or mismatched trailer as a miss. Storing
+  // the recompiled object replaces it.
+  size_t ObjectSize = 0;
+  bool Valid = false;
+  if (Buf && (*Buf)->getBufferSize() >= EntryTrailerSize) {
+    StringRef Trailer = (*Buf)->getBuffer().take_back(EntryTrailerSize);
+    ObjectSize = (*Buf)->getBufferSize() - EntryTrailerSize;
+    Valid = Trailer.startswith(StringRef(EntryMagic, sizeof(EntryMagic))) &&
+            support::endian::read64le(Trailer.data() + sizeof(EntryMagic)) ==
+                ObjectSize;
+  }
+
+  std::lock_guard<std::mutex> Lock(CacheMutex);
+  if (!Valid) {
+    PendingKeys[M] = std::move(Key);
+    return nullptr;
+  }
+  ++NumHits;
+  return llvm::make_unique<CachedObjectBuffer>(std::move(*Buf), ObjectSize);
+}
+
+} // end namespace orc
+} // end namespace llvm
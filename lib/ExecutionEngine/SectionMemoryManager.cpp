@@ -16,6 +16,7 @@
 #include "llvm/Config/config.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/Process.h"
+#include <algorithm>
 
 namespace llvm {
 
@@ -88,23 +89,29 @@ uint8_t *SectionMemoryManager::allocateSection(
       // Remember how much free space is now left in this block
       FreeMB.Free =
           sys::MemoryBlock((void *)(Addr + Size), EndOfBlock - Addr - Size);
+      AllocatedBytes += Size;
       return (uint8_t *)Addr;
     }
   }
 
-  // No pre-allocated free block was large enough. Allocate a new memory region.
+  // No pre-allocated free block was large enough. Allocate a new memory region,
+  // or a whole slab if we're allocating in slabs, so that the following
+  // sections can come from the same mapping.
   // Note that all sections get allocated as read-write.  The permissions will
   // be updated later based on memory group.
   //
-  // FIXME: It would be useful to define a default allocation size (or add
-  // it as a constructor parameter) to minimize the number of allocations.
-  //
   // FIXME: Initialize the Near member for each memory group to avoid
   // interleaving.
+  unsigned Flags = sys::Memory::MF_READ | sys::Memory::MF_WRITE;
+  uintptr_t MapSize = std::max<uintptr_t>(RequiredSize, SlabSize);
+  if (UseHugePages) {
+    // Only whole huge pages can be backed by huge pages.
+    Flags |= sys::Memory::MF_HUGE_HINT;
+    MapSize = alignTo(MapSize, sys::Memory::HugePageSize);
+  }
   std::error_code ec;
   sys::MemoryBlock MB = MMapper.allocateMappedMemory(
-      Purpose, RequiredSize, &MemGroup.Near,
-      sys::Memory::MF_READ | sys::Memory::MF_WRITE, ec);
+      Purpose, MapSize, &MemGroup.Near, Flags, ec);
   if (ec) {
     // FIXME: Add error propagation to the interface.
     return nullptr;
@@ -123,10 +130,11 @@ uint8_t *SectionMemoryManager::allocateSection(
 
   // The part of the block we're giving out to the user is now pending
   MemGroup.PendingMem.push_back(sys::MemoryBlock((void *)Addr, Size));
+  AllocatedBytes += Size;
 
   // The allocateMappedMemory may allocate much more memory than we need. In
   // this case, we store the unused memory as a free memory block.
-  unsigned FreeSize = EndOfBlock - Addr - Size;
+  uintptr_t FreeSize = EndOfBlock - Addr - Size;
   if (FreeSize > 16) {
     FreeMemBlock FreeMB;
     FreeMB.Free = sys::MemoryBlock((void *)(Addr + Size), FreeSize);
@@ -195,9 +203,61 @@ static sys::MemoryBlock trimBlockToPageSize(sys::MemoryBlock M) {
 std::error_code
 SectionMemoryManager::applyMemoryGroupPermissions(MemoryGroup &MemGroup,
                                                   unsigned Permissions) {
-  for (sys::MemoryBlock &MB : MemGroup.PendingMem)
-    if (std::error_code EC = MMapper.protectMappedMemory(MB, Permissions))
+  static const size_t PageSize = sys::Process::getPageSize();
+
+  // Permissions apply to whole pages, so protect the pages of the pending
+  // blocks, merging the blocks whose pages touch. Only merge blocks from the
+  // same mapping: the mapper may not support changing several at once.
+  // Mappings never overlap, so find a block's mapping by the nearest mapping
+  // start at or below it.
+  std::vector<uintptr_t> MappingStarts;
+  MappingStarts.reserve(MemGroup.AllocatedMem.size());
+  for (const sys::MemoryBlock &Mapping : MemGroup.AllocatedMem)
+    MappingStarts.push_back((uintptr_t)Mapping.base());
+  std::sort(MappingStarts.begin(), MappingStarts.end());
+  auto GetMapping = [&](const sys::MemoryBlock &MB) -> uintptr_t {
+    auto I = std::upper_bound(MappingStarts.begin(), MappingStarts.end(),
+                              (uintptr_t)MB.base());
+    assert(I != MappingStarts.begin() &&
+           "Pending block not in an allocated block");
+    return *std::prev(I);
+  };
+
+  std::sort(MemGroup.PendingMem.begin(), MemGroup.PendingMem.end(),
+            [](const sys::MemoryBlock &LHS, const sys::MemoryBlock &RHS) {
+              return LHS.base() < RHS.base();
+            });
+
+  uintptr_t RangeStart = 0, RangeEnd = 0;
+  uintptr_t RangeMapping = 0;
+  auto ProtectRange = [&]() -> std::error_code {
+    if (RangeStart == RangeEnd)
+      return std::error_code();
+    ++NumProtectCalls;
+    return MMapper.protectMappedMemory(
+        sys::MemoryBlock((void *)RangeStart, RangeEnd - RangeStart),
+        Permissions);
+  };
+
+  for (sys::MemoryBlock &MB : MemGroup.PendingMem) {
+    if (MB.size() == 0)
+      continue;
+    uintptr_t Start = alignDown((uintptr_t)MB.base(), PageSize);
+    uintptr_t End = alignTo((uintptr_t)MB.base() + MB.size(), PageSize);
+    uintptr_t Mapping = GetMapping(MB);
+    if (RangeStart != RangeEnd && Start <= RangeEnd &&
+        Mapping == RangeMapping) {
+      RangeEnd = std::max(RangeEnd, End);
+      continue;
+    }
+    if (std::error_code EC = ProtectRange())
       return EC;
+    RangeStart = Start;
+    RangeEnd = End;
+    RangeMapping = Mapping;
+  }
+  if (std::error_code EC = ProtectRange())
+    return EC;
 
   MemGroup.PendingMem.clear();
 
@@ -230,6 +290,21 @@ SectionMemoryManager::~SectionMemoryManager() {
   }
 }
 
+SectionMemoryManager::MemoryStats
+SectionMemoryManager::getMemoryStats() const {
+  MemoryStats Stats;
+  for (const MemoryGroup *Group : {&CodeMem, &RWDataMem, &RODataMem}) {
+    Stats.NumMappings += Group->AllocatedMem.size();
+    for (const sys::MemoryBlock &Block : Group->AllocatedMem)
+      Stats.MappedBytes += Block.size();
+    for (const FreeMemBlock &FreeMB : Group->FreeMem)
+      Stats.FreeBytes += FreeMB.Free.size();
+  }
+  Stats.AllocatedBytes = AllocatedBytes;
+  Stats.NumProtectCalls = NumProtectCalls;
+  return Stats;
+}
+
 SectionMemoryManager::MemoryMapper::~MemoryMapper() {}
 
 void SectionMemoryManager::anchor() {}
@@ -259,7 +334,9 @@ public:
 DefaultMMapper DefaultMMapperInstance;
 } // namespace
 
-SectionMemoryManager::SectionMemoryManager(MemoryMapper *MM)
-    : MMapper(MM ? *MM : DefaultMMapperInstance) {}
+SectionMemoryManager::SectionMemoryManager(MemoryMapper *MM, size_t SlabSize,
+                                           bool UseHugePages)
+    : MMapper(MM ? *MM : DefaultMMapperInstance), SlabSize(SlabSize),
+      UseHugePages(UseHugePages) {}
 
 } // namespace llvm
@@ -27,9 +27,11 @@
 #include "llvm/MC/MCValue.h"
 #include "llvm/MC/MCWasmObjectWriter.h"
 #include "llvm/Support/Casting.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/LEB128.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/StringSaver.h"
 #include <vector>
 
@@ -43,6 +45,15 @@ namespace {
 // and emtpy slot at 0 and therefore calling a null function pointer will trap.
 static const uint32_t kInitialTableOffset = 1;
 
+// Below this many functions, encoding the code section in parallel costs more
+// than it saves.
+static const size_t kParallelCodeThreshold = 64;
+
+static cl::opt<bool> SerialCodeSection(
+    "wasm-serial-code-section", cl::Hidden, cl::init(false),
+    cl::desc("Encode the function bodies of the wasm code section on a "
+             "single thread"));
+
 // For patching purposes, we need to remember where each section starts, both
 // for patching up the section size field, and for patching up references to
 // locations within the section.
@@ -318,6 +329,10 @@ private:
                                  const MCAsmLayout &Layout);
 
   uint32_t getProvisionalValue(const WasmRelocationEntry &RelEntry);
+  unsigned applyRelocation(const WasmRelocationEntry &RelEntry, uint8_t *Loc,
+                           bool Minimal = false);
+  size_t compactBody(SmallVectorImpl<char> &Body,
+                     MutableArrayRef<const WasmRelocationEntry *> Relocs);
   void applyRelocations(ArrayRef<WasmRelocationEntry> Relocations,
                         uint64_t ContentsOffset);
 
@@ -527,31 +542,24 @@ void WasmObjectWriter::recordRelocation(MCAssembler &Asm,
   }
 }
 
-// Write X as an (unsigned) LEB value at offset Offset in Stream, padded
-// to allow patching.
-static void
-WritePatchableLEB(raw_pwrite_stream &Stream, uint32_t X, uint64_t Offset) {
-  uint8_t Buffer[5];
-  unsigned SizeLen = encodeULEB128(X, Buffer, 5);
+// Write X as an (unsigned) LEB value at Buf, padded to allow patching.
+static unsigned WritePatchableLEB(uint8_t *Buf, uint32_t X) {
+  unsigned SizeLen = encodeULEB128(X, Buf, 5);
   assert(SizeLen == 5);
-  Stream.pwrite((char *)Buffer, SizeLen, Offset);
+  return SizeLen;
 }
 
-// Write X as an signed LEB value at offset Offset in Stream, padded
-// to allow patching.
-static void
-WritePatchableSLEB(raw_pwrite_stream &Stream, int32_t X, uint64_t Offset) {
-  uint8_t Buffer[5];
-  unsigned SizeLen = encodeSLEB128(X, Buffer, 5);
+// Write X as an signed LEB value at Buf, padded to allow patching.
+static unsigned WritePatchableSLEB(uint8_t *Buf, int32_t X) {
+  unsigned SizeLen = encodeSLEB128(X, Buf, 5);
   assert(SizeLen == 5);
-  Stream.pwrite((char *)Buffer, SizeLen, Offset);
+  return SizeLen;
 }
 
-// Write X as a plain integer value at offset Offset in Stream.
-static void WriteI32(raw_pwrite_stream &Stream, uint32_t X, uint64_t Offset) {
-  uint8_t Buffer[4];
-  support::endian::write32le(Buffer, X);
-  Stream.pwrite((char *)Buffer, sizeof(Buffer), Offset);
+// Write X as a plain integer value at Buf.
+static unsigned WriteI32(uint8_t *Buf, uint32_t X) {
+  support::endian::write32le(Buf, X);
+  return 4;
 }
 
 static const MCSymbolWasm* ResolveSymbol(const MCSymbolWasm& Symbol) {
@@ -588,6 +596,11 @@ WasmObjectWriter::getProvisionalValue(const WasmRelocationEntry &RelEntry) {
                          RelEntry.Symbol->getName());
     return WasmIndices[RelEntry.Symbol];
   case wasm::R_WEBASSEMBLY_FUNCTION_OFFSET_I32:
+    // Compacting moves code around within functions, which would leave
+    // offsets into them (i.e. debug info) pointing at the wrong place.
+    if (TargetObjectWriter->isCompact())
+      report_fatal_error("compact wasm objects can't refer to code offsets");
+    LLVM_FALLTHROUGH;
   case wasm::R_WEBASSEMBLY_SECTION_OFFSET_I32: {
     const auto &Section =
         static_cast<const MCSectionWasm &>(RelEntry.Symbol->getSection());
@@ -599,8 +612,12 @@ WasmObjectWriter::getProvisionalValue(const WasmRelocationEntry &RelEntry) {
     // Provisional value is address of the global
     const MCSymbolWasm *Sym = ResolveSymbol(*RelEntry.Symbol);
     // For undefined symbols, use zero
-    if (!Sym->isDefined())
+    if (!Sym->isDefined()) {
+      if (TargetObjectWriter->isCompact())
+        report_fatal_error("undefined data symbol in compact wasm object: " +
+                           Sym->getName());
       return 0;
+    }
     const wasm::WasmDataReference &Ref = DataLocations[Sym];
     const WasmDataSegment &Segment = DataSegments[Ref.Segment];
     // Ignore overflow. LLVM allows address arithmetic to silently wrap.
@@ -660,6 +677,78 @@ WasmObjectWriter::getRelocationIndexValue(const WasmRelocationEntry &RelEntry) {
   return RelEntry.Symbol->getIndex();
 }
 
+// The number of bytes the assembler reserves for a relocation of this type.
+static unsigned getRelocationSize(unsigned Type) {
+  switch (Type) {
+  case wasm::R_WEBASSEMBLY_TABLE_INDEX_I32:
+  case wasm::R_WEBASSEMBLY_MEMORY_ADDR_I32:
+  case wasm::R_WEBASSEMBLY_FUNCTION_OFFSET_I32:
+  case wasm::R_WEBASSEMBLY_SECTION_OFFSET_I32:
+    return 4;
+  default:
+    return 5;
+  }
+}
+
+// Write the provisional value of RelEntry at Loc, and return the number of
+// bytes written.  LEBs are padded to allow patching, unless Minimal is set.
+unsigned WasmObjectWriter::applyRelocation(const WasmRelocationEntry &RelEntry,
+                                           uint8_t *Loc, bool Minimal) {
+  LLVM_DEBUG(dbgs() << "applyRelocation: " << RelEntry << "\n");
+  uint32_t Value = getProvisionalValue(RelEntry);
+
+  switch (RelEntry.Type) {
+  case wasm::R_WEBASSEMBLY_FUNCTION_INDEX_LEB:
+  case wasm::R_WEBASSEMBLY_TYPE_INDEX_LEB:
+  case wasm::R_WEBASSEMBLY_GLOBAL_INDEX_LEB:
+  case wasm::R_WEBASSEMBLY_MEMORY_ADDR_LEB:
+    return Minimal ? encodeULEB128(Value, Loc) : WritePatchableLEB(Loc, Value);
+  case wasm::R_WEBASSEMBLY_TABLE_INDEX_I32:
+  case wasm::R_WEBASSEMBLY_MEMORY_ADDR_I32:
+  case wasm::R_WEBASSEMBLY_FUNCTION_OFFSET_I32:
+  case wasm::R_WEBASSEMBLY_SECTION_OFFSET_I32:
+    return WriteI32(Loc, Value);
+  case wasm::R_WEBASSEMBLY_TABLE_INDEX_SLEB:
+  case wasm::R_WEBASSEMBLY_MEMORY_ADDR_SLEB:
+    return Minimal ? encodeSLEB128(int32_t(Value), Loc)
+                   : WritePatchableSLEB(Loc, Value);
+  default:
+    llvm_unreachable("invalid relocation type");
+  }
+}
+
+// Resolve Relocs, which all point into Body, while rewriting Body in place
+// in a single pass.  Each relocated LEB is written at its minimal width
+// instead of padded to five bytes.  Returns the number of bytes saved.
+size_t WasmObjectWriter::compactBody(
+    SmallVectorImpl<char> &Body,
+    MutableArrayRef<const WasmRelocationEntry *> Relocs) {
+  std::sort(Relocs.begin(), Relocs.end(),
+            [](const WasmRelocationEntry *A, const WasmRelocationEntry *B) {
+              return A->Offset < B->Offset;
+            });
+
+  // The output never gets ahead of the input, so the rewrite can share the
+  // buffer.
+  char *Out = Body.data();
+  const char *In = Body.data();
+  for (const WasmRelocationEntry *RelEntry : Relocs) {
+    const char *Fixup = Body.data() + RelEntry->Offset;
+    std::memmove(Out, In, Fixup - In);
+    Out += Fixup - In;
+    Out += applyRelocation(*RelEntry, reinterpret_cast<uint8_t *>(Out),
+                           /*Minimal=*/true);
+    In = Fixup + getRelocationSize(RelEntry->Type);
+  }
+  const char *End = Body.data() + Body.size();
+  std::memmove(Out, In, End - In);
+  Out += End - In;
+
+  size_t Saved = End - Out;
+  Body.resize(Out - Body.data());
+  return Saved;
+}
+
 // Apply the portions of the relocation records that we can handle ourselves
 // directly.
 void WasmObjectWriter::applyRelocations(
@@ -669,30 +758,9 @@ void WasmObjectWriter::applyRelocations(
     uint64_t Offset = ContentsOffset +
                       RelEntry.FixupSection->getSectionOffset() +
                       RelEntry.Offset;
-
-    LLVM_DEBUG(dbgs() << "applyRelocation: " << RelEntry << "\n");
-    uint32_t Value = getProvisionalValue(RelEntry);
-
-    switch (RelEntry.Type) {
-    case wasm::R_WEBASSEMBLY_FUNCTION_INDEX_LEB:
-    case wasm::R_WEBASSEMBLY_TYPE_INDEX_LEB:
-    case wasm::R_WEBASSEMBLY_GLOBAL_INDEX_LEB:
-    case wasm::R_WEBASSEMBLY_MEMORY_ADDR_LEB:
-      WritePatchableLEB(Stream, Value, Offset);
-      break;
-    case wasm::R_WEBASSEMBLY_TABLE_INDEX_I32:
-    case wasm::R_WEBASSEMBLY_MEMORY_ADDR_I32:
-    case wasm::R_WEBASSEMBLY_FUNCTION_OFFSET_I32:
-    case wasm::R_WEBASSEMBLY_SECTION_OFFSET_I32:
-      WriteI32(Stream, Value, Offset);
-      break;
-    case wasm::R_WEBASSEMBLY_TABLE_INDEX_SLEB:
-    case wasm::R_WEBASSEMBLY_MEMORY_ADDR_SLEB:
-      WritePatchableSLEB(Stream, Value, Offset);
-      break;
-    default:
-      llvm_unreachable("invalid relocation type");
-    }
+    uint8_t Buffer[5];
+    unsigned Size = applyRelocation(RelEntry, Buffer);
+    Stream.pwrite((char *)Buffer, Size, Offset);
   }
 }
 
@@ -846,20 +914,76 @@ void WasmObjectWriter::writeCodeSection(const MCAssembler &Asm,
 
   encodeULEB128(Functions.size(), W.OS);
 
-  for (const WasmFunction &Func : Functions) {
-    auto &FuncSection = static_cast<MCSectionWasm &>(Func.Sym->getSection());
+  // Once layout is done the function bodies don't depend on each other, so
+  // encode each into a buffer of its own, in parallel for large modules.
+  std::vector<SmallVector<char, 0>> Bodies(Functions.size());
+  auto EncodeBody = [&](size_t I) {
+    raw_svector_ostream OS(Bodies[I]);
+    Asm.writeSectionData(OS, &Functions[I].Sym->getSection(), Layout);
+  };
+#if LLVM_ENABLE_THREADS
+  if (Functions.size() >= kParallelCodeThreshold && !SerialCodeSection) {
+    parallel::for_each_n(parallel::par, size_t(0), Functions.size(),
+                         EncodeBody);
+  } else {
+    parallel::for_each_n(parallel::seq, size_t(0), Functions.size(),
+                         EncodeBody);
+  }
+#else
+  parallel::for_each_n(parallel::seq, size_t(0), Functions.size(), EncodeBody);
+#endif
+
+  DenseMap<const MCSection *, size_t> BodyIndices;
+  for (size_t I = 0, E = Functions.size(); I != E; ++I)
+    BodyIndices[&Functions[I].Sym->getSection()] = I;
+  auto getBodyIndex = [&](const WasmRelocationEntry &RelEntry) {
+    auto It = BodyIndices.find(RelEntry.FixupSection);
+    assert(It != BodyIndices.end() && "fixup outside of a function body");
+    return It->second;
+  };
+
+  // A compact object has its code relocations resolved while the bodies are
+  // rewritten, since the bodies shrink.  Nothing in the code section refers
+  // to a code offset, so this can happen before the layout below.
+  std::vector<size_t> Saved(Functions.size());
+  if (TargetObjectWriter->isCompact()) {
+    std::vector<std::vector<const WasmRelocationEntry *>> BodyRelocs(
+        Functions.size());
+    for (const WasmRelocationEntry &RelEntry : CodeRelocations)
+      BodyRelocs[getBodyIndex(RelEntry)].push_back(&RelEntry);
+    for (size_t I = 0, E = Functions.size(); I != E; ++I)
+      Saved[I] = compactBody(Bodies[I], BodyRelocs[I]);
+  }
+
+  // Lay the bodies out as the serial writer would, so that every section
+  // offset is known before any relocation is resolved.
+  uint64_t Offset = W.OS.tell() - Section.ContentsOffset;
+  SmallVector<uint64_t, 4> SizeFields;
+  for (size_t I = 0, E = Functions.size(); I != E; ++I) {
+    auto &FuncSection =
+        static_cast<MCSectionWasm &>(Functions[I].Sym->getSection());
 
     int64_t Size = 0;
-    if (!Func.Sym->getSize()->evaluateAsAbsolute(Size, Layout))
+    if (!Functions[I].Sym->getSize()->evaluateAsAbsolute(Size, Layout))
       report_fatal_error(".size expression must be evaluatable");
 
-    encodeULEB128(Size, W.OS);
-    FuncSection.setSectionOffset(W.OS.tell() - Section.ContentsOffset);
-    Asm.writeSectionData(W.OS, &FuncSection, Layout);
+    SizeFields.push_back(Size - Saved[I]);
+    Offset += getULEB128Size(SizeFields.back());
+    FuncSection.setSectionOffset(Offset);
+    Offset += Bodies[I].size();
   }
 
-  // Apply fixups.
-  applyRelocations(CodeRelocations, Section.ContentsOffset);
+  // Apply fixups to the buffers, then write them out.
+  if (!TargetObjectWriter->isCompact())
+    for (const WasmRelocationEntry &RelEntry : CodeRelocations)
+      applyRelocation(RelEntry,
+                      reinterpret_cast<uint8_t *>(
+                          Bodies[getBodyIndex(RelEntry)].data() +
+                          RelEntry.Offset));
+  for (size_t I = 0, E = Functions.size(); I != E; ++I) {
+    encodeULEB128(SizeFields[I], W.OS);
+    W.OS << Bodies[I];
+  }
 
   endSection(Section);
 }
@@ -1467,10 +1591,14 @@ uint64_t WasmObjectWriter::writeObject(MCAssembler &Asm,
   writeCodeSection(Asm, Layout, Functions);
   writeDataSection();
   writeCustomSections(Asm, Layout);
-  writeLinkingMetaDataSection(SymbolInfos, InitFuncs, Comdats);
-  writeRelocSection(CodeSectionIndex, "CODE", CodeRelocations);
-  writeRelocSection(DataSectionIndex, "DATA", DataRelocations);
-  writeCustomRelocSections();
+  // A compact object is final: everything has been resolved in place, and
+  // without a linking section the linker won't take it as an input.
+  if (!TargetObjectWriter->isCompact()) {
+    writeLinkingMetaDataSection(SymbolInfos, InitFuncs, Comdats);
+    writeRelocSection(CodeSectionIndex, "CODE", CodeRelocations);
+    writeRelocSection(DataSectionIndex, "DATA", DataRelocations);
+    writeCustomRelocSections();
+  }
 
   // TODO: Translate the .comment section to the output.
   return W.OS.tell() - StartOffset;
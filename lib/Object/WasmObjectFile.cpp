@@ -53,9 +53,9 @@ LLVM_DUMP_METHOD void WasmSymbol::dump() const { print(dbgs()); }
 #endif
 
 Expected<std::unique_ptr<WasmObjectFile>>
-ObjectFile::createWasmObjectFile(MemoryBufferRef Buffer) {
+ObjectFile::createWasmObjectFile(MemoryBufferRef Buffer, bool Lazy) {
   Error Err = Error::success();
-  auto ObjectFile = llvm::make_unique<WasmObjectFile>(Buffer, Err);
+  auto ObjectFile = llvm::make_unique<WasmObjectFile>(Buffer, Err, Lazy);
   if (Err)
     return std::move(Err);
 
@@ -225,7 +225,7 @@ static Error readSection(WasmSection &Section,
   return Error::success();
 }
 
-WasmObjectFile::WasmObjectFile(MemoryBufferRef Buffer, Error &Err)
+WasmObjectFile::WasmObjectFile(MemoryBufferRef Buffer, Error &Err, bool Lazy)
     : ObjectFile(Binary::ID_Wasm, Buffer) {
   ErrorAsOutParameter ErrAsOutParam(&Err);
   Header.Magic = getData().substr(0, 4);
@@ -253,18 +253,71 @@ WasmObjectFile::WasmObjectFile(MemoryBufferRef Buffer, Error &Err)
     return;
   }
 
-  WasmSection Sec;
   while (Ctx.Ptr < Ctx.End) {
+    WasmSection Sec;
     if ((Err = readSection(Sec, Ctx)))
       return;
-    if ((Err = parseSection(Sec)))
-      return;
-
+    if (Sec.Type == wasm::WASM_SEC_CUSTOM && Sec.Name == "linking")
+      HasLinkingSection = true;
     Sections.push_back(Sec);
   }
+
+  if (!Lazy)
+    Err = parseSections(true);
 }
 
-Error WasmObjectFile::parseSection(WasmSection &Sec) {
+// The sections every query about the module as a whole may need.  None of
+// them refers to the code or data sections, or to the custom sections that
+// describe those, so they can be decoded without touching the (usually much
+// larger) rest of the file.
+static bool isModuleSection(const WasmSection &Sec) {
+  switch (Sec.Type) {
+  case wasm::WASM_SEC_CODE:
+  case wasm::WASM_SEC_DATA:
+    return false;
+  case wasm::WASM_SEC_CUSTOM:
+    return Sec.Name == ".imports" || Sec.Name == ".snax_abi" ||
+           Sec.Name == ".snax_actions" || Sec.Name == ".snax_notify";
+  default:
+    return true;
+  }
+}
+
+Error WasmObjectFile::parseSections(bool All) {
+  if (ModuleParsed && (AllParsed || !All))
+    return Error::success();
+  // The tables are filled in as the sections are decoded, so a pass that
+  // failed part way can't simply be run again.
+  if (ParseFailed)
+    return make_error<GenericBinaryError>("Malformed section body",
+                                          object_error::parse_failed);
+  if (!ModuleParsed) {
+    for (uint32_t I = 0, E = Sections.size(); I != E; ++I)
+      if (isModuleSection(Sections[I]))
+        if (Error Err = parseSection(I)) {
+          ParseFailed = true;
+          return Err;
+        }
+    ModuleParsed = true;
+  }
+  if (All && !AllParsed) {
+    for (uint32_t I = 0, E = Sections.size(); I != E; ++I)
+      if (!isModuleSection(Sections[I]))
+        if (Error Err = parseSection(I)) {
+          ParseFailed = true;
+          return Err;
+        }
+    AllParsed = true;
+  }
+  return Error::success();
+}
+
+Error WasmObjectFile::parseModuleSections() { return parseSections(false); }
+
+Error WasmObjectFile::parseAllSections() { return parseSections(true); }
+
+Error WasmObjectFile::parseSection(uint32_t Index) {
+  WasmSection &Sec = Sections[Index];
   ReadContext Ctx;
   Ctx.Start = Sec.Content.data();
   Ctx.End = Ctx.Start + Sec.Content.size();
@@ -283,6 +336,7 @@ Error WasmObjectFile::parseSection(WasmSection &Sec) {
   case wasm::WASM_SEC_MEMORY:
     return parseMemorySection(Ctx);
   case wasm::WASM_SEC_GLOBAL:
+    GlobalSection = Index;
     return parseGlobalSection(Ctx);
   case wasm::WASM_SEC_EXPORT:
     return parseExportSection(Ctx);
@@ -291,8 +345,10 @@ Error WasmObjectFile::parseSection(WasmSection &Sec) {
   case wasm::WASM_SEC_ELEM:
     return parseElemSection(Ctx);
   case wasm::WASM_SEC_CODE:
+    CodeSection = Index;
     return parseCodeSection(Ctx);
   case wasm::WASM_SEC_DATA:
+    DataSection = Index;
     return parseDataSection(Ctx);
   default:
     return make_error<GenericBinaryError>("Bad section type",
@@ -300,6 +356,33 @@ Error WasmObjectFile::parseSection(WasmSection &Sec) {
   }
 }
 
+void WasmSnaxTable::buildIndex() {
+  Index.clear();
+  if (std::is_sorted(Entries.begin(), Entries.end()))
+    return;
+  Index.resize(Entries.size());
+  for (uint32_t I = 0, E = Entries.size(); I != E; ++I)
+    Index[I] = I;
+  std::stable_sort(Index.begin(), Index.end(), [&](uint32_t A, uint32_t B) {
+    return Entries[A] < Entries[B];
+  });
+}
+
+Optional<uint32_t> WasmSnaxTable::find(StringRef Name) const {
+  if (Index.empty()) {
+    auto It = std::lower_bound(Entries.begin(), Entries.end(), Name);
+    if (It == Entries.end() || *It != Name)
+      return None;
+    return uint32_t(It - Entries.begin());
+  }
+  auto It = std::lower_bound(
+      Index.begin(), Index.end(), Name,
+      [&](uint32_t I, StringRef N) { return Entries[I] < N; });
+  if (It == Index.end() || Entries[*It] != Name)
+    return None;
+  return *It;
+}
+
 Error WasmObjectFile::parseSnaxABISection(ReadContext& Ctx) {
    StringRef sr = readString(Ctx);
    snax_abi = sr;
@@ -311,40 +394,62 @@ Error WasmObjectFile::parseSnaxABISection(ReadContext& Ctx) {
 
 }
 
-Error WasmObjectFile::parseAllowedSection(ReadContext& Ctx) {
-   while (Ctx.Ptr < Ctx.End) {
-    StringRef Name = readString(Ctx);
-    AllowedImports.push_back(Name);
-   }
-
-   if (Ctx.Ptr != Ctx.End)
-      return make_error<GenericBinaryError>("allowed import section ended prematurely",
-                                          object_error::parse_failed);
-   return Error::success();
+// The readers above abort on malformed input.  These report whether they
+// succeeded instead, for the sections parsed here from scratch.
+static bool tryReadULEB128(WasmObjectFile::ReadContext &Ctx, uint64_t &Value) {
+  unsigned Count;
+  const char *Error = nullptr;
+  Value = decodeULEB128(Ctx.Ptr, &Count, Ctx.End, &Error);
+  if (Error)
+    return false;
+  Ctx.Ptr += Count;
+  return true;
 }
 
-Error WasmObjectFile::parseActionsSection(ReadContext& Ctx) {
-   while (Ctx.Ptr < Ctx.End) {
-    StringRef Name = readString(Ctx);
-    Actions.push_back(Name);
-   }
-
-   if (Ctx.Ptr != Ctx.End)
-      return make_error<GenericBinaryError>("actions section ended prematurely",
-                                          object_error::parse_failed);
-   return Error::success();
+static bool tryReadString(WasmObjectFile::ReadContext &Ctx, StringRef &Str) {
+  uint64_t StringLen;
+  if (!tryReadULEB128(Ctx, StringLen) ||
+      StringLen > uint64_t(Ctx.End - Ctx.Ptr))
+    return false;
+  Str = StringRef(reinterpret_cast<const char *>(Ctx.Ptr), StringLen);
+  Ctx.Ptr += StringLen;
+  return true;
 }
 
-Error WasmObjectFile::parseNotifySection(ReadContext& Ctx) {
-   while (Ctx.Ptr < Ctx.End) {
-    StringRef Name = readString(Ctx);
-    Notify.push_back(Name);
-   }
-
-   if (Ctx.Ptr != Ctx.End)
-      return make_error<GenericBinaryError>("notify section ended prematurely",
+Error WasmObjectFile::parseSnaxTable(ReadContext &Ctx, WasmSnaxTable &Table,
+                                     StringRef SectionName) {
+  auto Malformed = [&]() {
+    return make_error<GenericBinaryError>("Malformed " + SectionName +
+                                              " section",
                                           object_error::parse_failed);
-   return Error::success();
+  };
+
+  if (Ctx.Ptr != Ctx.End && *Ctx.Ptr == wasm::WASM_SNAX_TABLE_SORTED) {
+    ++Ctx.Ptr;
+    uint64_t Count;
+    if (!tryReadULEB128(Ctx, Count) || Count > uint64_t(Ctx.End - Ctx.Ptr))
+      return Malformed();
+    Table.Entries.reserve(Count);
+    while (Count--) {
+      StringRef Name;
+      if (!tryReadString(Ctx, Name))
+        return Malformed();
+      Table.Entries.push_back(Name);
+    }
+    if (Ctx.Ptr != Ctx.End)
+      return Malformed();
+  } else {
+    // A table without a header: the names run to the end of the section.
+    while (Ctx.Ptr != Ctx.End) {
+      StringRef Name;
+      if (!tryReadString(Ctx, Name))
+        return Malformed();
+      Table.Entries.push_back(Name);
+    }
+  }
+
+  Table.buildIndex();
+  return Error::success();
 }
 
 Error WasmObjectFile::parseNameSection(ReadContext &Ctx) {
@@ -394,7 +499,6 @@ Error WasmObjectFile::parseNameSection(ReadContext &Ctx) {
 }
 
 Error WasmObjectFile::parseLinkingSection(ReadContext &Ctx) {
-  HasLinkingSection = true;
   if (Functions.size() != FunctionTypes.size()) {
     return make_error<GenericBinaryError>(
         "Linking data must come after code section", object_error::parse_failed);
@@ -714,16 +818,16 @@ Error WasmObjectFile::parseRelocSection(StringRef Name, ReadContext &Ctx) {
 
 Error WasmObjectFile::parseCustomSection(WasmSection &Sec, ReadContext &Ctx) {
   if (Sec.Name == ".imports") {
-     if (Error Err = parseAllowedSection(Ctx))
+     if (Error Err = parseSnaxTable(Ctx, AllowedImports, Sec.Name))
         return Err;
   } else if (Sec.Name == ".snax_abi") {
      if (Error Err = parseSnaxABISection(Ctx))
         return Err;
   } else if (Sec.Name == ".snax_actions") {
-     if (Error Err = parseActionsSection(Ctx))
+     if (Error Err = parseSnaxTable(Ctx, Actions, Sec.Name))
         return Err;
   } else if (Sec.Name == ".snax_notify") {
-     if (Error Err = parseNotifySection(Ctx))
+     if (Error Err = parseSnaxTable(Ctx, Notify, Sec.Name))
         return Err;
   } else if (Sec.Name == "name") {
     if (Error Err = parseNameSection(Ctx))
@@ -757,11 +861,10 @@ Error WasmObjectFile::parseTypeSection(ReadContext &Ctx) {
     }
     uint32_t ReturnCount = readVaruint32(Ctx);
     if (ReturnCount) {
-      if (ReturnCount != 1) {
-        return make_error<GenericBinaryError>(
-            "Multiple return types not supported", object_error::parse_failed);
-      }
       Sig.ReturnType = readUint8(Ctx);
+      Sig.ExtraReturnTypes.reserve(ReturnCount - 1);
+      while (--ReturnCount)
+        Sig.ExtraReturnTypes.push_back(readUint8(Ctx));
     }
     Signatures.push_back(Sig);
   }
@@ -856,7 +959,6 @@ Error WasmObjectFile::parseMemorySection(ReadContext &Ctx) {
 }
 
 Error WasmObjectFile::parseGlobalSection(ReadContext &Ctx) {
-  GlobalSection = Sections.size();
   uint32_t Count = readVaruint32(Ctx);
   Globals.reserve(Count);
   while (Count--) {
@@ -959,7 +1061,6 @@ Error WasmObjectFile::parseStartSection(ReadContext &Ctx) {
 }
 
 Error WasmObjectFile::parseCodeSection(ReadContext &Ctx) {
-  CodeSection = Sections.size();
   uint32_t FunctionCount = readVaruint32(Ctx);
   if (FunctionCount != FunctionTypes.size()) {
     return make_error<GenericBinaryError>("Invalid function count",
@@ -1025,7 +1126,6 @@ Error WasmObjectFile::parseElemSection(ReadContext &Ctx) {
 }
 
 Error WasmObjectFile::parseDataSection(ReadContext &Ctx) {
-  DataSection = Sections.size();
   uint32_t Count = readVaruint32(Ctx);
   DataSegments.reserve(Count);
   while (Count--) {
@@ -1082,12 +1182,14 @@ uint32_t WasmObjectFile::getSymbolFlags(DataRefImpl Symb) const {
 }
 
 basic_symbol_iterator WasmObjectFile::symbol_begin() const {
+  requireAllSections();
   DataRefImpl Ref;
   Ref.d.a = 0;
   return BasicSymbolRef(Ref, this);
 }
 
 basic_symbol_iterator WasmObjectFile::symbol_end() const {
+  requireAllSections();
   DataRefImpl Ref;
   Ref.d.a = Symbols.size();
   return BasicSymbolRef(Ref, this);
@@ -1263,6 +1365,7 @@ bool WasmObjectFile::isSectionVirtual(DataRefImpl Sec) const { return false; }
 bool WasmObjectFile::isSectionBitcode(DataRefImpl Sec) const { return false; }
 
 relocation_iterator WasmObjectFile::section_rel_begin(DataRefImpl Ref) const {
+  requireAllSections();
   DataRefImpl RelocRef;
   RelocRef.d.a = Ref.d.a;
   RelocRef.d.b = 0;
@@ -1270,6 +1373,7 @@ relocation_iterator WasmObjectFile::section_rel_begin(DataRefImpl Ref) const {
 }
 
 relocation_iterator WasmObjectFile::section_rel_end(DataRefImpl Ref) const {
+  requireAllSections();
   const WasmSection &Sec = getWasmSection(Ref);
   DataRefImpl RelocRef;
   RelocRef.d.a = Ref.d.a;
@@ -240,6 +240,7 @@ void MappingTraits<WasmYAML::Signature>::mapping(
   IO.mapRequired("Index", Signature.Index);
   IO.mapRequired("ReturnType", Signature.ReturnType);
   IO.mapRequired("ParamTypes", Signature.ParamTypes);
+  IO.mapOptional("ExtraReturnTypes", Signature.ExtraReturnTypes);
 }
 
 void MappingTraits<WasmYAML::Table>::mapping(IO &IO, WasmYAML::Table &Table) {
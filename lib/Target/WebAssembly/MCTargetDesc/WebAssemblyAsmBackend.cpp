@@ -33,10 +33,12 @@ namespace {
 class WebAssemblyAsmBackend final : public MCAsmBackend {
   bool Is64Bit;
   bool IsELF;
+  bool IsCompact;
 
  public:
-  explicit WebAssemblyAsmBackend(bool Is64Bit, bool IsELF)
-      : MCAsmBackend(support::little), Is64Bit(Is64Bit), IsELF(IsELF) {}
+  explicit WebAssemblyAsmBackend(bool Is64Bit, bool IsELF, bool IsCompact)
+      : MCAsmBackend(support::little), Is64Bit(Is64Bit), IsELF(IsELF),
+        IsCompact(IsCompact) {}
   ~WebAssemblyAsmBackend() override {}
 
   unsigned getNumFixupKinds() const override {
@@ -127,11 +129,13 @@ void WebAssemblyAsmBackend::applyFixup(const MCAssembler &Asm,
 std::unique_ptr<MCObjectTargetWriter>
 WebAssemblyAsmBackend::createObjectTargetWriter() const {
   return IsELF ? createWebAssemblyELFObjectWriter(Is64Bit, 0)
-               : createWebAssemblyWasmObjectWriter(Is64Bit);
+               : createWebAssemblyWasmObjectWriter(Is64Bit, IsCompact);
 }
 
 } // end anonymous namespace
 
-MCAsmBackend *llvm::createWebAssemblyAsmBackend(const Triple &TT) {
-  return new WebAssemblyAsmBackend(TT.isArch64Bit(), TT.isOSBinFormatELF());
+MCAsmBackend *llvm::createWebAssemblyAsmBackend(const Triple &TT,
+                                                bool IsCompact) {
+  return new WebAssemblyAsmBackend(TT.isArch64Bit(), TT.isOSBinFormatELF(),
+                                   IsCompact);
 }
@@ -71,8 +71,9 @@ static MCCodeEmitter *createCodeEmitter(const MCInstrInfo &MCII,
 static MCAsmBackend *createAsmBackend(const Target & /*T*/,
                                       const MCSubtargetInfo &STI,
                                       const MCRegisterInfo & /*MRI*/,
-                                      const MCTargetOptions & /*Options*/) {
-  return createWebAssemblyAsmBackend(STI.getTargetTriple());
+                                      const MCTargetOptions &Options) {
+  return createWebAssemblyAsmBackend(STI.getTargetTriple(),
+                                     Options.MCWasmCompactObject);
 }
 
 static MCSubtargetInfo *createMCSubtargetInfo(const Triple &TT, StringRef CPU,
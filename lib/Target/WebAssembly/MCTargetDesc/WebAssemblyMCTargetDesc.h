@@ -38,13 +38,13 @@ Target &getTheWebAssemblyTarget64();
 
 MCCodeEmitter *createWebAssemblyMCCodeEmitter(const MCInstrInfo &MCII);
 
-MCAsmBackend *createWebAssemblyAsmBackend(const Triple &TT);
+MCAsmBackend *createWebAssemblyAsmBackend(const Triple &TT, bool IsCompact);
 
 std::unique_ptr<MCObjectTargetWriter>
 createWebAssemblyELFObjectWriter(bool Is64Bit, uint8_t OSABI);
 
 std::unique_ptr<MCObjectTargetWriter>
-createWebAssemblyWasmObjectWriter(bool Is64Bit);
+createWebAssemblyWasmObjectWriter(bool Is64Bit, bool IsCompact);
 
 namespace WebAssembly {
 enum OperandType {
@@ -94,9 +94,13 @@ void WebAssemblyTargetAsmStreamer::emitIndirectFunctionType(
   OS << "\t.functype\t" << Symbol->getName();
   if (Results.empty())
     OS << ", void";
-  else {
-    assert(Results.size() == 1);
+  else if (Results.size() == 1)
     OS << ", " << WebAssembly::TypeToString(Results.front());
+  else {
+    OS << ", (";
+    for (size_t I = 0, E = Results.size(); I != E; ++I)
+      OS << (I ? ", " : "") << WebAssembly::TypeToString(Results[I]);
+    OS << ")";
   }
   for (auto Ty : Params)
     OS << ", " << WebAssembly::TypeToString(Ty);
@@ -23,6 +23,7 @@
 #include "WebAssemblyMachineFunctionInfo.h"
 #include "WebAssemblyRegisterInfo.h"
 #include "llvm/ADT/StringExtras.h"
+#include "llvm/BinaryFormat/Wasm.h"
 #include "llvm/CodeGen/Analysis.h"
 #include "llvm/CodeGen/AsmPrinter.h"
 #include "llvm/CodeGen/MachineConstantPool.h"
@@ -153,82 +154,65 @@ void WebAssemblyAsmPrinter::EmitEndOfAsmFile(Module &M) {
       OutStreamer->PopSection();
     }
   }
-   
-  bool has_import = false;
-  bool has_abi    = false;
-  bool has_snax_action = false;
-  bool has_snax_notify = false;
+
+  // Collect the Snax tables in a single walk over the function attributes.
+  SmallVector<StringRef, 16> Imports;
+  SmallVector<StringRef, 16> Actions;
+  SmallVector<StringRef, 16> Notify;
+  SmallVector<StringRef, 1> ABIs;
   for (const auto &F : M) {
-     if (F.hasFnAttribute("snax_wasm_import"))
-        has_import = true;
-     if (F.hasFnAttribute("snax_wasm_abi"))
-        has_abi = true;
-     if (F.hasFnAttribute("snax_wasm_action"))
-        has_snax_action = true;
-     if (F.hasFnAttribute("snax_wasm_notify"))
-        has_snax_notify = true;
+    for (const Attribute &Attr :
+         F.getAttributes().getAttributes(AttributeList::FunctionIndex)) {
+      if (!Attr.isStringAttribute())
+        continue;
+      StringRef Kind = Attr.getKindAsString();
+      if (Kind == "snax_wasm_import")
+        Imports.push_back(F.getName());
+      else if (Kind == "snax_wasm_abi")
+        ABIs.push_back(Attr.getValueAsString());
+      else if (Kind == "snax_wasm_action")
+        Actions.push_back(Attr.getValueAsString());
+      else if (Kind == "snax_wasm_notify")
+        Notify.push_back(Attr.getValueAsString());
+    }
   }
 
-  if (has_import) {
-     OutStreamer->PushSection();
-     std::string SectionName = ".imports";
-     MCSectionWasm *mySection =
-         OutContext.getWasmSection(SectionName, SectionKind::getMetadata());
-     OutStreamer->SwitchSection(mySection);
-     for (const auto &F : M) {
-        if (F.hasFnAttribute("snax_wasm_import")) {
-           OutStreamer->EmitULEB128IntValue(F.getName().size());
-           OutStreamer->EmitBytes(F.getName());
-        }
-     }
-     OutStreamer->PopSection();
-  }
-  if (has_abi) {
-     OutStreamer->PushSection(); 
-     std::string SectionName = ".snax_abi";
-     MCSectionWasm *mySection =
-         OutContext.getWasmSection(SectionName, SectionKind::getMetadata());
-     OutStreamer->SwitchSection(mySection);
-     for (const auto &F : M) {
-        if (F.hasFnAttribute("snax_wasm_abi")) {
-           StringRef abi = F.getFnAttribute("snax_wasm_abi").getValueAsString();
-           OutStreamer->EmitULEB128IntValue(abi.size());
-           OutStreamer->EmitBytes(abi);
-        }
-     }
-     OutStreamer->PopSection();
-  }
-  if (has_snax_action) {
-     OutStreamer->PushSection(); 
-     std::string SectionName = ".snax_actions";
-     MCSectionWasm *mySection =
-         OutContext.getWasmSection(SectionName, SectionKind::getMetadata());
-     OutStreamer->SwitchSection(mySection);
-     for (const auto &F : M) {
-        if (F.hasFnAttribute("snax_wasm_action")) {
-           StringRef action_name = F.getFnAttribute("snax_wasm_action").getValueAsString();
-           OutStreamer->EmitULEB128IntValue(action_name.size());
-           OutStreamer->EmitBytes(action_name);
-        }
-     }
-     OutStreamer->PopSection();
-  }
-  if (has_snax_notify) {
-     OutStreamer->PushSection(); 
-     std::string SectionName = ".snax_notify";
-     MCSectionWasm *mySection =
-         OutContext.getWasmSection(SectionName, SectionKind::getMetadata());
-     OutStreamer->SwitchSection(mySection);
-     for (const auto &F : M) {
-        if (F.hasFnAttribute("snax_wasm_notify")) {
-           StringRef name = F.getFnAttribute("snax_wasm_notify").getValueAsString();
-           OutStreamer->EmitULEB128IntValue(name.size());
-           OutStreamer->EmitBytes(name);
-        }
-     }
-     OutStreamer->PopSection();
+  EmitSnaxTable(".imports", Imports);
+  if (!ABIs.empty()) {
+    OutStreamer->PushSection();
+    OutStreamer->SwitchSection(
+        OutContext.getWasmSection(".snax_abi", SectionKind::getMetadata()));
+    for (StringRef ABI : ABIs) {
+      OutStreamer->EmitULEB128IntValue(ABI.size());
+      OutStreamer->EmitBytes(ABI);
+    }
+    OutStreamer->PopSection();
   }
+  EmitSnaxTable(".snax_actions", Actions);
+  EmitSnaxTable(".snax_notify", Notify);
+}
 
+// Snax tables are a format byte and a ULEB128 entry count, followed by the
+// length-prefixed entries in sorted order without duplicates, so readers can
+// binary search them.  The format byte tells them apart from tables written
+// before there was a count.
+void WebAssemblyAsmPrinter::EmitSnaxTable(StringRef SectionName,
+                                          SmallVectorImpl<StringRef> &Entries) {
+  if (Entries.empty())
+    return;
+  std::sort(Entries.begin(), Entries.end());
+  Entries.erase(std::unique(Entries.begin(), Entries.end()), Entries.end());
+
+  OutStreamer->PushSection();
+  OutStreamer->SwitchSection(
+      OutContext.getWasmSection(SectionName, SectionKind::getMetadata()));
+  OutStreamer->EmitIntValue(wasm::WASM_SNAX_TABLE_SORTED, 1);
+  OutStreamer->EmitULEB128IntValue(Entries.size());
+  for (StringRef Entry : Entries) {
+    OutStreamer->EmitULEB128IntValue(Entry.size());
+    OutStreamer->EmitBytes(Entry);
+  }
+  OutStreamer->PopSection();
 }
 
 void WebAssemblyAsmPrinter::EmitConstantPool() {
@@ -243,7 +227,6 @@ void WebAssemblyAsmPrinter::EmitJumpTableInfo() {
 void WebAssemblyAsmPrinter::EmitFunctionBodyStart() {
   getTargetStreamer()->emitParam(CurrentFnSym, MFI->getParams());
 
-  SmallVector<MVT, 4> ResultVTs;
   const Function &F = MF->getFunction();
 
   // Emit the function index.
@@ -254,14 +237,9 @@ void WebAssemblyAsmPrinter::EmitFunctionBodyStart() {
         cast<ConstantAsMetadata>(Idx->getOperand(0))->getValue()));
   }
 
-  ComputeLegalValueVTs(F, TM, F.getReturnType(), ResultVTs);
-
-  // If the return type needs to be legalized it will get converted into
+  // Results that can't be returned directly have already been converted into
   // passing a pointer.
-  if (ResultVTs.size() == 1)
-    getTargetStreamer()->emitResult(CurrentFnSym, ResultVTs);
-  else
-    getTargetStreamer()->emitResult(CurrentFnSym, ArrayRef<MVT>());
+  getTargetStreamer()->emitResult(CurrentFnSym, MFI->getResults());
 
   if (TM.getTargetTriple().isOSBinFormatELF()) {
     assert(MFI->getLocals().empty());
@@ -306,6 +284,23 @@ void WebAssemblyAsmPrinter::EmitInstruction(const MachineInstr *MI) {
     // These represent values which are live into the function entry, so there's
     // no instruction to emit.
     break;
+  case WebAssembly::CALL_RESULT_I32:
+  case WebAssembly::CALL_RESULT_I64:
+  case WebAssembly::CALL_RESULT_F32:
+  case WebAssembly::CALL_RESULT_F64: {
+    // These represent the results a multivalue call leaves on the stack, so
+    // there's no instruction to emit either.
+    if (isVerbose()) {
+      unsigned Reg = MI->getOperand(0).getReg();
+      unsigned WAReg = MFI->getWAReg(Reg);
+      OutStreamer->AddComment(
+          MFI->isVRegStackified(Reg)
+              ? "call-result: $push" + Twine(MFI->getWARegStackId(WAReg))
+              : "call-result: $" + Twine(WAReg));
+      OutStreamer->AddBlankLine();
+    }
+    break;
+  }
   case WebAssembly::FALLTHROUGH_RETURN_I32:
   case WebAssembly::FALLTHROUGH_RETURN_I64:
   case WebAssembly::FALLTHROUGH_RETURN_F32:
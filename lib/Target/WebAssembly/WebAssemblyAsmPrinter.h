@@ -70,6 +70,10 @@ public:
   MVT getRegType(unsigned RegNo) const;
   std::string regToString(const MachineOperand &MO);
   WebAssemblyTargetStreamer *getTargetStreamer();
+
+private:
+  void EmitSnaxTable(StringRef SectionName,
+                     SmallVectorImpl<StringRef> &Entries);
 };
 
 } // end namespace llvm
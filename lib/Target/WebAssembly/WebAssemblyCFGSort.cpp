@@ -23,17 +23,28 @@
 #include "WebAssemblyUtilities.h"
 #include "llvm/ADT/PriorityQueue.h"
 #include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/CodeGen/MachineBlockFrequencyInfo.h"
 #include "llvm/CodeGen/MachineDominators.h"
 #include "llvm/CodeGen/MachineFunction.h"
 #include "llvm/CodeGen/MachineLoopInfo.h"
 #include "llvm/CodeGen/MachineRegisterInfo.h"
 #include "llvm/CodeGen/Passes.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 using namespace llvm;
 
 #define DEBUG_TYPE "wasm-cfg-sort"
 
+STATISTIC(NumFallthroughs, "Number of blocks placed after a predecessor");
+
+static cl::opt<bool> SortByFrequency(
+    "wasm-cfg-sort-by-frequency", cl::Hidden,
+    cl::desc("WebAssembly: When choosing which successor follows a block, "
+             "prefer the most frequently executed one."),
+    cl::init(false));
+
 namespace {
 class WebAssemblyCFGSort final : public MachineFunctionPass {
   StringRef getPassName() const override { return "WebAssembly CFG Sort"; }
@@ -44,6 +55,9 @@ class WebAssemblyCFGSort final : public MachineFunctionPass {
     AU.addPreserved<MachineDominatorTree>();
     AU.addRequired<MachineLoopInfo>();
     AU.addPreserved<MachineLoopInfo>();
+    if (SortByFrequency)
+      AU.addRequired<MachineBlockFrequencyInfo>();
+    AU.addPreserved<MachineBlockFrequencyInfo>();
     MachineFunctionPass::getAnalysisUsage(AU);
   }
 
@@ -81,10 +95,22 @@ static void MaybeUpdateTerminator(MachineBasicBlock *MBB) {
 }
 
 namespace {
-/// Sort blocks by their number.
+/// Sort blocks by their number, or, if MBFI is given, by their frequency
+/// first so that the hottest successor is placed to fall through.
 struct CompareBlockNumbers {
+  const MachineBlockFrequencyInfo *MBFI;
+
+  explicit CompareBlockNumbers(const MachineBlockFrequencyInfo *MBFI = nullptr)
+      : MBFI(MBFI) {}
+
   bool operator()(const MachineBasicBlock *A,
                   const MachineBasicBlock *B) const {
+    if (MBFI) {
+      uint64_t FA = MBFI->getBlockFreq(A).getFrequency();
+      uint64_t FB = MBFI->getBlockFreq(B).getFrequency();
+      if (FA != FB)
+        return FA < FB;
+    }
     return A->getNumber() > B->getNumber();
   }
 };
@@ -115,7 +141,8 @@ struct Entry {
 /// TODO: There are many opportunities for improving the heuristics here.
 /// Explore them.
 static void SortBlocks(MachineFunction &MF, const MachineLoopInfo &MLI,
-                       const MachineDominatorTree &MDT) {
+                       const MachineDominatorTree &MDT,
+                       const MachineBlockFrequencyInfo *MBFI) {
   // Prepare for a topological sort: Record the number of predecessors each
   // block has, ignoring loop backedges.
   MF.RenumberBlocks();
@@ -136,10 +163,12 @@ static void SortBlocks(MachineFunction &MF, const MachineLoopInfo &MLI,
   //  - It's desirable to preserve the original block order when possible.
   // We use two ready lists; Preferred and Ready. Preferred has recently
   // processed successors, to help preserve block sequences from the original
-  // order. Ready has the remaining ready blocks.
+  // order. Ready has the remaining ready blocks. With MBFI, Preferred offers
+  // the hottest successors first instead, so that they fall through and the
+  // colder ones end up after them, at the ends of blocks.
   PriorityQueue<MachineBasicBlock *, std::vector<MachineBasicBlock *>,
                 CompareBlockNumbers>
-      Preferred;
+      Preferred{CompareBlockNumbers(MBFI)};
   PriorityQueue<MachineBasicBlock *, std::vector<MachineBasicBlock *>,
                 CompareBlockNumbersBackwards>
       Ready;
@@ -186,7 +215,9 @@ static void SortBlocks(MachineFunction &MF, const MachineLoopInfo &MLI,
         continue;
       }
       // If Next was originally ordered before MBB, and it isn't because it was
-      // loop-rotated above the header, it's not preferred.
+      // loop-rotated above the header, it's not preferred. This keeps the
+      // original order even when sorting by frequency, since that's usually
+      // what earlier layout passes chose.
       if (Next->getNumber() < MBB->getNumber() &&
           (!L || !L->contains(Next) ||
            L->getHeader()->getNumber() < Next->getNumber())) {
@@ -218,6 +249,8 @@ static void SortBlocks(MachineFunction &MF, const MachineLoopInfo &MLI,
       }
     }
     // Move the next block into place and iterate.
+    if (MBB->isSuccessor(Next))
+      ++NumFallthroughs;
     Next->moveAfter(MBB);
     MaybeUpdateTerminator(MBB);
     MBB = Next;
@@ -273,8 +306,11 @@ bool WebAssemblyCFGSort::runOnMachineFunction(MachineFunction &MF) {
   // Liveness is not tracked for VALUE_STACK physreg.
   MF.getRegInfo().invalidateLiveness();
 
+  const MachineBlockFrequencyInfo *MBFI =
+      SortByFrequency ? &getAnalysis<MachineBlockFrequencyInfo>() : nullptr;
+
   // Sort the blocks, with contiguous loops.
-  SortBlocks(MF, MLI, MDT);
+  SortBlocks(MF, MLI, MDT, MBFI);
 
   return true;
 }
@@ -23,6 +23,7 @@
 #include "WebAssemblyMachineFunctionInfo.h"
 #include "WebAssemblySubtarget.h"
 #include "WebAssemblyUtilities.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/CodeGen/MachineDominators.h"
 #include "llvm/CodeGen/MachineFunction.h"
 #include "llvm/CodeGen/MachineInstrBuilder.h"
@@ -35,6 +36,11 @@ using namespace llvm;
 
 #define DEBUG_TYPE "wasm-cfg-stackify"
 
+STATISTIC(NumBlockMarkers, "Number of block markers placed");
+STATISTIC(NumLoopMarkers, "Number of loop markers placed");
+STATISTIC(NumBranches, "Number of branch instructions");
+STATISTIC(MaxNestingDepth, "Maximum nesting depth of blocks and loops");
+
 namespace {
 class WebAssemblyCFGStackify final : public MachineFunctionPass {
   StringRef getPassName() const override { return "WebAssembly CFG Stackify"; }
@@ -236,16 +242,34 @@ GetDepth(const SmallVectorImpl<const MachineBasicBlock *> &Stack,
 /// that end at the function end need to have a return type signature that
 /// matches the function signature, even though it's unreachable. This function
 /// checks for such cases and fixes up the signatures.
+///
+/// Block signatures can't describe multiple values, so for functions returning
+/// more than one an unreachable is placed after such ends instead.
 static void FixEndsAtEndOfFunction(
     MachineFunction &MF,
     const WebAssemblyFunctionInfo &MFI,
+    const WebAssemblyInstrInfo &TII,
     DenseMap<const MachineInstr *, MachineInstr *> &BlockTops,
     DenseMap<const MachineInstr *, MachineInstr *> &LoopTops) {
-  assert(MFI.getResults().size() <= 1);
-
   if (MFI.getResults().empty())
     return;
 
+  if (MFI.getResults().size() > 1) {
+    for (MachineBasicBlock &MBB : reverse(MF)) {
+      for (MachineInstr &MI : reverse(MBB)) {
+        if (MI.isPosition() || MI.isDebugInstr())
+          continue;
+        if (MI.getOpcode() == WebAssembly::END_BLOCK ||
+            MI.getOpcode() == WebAssembly::END_LOOP)
+          BuildMI(MF.back(), MF.back().end(),
+                  MF.back().findPrevDebugLoc(MF.back().end()),
+                  TII.get(WebAssembly::UNREACHABLE));
+        return;
+      }
+    }
+    return;
+  }
+
   WebAssembly::ExprType retType;
   switch (MFI.getResults().front().SimpleTy) {
   case MVT::i32: retType = WebAssembly::ExprType::I32; break;
@@ -323,18 +347,24 @@ static void PlaceMarkers(MachineFunction &MF, const MachineLoopInfo &MLI,
         assert(ScopeTops[Stack.back()->getNumber()]->getNumber() <= MBB.getNumber() &&
                "Block should be balanced");
         Stack.pop_back();
+        ++NumBlockMarkers;
         break;
       case WebAssembly::LOOP:
         assert(Stack.back() == &MBB && "Loop top should be balanced");
         Stack.pop_back();
+        ++NumLoopMarkers;
         break;
       case WebAssembly::END_BLOCK:
         Stack.push_back(&MBB);
+        MaxNestingDepth.updateMax(Stack.size());
         break;
       case WebAssembly::END_LOOP:
         Stack.push_back(LoopTops[&MI]->getParent());
+        MaxNestingDepth.updateMax(Stack.size());
         break;
       default:
+        if (MI.isBranch())
+          ++NumBranches;
         if (MI.isTerminator()) {
           // Rewrite MBB operands to be depth immediates.
           SmallVector<MachineOperand, 4> Ops(MI.operands());
@@ -354,7 +384,7 @@ static void PlaceMarkers(MachineFunction &MF, const MachineLoopInfo &MLI,
 
   // Fix up block/loop signatures at the end of the function to conform to
   // WebAssembly's rules.
-  FixEndsAtEndOfFunction(MF, MFI, BlockTops, LoopTops);
+  FixEndsAtEndOfFunction(MF, MFI, TII, BlockTops, LoopTops);
 
   // Add an end instruction at the end of the function body.
   if (!MF.getSubtarget<WebAssemblySubtarget>()
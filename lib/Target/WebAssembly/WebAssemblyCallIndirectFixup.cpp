@@ -73,6 +73,7 @@ static unsigned GetNonPseudoCallIndirectOpcode(const MachineInstr &MI) {
   case PCALL_INDIRECT_v8i16: return CALL_INDIRECT_v8i16;
   case PCALL_INDIRECT_v4i32: return CALL_INDIRECT_v4i32;
   case PCALL_INDIRECT_v4f32: return CALL_INDIRECT_v4f32;
+  case PRET_CALL_INDIRECT: return RET_CALL_INDIRECT;
   default: return INSTRUCTION_LIST_END;
   }
 }
@@ -21,6 +21,7 @@
 #include "WebAssemblyMachineFunctionInfo.h"
 #include "WebAssemblySubtarget.h"
 #include "WebAssemblyTargetMachine.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/BranchProbabilityInfo.h"
 #include "llvm/CodeGen/FastISel.h"
 #include "llvm/CodeGen/FunctionLoweringInfo.h"
@@ -41,6 +42,16 @@ using namespace llvm;
 
 #define DEBUG_TYPE "wasm-fastisel"
 
+STATISTIC(NumFailedCalls, "Number of calls left to SelectionDAG");
+STATISTIC(NumFailedIntrinsics,
+          "Number of intrinsic calls left to SelectionDAG");
+STATISTIC(NumFailedAtomics,
+          "Number of atomic operations left to SelectionDAG");
+STATISTIC(NumFailedVectors,
+          "Number of vector operations left to SelectionDAG");
+STATISTIC(NumFailedMemory, "Number of loads and stores left to SelectionDAG");
+STATISTIC(NumFailedOther, "Number of other instructions left to SelectionDAG");
+
 namespace {
 
 class WebAssemblyFastISel final : public FastISel {
@@ -184,6 +195,7 @@ private:
   bool selectBr(const Instruction *I);
   bool selectRet(const Instruction *I);
   bool selectUnreachable(const Instruction *I);
+  bool selectInstruction(const Instruction *I);
 
 public:
   // Backend specific FastISel code.
@@ -475,8 +487,18 @@ unsigned WebAssemblyFastISel::signExtendToI32(unsigned Reg, const Value *V,
 
   switch (From) {
   case MVT::i1:
+    break;
   case MVT::i8:
   case MVT::i16:
+    if (Subtarget->hasSignExt()) {
+      unsigned Result = createResultReg(&WebAssembly::I32RegClass);
+      BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DbgLoc,
+              TII.get(From == MVT::i8 ? WebAssembly::I32_EXTEND8_S_I32
+                                      : WebAssembly::I32_EXTEND16_S_I32),
+              Result)
+          .addReg(Reg);
+      return Result;
+    }
     break;
   case MVT::i32:
     return copyValue(Reg);
@@ -728,15 +750,38 @@ bool WebAssemblyFastISel::selectCall(const Instruction *I) {
       Call->getFunctionType()->isVarArg())
     return false;
 
-  Function *Func = Call->getCalledFunction();
+  const Function *Func = Call->getCalledFunction();
   if (Func && Func->isIntrinsic())
     return false;
 
-  bool IsDirect = Func != nullptr;
-  if (!IsDirect && isa<ConstantExpr>(Call->getCalledValue()))
-    return false;
-
   FunctionType *FuncTy = Call->getFunctionType();
+
+  // A call through a constant cast of a function with the same signature is
+  // just a direct call, and so is a round trip through a pointer-sized
+  // integer. Casts of functions with other signatures are left for
+  // FixFunctionBitcasts' wrappers or the linker; calling them through the
+  // table would trap on the signature check. Other constant callees are
+  // materialized and called indirectly.
+  if (!Func)
+    if (auto *CE = dyn_cast<ConstantExpr>(Call->getCalledValue())) {
+      if (!CE->isCast())
+        return false;
+      const Value *Callee = CE->stripPointerCasts();
+      if (auto *IntToPtr = dyn_cast<ConstantExpr>(Callee))
+        if (IntToPtr->getOpcode() == Instruction::IntToPtr)
+          if (auto *PtrToInt = dyn_cast<ConstantExpr>(IntToPtr->getOperand(0)))
+            if (PtrToInt->getOpcode() == Instruction::PtrToInt &&
+                DL.getTypeSizeInBits(PtrToInt->getType()) ==
+                    DL.getPointerSizeInBits())
+              Callee = PtrToInt->getOperand(0)->stripPointerCasts();
+      auto *F = dyn_cast<Function>(Callee);
+      if (F && !F->isIntrinsic() && F->getFunctionType() == FuncTy)
+        Func = F;
+      else if (isa<GlobalValue>(Callee))
+        return false;
+    }
+
+  bool IsDirect = Func != nullptr;
   unsigned Opc;
   bool IsVoid = FuncTy->getReturnType()->isVoidTy();
   unsigned ResultReg;
@@ -1119,7 +1164,8 @@ bool WebAssemblyFastISel::selectBitCast(const Instruction *I) {
 
 bool WebAssemblyFastISel::selectLoad(const Instruction *I) {
   const LoadInst *Load = cast<LoadInst>(I);
-  if (Load->isAtomic())
+  bool IsAtomic = Load->isAtomic();
+  if (IsAtomic && !Subtarget->hasAtomics())
     return false;
   if (!Subtarget->hasSIMD128() && Load->getType()->isVectorTy())
     return false;
@@ -1130,31 +1176,38 @@ bool WebAssemblyFastISel::selectLoad(const Instruction *I) {
 
   // TODO: Fold a following sign-/zero-extend into the load instruction.
 
+  // Atomic accesses are always sequentially consistent in wasm, so every
+  // atomic ordering maps onto the same instructions.
   unsigned Opc;
   const TargetRegisterClass *RC;
   switch (getSimpleType(Load->getType())) {
   case MVT::i1:
   case MVT::i8:
-    Opc = WebAssembly::LOAD8_U_I32;
+    Opc = IsAtomic ? WebAssembly::ATOMIC_LOAD8_U_I32 : WebAssembly::LOAD8_U_I32;
     RC = &WebAssembly::I32RegClass;
     break;
   case MVT::i16:
-    Opc = WebAssembly::LOAD16_U_I32;
+    Opc = IsAtomic ? WebAssembly::ATOMIC_LOAD16_U_I32
+                   : WebAssembly::LOAD16_U_I32;
     RC = &WebAssembly::I32RegClass;
     break;
   case MVT::i32:
-    Opc = WebAssembly::LOAD_I32;
+    Opc = IsAtomic ? WebAssembly::ATOMIC_LOAD_I32 : WebAssembly::LOAD_I32;
     RC = &WebAssembly::I32RegClass;
     break;
   case MVT::i64:
-    Opc = WebAssembly::LOAD_I64;
+    Opc = IsAtomic ? WebAssembly::ATOMIC_LOAD_I64 : WebAssembly::LOAD_I64;
     RC = &WebAssembly::I64RegClass;
     break;
   case MVT::f32:
+    if (IsAtomic)
+      return false;
     Opc = WebAssembly::LOAD_F32;
     RC = &WebAssembly::F32RegClass;
     break;
   case MVT::f64:
+    if (IsAtomic)
+      return false;
     Opc = WebAssembly::LOAD_F64;
     RC = &WebAssembly::F64RegClass;
     break;
@@ -1327,7 +1380,7 @@ bool WebAssemblyFastISel::selectUnreachable(const Instruction *I) {
   return true;
 }
 
-bool WebAssemblyFastISel::fastSelectInstruction(const Instruction *I) {
+bool WebAssemblyFastISel::selectInstruction(const Instruction *I) {
   switch (I->getOpcode()) {
   case Instruction::Call:
     if (selectCall(I))
@@ -1352,6 +1405,39 @@ bool WebAssemblyFastISel::fastSelectInstruction(const Instruction *I) {
   return selectOperator(I, I->getOpcode());
 }
 
+/// Count an instruction FastISel couldn't select, by the reason it most
+/// likely failed, so it's easy to see which forms still need work.
+static void countFailure(const Instruction *I) {
+  if (I->isAtomic()) {
+    ++NumFailedAtomics;
+    return;
+  }
+
+  bool IsVector = I->getType()->isVectorTy();
+  for (const Value *Op : I->operands())
+    IsVector |= Op->getType()->isVectorTy();
+  if (IsVector) {
+    ++NumFailedVectors;
+    return;
+  }
+
+  if (isa<IntrinsicInst>(I))
+    ++NumFailedIntrinsics;
+  else if (isa<CallInst>(I))
+    ++NumFailedCalls;
+  else if (isa<LoadInst>(I) || isa<StoreInst>(I))
+    ++NumFailedMemory;
+  else
+    ++NumFailedOther;
+}
+
+bool WebAssemblyFastISel::fastSelectInstruction(const Instruction *I) {
+  if (selectInstruction(I))
+    return true;
+  countFailure(I);
+  return false;
+}
+
 FastISel *WebAssembly::createFastISel(FunctionLoweringInfo &FuncInfo,
                                       const TargetLibraryInfo *LibInfo) {
   return new WebAssemblyFastISel(FuncInfo, LibInfo);
@@ -17,12 +17,16 @@
 /// it linearizes control flow, turning diamonds into two triangles, which is
 /// both unnecessary and undesirable for WebAssembly.
 ///
-/// TODO: The transformation implemented here handles all irreducible control
-/// flow, without exponential code-size expansion, though it does so by creating
-/// inefficient code in many cases. Ideally, we should add other
-/// transformations, including code-duplicating cases, which can be more
-/// efficient in common cases, and they can fall back to this conservative
-/// implementation as needed.
+/// Irreducible regions are first handled by node splitting: one entry of the
+/// region is chosen as the loop header, and the blocks reachable from each of
+/// the other entries without going through it are duplicated for the edges
+/// entering there, which keeps all branches direct. Duplication is limited by
+/// a per-function budget of instructions. When that is exceeded, or the region
+/// contains natural loops, the region is handled by the conservative
+/// transformation, which routes every edge into the region through a dispatch
+/// block with a br_table over a label variable. That handles all irreducible
+/// control flow without exponential code-size expansion, at the cost of an
+/// indirect branch on every such edge.
 ///
 //===----------------------------------------------------------------------===//
 
@@ -33,18 +37,31 @@
 #include "llvm/ADT/PriorityQueue.h"
 #include "llvm/ADT/SCCIterator.h"
 #include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/CodeGen/MachineDominators.h"
 #include "llvm/CodeGen/MachineFunction.h"
 #include "llvm/CodeGen/MachineInstrBuilder.h"
 #include "llvm/CodeGen/MachineLoopInfo.h"
 #include "llvm/CodeGen/MachineRegisterInfo.h"
 #include "llvm/CodeGen/Passes.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 using namespace llvm;
 
 #define DEBUG_TYPE "wasm-fix-irreducible-control-flow"
 
+STATISTIC(NumRegionsSplit, "Number of irreducible regions fixed by splitting");
+STATISTIC(NumBlocksDuplicated, "Number of blocks duplicated by splitting");
+STATISTIC(NumDispatchers, "Number of irreducible regions given a dispatcher");
+
+static cl::opt<unsigned> DuplicationBudget(
+    "wasm-irreducible-duplication-budget", cl::Hidden,
+    cl::desc("WebAssembly: Maximum number of instructions to duplicate per "
+             "function to make irreducible control flow reducible, before "
+             "falling back to a br_table dispatcher."),
+    cl::init(64));
+
 namespace {
 class WebAssemblyFixIrreducibleControlFlow final : public MachineFunctionPass {
   StringRef getPassName() const override {
@@ -62,7 +79,10 @@ class WebAssemblyFixIrreducibleControlFlow final : public MachineFunctionPass {
 
   bool runOnMachineFunction(MachineFunction &MF) override;
 
-  bool VisitLoop(MachineFunction &MF, MachineLoopInfo &MLI, MachineLoop *Loop);
+  bool VisitLoop(MachineFunction &MF, MachineLoopInfo &MLI, MachineLoop *Loop,
+                 unsigned &Budget, bool &Split);
+  bool SplitNodes(MachineFunction &MF, MachineLoopInfo &MLI, MachineLoop *Loop,
+                  unsigned &Budget);
 
 public:
   static char ID; // Pass identification, replacement for typeid
@@ -133,9 +153,342 @@ public:
 
 } // end anonymous namespace
 
+/// Return the block MBB falls through to, if any.
+static MachineBasicBlock *getFallthrough(MachineBasicBlock *MBB) {
+  MachineFunction::iterator Next = std::next(MBB->getIterator());
+  if (Next == MBB->getParent()->end() || !MBB->isSuccessor(&*Next))
+    return nullptr;
+  MachineBasicBlock::iterator Last = MBB->getLastNonDebugInstr();
+  if (Last != MBB->end() && Last->isBarrier())
+    return nullptr;
+  return &*Next;
+}
+
+/// Return the number of instructions duplicating MBB costs, counting a
+/// branch that may be needed in place of a fallthrough, or ~0U if MBB can't be
+/// duplicated.
+static unsigned getDuplicationCost(const MachineBasicBlock *MBB) {
+  if (MBB->isEHPad() || MBB->hasAddressTaken())
+    return ~0U;
+  unsigned Cost = 1;
+  for (const MachineInstr &MI : *MBB) {
+    if (MI.isNotDuplicable())
+      return ~0U;
+    if (!MI.isDebugInstr())
+      ++Cost;
+  }
+  return Cost;
+}
+
+namespace {
+/// The irreducible region inside a loop (or the function body), as a graph in
+/// which nested loops are collapsed into their headers.
+class RegionGraph {
+  MachineLoopInfo &MLI;
+  MachineLoop *Loop;
+  MachineBasicBlock *Header;
+  SmallVector<MachineBasicBlock *, 16> Nodes;
+  DenseMap<MachineBasicBlock *, unsigned> NodeIndex;
+  SmallVector<SmallVector<unsigned, 2>, 16> Succs;
+
+public:
+  RegionGraph(MachineFunction &MF, MachineLoopInfo &MLI, MachineLoop *Loop,
+              MachineBasicBlock *Header)
+      : MLI(MLI), Loop(Loop), Header(Header) {
+    for (MachineBasicBlock &MBB : MF)
+      if (contains(&MBB) && getNode(&MBB) == &MBB) {
+        NodeIndex[&MBB] = Nodes.size();
+        Nodes.push_back(&MBB);
+      }
+    Succs.resize(Nodes.size());
+    for (unsigned I = 0, E = Nodes.size(); I != E; ++I) {
+      MachineBasicBlock *MBB = Nodes[I];
+      SmallVector<MachineBasicBlock *, 4> Targets;
+      if (MachineLoop *Inner = getInnerLoop(MBB))
+        Inner->getExitBlocks(Targets);
+      else
+        Targets.append(MBB->succ_begin(), MBB->succ_end());
+      for (MachineBasicBlock *Target : Targets)
+        if (contains(Target))
+          Succs[I].push_back(NodeIndex[getNode(Target)]);
+    }
+  }
+
+  /// Test whether MBB is in the region, excluding its header.
+  bool contains(MachineBasicBlock *MBB) const {
+    return MBB != Header && (!Loop || Loop->contains(MBB));
+  }
+
+  /// If MBB is the header of a loop nested directly inside the region, return
+  /// that loop.
+  MachineLoop *getInnerLoop(MachineBasicBlock *MBB) const {
+    MachineLoop *Inner = MLI.getLoopFor(MBB);
+    if (Inner == Loop || Inner->getHeader() != MBB)
+      return nullptr;
+    return Inner;
+  }
+
+  /// Return the node representing MBB: MBB itself, or the header of the
+  /// nested loop containing it.
+  MachineBasicBlock *getNode(MachineBasicBlock *MBB) const {
+    MachineLoop *Inner = MLI.getLoopFor(MBB);
+    if (Inner == Loop)
+      return MBB;
+    while (Inner->getParentLoop() != Loop)
+      Inner = Inner->getParentLoop();
+    return Inner->getHeader();
+  }
+
+  unsigned size() const { return Nodes.size(); }
+  MachineBasicBlock *getBlock(unsigned N) const { return Nodes[N]; }
+  const SmallVectorImpl<unsigned> &successors(unsigned N) const {
+    return Succs[N];
+  }
+  unsigned getIndex(MachineBasicBlock *MBB) const {
+    auto I = NodeIndex.find(MBB);
+    return I == NodeIndex.end() ? ~0U : I->second;
+  }
+
+  /// Compute the strongly connected components, returning the component of
+  /// each node.
+  SmallVector<unsigned, 16> computeSCCs() const;
+};
+} // end anonymous namespace
+
+SmallVector<unsigned, 16> RegionGraph::computeSCCs() const {
+  // Tarjan's algorithm, iteratively.
+  unsigned N = Nodes.size();
+  SmallVector<unsigned, 16> Index(N, ~0U), LowLink(N, 0), SCC(N, ~0U);
+  SmallVector<unsigned, 16> Stack;
+  SmallVector<bool, 16> OnStack(N, false);
+  SmallVector<std::pair<unsigned, unsigned>, 16> CallStack;
+  unsigned NextIndex = 0, NextSCC = 0;
+  for (unsigned Root = 0; Root != N; ++Root) {
+    if (Index[Root] != ~0U)
+      continue;
+    CallStack.push_back(std::make_pair(Root, 0));
+    Index[Root] = LowLink[Root] = NextIndex++;
+    Stack.push_back(Root);
+    OnStack[Root] = true;
+    while (!CallStack.empty()) {
+      unsigned V = CallStack.back().first;
+      unsigned &SuccNo = CallStack.back().second;
+      if (SuccNo != Succs[V].size()) {
+        unsigned W = Succs[V][SuccNo++];
+        if (Index[W] == ~0U) {
+          Index[W] = LowLink[W] = NextIndex++;
+          Stack.push_back(W);
+          OnStack[W] = true;
+          CallStack.push_back(std::make_pair(W, 0));
+        } else if (OnStack[W]) {
+          LowLink[V] = std::min(LowLink[V], Index[W]);
+        }
+        continue;
+      }
+      CallStack.pop_back();
+      if (!CallStack.empty()) {
+        unsigned Parent = CallStack.back().first;
+        LowLink[Parent] = std::min(LowLink[Parent], LowLink[V]);
+      }
+      if (LowLink[V] == Index[V]) {
+        unsigned W;
+        do {
+          W = Stack.pop_back_val();
+          OnStack[W] = false;
+          SCC[W] = NextSCC;
+        } while (W != V);
+        ++NextSCC;
+      }
+    }
+  }
+  return SCC;
+}
+
+/// Collect the nodes of component C reachable from Entry without going
+/// through Header.
+static void collectReachable(const RegionGraph &G,
+                             const SmallVectorImpl<unsigned> &SCC, unsigned C,
+                             unsigned Entry, unsigned Header,
+                             SetVector<unsigned> &Reached) {
+  SmallVector<unsigned, 8> Worklist(1, Entry);
+  Reached.insert(Entry);
+  while (!Worklist.empty()) {
+    unsigned N = Worklist.pop_back_val();
+    for (unsigned Succ : G.successors(N))
+      if (Succ != Header && SCC[Succ] == C && Reached.insert(Succ))
+        Worklist.push_back(Succ);
+  }
+}
+
+/// Try to make one irreducible region inside Loop reducible by node splitting,
+/// within Budget instructions. Return true if anything changed.
+bool WebAssemblyFixIrreducibleControlFlow::SplitNodes(MachineFunction &MF,
+                                                      MachineLoopInfo &MLI,
+                                                      MachineLoop *Loop,
+                                                      unsigned &Budget) {
+  MachineBasicBlock *Header = Loop ? Loop->getHeader() : &*MF.begin();
+  RegionGraph G(MF, MLI, Loop, Header);
+  SmallVector<unsigned, 16> SCC = G.computeSCCs();
+
+  // Group the nodes by component and find the ones with more than one node.
+  DenseMap<unsigned, SmallVector<unsigned, 4>> Components;
+  for (unsigned N = 0, E = G.size(); N != E; ++N)
+    Components[SCC[N]].push_back(N);
+
+  for (unsigned N = 0, E = G.size(); N != E; ++N) {
+    const SmallVectorImpl<unsigned> &Members = Components[SCC[N]];
+    if (Members.size() < 2 || Members.front() != N)
+      continue;
+    unsigned C = SCC[N];
+
+    // Duplicating nested loops isn't supported.
+    for (unsigned M : Members)
+      if (G.getInnerLoop(G.getBlock(M)))
+        return false;
+
+    // Find the entries: the nodes with predecessors outside the component.
+    SmallVector<unsigned, 4> Entries;
+    for (unsigned M : Members)
+      for (MachineBasicBlock *Pred : G.getBlock(M)->predecessors()) {
+        unsigned P = G.contains(Pred) ? G.getIndex(G.getNode(Pred)) : ~0U;
+        if (P == ~0U || SCC[P] != C) {
+          Entries.push_back(M);
+          break;
+        }
+      }
+    if (Entries.size() < 2)
+      continue;
+
+    // Pick the entry to become the loop header which needs the fewest
+    // instructions to be duplicated.
+    unsigned BestHeader = ~0U;
+    uint64_t BestCost = ~0ULL;
+    for (unsigned H : Entries) {
+      uint64_t Cost = 0;
+      for (unsigned Entry : Entries) {
+        if (Entry == H)
+          continue;
+        SetVector<unsigned> Reached;
+        collectReachable(G, SCC, C, Entry, H, Reached);
+        for (unsigned R : Reached)
+          Cost += getDuplicationCost(G.getBlock(R));
+      }
+      if (Cost < BestCost) {
+        BestCost = Cost;
+        BestHeader = H;
+      }
+    }
+    if (BestCost > Budget) {
+      LLVM_DEBUG(dbgs() << "Splitting would duplicate " << BestCost
+                        << " instructions; over budget\n");
+      return false;
+    }
+    Budget -= BestCost;
+
+    LLVM_DEBUG(dbgs() << "Splitting irreducible region with header "
+                      << printMBBReference(*G.getBlock(BestHeader)) << "\n");
+
+    // For each other entry, duplicate the blocks reachable from it up to the
+    // new header, and send the edges from outside the region to the copies.
+    const auto &TII = *MF.getSubtarget<WebAssemblySubtarget>().getInstrInfo();
+    MachineRegisterInfo &MRI = MF.getRegInfo();
+    auto &MFI = *MF.getInfo<WebAssemblyFunctionInfo>();
+    for (unsigned Entry : Entries) {
+      if (Entry == BestHeader)
+        continue;
+      SetVector<unsigned> Reached;
+      collectReachable(G, SCC, C, Entry, BestHeader, Reached);
+
+      DenseMap<MachineBasicBlock *, MachineBasicBlock *> Map;
+      for (unsigned R : Reached) {
+        MachineBasicBlock *MBB = G.getBlock(R);
+        MachineBasicBlock *Copy =
+            MF.CreateMachineBasicBlock(MBB->getBasicBlock());
+        MF.insert(MF.end(), Copy);
+        MLI.changeLoopFor(Copy, Loop);
+        Map[MBB] = Copy;
+        ++NumBlocksDuplicated;
+      }
+
+      for (unsigned R : Reached) {
+        MachineBasicBlock *MBB = G.getBlock(R);
+        MachineBasicBlock *Copy = Map[MBB];
+
+        // Values on the value stack don't live across blocks, so give the
+        // copies of stackified registers their own registers. Other registers
+        // are locals by now, and can just have another def.
+        DenseMap<unsigned, unsigned> StackRegs;
+        for (MachineInstr &MI : *MBB) {
+          MachineInstr *NewMI = MF.CloneMachineInstr(&MI);
+          Copy->push_back(NewMI);
+          for (MachineOperand &MO : NewMI->operands()) {
+            if (MO.isMBB()) {
+              if (MachineBasicBlock *Target = Map.lookup(MO.getMBB()))
+                MO.setMBB(Target);
+              continue;
+            }
+            if (!MO.isReg() ||
+                !TargetRegisterInfo::isVirtualRegister(MO.getReg()))
+              continue;
+            unsigned Reg = MO.getReg();
+            if (MO.isDef()) {
+              if (MFI.isVRegStackified(Reg)) {
+                unsigned NewReg =
+                    MRI.createVirtualRegister(MRI.getRegClass(Reg));
+                StackRegs[Reg] = NewReg;
+                MO.setReg(NewReg);
+              }
+            } else if (unsigned NewReg = StackRegs.lookup(Reg)) {
+              MO.setReg(NewReg);
+            }
+          }
+        }
+        for (auto &Pair : StackRegs)
+          MFI.stackifyVReg(Pair.second);
+
+        for (auto SI = MBB->succ_begin(), SE = MBB->succ_end(); SI != SE;
+             ++SI) {
+          Copy->copySuccessor(MBB, SI);
+          if (MachineBasicBlock *Target = Map.lookup(*SI))
+            Copy->replaceSuccessor(*SI, Target);
+        }
+
+        // The copies live at the end of the function, so they need explicit
+        // branches where the originals fall through.
+        if (MachineBasicBlock *Fallthrough = getFallthrough(MBB)) {
+          MachineBasicBlock *Target = Map.lookup(Fallthrough);
+          BuildMI(*Copy, Copy->end(), DebugLoc(), TII.get(WebAssembly::BR))
+              .addMBB(Target ? Target : Fallthrough);
+        }
+      }
+
+      MachineBasicBlock *EntryBlock = G.getBlock(Entry);
+      SmallVector<MachineBasicBlock *, 4> OutsidePreds;
+      for (MachineBasicBlock *Pred : EntryBlock->predecessors()) {
+        unsigned P = G.contains(Pred) ? G.getIndex(G.getNode(Pred)) : ~0U;
+        if (P == ~0U || SCC[P] != C)
+          OutsidePreds.push_back(Pred);
+      }
+      for (MachineBasicBlock *Pred : OutsidePreds) {
+        if (getFallthrough(Pred) == EntryBlock)
+          BuildMI(*Pred, Pred->end(), DebugLoc(), TII.get(WebAssembly::BR))
+              .addMBB(EntryBlock);
+        Pred->ReplaceUsesOfBlockWith(EntryBlock, Map[EntryBlock]);
+      }
+    }
+
+    ++NumRegionsSplit;
+    return true;
+  }
+
+  return false;
+}
+
 bool WebAssemblyFixIrreducibleControlFlow::VisitLoop(MachineFunction &MF,
                                                      MachineLoopInfo &MLI,
-                                                     MachineLoop *Loop) {
+                                                     MachineLoop *Loop,
+                                                     unsigned &Budget,
+                                                     bool &Split) {
   MachineBasicBlock *Header = Loop ? Loop->getHeader() : &*MF.begin();
   SetVector<MachineBasicBlock *> RewriteSuccs;
 
@@ -179,6 +532,13 @@ bool WebAssemblyFixIrreducibleControlFlow::VisitLoop(MachineFunction &MF,
 
   LLVM_DEBUG(dbgs() << "Irreducible control flow detected!\n");
 
+  // Prefer duplicating code to keep the branches direct, if it's small enough.
+  if (SplitNodes(MF, MLI, Loop, Budget)) {
+    Split = true;
+    return true;
+  }
+  ++NumDispatchers;
+
   // Ok. We have irreducible control flow! Create a dispatch block which will
   // contains a jump table to any block in the problematic set of blocks.
   MachineBasicBlock *Dispatch = MF.CreateMachineBasicBlock();
@@ -274,25 +634,36 @@ bool WebAssemblyFixIrreducibleControlFlow::runOnMachineFunction(
 
   bool Changed = false;
   auto &MLI = getAnalysis<MachineLoopInfo>();
+  unsigned Budget = DuplicationBudget;
+
+  // Splitting a region turns it into a natural loop, possibly with more
+  // irreducible control flow inside, and invalidates the loop info, so start
+  // over after each split. The dispatcher transformation leaves nothing to
+  // revisit.
+  for (bool Split = true; Split;) {
+    Split = false;
+    bool Iteration = false;
+
+    // Visit the function body, which is identified as a null loop.
+    Iteration |= VisitLoop(MF, MLI, nullptr, Budget, Split);
+
+    // Visit all the loops.
+    SmallVector<MachineLoop *, 8> Worklist(MLI.begin(), MLI.end());
+    while (!Split && !Worklist.empty()) {
+      MachineLoop *CurLoop = Worklist.pop_back_val();
+      Worklist.append(CurLoop->begin(), CurLoop->end());
+      Iteration |= VisitLoop(MF, MLI, CurLoop, Budget, Split);
+    }
 
-  // Visit the function body, which is identified as a null loop.
-  Changed |= VisitLoop(MF, MLI, nullptr);
-
-  // Visit all the loops.
-  SmallVector<MachineLoop *, 8> Worklist(MLI.begin(), MLI.end());
-  while (!Worklist.empty()) {
-    MachineLoop *CurLoop = Worklist.pop_back_val();
-    Worklist.append(CurLoop->begin(), CurLoop->end());
-    Changed |= VisitLoop(MF, MLI, CurLoop);
-  }
-
-  // If we made any changes, completely recompute everything.
-  if (LLVM_UNLIKELY(Changed)) {
-    LLVM_DEBUG(dbgs() << "Recomputing dominators and loops.\n");
-    MF.getRegInfo().invalidateLiveness();
-    MF.RenumberBlocks();
-    getAnalysis<MachineDominatorTree>().runOnMachineFunction(MF);
-    MLI.runOnMachineFunction(MF);
+    // If we made any changes, completely recompute everything.
+    if (LLVM_UNLIKELY(Iteration)) {
+      LLVM_DEBUG(dbgs() << "Recomputing dominators and loops.\n");
+      MF.getRegInfo().invalidateLiveness();
+      MF.RenumberBlocks();
+      getAnalysis<MachineDominatorTree>().runOnMachineFunction(MF);
+      MLI.runOnMachineFunction(MF);
+      Changed = true;
+    }
   }
 
   return Changed;
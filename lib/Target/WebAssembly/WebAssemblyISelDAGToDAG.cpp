@@ -83,6 +83,17 @@ void WebAssemblyDAGToDAGISel::Select(SDNode *Node) {
     break;
     // If we need WebAssembly-specific selection, it would go here.
     (void)VT;
+  case WebAssemblyISD::RETURN: {
+    // Returns of a single value are matched by the RETURN_* patterns. Returns
+    // of more than one value take them all as variadic operands.
+    if (Node->getNumOperands() <= 2)
+      break;
+    SmallVector<SDValue, 4> Ops(Node->op_begin() + 1, Node->op_end());
+    Ops.push_back(Node->getOperand(0));
+    ReplaceNode(Node, CurDAG->getMachineNode(WebAssembly::RETURN_MULTI,
+                                             SDLoc(Node), MVT::Other, Ops));
+    return;
+  }
   }
 
   // Select the default instruction.
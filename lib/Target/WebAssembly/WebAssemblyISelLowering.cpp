@@ -27,6 +27,7 @@
 #include "llvm/IR/DiagnosticPrinter.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Intrinsics.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/raw_ostream.h"
@@ -35,6 +36,12 @@ using namespace llvm;
 
 #define DEBUG_TYPE "wasm-lower"
 
+static cl::opt<unsigned> BulkMemoryInlineStores(
+    "wasm-bulk-memory-inline-stores", cl::Hidden, cl::init(4),
+    cl::desc("WebAssembly: with bulk memory, the maximum number of stores a "
+             "memcpy, memmove or memset is expanded to before it is lowered "
+             "to memory.copy or memory.fill"));
+
 WebAssemblyTargetLowering::WebAssemblyTargetLowering(
     const TargetMachine &TM, const WebAssemblySubtarget &STI)
     : TargetLowering(TM), Subtarget(&STI) {
@@ -155,6 +162,18 @@ WebAssemblyTargetLowering::WebAssemblyTargetLowering(
   setOperationAction(ISD::INTRINSIC_WO_CHAIN, MVT::Other, Custom);
 
   setMaxAtomicSizeInBitsSupported(64);
+
+  // memory.copy and memory.fill beat all but the shortest load/store
+  // sequences, so only expand small constant sizes inline and leave the rest
+  // to WebAssemblySelectionDAGInfo. Without bulk memory, anything too large
+  // to expand becomes a libcall. utils/create_wasm_bulk_memory_bench.py times
+  // all three.
+  if (Subtarget->hasBulkMemory()) {
+    MaxStoresPerMemcpy = MaxStoresPerMemmove = MaxStoresPerMemset =
+        BulkMemoryInlineStores;
+    MaxStoresPerMemcpyOptSize = MaxStoresPerMemmoveOptSize =
+        MaxStoresPerMemsetOptSize = BulkMemoryInlineStores / 2;
+  }
 }
 
 FastISel *WebAssemblyTargetLowering::createFastISel(
@@ -456,6 +475,26 @@ static bool CallingConvSupported(CallingConv::ID CallConv) {
          CallConv == CallingConv::CXX_FAST_TLS;
 }
 
+// Test whether a call can be emitted as a return_call. The callee's results
+// must be exactly this function's, and nothing it is passed may live in this
+// function's frame, which is gone by the time the callee runs.
+static bool mayTailCall(const WebAssemblySubtarget &Subtarget,
+                        const TargetLowering::CallLoweringInfo &CLI) {
+  if (!Subtarget.hasTailCall() || CLI.IsVarArg)
+    return false;
+  for (const ISD::OutputArg &Out : CLI.Outs)
+    if (Out.Flags.isByVal() && Out.Flags.getByValSize() != 0)
+      return false;
+
+  const MachineFunction &MF = CLI.DAG.getMachineFunction();
+  const Function &F = MF.getFunction();
+  SmallVector<MVT, 4> CallerResults;
+  SmallVector<MVT, 4> CalleeResults;
+  ComputeLegalValueVTs(F, MF.getTarget(), F.getReturnType(), CallerResults);
+  ComputeLegalValueVTs(F, MF.getTarget(), CLI.RetTy, CalleeResults);
+  return CallerResults == CalleeResults;
+}
+
 SDValue WebAssemblyTargetLowering::LowerCall(
     CallLoweringInfo &CLI, SmallVectorImpl<SDValue> &InVals) const {
   SelectionDAG &DAG = CLI.DAG;
@@ -473,17 +512,22 @@ SDValue WebAssemblyTargetLowering::LowerCall(
   if (CLI.IsPatchPoint)
     fail(DL, DAG, "WebAssembly doesn't support patch point yet");
 
-  // WebAssembly doesn't currently support explicit tail calls. If they are
-  // required, fail. Otherwise, just disable them.
-  if ((CallConv == CallingConv::Fast && CLI.IsTailCall &&
-       MF.getTarget().Options.GuaranteedTailCallOpt) ||
-      (CLI.CS && CLI.CS.isMustTailCall()))
-    fail(DL, DAG, "WebAssembly doesn't support tail call yet");
-  CLI.IsTailCall = false;
+  // Tail calls become return_call when the callee can take over this frame.
+  // Otherwise they are emitted as regular calls, unless they are required.
+  bool MustTail = (CallConv == CallingConv::Fast && CLI.IsTailCall &&
+                   MF.getTarget().Options.GuaranteedTailCallOpt) ||
+                  (CLI.CS && CLI.CS.isMustTailCall());
+  if (CLI.IsTailCall || MustTail)
+    CLI.IsTailCall = mayTailCall(*Subtarget, CLI);
+  if (MustTail && !CLI.IsTailCall)
+    fail(DL, DAG, Subtarget->hasTailCall()
+                      ? "WebAssembly can't emit this call as a tail call"
+                      : "WebAssembly doesn't support tail call without the "
+                        "tail-call feature");
 
   SmallVectorImpl<ISD::InputArg> &Ins = CLI.Ins;
-  if (Ins.size() > 1)
-    fail(DL, DAG, "WebAssembly doesn't support more than 1 returned value yet");
+  assert((Ins.size() <= 1 || Subtarget->hasMultivalue()) &&
+         "WebAssembly can only return up to one value without multivalue");
 
   SmallVectorImpl<ISD::OutputArg> &Outs = CLI.Outs;
   SmallVectorImpl<SDValue> &OutVals = CLI.OutVals;
@@ -595,6 +639,30 @@ SDValue WebAssemblyTargetLowering::LowerCall(
     // registers.
     InTys.push_back(In.VT);
   }
+  // A return_call hands the callee's results straight to our caller.
+  if (CLI.IsTailCall)
+    return DAG.getNode(WebAssemblyISD::RET_CALL, DL, MVT::Other, Ops);
+
+  if (Ins.size() > 1) {
+    // A multivalue call is a void call followed by one CALL_RESULT per value,
+    // which take the values off the value stack from the last to the first.
+    // The glue keeps them together, right after the call.
+    SDValue Call = DAG.getNode(WebAssemblyISD::CALL_MULTI, DL,
+                               DAG.getVTList(MVT::Other, MVT::Glue), Ops);
+    Chain = Call.getValue(0);
+    SDValue Glue = Call.getValue(1);
+    InVals.resize(Ins.size());
+    for (size_t I = Ins.size(); I-- != 0;) {
+      SDValue Result = DAG.getNode(
+          WebAssemblyISD::CALL_RESULT, DL,
+          DAG.getVTList(Ins[I].VT, MVT::Other, MVT::Glue), Chain, Glue);
+      InVals[I] = Result;
+      Chain = Result.getValue(1);
+      Glue = Result.getValue(2);
+    }
+    return Chain;
+  }
+
   InTys.push_back(MVT::Other);
   SDVTList InTyList = DAG.getVTList(InTys);
   SDValue Res =
@@ -614,8 +682,11 @@ bool WebAssemblyTargetLowering::CanLowerReturn(
     CallingConv::ID /*CallConv*/, MachineFunction & /*MF*/, bool /*IsVarArg*/,
     const SmallVectorImpl<ISD::OutputArg> &Outs,
     LLVMContext & /*Context*/) const {
-  // WebAssembly can't currently handle returning tuples.
-  return Outs.size() <= 1;
+  // Tuples are returned directly only with the multivalue feature.
+  SmallVector<MVT, 4> ResultVTs;
+  for (const ISD::OutputArg &Out : Outs)
+    ResultVTs.push_back(Out.VT);
+  return canLowerReturnValues(*Subtarget, ResultVTs);
 }
 
 SDValue WebAssemblyTargetLowering::LowerReturn(
@@ -623,7 +694,8 @@ SDValue WebAssemblyTargetLowering::LowerReturn(
     const SmallVectorImpl<ISD::OutputArg> &Outs,
     const SmallVectorImpl<SDValue> &OutVals, const SDLoc &DL,
     SelectionDAG &DAG) const {
-  assert(Outs.size() <= 1 && "WebAssembly can only return up to one value");
+  assert((Outs.size() <= 1 || Subtarget->hasMultivalue()) &&
+         "WebAssembly can only return up to one value without multivalue");
   if (!CallingConvSupported(CallConv))
     fail(DL, DAG, "WebAssembly doesn't support non-C calling conventions");
 
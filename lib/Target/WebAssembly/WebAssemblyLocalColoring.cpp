@@ -0,0 +1,284 @@
+//===-- WebAssemblyLocalColoring.cpp - Local coloring ---------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements a pass that minimizes the number of wasm locals.
+///
+/// RegColoring only merges virtual registers whose live intervals don't
+/// overlap, and ExplicitLocals then gives a fresh local to every register that
+/// remains, including the ones feeding tees. This pass runs on the explicit
+/// get_local/set_local/tee_local form, computes which locals interfere, and
+/// greedily assigns non-interfering locals of the same type to one slot. When
+/// there are enough locals that some indices need a multi-byte LEB, the slots
+/// are numbered so that the most frequently accessed ones get the smallest
+/// indices.
+///
+//===----------------------------------------------------------------------===//
+
+#include "MCTargetDesc/WebAssemblyMCTargetDesc.h"
+#include "WebAssembly.h"
+#include "WebAssemblyMachineFunctionInfo.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/CodeGen/MachineFunctionPass.h"
+#include "llvm/CodeGen/Passes.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+using namespace llvm;
+
+#define DEBUG_TYPE "wasm-local-coloring"
+
+STATISTIC(NumLocalsBefore, "Number of locals before local coloring");
+STATISTIC(NumLocalsAfter, "Number of locals after local coloring");
+
+static cl::opt<bool> DisableLocalColoring(
+    "disable-wasm-local-coloring", cl::Hidden,
+    cl::desc("WebAssembly: Disable merging of non-interfering locals."),
+    cl::init(false));
+
+namespace {
+class WebAssemblyLocalColoring final : public MachineFunctionPass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  WebAssemblyLocalColoring() : MachineFunctionPass(ID) {}
+
+  StringRef getPassName() const override {
+    return "WebAssembly Local Coloring";
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.setPreservesCFG();
+    MachineFunctionPass::getAnalysisUsage(AU);
+  }
+
+  bool runOnMachineFunction(MachineFunction &MF) override;
+};
+} // end anonymous namespace
+
+char WebAssemblyLocalColoring::ID = 0;
+INITIALIZE_PASS(WebAssemblyLocalColoring, DEBUG_TYPE,
+                "Minimize number of locals used", false, false)
+
+FunctionPass *llvm::createWebAssemblyLocalColoring() {
+  return new WebAssemblyLocalColoring();
+}
+
+/// If MI is a get_local, set_local or tee_local, return the operand holding
+/// the local index, and set IsDef if MI writes the local.
+static MachineOperand *getLocalOperand(MachineInstr &MI, bool &IsDef) {
+  switch (MI.getOpcode()) {
+  case WebAssembly::GET_LOCAL_I32:
+  case WebAssembly::GET_LOCAL_I64:
+  case WebAssembly::GET_LOCAL_F32:
+  case WebAssembly::GET_LOCAL_F64:
+  case WebAssembly::GET_LOCAL_V128:
+  case WebAssembly::GET_LOCAL_EXCEPT_REF:
+    IsDef = false;
+    return &MI.getOperand(1);
+  case WebAssembly::SET_LOCAL_I32:
+  case WebAssembly::SET_LOCAL_I64:
+  case WebAssembly::SET_LOCAL_F32:
+  case WebAssembly::SET_LOCAL_F64:
+  case WebAssembly::SET_LOCAL_V128:
+  case WebAssembly::SET_LOCAL_EXCEPT_REF:
+    IsDef = true;
+    return &MI.getOperand(0);
+  case WebAssembly::TEE_LOCAL_I32:
+  case WebAssembly::TEE_LOCAL_I64:
+  case WebAssembly::TEE_LOCAL_F32:
+  case WebAssembly::TEE_LOCAL_F64:
+  case WebAssembly::TEE_LOCAL_V128:
+  case WebAssembly::TEE_LOCAL_EXCEPT_REF:
+    IsDef = true;
+    return &MI.getOperand(1);
+  default:
+    return nullptr;
+  }
+}
+
+bool WebAssemblyLocalColoring::runOnMachineFunction(MachineFunction &MF) {
+  LLVM_DEBUG({
+    dbgs() << "********** Local Coloring **********\n"
+           << "********** Function: " << MF.getName() << '\n';
+  });
+
+  if (DisableLocalColoring)
+    return false;
+
+  // As in RegColoring, don't merge locals in functions that call setjmp, since
+  // a local could be modified before a longjmp brings control back.
+  if (MF.exposesReturnsTwice())
+    return false;
+
+  WebAssemblyFunctionInfo &MFI = *MF.getInfo<WebAssemblyFunctionInfo>();
+  const std::vector<MVT> Locals = MFI.getLocals();
+  unsigned NumParams = MFI.getParams().size();
+  unsigned NumLocals = Locals.size();
+  if (NumLocals == 0)
+    return false;
+
+  // Inline asm refers to locals by immediate operands we can't tell apart from
+  // other immediates, so leave functions containing it alone.
+  for (const MachineBasicBlock &MBB : MF)
+    for (const MachineInstr &MI : MBB)
+      if (MI.isInlineAsm())
+        return false;
+
+  NumLocalsBefore += NumLocals;
+
+  // Collect the accesses to each local, and the locals each block reads
+  // before writing (Gen) and writes (Kill). Parameters keep their numbers.
+  unsigned NumBlocks = MF.getNumBlockIDs();
+  SmallVector<BitVector, 16> Gen(NumBlocks, BitVector(NumLocals));
+  SmallVector<BitVector, 16> Kill(NumBlocks, BitVector(NumLocals));
+  SmallVector<unsigned, 16> UseCount(NumLocals, 0);
+  for (MachineBasicBlock &MBB : MF) {
+    unsigned N = MBB.getNumber();
+    for (MachineInstr &MI : MBB) {
+      bool IsDef;
+      MachineOperand *MO = getLocalOperand(MI, IsDef);
+      if (!MO || MO->getImm() < NumParams)
+        continue;
+      unsigned L = MO->getImm() - NumParams;
+      ++UseCount[L];
+      if (IsDef)
+        Kill[N].set(L);
+      else if (!Kill[N].test(L))
+        Gen[N].set(L);
+    }
+  }
+
+  // Compute the locals live into each block.
+  SmallVector<BitVector, 16> LiveIn(NumBlocks, BitVector(NumLocals));
+  SmallVector<BitVector, 16> LiveOut(NumBlocks, BitVector(NumLocals));
+  for (bool Changed = true; Changed;) {
+    Changed = false;
+    for (MachineBasicBlock &MBB : reverse(MF)) {
+      unsigned N = MBB.getNumber();
+      for (MachineBasicBlock *Succ : MBB.successors())
+        LiveOut[N] |= LiveIn[Succ->getNumber()];
+      BitVector In = LiveOut[N];
+      In.reset(Kill[N]);
+      In |= Gen[N];
+      if (In != LiveIn[N]) {
+        LiveIn[N] = std::move(In);
+        Changed = true;
+      }
+    }
+  }
+
+  // Build the interference graph. A write to a local interferes with every
+  // other local live at that point.
+  SmallVector<BitVector, 16> Interferes(NumLocals, BitVector(NumLocals));
+  for (MachineBasicBlock &MBB : MF) {
+    BitVector Live = LiveOut[MBB.getNumber()];
+    for (MachineInstr &MI : reverse(MBB)) {
+      bool IsDef;
+      MachineOperand *MO = getLocalOperand(MI, IsDef);
+      if (!MO || MO->getImm() < NumParams)
+        continue;
+      unsigned L = MO->getImm() - NumParams;
+      if (!IsDef) {
+        Live.set(L);
+        continue;
+      }
+      for (unsigned J : Live.set_bits()) {
+        Interferes[L].set(J);
+        Interferes[J].set(L);
+      }
+      Live.reset(L);
+    }
+  }
+
+  // Locals read before they're written rely on being zero-initialized, so
+  // they can't share a slot with anything.
+  const BitVector &EntryLive = LiveIn[MF.front().getNumber()];
+  for (unsigned L : EntryLive.set_bits())
+    for (unsigned J = 0; J != NumLocals; ++J) {
+      Interferes[L].set(J);
+      Interferes[J].set(L);
+    }
+
+  // Assign the locals to slots, most frequently used first, taking the first
+  // slot of the same type that doesn't interfere.
+  SmallVector<unsigned, 16> Order(NumLocals);
+  for (unsigned L = 0; L != NumLocals; ++L)
+    Order[L] = L;
+  std::stable_sort(Order.begin(), Order.end(), [&](unsigned A, unsigned B) {
+    return UseCount[A] > UseCount[B];
+  });
+
+  struct Slot {
+    MVT Type;
+    unsigned FirstLocal;
+    unsigned UseCount;
+    BitVector Interferes;
+  };
+  SmallVector<Slot, 16> Slots;
+  SmallVector<unsigned, 16> SlotOf(NumLocals);
+  for (unsigned L : Order) {
+    unsigned S = 0, E = Slots.size();
+    for (; S != E; ++S)
+      if (Slots[S].Type == Locals[L] && !Slots[S].Interferes.test(L))
+        break;
+    if (S == E)
+      Slots.push_back({Locals[L], L, 0, BitVector(NumLocals)});
+    Slot &Sl = Slots[S];
+    Sl.FirstLocal = std::min(Sl.FirstLocal, L);
+    Sl.UseCount += UseCount[L];
+    Sl.Interferes |= Interferes[L];
+    SlotOf[L] = S;
+  }
+
+  // Number the slots. Indices below 128 take one byte in the LEB encoding, so
+  // if they all fit, keep the original order, which keeps locals of the same
+  // type together in the declarations; otherwise give the most used slots the
+  // smallest indices.
+  SmallVector<unsigned, 16> SlotOrder(Slots.size());
+  for (unsigned S = 0, E = Slots.size(); S != E; ++S)
+    SlotOrder[S] = S;
+  bool ByUseCount = NumParams + Slots.size() > 128;
+  std::sort(SlotOrder.begin(), SlotOrder.end(), [&](unsigned A, unsigned B) {
+    if (ByUseCount && Slots[A].UseCount != Slots[B].UseCount)
+      return Slots[A].UseCount > Slots[B].UseCount;
+    return Slots[A].FirstLocal < Slots[B].FirstLocal;
+  });
+  SmallVector<unsigned, 16> NewIndex(Slots.size());
+  for (unsigned I = 0, E = SlotOrder.size(); I != E; ++I)
+    NewIndex[SlotOrder[I]] = I;
+
+  NumLocalsAfter += Slots.size();
+
+  bool Changed = Slots.size() != NumLocals;
+  for (unsigned L = 0; L != NumLocals; ++L)
+    Changed |= NewIndex[SlotOf[L]] != L;
+  if (!Changed)
+    return false;
+
+  LLVM_DEBUG(dbgs() << "Reduced " << NumLocals << " locals to " << Slots.size()
+                    << '\n');
+
+  for (MachineBasicBlock &MBB : MF)
+    for (MachineInstr &MI : MBB) {
+      bool IsDef;
+      MachineOperand *MO = getLocalOperand(MI, IsDef);
+      if (!MO || MO->getImm() < NumParams)
+        continue;
+      unsigned L = MO->getImm() - NumParams;
+      MO->setImm(NumParams + NewIndex[SlotOf[L]]);
+    }
+
+  MFI.setNumLocals(0);
+  MFI.setNumLocals(Slots.size());
+  for (unsigned S = 0, E = Slots.size(); S != E; ++S)
+    MFI.setLocal(NewIndex[S], Slots[S].Type);
+
+  return true;
+}
@@ -185,6 +185,34 @@ void WebAssemblyMCInstLower::Lower(const MachineInstr *MI,
                 MI->getParent()->getParent()->getRegInfo();
             for (const MachineOperand &MO : MI->defs())
               Returns.push_back(getType(MRI.getRegClass(MO.getReg())));
+            // return_call_indirect has no defs; the callee's results are
+            // this function's results.
+            if (MI->getOpcode() == WebAssembly::RET_CALL_INDIRECT) {
+              const auto &MFI = *MI->getParent()
+                                     ->getParent()
+                                     ->getInfo<WebAssemblyFunctionInfo>();
+              for (MVT ResultMVT : MFI.getResults())
+                Returns.push_back(WebAssembly::toValType(ResultMVT));
+            }
+            // A multivalue call_indirect is void; its results are the
+            // CALL_RESULT pseudos that follow it, from the last to the first.
+            if (MI->getOpcode() == WebAssembly::CALL_INDIRECT_VOID) {
+              const auto &MFI = *MI->getParent()
+                                     ->getParent()
+                                     ->getInfo<WebAssemblyFunctionInfo>();
+              auto I = std::next(MI->getIterator());
+              auto E = MI->getParent()->instr_end();
+              while (I != E && WebAssembly::isCallResult(*I)) {
+                unsigned Reg = I->getOperand(0).getReg();
+                Returns.push_back(getType(MRI.getRegClass(Reg)));
+                // A stackified result is followed by the set_local or drop
+                // that ExplicitLocals inserted for it.
+                if (MFI.isVRegStackified(Reg) && ++I == E)
+                  break;
+                ++I;
+              }
+              std::reverse(Returns.begin(), Returns.end());
+            }
             for (const MachineOperand &MO : MI->explicit_uses())
               if (MO.isReg())
                 Params.push_back(getType(MRI.getRegClass(MO.getReg())));
@@ -17,8 +17,15 @@
 #include "WebAssemblyISelLowering.h"
 #include "WebAssemblySubtarget.h"
 #include "llvm/CodeGen/Analysis.h"
+#include "llvm/Support/CommandLine.h"
 using namespace llvm;
 
+static cl::opt<unsigned> MultivalueMaxResults(
+    "wasm-multivalue-max-results", cl::Hidden,
+    cl::desc("WebAssembly: the most values returned directly with the "
+             "multivalue feature; larger results are returned in memory"),
+    cl::init(4));
+
 WebAssemblyFunctionInfo::~WebAssemblyFunctionInfo() {}
 
 void WebAssemblyFunctionInfo::initWARegs() {
@@ -43,15 +50,29 @@ void llvm::ComputeLegalValueVTs(const Function &F, const TargetMachine &TM,
   }
 }
 
+bool llvm::canLowerReturnValues(const WebAssemblySubtarget &Subtarget,
+                                ArrayRef<MVT> Results) {
+  if (Results.size() <= 1)
+    return true;
+  if (!Subtarget.hasMultivalue() || Results.size() > MultivalueMaxResults)
+    return false;
+  // Only scalars are returned as multiple values.
+  return llvm::all_of(Results, [](MVT VT) {
+    return VT == MVT::i32 || VT == MVT::i64 || VT == MVT::f32 ||
+           VT == MVT::f64;
+  });
+}
+
 void llvm::ComputeSignatureVTs(const Function &F, const TargetMachine &TM,
                                SmallVectorImpl<MVT> &Params,
                                SmallVectorImpl<MVT> &Results) {
   ComputeLegalValueVTs(F, TM, F.getReturnType(), Results);
 
-  if (Results.size() > 1) {
-    // WebAssembly currently can't lower returns of multiple values without
-    // demoting to sret (see WebAssemblyTargetLowering::CanLowerReturn). So
-    // replace multiple return values with a pointer parameter.
+  if (!canLowerReturnValues(TM.getSubtarget<WebAssemblySubtarget>(F),
+                            Results)) {
+    // Results that can't be returned directly are demoted to sret (see
+    // WebAssemblyTargetLowering::CanLowerReturn). So replace them with a
+    // pointer parameter.
     Results.clear();
     Params.push_back(
         MVT::getIntegerVT(TM.createDataLayout().getPointerSizeInBits()));
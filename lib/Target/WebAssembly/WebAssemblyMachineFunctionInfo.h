@@ -21,6 +21,8 @@
 
 namespace llvm {
 
+class WebAssemblySubtarget;
+
 /// This class is derived from MachineFunctionInfo and contains private
 /// WebAssembly-specific information for each MachineFunction.
 class WebAssemblyFunctionInfo final : public MachineFunctionInfo {
@@ -114,6 +116,11 @@ class WebAssemblyFunctionInfo final : public MachineFunctionInfo {
 void ComputeLegalValueVTs(const Function &F, const TargetMachine &TM,
                           Type *Ty, SmallVectorImpl<MVT> &ValueVTs);
 
+/// Test whether results of the given legalized types are returned directly, as
+/// opposed to through a pointer to memory provided by the caller.
+bool canLowerReturnValues(const WebAssemblySubtarget &Subtarget,
+                          ArrayRef<MVT> Results);
+
 void ComputeSignatureVTs(const Function &F, const TargetMachine &TM,
                          SmallVectorImpl<MVT> &Params,
                          SmallVectorImpl<MVT> &Results);
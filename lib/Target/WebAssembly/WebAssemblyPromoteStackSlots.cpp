@@ -0,0 +1,277 @@
+//===-- WebAssemblyPromoteStackSlots.cpp - Promote stack slots to regs ----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements a pass that promotes stack slots which never escape
+/// to virtual registers, which become wasm locals.
+///
+/// A frame object lives in linear memory, below the __stack_pointer global, so
+/// every function with one pays for reading (and usually writing back) that
+/// global in its prologue and epilogue, on top of the loads and stores to the
+/// object itself. Objects that are only ever loaded and stored whole, with a
+/// single scalar type, don't need an address at all: this pass rewrites their
+/// accesses into register copies and deletes the object. When that empties the
+/// frame, frame lowering emits no stack pointer code for the function.
+///
+//===----------------------------------------------------------------------===//
+
+#include "MCTargetDesc/WebAssemblyMCTargetDesc.h"
+#include "WebAssembly.h"
+#include "WebAssemblySubtarget.h"
+#include "WebAssemblyUtilities.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/CodeGen/MachineFrameInfo.h"
+#include "llvm/CodeGen/MachineFunctionPass.h"
+#include "llvm/CodeGen/MachineInstrBuilder.h"
+#include "llvm/CodeGen/MachineRegisterInfo.h"
+#include "llvm/CodeGen/MachineSSAUpdater.h"
+#include "llvm/CodeGen/Passes.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+using namespace llvm;
+
+#define DEBUG_TYPE "wasm-promote-stack-slots"
+
+STATISTIC(NumSlotsPromoted, "Number of stack slots promoted to locals");
+STATISTIC(NumFramesRemoved, "Number of functions left without a stack frame");
+
+static cl::opt<bool> DisablePromoteStackSlots(
+    "disable-wasm-stack-slot-promotion", cl::Hidden,
+    cl::desc("WebAssembly: Disable promotion of stack slots to locals."),
+    cl::init(false));
+
+namespace {
+class WebAssemblyPromoteStackSlots final : public MachineFunctionPass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  WebAssemblyPromoteStackSlots() : MachineFunctionPass(ID) {}
+
+private:
+  StringRef getPassName() const override {
+    return "WebAssembly Promote Stack Slots";
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.setPreservesCFG();
+    MachineFunctionPass::getAnalysisUsage(AU);
+  }
+
+  bool runOnMachineFunction(MachineFunction &MF) override;
+};
+} // end anonymous namespace
+
+char WebAssemblyPromoteStackSlots::ID = 0;
+INITIALIZE_PASS(WebAssemblyPromoteStackSlots, DEBUG_TYPE,
+                "Promote non-escaping stack slots to locals", false, false)
+
+FunctionPass *llvm::createWebAssemblyPromoteStackSlots() {
+  return new WebAssemblyPromoteStackSlots();
+}
+
+/// If MI is a plain load or store of a whole scalar, return the register class
+/// of the value, and set Size to its width in bytes.
+static const TargetRegisterClass *getAccessClass(const MachineInstr &MI,
+                                                 unsigned &Size) {
+  switch (MI.getOpcode()) {
+  case WebAssembly::LOAD_I32:
+  case WebAssembly::STORE_I32:
+    Size = 4;
+    return &WebAssembly::I32RegClass;
+  case WebAssembly::LOAD_I64:
+  case WebAssembly::STORE_I64:
+    Size = 8;
+    return &WebAssembly::I64RegClass;
+  case WebAssembly::LOAD_F32:
+  case WebAssembly::STORE_F32:
+    Size = 4;
+    return &WebAssembly::F32RegClass;
+  case WebAssembly::LOAD_F64:
+  case WebAssembly::STORE_F64:
+    Size = 8;
+    return &WebAssembly::F64RegClass;
+  default:
+    return nullptr;
+  }
+}
+
+/// Return the operand number of the address of a load or store accepted by
+/// getAccessClass.
+static unsigned getAddressOperandNo(const MachineInstr &MI) {
+  return MI.mayStore() ? WebAssembly::StoreAddressOperandNo
+                       : WebAssembly::LoadAddressOperandNo;
+}
+
+namespace {
+/// The accesses of one stack slot, and whether they allow promoting it.
+struct SlotInfo {
+  const TargetRegisterClass *RC = nullptr;
+  SmallPtrSet<MachineInstr *, 8> Accesses;
+  bool Promotable = true;
+};
+} // end anonymous namespace
+
+/// Delete the def of Reg if promotion left it without uses, e.g. a value that
+/// was only ever stored to the slot, and likewise for its operands.
+static void eraseDeadDefs(unsigned Reg, MachineRegisterInfo &MRI) {
+  SmallVector<unsigned, 4> Worklist(1, Reg);
+  while (!Worklist.empty()) {
+    unsigned R = Worklist.pop_back_val();
+    if (!TargetRegisterInfo::isVirtualRegister(R) || !MRI.use_empty(R))
+      continue;
+    MachineInstr *Def = MRI.getUniqueVRegDef(R);
+    bool SawStore = true;
+    if (!Def || Def->getNumDefs() != 1 || WebAssembly::isArgument(*Def) ||
+        !Def->isSafeToMove(nullptr, SawStore))
+      continue;
+    for (const MachineOperand &MO : Def->uses())
+      if (MO.isReg())
+        Worklist.push_back(MO.getReg());
+    Def->eraseFromParent();
+  }
+}
+
+bool WebAssemblyPromoteStackSlots::runOnMachineFunction(MachineFunction &MF) {
+  LLVM_DEBUG({
+    dbgs() << "********** Promote Stack Slots **********\n"
+           << "********** Function: " << MF.getName() << '\n';
+  });
+
+  MachineFrameInfo &MFI = MF.getFrameInfo();
+  if (DisablePromoteStackSlots || !MFI.hasStackObjects())
+    return false;
+
+  MachineRegisterInfo &MRI = MF.getRegInfo();
+  const auto &TII = *MF.getSubtarget<WebAssemblySubtarget>().getInstrInfo();
+  assert(MRI.isSSA() && "PromoteStackSlots depends on SSA form");
+
+  // Find the accesses of each slot. Any use of a slot's address other than
+  // as the address of a whole, unconditional load or store of one type means
+  // the address escapes, or the slot is accessed in pieces; either way it has
+  // to stay in memory.
+  MapVector<int, SlotInfo> Slots;
+  for (MachineBasicBlock &MBB : MF) {
+    for (MachineInstr &MI : MBB) {
+      for (unsigned I = 0, E = MI.getNumOperands(); I != E; ++I) {
+        const MachineOperand &MO = MI.getOperand(I);
+        if (!MO.isFI())
+          continue;
+        SlotInfo &Slot = Slots[MO.getIndex()];
+        unsigned Size;
+        const TargetRegisterClass *RC = getAccessClass(MI, Size);
+        if (!RC || I != getAddressOperandNo(MI) ||
+            !MI.getOperand(I - 1).isImm() || MI.getOperand(I - 1).getImm() ||
+            !MI.hasOneMemOperand() ||
+            (*MI.memoperands_begin())->isVolatile() ||
+            (*MI.memoperands_begin())->isAtomic() ||
+            MFI.getObjectSize(MO.getIndex()) != Size ||
+            (Slot.RC && Slot.RC != RC)) {
+          Slot.Promotable = false;
+          continue;
+        }
+        Slot.RC = RC;
+        Slot.Accesses.insert(&MI);
+      }
+    }
+  }
+
+  // Slots described by debug info must keep their storage.
+  for (const auto &VI : MF.getVariableDbgInfo())
+    if (Slots.count(VI.Slot))
+      Slots[VI.Slot].Promotable = false;
+
+  bool Changed = false;
+  MachineBasicBlock &Entry = MF.front();
+
+  for (auto &Pair : Slots) {
+    int FI = Pair.first;
+    SlotInfo &Slot = Pair.second;
+    if (!Slot.Promotable || FI < 0 || MFI.isDeadObjectIndex(FI) ||
+        MFI.isVariableSizedObjectIndex(FI))
+      continue;
+
+    LLVM_DEBUG(dbgs() << "Promoting stack slot " << FI << '\n');
+
+    // The slot's contents on entry are undefined. Memory is, but locals are
+    // zero-initialized, so this is no worse.
+    auto InsertPt = Entry.begin();
+    while (InsertPt != Entry.end() && WebAssembly::isArgument(*InsertPt))
+      ++InsertPt;
+    unsigned Undef = MRI.createVirtualRegister(Slot.RC);
+    BuildMI(Entry, InsertPt, DebugLoc(),
+            TII.get(TargetOpcode::IMPLICIT_DEF), Undef);
+
+    // Record the value each block leaves in the slot, then rewrite loads to
+    // copies of the value live at that point, like mem2reg.
+    MachineSSAUpdater SSA(MF);
+    SSA.Initialize(Undef);
+    SmallPtrSet<MachineBasicBlock *, 8> Blocks;
+    for (MachineInstr *MI : Slot.Accesses)
+      Blocks.insert(MI->getParent());
+    Blocks.insert(&Entry);
+    for (MachineBasicBlock &MBB : MF) {
+      if (!Blocks.count(&MBB))
+        continue;
+      unsigned Last = &MBB == &Entry ? Undef : 0;
+      for (MachineInstr &MI : MBB)
+        if (MI.mayStore() && Slot.Accesses.count(&MI))
+          Last = MI.getOperand(3).getReg();
+      if (Last)
+        SSA.AddAvailableValue(&MBB, Last);
+    }
+
+    SmallVector<unsigned, 8> StoredRegs;
+    for (MachineBasicBlock &MBB : MF) {
+      if (!Blocks.count(&MBB))
+        continue;
+      unsigned Cur = &MBB == &Entry ? Undef : 0;
+      for (auto I = MBB.begin(), E = MBB.end(); I != E;) {
+        MachineInstr &MI = *I++;
+        if (!Slot.Accesses.count(&MI))
+          continue;
+        if (MI.mayStore()) {
+          Cur = MI.getOperand(3).getReg();
+          StoredRegs.push_back(Cur);
+        } else {
+          if (!Cur)
+            Cur = SSA.GetValueInMiddleOfBlock(&MBB);
+          BuildMI(MBB, MI, MI.getDebugLoc(), TII.get(TargetOpcode::COPY),
+                  MI.getOperand(0).getReg())
+              .addReg(Cur);
+        }
+        MI.eraseFromParent();
+      }
+    }
+
+    // Values now live in registers across blocks.
+    for (unsigned Reg : StoredRegs)
+      MRI.clearKillFlags(Reg);
+    for (unsigned Reg : StoredRegs)
+      eraseDeadDefs(Reg, MRI);
+    if (MRI.use_empty(Undef))
+      MRI.getVRegDef(Undef)->eraseFromParent();
+
+    MFI.RemoveStackObject(FI);
+    ++NumSlotsPromoted;
+    Changed = true;
+  }
+
+  if (Changed) {
+    bool HasObjects = false;
+    for (int I = MFI.getObjectIndexBegin(), E = MFI.getObjectIndexEnd(); I != E;
+         ++I)
+      HasObjects |= !MFI.isDeadObjectIndex(I);
+    if (!HasObjects)
+      ++NumFramesRemoved;
+  }
+
+  return Changed;
+}
@@ -35,6 +35,7 @@
 #include "llvm/CodeGen/Passes.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
+#include <set>
 using namespace llvm;
 
 #define DEBUG_TYPE "wasm-reg-stackify"
@@ -238,6 +239,8 @@ static void Query(const MachineInstr &MI, AliasAnalysis &AA, bool &Read,
     switch (MI.getOpcode()) {
     case WebAssembly::CALL_VOID:
     case WebAssembly::CALL_INDIRECT_VOID:
+    case WebAssembly::RET_CALL:
+    case WebAssembly::RET_CALL_INDIRECT:
       QueryCallee(MI, 0, Read, Write, Effects, StackPointer);
       break;
     case WebAssembly::CALL_I32: case WebAssembly::CALL_I64:
@@ -305,13 +308,121 @@ static bool HasOneUse(unsigned Reg, MachineInstr *Def,
   return HasOne;
 }
 
+namespace {
+/// The memory and side-effect properties of an instruction, as computed by
+/// Query.
+struct QueryResult {
+  bool Read = false;
+  bool Write = false;
+  bool Effects = false;
+  bool StackPointer = false;
+};
+
+/// Cached Query results for the instructions of a block, along with the
+/// positions of the instructions having each property. This lets IsSafeToMove
+/// look up whether anything between a def and its insertion point conflicts
+/// with it, instead of walking every instruction in between, which is
+/// quadratic in the size of the block.
+///
+/// Positions are SlotIndexes, which keep their relative order when
+/// LiveIntervals renumbers them, so the sets stay sorted as instructions are
+/// inserted. Instructions that move or get erased must be removed first and,
+/// if they move, added back afterwards.
+class BlockHazards {
+  AliasAnalysis &AA;
+  const LiveIntervals &LIS;
+  DenseMap<const MachineInstr *, QueryResult> Results;
+  std::set<SlotIndex> Reads, Writes, Effects, StackPointers;
+
+  static bool hasIndexBetween(const std::set<SlotIndex> &Set, SlotIndex From,
+                              SlotIndex To) {
+    auto I = Set.upper_bound(From);
+    return I != Set.end() && *I < To;
+  }
+
+public:
+  BlockHazards(AliasAnalysis &AA, const LiveIntervals &LIS)
+      : AA(AA), LIS(LIS) {}
+
+  /// Start tracking the instructions of MBB, forgetting any previous block.
+  void reset(const MachineBasicBlock &MBB) {
+    Results.clear();
+    Reads.clear();
+    Writes.clear();
+    Effects.clear();
+    StackPointers.clear();
+    for (const MachineInstr &MI : MBB)
+      if (!MI.isTerminator())
+        insert(MI);
+  }
+
+  /// Return the (memoized) Query result for MI.
+  const QueryResult &get(const MachineInstr &MI) {
+    auto Pair = Results.insert(std::make_pair(&MI, QueryResult()));
+    if (Pair.second) {
+      QueryResult &R = Pair.first->second;
+      Query(MI, AA, R.Read, R.Write, R.Effects, R.StackPointer);
+    }
+    return Pair.first->second;
+  }
+
+  /// Record MI at its current position.
+  void insert(const MachineInstr &MI) {
+    if (MI.isDebugInstr())
+      return;
+    const QueryResult &R = get(MI);
+    if (!R.Read && !R.Write && !R.Effects && !R.StackPointer)
+      return;
+    SlotIndex Idx = LIS.getInstructionIndex(MI);
+    if (R.Read)
+      Reads.insert(Idx);
+    if (R.Write)
+      Writes.insert(Idx);
+    if (R.Effects)
+      Effects.insert(Idx);
+    if (R.StackPointer)
+      StackPointers.insert(Idx);
+  }
+
+  /// Forget MI's current position. If Erase is set, also forget its Query
+  /// result, since MI is about to be deleted.
+  void remove(const MachineInstr &MI, bool Erase) {
+    auto I = Results.find(&MI);
+    if (I == Results.end())
+      return;
+    SlotIndex Idx = LIS.getInstructionIndex(MI);
+    Reads.erase(Idx);
+    Writes.erase(Idx);
+    Effects.erase(Idx);
+    StackPointers.erase(Idx);
+    if (Erase)
+      Results.erase(I);
+  }
+
+  /// Test whether an instruction strictly between From and To conflicts with
+  /// an instruction having the properties in R.
+  bool conflictsBetween(const QueryResult &R, SlotIndex From,
+                        SlotIndex To) const {
+    if (R.Effects && hasIndexBetween(Effects, From, To))
+      return true;
+    if (R.Read && hasIndexBetween(Writes, From, To))
+      return true;
+    if (R.Write && (hasIndexBetween(Reads, From, To) ||
+                    hasIndexBetween(Writes, From, To)))
+      return true;
+    if (R.StackPointer && hasIndexBetween(StackPointers, From, To))
+      return true;
+    return false;
+  }
+};
+} // end anonymous namespace
+
 // Test whether it's safe to move Def to just before Insert.
-// TODO: Compute memory dependencies in a way that doesn't require always
-// walking the block.
 // TODO: Compute memory dependencies in a way that uses AliasAnalysis to be
 // more precise.
 static bool IsSafeToMove(const MachineInstr *Def, const MachineInstr *Insert,
-                         AliasAnalysis &AA, const MachineRegisterInfo &MRI) {
+                         const MachineRegisterInfo &MRI,
+                         const LiveIntervals &LIS, BlockHazards &Hazards) {
   assert(Def->getParent() == Insert->getParent());
 
   // Check for register dependencies.
@@ -345,38 +456,31 @@ static bool IsSafeToMove(const MachineInstr *Def, const MachineInstr *Insert,
       MutableRegisters.push_back(Reg);
   }
 
-  bool Read = false, Write = false, Effects = false, StackPointer = false;
-  Query(*Def, AA, Read, Write, Effects, StackPointer);
+  const QueryResult &R = Hazards.get(*Def);
 
   // If the instruction does not access memory and has no side effects, it has
   // no additional dependencies.
   bool HasMutableRegisters = !MutableRegisters.empty();
-  if (!Read && !Write && !Effects && !StackPointer && !HasMutableRegisters)
+  if (!R.Read && !R.Write && !R.Effects && !R.StackPointer &&
+      !HasMutableRegisters)
     return true;
 
-  // Scan through the intervening instructions between Def and Insert.
-  MachineBasicBlock::const_iterator D(Def), I(Insert);
-  for (--I; I != D; --I) {
-    bool InterveningRead = false;
-    bool InterveningWrite = false;
-    bool InterveningEffects = false;
-    bool InterveningStackPointer = false;
-    Query(*I, AA, InterveningRead, InterveningWrite, InterveningEffects,
-          InterveningStackPointer);
-    if (Effects && InterveningEffects)
-      return false;
-    if (Read && InterveningWrite)
-      return false;
-    if (Write && (InterveningRead || InterveningWrite))
-      return false;
-    if (StackPointer && InterveningStackPointer)
-      return false;
+  // Check the intervening instructions between Def and Insert.
+  SlotIndex DefIdx = LIS.getInstructionIndex(*Def);
+  SlotIndex InsertIdx = LIS.getInstructionIndex(*Insert);
+  if (Hazards.conflictsBetween(R, DefIdx, InsertIdx))
+    return false;
 
-    for (unsigned Reg : MutableRegisters)
-      for (const MachineOperand &MO : I->operands())
-        if (MO.isReg() && MO.isDef() && MO.getReg() == Reg)
+  // Registers that aren't in SSA form only have a few defs; check whether any
+  // of them is in the way rather than scanning the instructions.
+  for (unsigned Reg : MutableRegisters)
+    for (const MachineInstr &MI : MRI.def_instructions(Reg))
+      if (&MI != Def && MI.getParent() == Def->getParent() &&
+          !MI.isDebugInstr()) {
+        SlotIndex Idx = LIS.getInstructionIndex(MI);
+        if (DefIdx < Idx && Idx < InsertIdx)
           return false;
-  }
+      }
 
   return true;
 }
@@ -410,8 +514,15 @@ static bool OneUseDominatesOtherUses(unsigned Reg, const MachineOperand &OneUse,
       if (&OneUse > &Use)
         return false;
     } else {
-      // Test that the use is dominated by the one selected use.
-      while (!MDT.dominates(OneUseInst, UseInst)) {
+      // Test that the use is dominated by the one selected use. Within a
+      // block, compare slot indices rather than have the dominator tree scan
+      // the block for whichever instruction comes first.
+      auto Dominates = [&](const MachineInstr *A, const MachineInstr *B) {
+        if (A->getParent() == B->getParent())
+          return LIS.getInstructionIndex(*A) < LIS.getInstructionIndex(*B);
+        return MDT.dominates(A->getParent(), B->getParent());
+      };
+      while (!Dominates(OneUseInst, UseInst)) {
         // Actually, dominating is over-conservative. Test that the use would
         // happen after the one selected use in the stack evaluation order.
         //
@@ -471,11 +582,14 @@ static MachineInstr *MoveForSingleUse(unsigned Reg, MachineOperand& Op,
                                       MachineBasicBlock &MBB,
                                       MachineInstr *Insert, LiveIntervals &LIS,
                                       WebAssemblyFunctionInfo &MFI,
-                                      MachineRegisterInfo &MRI) {
+                                      MachineRegisterInfo &MRI,
+                                      BlockHazards &Hazards) {
   LLVM_DEBUG(dbgs() << "Move for single use: "; Def->dump());
 
+  Hazards.remove(*Def, /*Erase=*/false);
   MBB.splice(Insert, &MBB, Def);
   LIS.handleMove(*Def);
+  Hazards.insert(*Def);
 
   if (MRI.hasOneDef(Reg) && MRI.hasOneUse(Reg)) {
     // No one else is using this register for anything so we can just stackify
@@ -512,7 +626,8 @@ static MachineInstr *RematerializeCheapDef(
     unsigned Reg, MachineOperand &Op, MachineInstr &Def, MachineBasicBlock &MBB,
     MachineBasicBlock::instr_iterator Insert, LiveIntervals &LIS,
     WebAssemblyFunctionInfo &MFI, MachineRegisterInfo &MRI,
-    const WebAssemblyInstrInfo *TII, const WebAssemblyRegisterInfo *TRI) {
+    const WebAssemblyInstrInfo *TII, const WebAssemblyRegisterInfo *TRI,
+    BlockHazards &Hazards) {
   LLVM_DEBUG(dbgs() << "Rematerializing cheap def: "; Def.dump());
   LLVM_DEBUG(dbgs() << " - for use in "; Op.getParent()->dump());
 
@@ -521,6 +636,7 @@ static MachineInstr *RematerializeCheapDef(
   Op.setReg(NewReg);
   MachineInstr *Clone = &*std::prev(Insert);
   LIS.InsertMachineInstrInMaps(*Clone);
+  Hazards.insert(*Clone);
   LIS.createAndComputeVirtRegInterval(NewReg);
   MFI.stackifyVReg(NewReg);
   ImposeStackOrdering(Clone);
@@ -538,9 +654,8 @@ static MachineInstr *RematerializeCheapDef(
   // If that was the last use of the original, delete the original.
   if (IsDead) {
     LLVM_DEBUG(dbgs() << " - Deleting original\n");
-    SlotIndex Idx = LIS.getInstructionIndex(Def).getRegSlot();
-    LIS.removePhysRegDefAt(WebAssembly::ARGUMENTS, Idx);
     LIS.removeInterval(Reg);
+    Hazards.remove(Def, /*Erase=*/true);
     LIS.RemoveMachineInstrFromMaps(Def);
     Def.eraseFromParent();
   }
@@ -571,12 +686,15 @@ static MachineInstr *RematerializeCheapDef(
 static MachineInstr *MoveAndTeeForMultiUse(
     unsigned Reg, MachineOperand &Op, MachineInstr *Def, MachineBasicBlock &MBB,
     MachineInstr *Insert, LiveIntervals &LIS, WebAssemblyFunctionInfo &MFI,
-    MachineRegisterInfo &MRI, const WebAssemblyInstrInfo *TII) {
+    MachineRegisterInfo &MRI, const WebAssemblyInstrInfo *TII,
+    BlockHazards &Hazards) {
   LLVM_DEBUG(dbgs() << "Move and tee for multi-use:"; Def->dump());
 
   // Move Def into place.
+  Hazards.remove(*Def, /*Erase=*/false);
   MBB.splice(Insert, &MBB, Def);
   LIS.handleMove(*Def);
+  Hazards.insert(*Def);
 
   // Create the Tee and attach the registers.
   const auto *RegClass = MRI.getRegClass(Reg);
@@ -622,11 +740,39 @@ class TreeWalkerState {
   typedef iterator_range<mop_reverse_iterator> RangeTy;
   SmallVector<RangeTy, 4> Worklist;
 
+  /// How many operands on the stack use each register. A tree over a large
+  /// block can leave thousands of operands on the stack, too many to scan for
+  /// every operand visited.
+  DenseMap<unsigned, unsigned> NumPendingUses;
+
+  void addPending(const MachineOperand &MO) {
+    if (MO.isReg())
+      ++NumPendingUses[MO.getReg()];
+  }
+
+  void removePending(const MachineOperand &MO) {
+    if (MO.isReg())
+      --NumPendingUses[MO.getReg()];
+  }
+
+  void push(RangeTy Range) {
+    if (Range.begin() == Range.end())
+      return;
+    for (const MachineOperand &MO : Range)
+      addPending(MO);
+    Worklist.push_back(Range);
+  }
+
+  /// Stop counting the operands remaining at the top of the stack, which are
+  /// about to change.
+  void forgetTop() {
+    for (const MachineOperand &MO : Worklist.back())
+      removePending(MO);
+  }
+
 public:
   explicit TreeWalkerState(MachineInstr *Insert) {
-    const iterator_range<mop_iterator> &Range = Insert->explicit_uses();
-    if (Range.begin() != Range.end())
-      Worklist.push_back(reverse(Range));
+    push(reverse(Insert->explicit_uses()));
   }
 
   bool Done() const { return Worklist.empty(); }
@@ -634,6 +780,7 @@ public:
   MachineOperand &Pop() {
     RangeTy &Range = Worklist.back();
     MachineOperand &Op = *Range.begin();
+    removePending(Op);
     Range = drop_begin(Range, 1);
     if (Range.begin() == Range.end())
       Worklist.pop_back();
@@ -645,9 +792,7 @@ public:
 
   /// Push Instr's operands onto the stack to be visited.
   void PushOperands(MachineInstr *Instr) {
-    const iterator_range<mop_iterator> &Range(Instr->explicit_uses());
-    if (Range.begin() != Range.end())
-      Worklist.push_back(reverse(Range));
+    push(reverse(Instr->explicit_uses()));
   }
 
   /// Some of Instr's operands are on the top of the stack; remove them and
@@ -656,7 +801,22 @@ public:
     assert(HasRemainingOperands(Instr) &&
            "Reseting operands should only be done when the instruction has "
            "an operand still on the stack");
-    Worklist.back() = reverse(Instr->explicit_uses());
+    forgetTop();
+    Worklist.pop_back();
+    push(reverse(Instr->explicit_uses()));
+  }
+
+  /// Commute operands Op0 and Op1 of Instr, some of whose operands may still
+  /// be on the top of the stack.
+  void Commute(MachineInstr *Instr, unsigned Op0, unsigned Op1,
+               const WebAssemblyInstrInfo *TII) {
+    bool OnTop = HasRemainingOperands(Instr);
+    if (OnTop)
+      forgetTop();
+    TII->commuteInstruction(*Instr, /*NewMI=*/false, Op0, Op1);
+    if (OnTop)
+      for (const MachineOperand &MO : Worklist.back())
+        addPending(MO);
   }
 
   /// Test whether Instr has operands remaining to be visited at the top of
@@ -675,11 +835,7 @@ public:
   /// This is needed as a consequence of using implicit get_locals for
   /// uses and implicit set_locals for defs.
   bool IsOnStack(unsigned Reg) const {
-    for (const RangeTy &Range : Worklist)
-      for (const MachineOperand &MO : Range)
-        if (MO.isReg() && MO.getReg() == Reg)
-          return true;
-    return false;
+    return NumPendingUses.lookup(Reg) != 0;
   }
 };
 
@@ -710,7 +866,7 @@ public:
       assert(!Declined &&
              "Don't decline commuting until you've finished trying it");
       // Commuting didn't help. Revert it.
-      TII->commuteInstruction(*Insert, /*NewMI=*/false, Operand0, Operand1);
+      TreeWalker.Commute(Insert, Operand0, Operand1, TII);
       TentativelyCommuting = false;
       Declined = true;
     } else if (!Declined && TreeWalker.HasRemainingOperands(Insert)) {
@@ -718,7 +874,7 @@ public:
       Operand1 = TargetInstrInfo::CommuteAnyOperandIndex;
       if (TII->findCommutedOpIndices(*Insert, Operand0, Operand1)) {
         // Tentatively commute the operands and try again.
-        TII->commuteInstruction(*Insert, /*NewMI=*/false, Operand0, Operand1);
+        TreeWalker.Commute(Insert, Operand0, Operand1, TII);
         TreeWalker.ResetTopOperands(Insert);
         TentativelyCommuting = true;
         Declined = false;
@@ -749,6 +905,14 @@ bool WebAssemblyRegStackify::runOnMachineFunction(MachineFunction &MF) {
   MachineDominatorTree &MDT = getAnalysis<MachineDominatorTree>();
   LiveIntervals &LIS = getAnalysis<LiveIntervals>();
 
+  // Nearly every instruction has a dead def of ARGUMENTS, so its live range
+  // has a segment per instruction, and updating it would make every move
+  // linear in the size of the function. Nothing here needs it; LiveIntervals
+  // recomputes it if a later pass asks for it.
+  for (MCRegUnitIterator Unit(WebAssembly::ARGUMENTS, TRI); Unit.isValid();
+       ++Unit)
+    LIS.removeRegUnit(*Unit);
+
   // Disable the TEE optimization if we aren't doing direct wasm object
   // emission, because lowering TEE to TEE_LOCAL is done in the ExplicitLocals
   // pass, which is also disabled.
@@ -760,7 +924,9 @@ bool WebAssemblyRegStackify::runOnMachineFunction(MachineFunction &MF) {
   // Walk the instructions from the bottom up. Currently we don't look past
   // block boundaries, and the blocks aren't ordered so the block visitation
   // order isn't significant, but we may want to change this in the future.
+  BlockHazards Hazards(AA, LIS);
   for (MachineBasicBlock &MBB : MF) {
+    Hazards.reset(MBB);
     // Don't use a range-based for loop, because we modify the list as we're
     // iterating over it and the end iterator may change.
     for (auto MII = MBB.rbegin(); MII != MBB.rend(); ++MII) {
@@ -807,6 +973,11 @@ bool WebAssemblyRegStackify::runOnMachineFunction(MachineFunction &MF) {
         if (WebAssembly::isArgument(*Def))
           continue;
 
+        // The results of a multivalue call have to be taken off the stack in
+        // order, right after the call, so they always go to locals.
+        if (WebAssembly::isCallResult(*Def))
+          continue;
+
         // Decide which strategy to take. Prefer to move a single-use value
         // over cloning it, and prefer cloning over introducing a tee.
         // For moving, we require the def to be in the same block as the use;
@@ -814,18 +985,20 @@ bool WebAssemblyRegStackify::runOnMachineFunction(MachineFunction &MF) {
         // supports intra-block moves) and it's MachineSink's job to catch all
         // the sinking opportunities anyway.
         bool SameBlock = Def->getParent() == &MBB;
-        bool CanMove = SameBlock && IsSafeToMove(Def, Insert, AA, MRI) &&
+        bool CanMove = SameBlock &&
+                       IsSafeToMove(Def, Insert, MRI, LIS, Hazards) &&
                        !TreeWalker.IsOnStack(Reg);
         if (CanMove && HasOneUse(Reg, Def, MRI, MDT, LIS)) {
-          Insert = MoveForSingleUse(Reg, Op, Def, MBB, Insert, LIS, MFI, MRI);
+          Insert = MoveForSingleUse(Reg, Op, Def, MBB, Insert, LIS, MFI, MRI,
+                                    Hazards);
         } else if (ShouldRematerialize(*Def, AA, TII)) {
           Insert =
               RematerializeCheapDef(Reg, Op, *Def, MBB, Insert->getIterator(),
-                                    LIS, MFI, MRI, TII, TRI);
+                                    LIS, MFI, MRI, TII, TRI, Hazards);
         } else if (UseTee && CanMove &&
                    OneUseDominatesOtherUses(Reg, Op, MBB, MRI, MDT, LIS, MFI)) {
           Insert = MoveAndTeeForMultiUse(Reg, Op, Def, MBB, Insert, LIS, MFI,
-                                         MRI, TII);
+                                         MRI, TII, Hazards);
         } else {
           // We failed to stackify the operand. If the problem was ordering
           // constraints, Commuting may be able to help.
@@ -18,3 +18,47 @@ using namespace llvm;
 #define DEBUG_TYPE "wasm-selectiondag-info"
 
 WebAssemblySelectionDAGInfo::~WebAssemblySelectionDAGInfo() {}
+
+// Constant sizes small enough to expand inline never get here: SelectionDAG
+// tries a load/store sequence first, bounded by the MaxStoresPerMem* limits
+// WebAssemblyTargetLowering sets. What's left becomes a bulk memory operation
+// if the subtarget has them, or a libcall otherwise.
+static bool useBulkMemory(const SelectionDAG &DAG) {
+  const auto &ST =
+      DAG.getMachineFunction().getSubtarget<WebAssemblySubtarget>();
+  return ST.hasBulkMemory() && !ST.hasAddr64();
+}
+
+SDValue WebAssemblySelectionDAGInfo::EmitTargetCodeForMemcpy(
+    SelectionDAG &DAG, const SDLoc &DL, SDValue Chain, SDValue Dst, SDValue Src,
+    SDValue Size, unsigned Align, bool IsVolatile, bool AlwaysInline,
+    MachinePointerInfo DstPtrInfo, MachinePointerInfo SrcPtrInfo) const {
+  // Callers asking for an inline copy get the generic expansion.
+  if (AlwaysInline || !useBulkMemory(DAG))
+    return SDValue();
+  // The length operand is an i32, but the intrinsics may use any integer type
+  // for it, e.g. the i64 variants on wasm32.
+  return DAG.getNode(WebAssemblyISD::MEMORY_COPY, DL, MVT::Other, Chain, Dst,
+                     Src, DAG.getZExtOrTrunc(Size, DL, MVT::i32));
+}
+
+SDValue WebAssemblySelectionDAGInfo::EmitTargetCodeForMemmove(
+    SelectionDAG &DAG, const SDLoc &DL, SDValue Chain, SDValue Dst, SDValue Src,
+    SDValue Size, unsigned Align, bool IsVolatile,
+    MachinePointerInfo DstPtrInfo, MachinePointerInfo SrcPtrInfo) const {
+  // memory.copy is specified to handle overlapping ranges.
+  return EmitTargetCodeForMemcpy(DAG, DL, Chain, Dst, Src, Size, Align,
+                                 IsVolatile, false, DstPtrInfo, SrcPtrInfo);
+}
+
+SDValue WebAssemblySelectionDAGInfo::EmitTargetCodeForMemset(
+    SelectionDAG &DAG, const SDLoc &DL, SDValue Chain, SDValue Dst, SDValue Val,
+    SDValue Size, unsigned Align, bool IsVolatile,
+    MachinePointerInfo DstPtrInfo) const {
+  if (!useBulkMemory(DAG))
+    return SDValue();
+  // memory.fill takes the fill byte as an i32 and only uses the low 8 bits.
+  return DAG.getNode(WebAssemblyISD::MEMORY_FILL, DL, MVT::Other, Chain, Dst,
+                     DAG.getAnyExtOrTrunc(Val, DL, MVT::i32),
+                     DAG.getZExtOrTrunc(Size, DL, MVT::i32));
+}
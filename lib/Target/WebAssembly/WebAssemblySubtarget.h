@@ -34,6 +34,9 @@ class WebAssemblySubtarget final : public WebAssemblyGenSubtargetInfo {
   bool HasNontrappingFPToInt;
   bool HasSignExt;
   bool HasExceptionHandling;
+  bool HasBulkMemory;
+  bool HasTailCall;
+  bool HasMultivalue;
 
   /// String name of used CPU.
   std::string CPUString;
@@ -82,6 +85,9 @@ public:
   bool hasNontrappingFPToInt() const { return HasNontrappingFPToInt; }
   bool hasSignExt() const { return HasSignExt; }
   bool hasExceptionHandling() const { return HasExceptionHandling; }
+  bool hasBulkMemory() const { return HasBulkMemory; }
+  bool hasTailCall() const { return HasTailCall; }
+  bool hasMultivalue() const { return HasMultivalue; }
 
   /// Parses features string setting specified subtarget options. Definition of
   /// function is auto generated by tblgen.
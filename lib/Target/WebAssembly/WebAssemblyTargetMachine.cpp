@@ -57,6 +57,7 @@ extern "C" void LLVMInitializeWebAssemblyTarget() {
   initializeOptimizeReturnedPass(PR);
   initializeWebAssemblyArgumentMovePass(PR);
   initializeWebAssemblySetP2AlignOperandsPass(PR);
+  initializeWebAssemblyPromoteStackSlotsPass(PR);
   initializeWebAssemblyReplacePhysRegsPass(PR);
   initializeWebAssemblyPrepareForLiveIntervalsPass(PR);
   initializeWebAssemblyOptimizeLiveIntervalsPass(PR);
@@ -64,6 +65,7 @@ extern "C" void LLVMInitializeWebAssemblyTarget() {
   initializeWebAssemblyRegStackifyPass(PR);
   initializeWebAssemblyRegColoringPass(PR);
   initializeWebAssemblyExplicitLocalsPass(PR);
+  initializeWebAssemblyLocalColoringPass(PR);
   initializeWebAssemblyFixIrreducibleControlFlowPass(PR);
   initializeWebAssemblyExceptionPreparePass(PR);
   initializeWebAssemblyCFGSortPass(PR);
@@ -177,6 +179,7 @@ public:
 
   void addIRPasses() override;
   bool addInstSelector() override;
+  void addPreRegAlloc() override;
   void addPostRegAlloc() override;
   bool addGCPasses() override { return false; }
   void addPreEmitPass() override;
@@ -260,6 +263,15 @@ bool WebAssemblyPassConfig::addInstSelector() {
   return false;
 }
 
+void WebAssemblyPassConfig::addPreRegAlloc() {
+  TargetPassConfig::addPreRegAlloc();
+
+  // Keep stack slots whose address never escapes in locals, so that functions
+  // with only such slots don't need a frame in linear memory.
+  if (getOptLevel() != CodeGenOpt::None)
+    addPass(createWebAssemblyPromoteStackSlots());
+}
+
 void WebAssemblyPassConfig::addPostRegAlloc() {
   // TODO: The following CodeGen passes don't currently support code containing
   // virtual registers. Consider removing their restrictions and re-enabling
@@ -321,6 +333,11 @@ void WebAssemblyPassConfig::addPreEmitPass() {
   // Insert explicit get_local and set_local operators.
   addPass(createWebAssemblyExplicitLocals());
 
+  // Merge locals that ExplicitLocals left separate but which never interfere,
+  // such as the ones feeding tees.
+  if (getOptLevel() != CodeGenOpt::None)
+    addPass(createWebAssemblyLocalColoring());
+
   // Do various transformations for exception handling
   addPass(createWebAssemblyExceptionPrepare());
 
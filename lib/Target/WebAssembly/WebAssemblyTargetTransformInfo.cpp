@@ -43,36 +43,54 @@ unsigned WebAssemblyTTIImpl::getRegisterBitWidth(bool Vector) const {
   return 64;
 }
 
+// The vector operations WebAssemblyInstrSIMD.td selects.  Any other operation
+// on a 128-bit vector type, including loads, stores, lane accesses, shuffles,
+// comparisons and conversions, doesn't have a pattern yet and would fail
+// instruction selection, so it gets UnsupportedSIMDCost to make sure neither
+// vectorizer ever picks it.  Reductions and interleaved accesses are costed by
+// BasicTTIImpl from the shuffles, arithmetic and memory operations they are
+// built from, so they follow from these.
+static const CostTblEntry SIMD128CostTable[] = {
+    {ISD::ADD, MVT::v16i8, 1}, {ISD::ADD, MVT::v8i16, 1},
+    {ISD::ADD, MVT::v4i32, 1}, {ISD::FADD, MVT::v4f32, 1},
+    {ISD::SUB, MVT::v16i8, 1}, {ISD::SUB, MVT::v8i16, 1},
+    {ISD::SUB, MVT::v4i32, 1}, {ISD::FSUB, MVT::v4f32, 1},
+    {ISD::MUL, MVT::v16i8, 1}, {ISD::MUL, MVT::v8i16, 1},
+    {ISD::MUL, MVT::v4i32, 1}, {ISD::FMUL, MVT::v4f32, 1},
+};
+
+static const unsigned UnsupportedSIMDCost = 1u << 16;
+
+// Whether Ty is legalized to a SIMD128 vector type.
+bool WebAssemblyTTIImpl::isSIMD128Type(Type *Ty) const {
+  if (!Ty->isVectorTy() || !getST()->hasSIMD128())
+    return false;
+  MVT VT = TLI->getTypeLegalizationCost(DL, Ty).second;
+  return VT == MVT::v16i8 || VT == MVT::v8i16 || VT == MVT::v4i32 ||
+         VT == MVT::v4f32;
+}
+
 unsigned WebAssemblyTTIImpl::getArithmeticInstrCost(
     unsigned Opcode, Type *Ty, TTI::OperandValueKind Opd1Info,
     TTI::OperandValueKind Opd2Info, TTI::OperandValueProperties Opd1PropInfo,
     TTI::OperandValueProperties Opd2PropInfo, ArrayRef<const Value *> Args) {
+  if (isSIMD128Type(Ty)) {
+    std::pair<int, MVT> LT = TLI->getTypeLegalizationCost(DL, Ty);
+    int ISD = TLI->InstructionOpcodeToISD(Opcode);
+    if (const auto *Entry = CostTableLookup(SIMD128CostTable, ISD, LT.second))
+      return LT.first * Entry->Cost;
+    return UnsupportedSIMDCost;
+  }
 
-  unsigned Cost = BasicTTIImplBase<WebAssemblyTTIImpl>::getArithmeticInstrCost(
+  return BasicTTIImplBase<WebAssemblyTTIImpl>::getArithmeticInstrCost(
       Opcode, Ty, Opd1Info, Opd2Info, Opd1PropInfo, Opd2PropInfo);
-
-  if (VectorType *VTy = dyn_cast<VectorType>(Ty)) {
-    switch (Opcode) {
-    case Instruction::LShr:
-    case Instruction::AShr:
-    case Instruction::Shl:
-      // SIMD128's shifts currently only accept a scalar shift count. For each
-      // element, we'll need to extract, op, insert. The following is a rough
-      // approxmation.
-      if (Opd2Info != TTI::OK_UniformValue &&
-          Opd2Info != TTI::OK_UniformConstantValue)
-        Cost = VTy->getNumElements() *
-               (TargetTransformInfo::TCC_Basic +
-                getArithmeticInstrCost(Opcode, VTy->getElementType()) +
-                TargetTransformInfo::TCC_Basic);
-      break;
-    }
-  }
-  return Cost;
 }
 
 unsigned WebAssemblyTTIImpl::getVectorInstrCost(unsigned Opcode, Type *Val,
                                                 unsigned Index) {
+  if (isSIMD128Type(Val))
+    return UnsupportedSIMDCost;
+
   unsigned Cost = BasicTTIImplBase::getVectorInstrCost(Opcode, Val, Index);
 
   // SIMD128's insert/extract currently only take constant indices.
@@ -81,3 +99,35 @@ unsigned WebAssemblyTTIImpl::getVectorInstrCost(unsigned Opcode, Type *Val,
 
   return Cost;
 }
+
+unsigned WebAssemblyTTIImpl::getShuffleCost(TTI::ShuffleKind Kind, Type *Tp,
+                                            int Index, Type *SubTp) {
+  if (isSIMD128Type(Tp))
+    return UnsupportedSIMDCost;
+  return BaseT::getShuffleCost(Kind, Tp, Index, SubTp);
+}
+
+unsigned WebAssemblyTTIImpl::getCastInstrCost(unsigned Opcode, Type *Dst,
+                                              Type *Src,
+                                              const Instruction *I) {
+  if (isSIMD128Type(Dst) || isSIMD128Type(Src))
+    return UnsupportedSIMDCost;
+  return BaseT::getCastInstrCost(Opcode, Dst, Src, I);
+}
+
+unsigned WebAssemblyTTIImpl::getCmpSelInstrCost(unsigned Opcode, Type *ValTy,
+                                                Type *CondTy,
+                                                const Instruction *I) {
+  if (isSIMD128Type(ValTy))
+    return UnsupportedSIMDCost;
+  return BaseT::getCmpSelInstrCost(Opcode, ValTy, CondTy, I);
+}
+
+unsigned WebAssemblyTTIImpl::getMemoryOpCost(unsigned Opcode, Type *Src,
+                                             unsigned Alignment,
+                                             unsigned AddressSpace,
+                                             const Instruction *I) {
+  if (isSIMD128Type(Src))
+    return UnsupportedSIMDCost;
+  return BaseT::getMemoryOpCost(Opcode, Src, Alignment, AddressSpace, I);
+}
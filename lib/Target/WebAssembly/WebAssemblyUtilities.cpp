@@ -34,6 +34,18 @@ bool WebAssembly::isArgument(const MachineInstr &MI) {
   }
 }
 
+bool WebAssembly::isCallResult(const MachineInstr &MI) {
+  switch (MI.getOpcode()) {
+  case WebAssembly::CALL_RESULT_I32:
+  case WebAssembly::CALL_RESULT_I64:
+  case WebAssembly::CALL_RESULT_F32:
+  case WebAssembly::CALL_RESULT_F64:
+    return true;
+  default:
+    return false;
+  }
+}
+
 bool WebAssembly::isCopy(const MachineInstr &MI) {
   switch (MI.getOpcode()) {
   case WebAssembly::COPY_I32:
@@ -82,6 +94,7 @@ bool WebAssembly::isCallIndirect(const MachineInstr &MI) {
   case WebAssembly::CALL_INDIRECT_v8i16:
   case WebAssembly::CALL_INDIRECT_v4i32:
   case WebAssembly::CALL_INDIRECT_v4f32:
+  case WebAssembly::RET_CALL_INDIRECT:
     return true;
   default:
     return false;
@@ -26,6 +26,7 @@ class WebAssemblyFunctionInfo;
 namespace WebAssembly {
 
 bool isArgument(const MachineInstr &MI);
+bool isCallResult(const MachineInstr &MI);
 bool isCopy(const MachineInstr &MI);
 bool isTee(const MachineInstr &MI);
 bool isChild(const MachineInstr &MI, const WebAssemblyFunctionInfo &MFI);
@@ -10,6 +10,8 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/Function.h"
@@ -18,6 +20,8 @@
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/CtorUtils.h"
+#include "llvm/Transforms/Utils/Evaluator.h"
 #include "llvm/Pass.h"
 #include "llvm/IR/Attributes.h"
 #include "llvm/Support/raw_ostream.h"
@@ -25,45 +29,162 @@
 #include <set>
 #include <string>
 #include <utility>
+#include <vector>
 
 using namespace llvm;
 
 #define DEBUG_TYPE "snax_apply"
+
+STATISTIC(NumCtorsEvaluated, "Number of static constructors evaluated ahead of time");
+STATISTIC(NumCtorCallsElided, "Number of __wasm_call_ctors calls elided");
+STATISTIC(NumDtorCallsElided, "Number of __cxa_finalize calls elided");
+STATISTIC(NumReturnsMerged,  "Number of returns merged into the entry epilogue");
+
 static cl::opt<std::string> entry_opt (
    "entry",
    cl::desc("Specify entry point")
 );
 
+static cl::opt<bool> whole_program (
+   "snax-apply-whole-program",
+   cl::desc("The module is the whole contract (LTO), so __wasm_call_ctors and "
+            "__cxa_finalize can be dropped when it has nothing to run"),
+   cl::init(false)
+);
+
 namespace {
-  // SnaxApply - Mutate the apply function as needed 
-  struct SnaxApplyPass : public FunctionPass {
-    static char ID; 
-    SnaxApplyPass() : FunctionPass(ID) {}
-    bool runOnFunction(Function &F) override {
-       if (F.hasFnAttribute("snax_wasm_entry") || F.getName().equals("apply")) {
-         Function* wasm_ctors = (Function*)F.getParent()->getOrInsertFunction("__wasm_call_ctors", AttributeList{}, Type::getVoidTy(F.getContext()));
-         Function* wasm_dtors = (Function*)F.getParent()->getOrInsertFunction("__cxa_finalize", AttributeList{}, Type::getVoidTy(F.getContext()), Type::getInt32Ty(F.getContext()));
-
-         IRBuilder<> builder(&F.getEntryBlock());
-         builder.SetInsertPoint(&(F.getEntryBlock().front()));
-
-         CallInst* wasm_ctor_call = builder.CreateCall(wasm_ctors, {}, "");
-         if (const Function* F_ = dyn_cast<Function>(wasm_ctors->stripPointerCasts()))
-            wasm_ctor_call->setCallingConv(F_->getCallingConv());
-
-         for ( Function::iterator bb = F.begin(); bb != F.end(); bb++ ) {
-            if (isa<ReturnInst>((*bb).getTerminator())) {
-               builder.SetInsertPoint((*bb).getTerminator());
-               // for now just call with null
-               CallInst* wasm_dtor_call = builder.CreateCall(wasm_dtors, {Constant::getNullValue(Type::getInt32Ty(F.getContext()))}, "");
-               if (const Function* F_ = dyn_cast<Function>(wasm_dtors->stripPointerCasts()))
-                  wasm_dtor_call->setCallingConv(F_->getCallingConv());
-            }
-         }
-
-         return true;
-      }
-      return false;
+  bool has_entries(const Module& M, StringRef list) {
+     const GlobalVariable* GV = M.getNamedGlobal(list);
+     if (!GV || !GV->hasInitializer())
+        return false;
+     auto* ATy = dyn_cast<ArrayType>(GV->getValueType());
+     return !ATy || ATy->getNumElements() != 0;
+  }
+
+  // Destructors are registered at run time through __cxa_atexit (global
+  // dtors are lowered to it, and so are function-local statics), so
+  // __cxa_finalize has work to do if anything can reach it.
+  bool needs_finalize(const Module& M) {
+     if (has_entries(M, "llvm.global_dtors"))
+        return true;
+     for (StringRef name : {"__cxa_atexit", "atexit"})
+        if (const Function* F = M.getFunction(name))
+           if (!F->use_empty())
+              return true;
+     return false;
+  }
+
+  // Run the static constructors we can evaluate at compile time and fold
+  // their stores into the initializers of the globals they write.  Anything
+  // the evaluator can't handle, or that stores into part of a global, keeps
+  // its runtime constructor.
+  bool evaluate_ctors(Module& M) {
+     TargetLibraryInfoImpl TLII(Triple(M.getTargetTriple()));
+     TargetLibraryInfo TLI(TLII);
+     const DataLayout& DL = M.getDataLayout();
+     auto evaluate = [&](Function* F) {
+        if (!F || F->isDeclaration())
+           return false;
+        Evaluator Eval(DL, &TLI);
+        Constant* RetValDummy;
+        if (!Eval.EvaluateFunction(F, RetValDummy, SmallVector<Constant*, 0>()))
+           return false;
+        for (const auto& Store : Eval.getMutatedMemory())
+           if (!isa<GlobalVariable>(Store.first))
+              return false;
+        for (const auto& Store : Eval.getMutatedMemory())
+           cast<GlobalVariable>(Store.first)->setInitializer(Store.second);
+        for (GlobalVariable* GV : Eval.getInvariants())
+           GV->setConstant(true);
+        ++NumCtorsEvaluated;
+        return true;
+     };
+     // Constructors run in order, so once one has to stay, the ones after it
+     // might depend on what it does and have to stay too.
+     bool blocked = false;
+     return optimizeGlobalCtorsList(M, [&](Function* F) {
+        if (!blocked)
+           blocked = !evaluate(F);
+        return !blocked;
+     });
+  }
+
+  // Funnel every return of F through a single epilogue block, so the entry
+  // point runs its exit code from one place.  Returns null if F never
+  // returns.
+  BasicBlock* merge_returns(Function& F) {
+     std::vector<ReturnInst*> rets;
+     for (BasicBlock& BB : F)
+        if (auto* ret = dyn_cast<ReturnInst>(BB.getTerminator()))
+           rets.push_back(ret);
+     if (rets.empty())
+        return nullptr;
+     if (rets.size() == 1)
+        return rets.front()->getParent();
+
+     BasicBlock* epilogue = BasicBlock::Create(F.getContext(), "epilogue", &F);
+     PHINode* phi = nullptr;
+     if (!F.getReturnType()->isVoidTy())
+        phi = PHINode::Create(F.getReturnType(), rets.size(), "retval", epilogue);
+     ReturnInst::Create(F.getContext(), phi, epilogue);
+     for (ReturnInst* ret : rets) {
+        if (phi)
+           phi->addIncoming(ret->getReturnValue(), ret->getParent());
+        BranchInst::Create(epilogue, ret->getParent());
+        ret->eraseFromParent();
+        ++NumReturnsMerged;
+     }
+     return epilogue;
+  }
+
+  bool is_entry(const Function& F) {
+     return !F.isDeclaration() && (F.hasFnAttribute("snax_wasm_entry") || F.getName().equals("apply"));
+  }
+
+  // SnaxApply - Mutate the apply function as needed
+  struct SnaxApplyPass : public ModulePass {
+    static char ID;
+    SnaxApplyPass() : ModulePass(ID) {}
+    bool runOnModule(Module &M) override {
+       std::vector<Function*> entries;
+       for (Function& F : M)
+          if (is_entry(F))
+             entries.push_back(&F);
+       if (entries.empty())
+          return false;
+
+       evaluate_ctors(M);
+       bool call_ctors = !whole_program || has_entries(M, "llvm.global_ctors");
+       bool call_dtors = !whole_program || needs_finalize(M);
+
+       for (Function* entry : entries) {
+          Function& F = *entry;
+          IRBuilder<> builder(&F.getEntryBlock());
+          if (call_ctors) {
+             Function* wasm_ctors = (Function*)M.getOrInsertFunction("__wasm_call_ctors", AttributeList{}, Type::getVoidTy(F.getContext()));
+             builder.SetInsertPoint(&(F.getEntryBlock().front()));
+             CallInst* wasm_ctor_call = builder.CreateCall(wasm_ctors, {}, "");
+             if (const Function* F_ = dyn_cast<Function>(wasm_ctors->stripPointerCasts()))
+                wasm_ctor_call->setCallingConv(F_->getCallingConv());
+          } else {
+             ++NumCtorCallsElided;
+          }
+
+          if (call_dtors) {
+             Function* wasm_dtors = (Function*)M.getOrInsertFunction("__cxa_finalize", AttributeList{}, Type::getVoidTy(F.getContext()), Type::getInt32Ty(F.getContext()));
+             if (BasicBlock* epilogue = merge_returns(F)) {
+                builder.SetInsertPoint(epilogue->getTerminator());
+                // for now just call with null
+                CallInst* wasm_dtor_call = builder.CreateCall(wasm_dtors, {Constant::getNullValue(Type::getInt32Ty(F.getContext()))}, "");
+                if (const Function* F_ = dyn_cast<Function>(wasm_dtors->stripPointerCasts()))
+                   wasm_dtor_call->setCallingConv(F_->getCallingConv());
+             }
+          } else {
+             ++NumDtorCallsElided;
+          }
+       }
+
+       return true;
     }
   };
 }
@@ -72,4 +193,5 @@ char SnaxApplyPass::ID = 0;
 static RegisterPass<SnaxApplyPass> X("apply_fixup", "Snax Apply Fixups");
 
 static void registerSnaxApplyPass(const PassManagerBuilder&, legacy::PassManagerBase& PM) { PM.add(new SnaxApplyPass()); }
-static RegisterStandardPasses RegisterMyPass(PassManagerBuilder::EP_EarlyAsPossible, registerSnaxApplyPass);
+static RegisterStandardPasses RegisterMyPass(PassManagerBuilder::EP_ModuleOptimizerEarly, registerSnaxApplyPass);
+static RegisterStandardPasses RegisterMyPassO0(PassManagerBuilder::EP_EnabledOnOptLevel0, registerSnaxApplyPass);
@@ -9,141 +9,811 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Constants.h"
 #include "llvm/IR/Function.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Intrinsics.h"
 #include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Operator.h"
+#include "llvm/IR/PassManager.h"
 #include "llvm/IR/Type.h"
 #include "llvm/IR/IRBuilder.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Passes/PassPlugin.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
 #include "llvm/Pass.h"
 #include "llvm/IR/Attributes.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/raw_ostream.h"
 
-#include <map>
-#include <set>
+#include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 using namespace llvm;
 
 #define DEBUG_TYPE "snax_softfloat"
 
+STATISTIC(NumFolded,   "Number of FP operations folded before lowering");
+STATISTIC(NumConversionsFolded, "Number of redundant FP conversions folded");
+STATISTIC(NumLowered,  "Number of FP operations lowered");
+STATISTIC(NumArith,    "Number of fadd/fsub/fmul/fdiv/frem lowered");
+STATISTIC(NumCompare,  "Number of fcmp lowered");
+STATISTIC(NumConvert,  "Number of FP conversions lowered");
+STATISTIC(NumIntrinsic, "Number of FP intrinsics lowered");
+STATISTIC(NumBitwise,  "Number of FP operations lowered to integer ops only");
+STATISTIC(NumHelperCalls, "Number of softfloat intrinsic calls emitted");
+STATISTIC(NumFastPath, "Number of FP operations lowered to inline fast paths");
+
+static cl::opt<bool> inline_fast_path (
+   "snax-softfloat-inline",
+   cl::desc("Lower fadd/fsub/fmul/fdiv to integer-only fast paths that only "
+            "call the softfloat intrinsics for special operands"),
+   cl::init(false)
+);
+
 namespace {
+  // Layout of an IEEE-754 binary format, used to emit the integer fast paths.
+  struct float_format {
+     Type*        fp_ty;
+     IntegerType* int_ty;   // same width as fp_ty
+     IntegerType* wide_ty;  // twice the width, for products and quotients
+     unsigned     mant_bits;
+     unsigned     exp_bits;
+
+     unsigned width()const    { return int_ty->getBitWidth(); }
+     unsigned sig_bits()const { return mant_bits + 1; }
+     uint64_t exp_max()const  { return (1ull << exp_bits) - 1; }
+     uint64_t bias()const     { return (1ull << (exp_bits - 1)) - 1; }
+     uint64_t mant_mask()const{ return (1ull << mant_bits) - 1; }
+     Constant* c(uint64_t v)const { return ConstantInt::get(int_ty, v); }
+     Constant* sign()const    { return ConstantInt::get(int_ty, APInt::getSignMask(width())); }
+  };
+
+  float_format get_format(Type* ty) {
+     LLVMContext& ctx = ty->getContext();
+     if (ty->isFloatTy())
+        return {ty, Type::getInt32Ty(ctx), Type::getInt64Ty(ctx), 23, 8};
+     return {ty, Type::getInt64Ty(ctx), Type::getInt128Ty(ctx), 52, 11};
+  }
+
+  // Types lowered to softfloat calls; get_format only describes these.
+  bool is_softfloat_type(Type* ty) {
+     return ty->isFloatTy() || ty->isDoubleTy();
+  }
+
+  // Unpacked operand of a fast path: biased exponent and significand with
+  // the implicit bit made explicit.
+  struct unpacked {
+     Value* exp;
+     Value* sig;
+  };
+
+  unpacked unpack(IRBuilder<>& b, const float_format& fmt, Value* bits) {
+     Value* exp = b.CreateAnd(b.CreateLShr(bits, fmt.mant_bits), fmt.exp_max());
+     Value* sig = b.CreateOr(b.CreateAnd(bits, fmt.mant_mask()), fmt.c(1ull << fmt.mant_bits));
+     return {exp, sig};
+  }
+
+  // Round a significand carrying three extra guard/round/sticky bits to
+  // nearest-even and pack it with the sign and biased exponent.  Returns the
+  // packed bits and whether the result is a normal number; anything else
+  // (overflow, subnormal) has to go through the slow path.
+  std::pair<Value*, Value*> round_and_pack(IRBuilder<>& b, const float_format& fmt,
+                                           Value* sign, Value* exp, Value* sig) {
+     Value* grs  = b.CreateAnd(sig, 7);
+     Value* mant = b.CreateLShr(sig, 3);
+     Value* up   = b.CreateOr(b.CreateICmpUGT(grs, fmt.c(4)),
+                              b.CreateAnd(b.CreateICmpEQ(grs, fmt.c(4)),
+                                          b.CreateICmpNE(b.CreateAnd(mant, 1), fmt.c(0))));
+     mant = b.CreateAdd(mant, b.CreateZExt(up, fmt.int_ty));
+     Value* carry = b.CreateICmpNE(b.CreateLShr(mant, fmt.sig_bits()), fmt.c(0));
+     mant = b.CreateSelect(carry, b.CreateLShr(mant, 1), mant);
+     exp  = b.CreateAdd(exp, b.CreateZExt(carry, fmt.int_ty));
+     Value* normal = b.CreateAnd(b.CreateICmpSGT(exp, fmt.c(0)),
+                                 b.CreateICmpSLT(exp, fmt.c(fmt.exp_max())));
+     Value* bits = b.CreateOr(sign, b.CreateOr(b.CreateShl(exp, fmt.mant_bits),
+                                               b.CreateAnd(mant, fmt.mant_mask())));
+     return {bits, normal};
+  }
+
+  // Shift right, or-ing every bit shifted out into the lowest bit.
+  Value* shift_right_sticky(IRBuilder<>& b, Value* v, Value* amt) {
+     Type* ty = v->getType();
+     Value* lost = b.CreateAnd(v, b.CreateSub(b.CreateShl(ConstantInt::get(ty, 1), amt),
+                                              ConstantInt::get(ty, 1)));
+     return b.CreateOr(b.CreateLShr(v, amt),
+                       b.CreateZExt(b.CreateICmpNE(lost, ConstantInt::get(ty, 0)), ty));
+  }
+
+  // Fast path for fadd/fsub; both operands are known normal.
+  std::pair<Value*, Value*> emit_add(IRBuilder<>& b, const float_format& fmt,
+                                     Value* ia, Value* ib, bool negate_b) {
+     if (negate_b)
+        ib = b.CreateXor(ib, fmt.sign());
+     Value* mag_mask = fmt.c(~0ull >> (65 - fmt.width()));
+     Value* swap = b.CreateICmpULT(b.CreateAnd(ia, mag_mask), b.CreateAnd(ib, mag_mask));
+     Value* x = b.CreateSelect(swap, ib, ia);
+     Value* y = b.CreateSelect(swap, ia, ib);
+     unpacked ux = unpack(b, fmt, x);
+     unpacked uy = unpack(b, fmt, y);
+
+     const unsigned ext_bits = fmt.sig_bits() + 3;
+     Value* mx = b.CreateShl(ux.sig, 3);
+     Value* my = b.CreateShl(uy.sig, 3);
+     Value* d  = b.CreateSub(ux.exp, uy.exp);
+     d  = b.CreateSelect(b.CreateICmpUGT(d, fmt.c(ext_bits)), fmt.c(ext_bits), d);
+     my = shift_right_sticky(b, my, d);
+
+     Value* same_sign = b.CreateICmpSGE(b.CreateXor(ia, ib), fmt.c(0));
+
+     Value* sum   = b.CreateAdd(mx, my);
+     Value* carry = b.CreateICmpNE(b.CreateLShr(sum, ext_bits), fmt.c(0));
+     Value* sum_n = b.CreateSelect(carry, b.CreateOr(b.CreateLShr(sum, 1), b.CreateAnd(sum, 1)), sum);
+     Value* sum_e = b.CreateAdd(ux.exp, b.CreateZExt(carry, fmt.int_ty));
+
+     Value* diff  = b.CreateSub(mx, my);
+     Function* ctlz = Intrinsic::getDeclaration(b.GetInsertBlock()->getModule(),
+                                                Intrinsic::ctlz, {fmt.int_ty});
+     Value* lz    = b.CreateCall(ctlz, {diff, b.getFalse()});
+     Value* norm  = b.CreateSub(lz, fmt.c(fmt.width() - ext_bits));
+     Value* diff_n = b.CreateShl(diff, norm);
+     Value* diff_e = b.CreateSub(ux.exp, norm);
+
+     Value* sig = b.CreateSelect(same_sign, sum_n, diff_n);
+     Value* exp = b.CreateSelect(same_sign, sum_e, diff_e);
+     auto res = round_and_pack(b, fmt, b.CreateAnd(x, fmt.sign()), exp, sig);
+
+     // x - x is +0.0 when rounding to nearest
+     Value* exact_zero = b.CreateAnd(b.CreateNot(same_sign), b.CreateICmpEQ(diff, fmt.c(0)));
+     return {b.CreateSelect(exact_zero, fmt.c(0), res.first),
+             b.CreateOr(exact_zero, res.second)};
+  }
+
+  // Fast path for fmul; both operands are known normal.
+  std::pair<Value*, Value*> emit_mul(IRBuilder<>& b, const float_format& fmt,
+                                     Value* ia, Value* ib) {
+     unpacked ua = unpack(b, fmt, ia);
+     unpacked ub = unpack(b, fmt, ib);
+     Value* sign = b.CreateAnd(b.CreateXor(ia, ib), fmt.sign());
+     Value* prod = b.CreateMul(b.CreateZExt(ua.sig, fmt.wide_ty), b.CreateZExt(ub.sig, fmt.wide_ty));
+
+     // the product of two significands has its top bit at 2n-1 or 2n-2, keep
+     // n+3 bits of it
+     const unsigned n = fmt.sig_bits();
+     Value* hi = b.CreateICmpNE(b.CreateLShr(prod, 2 * n - 1), ConstantInt::get(fmt.wide_ty, 0));
+     Value* amt = b.CreateSelect(hi, ConstantInt::get(fmt.wide_ty, n - 3),
+                                     ConstantInt::get(fmt.wide_ty, n - 4));
+     Value* sig = b.CreateTrunc(shift_right_sticky(b, prod, amt), fmt.int_ty);
+     Value* exp = b.CreateAdd(b.CreateSub(b.CreateAdd(ua.exp, ub.exp), fmt.c(fmt.bias())),
+                              b.CreateZExt(hi, fmt.int_ty));
+     return round_and_pack(b, fmt, sign, exp, sig);
+  }
+
+  // Fast path for fdiv; both operands are known normal.
+  std::pair<Value*, Value*> emit_div(IRBuilder<>& b, const float_format& fmt,
+                                     Value* ia, Value* ib) {
+     unpacked ua = unpack(b, fmt, ia);
+     unpacked ub = unpack(b, fmt, ib);
+     Value* sign = b.CreateAnd(b.CreateXor(ia, ib), fmt.sign());
+
+     // scale the dividend so the quotient lands in [2^(n+2), 2^(n+3))
+     const unsigned n = fmt.sig_bits();
+     Value* lt  = b.CreateICmpULT(ua.sig, ub.sig);
+     Value* num = b.CreateSelect(lt, b.CreateShl(ua.sig, 1), ua.sig);
+     num = b.CreateShl(b.CreateZExt(num, fmt.wide_ty), n + 2);
+     Value* den = b.CreateZExt(ub.sig, fmt.wide_ty);
+     Value* quo = b.CreateTrunc(b.CreateUDiv(num, den), fmt.int_ty);
+     Value* rem = b.CreateURem(num, den);
+     Value* sig = b.CreateOr(quo, b.CreateZExt(b.CreateICmpNE(rem, ConstantInt::get(fmt.wide_ty, 0)),
+                                               fmt.int_ty));
+     Value* exp = b.CreateSub(b.CreateAdd(b.CreateSub(ua.exp, ub.exp), fmt.c(fmt.bias())),
+                              b.CreateZExt(lt, fmt.int_ty));
+     return round_and_pack(b, fmt, sign, exp, sig);
+  }
+
+  // Integer-only negation, exact for every input including NaNs.
+  Value* create_neg(IRBuilder<>& b, Value* v) {
+     float_format fmt = get_format(v->getType());
+     return b.CreateBitCast(b.CreateXor(b.CreateBitCast(v, fmt.int_ty), fmt.sign()), v->getType());
+  }
+
+  // Try to replace an FP binary operator with something that needs no
+  // softfloat call at all, or with a cheaper operation.  Every rewrite here
+  // is exact under IEEE-754 round-to-nearest-even (up to NaN quieting), or is
+  // only done when the instruction's fast-math flags allow reassociation.
+  Value* fold_binop(BinaryOperator* binop) {
+     Value* lhs = binop->getOperand(0);
+     Value* rhs = binop->getOperand(1);
+     auto* cl = dyn_cast<ConstantFP>(lhs);
+     auto* cr = dyn_cast<ConstantFP>(rhs);
+     unsigned opcode = binop->getOpcode();
+     IRBuilder<> b(binop);
+     b.setFastMathFlags(binop->getFastMathFlags());
+
+     if (cl && cr)
+        return ConstantExpr::get(opcode, cl, cr);
+
+     switch (opcode) {
+        case Instruction::FAdd:
+           if (cr && cr->isNegativeZeroValue())
+              return lhs;
+           if (cl && cl->isNegativeZeroValue())
+              return rhs;
+           break;
+        case Instruction::FSub:
+           if (cr && cr->isZero() && !cr->isNegative())
+              return lhs;
+           if (cl && cl->isNegativeZeroValue())
+              return create_neg(b, rhs);
+           break;
+        case Instruction::FMul:
+           if (cl)
+              std::swap(lhs, rhs), std::swap(cl, cr);
+           if (cr && cr->isExactlyValue(1.0))
+              return lhs;
+           if (cr && cr->isExactlyValue(-1.0))
+              return create_neg(b, lhs);
+           break;
+        case Instruction::FDiv: {
+           if (cr && cr->isExactlyValue(1.0))
+              return lhs;
+           if (cr && cr->isExactlyValue(-1.0))
+              return create_neg(b, lhs);
+           // division by a power of two is exactly a multiply by its inverse
+           APFloat inv(0.0);
+           if (cr && cr->getValueAPF().getExactInverse(&inv))
+              return b.CreateFMul(lhs, ConstantFP::get(binop->getContext(), inv));
+           break;
+        }
+     }
+
+     if (!binop->hasAllowReassoc())
+        return nullptr;
+
+     // (x op c1) op c2 -> x op (c1 op c2) for add and mul chains
+     if ((opcode == Instruction::FAdd || opcode == Instruction::FMul) && cr) {
+        auto* inner = dyn_cast<BinaryOperator>(lhs);
+        if (inner && inner->getOpcode() == opcode && inner->hasOneUse() &&
+            inner->hasAllowReassoc() && isa<ConstantFP>(inner->getOperand(1))) {
+           Constant* c = ConstantExpr::get(opcode, cast<Constant>(inner->getOperand(1)), cr);
+           return b.CreateBinOp((Instruction::BinaryOps)opcode, inner->getOperand(0), c);
+        }
+     }
+
+     // multiply-accumulate: x*y + x*z -> x*(y+z)
+     if (opcode == Instruction::FAdd || opcode == Instruction::FSub) {
+        auto* ml = dyn_cast<BinaryOperator>(lhs);
+        auto* mr = dyn_cast<BinaryOperator>(rhs);
+        if (ml && mr && ml->getOpcode() == Instruction::FMul && mr->getOpcode() == Instruction::FMul &&
+            ml->hasOneUse() && mr->hasOneUse() && ml->hasAllowReassoc() && mr->hasAllowReassoc()) {
+           for (unsigned i = 0; i < 2; ++i) {
+              for (unsigned j = 0; j < 2; ++j) {
+                 if (ml->getOperand(i) != mr->getOperand(j))
+                    continue;
+                 Value* acc = b.CreateBinOp((Instruction::BinaryOps)opcode,
+                                            ml->getOperand(1 - i), mr->getOperand(1 - j));
+                 return b.CreateFMul(ml->getOperand(i), acc);
+              }
+           }
+        }
+     }
+     return nullptr;
+  }
+
+  // Run fold_binop to a fixed point over the f32/f64 binary operators of `f`.
+  bool fold_binops(Function& f) {
+     std::vector<WeakVH> worklist;
+     for (BasicBlock& bb : f)
+        for (Instruction& inst : bb)
+           if (isa<BinaryOperator>(inst) && is_softfloat_type(inst.getType()))
+              worklist.push_back(&inst);
+
+     bool changed = false;
+     for (size_t i = 0; i < worklist.size(); ++i) {
+        auto* binop = cast_or_null<BinaryOperator>(worklist[i]);
+        if (!binop)
+           continue;
+        Value* repl = fold_binop(binop);
+        if (!repl)
+           continue;
+        binop->replaceAllUsesWith(repl);
+        // operands only feeding the folded instruction (the rewritten halves
+        // of a chain) are dead now
+        SmallVector<Instruction*, 2> dead;
+        for (Value* op : binop->operands())
+           if (isa<BinaryOperator>(op) && op != repl && op->hasOneUse())
+              dead.push_back(cast<Instruction>(op));
+        binop->eraseFromParent();
+        for (Instruction* inst : dead)
+           inst->eraseFromParent();
+        if (isa<BinaryOperator>(repl) && is_softfloat_type(repl->getType()))
+           worklist.push_back(repl);
+        ++NumFolded;
+        changed = true;
+     }
+     return changed;
+  }
+
+  // Fold conversions that are exact round trips, so the optimizer never sees
+  // a pair of softfloat conversion calls cancelling each other out.
+  Value* fold_conversion(Instruction* inst) {
+     if (auto* trunc = dyn_cast<FPTruncInst>(inst)) {
+        // fptrunc (fpext x) -> x
+        if (auto* ext = dyn_cast<FPExtInst>(trunc->getOperand(0)))
+           if (ext->getSrcTy() == trunc->getDestTy())
+              return ext->getOperand(0);
+     } else if (isa<FPToSIInst>(inst) || isa<FPToUIInst>(inst)) {
+        // fpto[su]i ([su]itofp x) -> x, when the FP type holds every value of x
+        auto* conv = dyn_cast<CastInst>(inst->getOperand(0));
+        bool is_signed = isa<FPToSIInst>(inst);
+        if (conv && (is_signed ? isa<SIToFPInst>(conv) : isa<UIToFPInst>(conv)) &&
+            conv->getSrcTy() == inst->getType() && !conv->getSrcTy()->isVectorTy()) {
+           unsigned bits = conv->getSrcTy()->getIntegerBitWidth() - is_signed;
+           if (bits <= (unsigned)APFloat::semanticsPrecision(conv->getDestTy()->getFltSemantics()))
+              return conv->getOperand(0);
+        }
+     } else if (auto* cmp = dyn_cast<FCmpInst>(inst)) {
+        // fcmp (fpext a), (fpext b) -> fcmp a, b
+        auto* lhs = dyn_cast<FPExtInst>(cmp->getOperand(0));
+        auto* rhs = dyn_cast<FPExtInst>(cmp->getOperand(1));
+        if (lhs && rhs && lhs->getSrcTy() == rhs->getSrcTy())
+           return IRBuilder<>(cmp).CreateFCmp(cmp->getPredicate(), lhs->getOperand(0), rhs->getOperand(0));
+     }
+     return nullptr;
+  }
+
+  bool fold_conversions(Function& f) {
+     bool changed = false;
+     for (BasicBlock& bb : f) {
+        for (auto it = bb.begin(); it != bb.end();) {
+           Instruction& inst = *it++;
+           if (Value* repl = fold_conversion(&inst)) {
+              inst.replaceAllUsesWith(repl);
+              inst.eraseFromParent();
+              ++NumConversionsFolded;
+              changed = true;
+           }
+        }
+     }
+     return changed;
+  }
+
+  // Lowering tables.  Each entry names the softfloat intrinsic (without the
+  // _snax_fNN_ prefix) implementing the operation.
+  struct binop_lowering {
+     unsigned    opcode;
+     const char* name;
+  };
+  const binop_lowering binop_table[] = {
+     {Instruction::FAdd, "add"},
+     {Instruction::FSub, "sub"},
+     {Instruction::FMul, "mul"},
+     {Instruction::FDiv, "div"},
+     {Instruction::FRem, "rem"},
+  };
+
+  // fcmp predicates are built from the ordered comparison intrinsics: the
+  // result is first(a, b) [|| second(a, b)], negated when `negate` is set.
+  struct fcmp_lowering {
+     CmpInst::Predicate pred;
+     const char*        first;
+     const char*        second;
+     bool               negate;
+  };
+  const fcmp_lowering fcmp_table[] = {
+     {CmpInst::FCMP_OEQ, "eq", nullptr, false},
+     {CmpInst::FCMP_OGT, "gt", nullptr, false},
+     {CmpInst::FCMP_OGE, "ge", nullptr, false},
+     {CmpInst::FCMP_OLT, "lt", nullptr, false},
+     {CmpInst::FCMP_OLE, "le", nullptr, false},
+     {CmpInst::FCMP_ONE, "lt", "gt",    false},
+     {CmpInst::FCMP_UEQ, "lt", "gt",    true},
+     {CmpInst::FCMP_UGT, "le", nullptr, true},
+     {CmpInst::FCMP_UGE, "lt", nullptr, true},
+     {CmpInst::FCMP_ULT, "ge", nullptr, true},
+     {CmpInst::FCMP_ULE, "gt", nullptr, true},
+     {CmpInst::FCMP_UNE, "ne", nullptr, false},
+  };
+
+  struct intrinsic_lowering {
+     Intrinsic::ID id;
+     const char*   name;
+  };
+  const intrinsic_lowering intrinsic_table[] = {
+     {Intrinsic::sqrt,      "sqrt"},
+     {Intrinsic::floor,     "floor"},
+     {Intrinsic::ceil,      "ceil"},
+     {Intrinsic::trunc,     "trunc"},
+     {Intrinsic::nearbyint, "nearest"},
+     {Intrinsic::rint,      "nearest"},
+  };
+
+  std::string type_prefix(Type* ty) {
+     if (ty->isFloatTy())
+        return "f32";
+     if (ty->isDoubleTy())
+        return "f64";
+     return "i" + std::to_string(ty->getIntegerBitWidth());
+  }
+
+  Value* create_is_nan(IRBuilder<>& b, Value* v) {
+     float_format fmt = get_format(v->getType());
+     Value* mag = b.CreateAnd(b.CreateBitCast(v, fmt.int_ty), fmt.c(~0ull >> (65 - fmt.width())));
+     return b.CreateICmpUGT(mag, fmt.c(fmt.exp_max() << fmt.mant_bits));
+  }
+
+  // Cheap pre-scan: collect, in program order, every instruction the
+  // lowering may have to rewrite.  Functions without any are skipped
+  // without touching the module.
+  std::vector<Instruction*> scan_function(Function& f) {
+     std::vector<Instruction*> worklist;
+     for (BasicBlock& bb : f) {
+        for (Instruction& inst : bb) {
+           if (auto* alloca_inst = dyn_cast<AllocaInst>(&inst)) {
+              if (alloca_inst->getAllocatedType()->isX86_FP80Ty())
+                 worklist.push_back(&inst);
+           } else if (isa<BinaryOperator>(inst) || isa<FCmpInst>(inst) || isa<IntrinsicInst>(inst)) {
+              if (is_softfloat_type(inst.getType()) || is_softfloat_type(inst.getOperand(0)->getType()))
+                 worklist.push_back(&inst);
+           } else if (isa<CastInst>(inst) && !isa<BitCastInst>(inst)) {
+              if (is_softfloat_type(inst.getType()) || is_softfloat_type(inst.getOperand(0)->getType()))
+                 worklist.push_back(&inst);
+           }
+        }
+     }
+     return worklist;
+  }
+
+  // Lowers the FP operations of one module to softfloat intrinsics.  Each
+  // intrinsic and fast-path wrapper is looked up or declared once per module.
+  class softfloat_lowering {
+     public:
+        explicit softfloat_lowering(Module& m) : m(m) {}
+
+        // Lower the instructions of `worklist`, as returned by scan_function.
+        bool run(Function& f, std::vector<Instruction*> worklist);
+
+     private:
+        Function* get_helper(const Twine& name, Type* ret, ArrayRef<Type*> params);
+        Function* get_fast_path(Function* slow, unsigned opcode);
+        Value* call_helper(IRBuilder<>& b, Function* helper, ArrayRef<Value*> args);
+
+        Value* lower(Instruction* inst);
+        Value* lower_binop(BinaryOperator* binop);
+        Value* lower_fcmp(FCmpInst* cmp);
+        Value* lower_cast(CastInst* cast);
+        Value* lower_intrinsic(IntrinsicInst* ii);
+
+        Module&              m;
+        StringMap<Function*> helpers;
+  };
+
+  // Declare (or find) the softfloat intrinsic `_snax_<name>`.  They are pure
+  // functions of their operands, which lets the optimizer CSE and drop
+  // redundant calls after lowering.
+  Function* softfloat_lowering::get_helper(const Twine& name, Type* ret, ArrayRef<Type*> params) {
+     SmallString<32> buf;
+     Function*& helper = helpers[("_snax_" + name).toStringRef(buf)];
+     if (helper)
+        return helper;
+     LLVMContext& ctx = m.getContext();
+     AttributeList attrs = AttributeList().addAttribute(ctx, AttributeList::FunctionIndex, Attribute::ReadNone)
+                                          .addAttribute(ctx, AttributeList::FunctionIndex, Attribute::NoUnwind);
+     helper = cast<Function>(m.getOrInsertFunction(buf, FunctionType::get(ret, params, false), attrs));
+     return helper;
+  }
+
+  // Build (or find) the internal function wrapping the softfloat intrinsic
+  // `slow` with an integer-only fast path for normal operands and results.
+  // The wrappers are small enough for the inliner to fold into their callers.
+  Function* softfloat_lowering::get_fast_path(Function* slow, unsigned opcode) {
+     std::string name = ("__" + slow->getName() + "_fast").str();
+     Function*& f = helpers[name];
+     if (f)
+        return f;
+     if ((f = m.getFunction(name)))
+        return f;
+
+     Type* fp_ty = slow->getReturnType();
+     float_format fmt = get_format(fp_ty);
+     LLVMContext& ctx = m.getContext();
+     f = Function::Create(slow->getFunctionType(), GlobalValue::InternalLinkage, name, &m);
+     Value* a = &*f->arg_begin();
+     Value* b = &*std::next(f->arg_begin());
+
+     BasicBlock* entry = BasicBlock::Create(ctx, "entry", f);
+     BasicBlock* fast  = BasicBlock::Create(ctx, "fast", f);
+     BasicBlock* done  = BasicBlock::Create(ctx, "done", f);
+     BasicBlock* slow_bb = BasicBlock::Create(ctx, "slow", f);
+
+     IRBuilder<> builder(entry);
+     Value* ia = builder.CreateBitCast(a, fmt.int_ty);
+     Value* ib = builder.CreateBitCast(b, fmt.int_ty);
+     auto is_special = [&](Value* bits) {
+        Value* exp = builder.CreateAnd(builder.CreateLShr(bits, fmt.mant_bits), fmt.exp_max());
+        return builder.CreateOr(builder.CreateICmpEQ(exp, fmt.c(0)),
+                                builder.CreateICmpEQ(exp, fmt.c(fmt.exp_max())));
+     };
+     builder.CreateCondBr(builder.CreateOr(is_special(ia), is_special(ib)), slow_bb, fast);
+
+     builder.SetInsertPoint(fast);
+     std::pair<Value*, Value*> res;
+     switch (opcode) {
+        case Instruction::FAdd: res = emit_add(builder, fmt, ia, ib, false); break;
+        case Instruction::FSub: res = emit_add(builder, fmt, ia, ib, true);  break;
+        case Instruction::FMul: res = emit_mul(builder, fmt, ia, ib);        break;
+        case Instruction::FDiv: res = emit_div(builder, fmt, ia, ib);        break;
+        default: llvm_unreachable("no fast path for opcode");
+     }
+     builder.CreateCondBr(res.second, done, slow_bb);
+
+     builder.SetInsertPoint(done);
+     builder.CreateRet(builder.CreateBitCast(res.first, fp_ty));
+
+     builder.SetInsertPoint(slow_bb);
+     CallInst* call = builder.CreateCall(slow, {a, b});
+     call->setCallingConv(slow->getCallingConv());
+     builder.CreateRet(call);
+     return f;
+  }
+
+  Value* softfloat_lowering::call_helper(IRBuilder<>& b, Function* helper, ArrayRef<Value*> args) {
+     CallInst* call = b.CreateCall(helper, args);
+     call->setCallingConv(helper->getCallingConv());
+     ++NumHelperCalls;
+     return call;
+  }
+
+  Value* softfloat_lowering::lower_binop(BinaryOperator* binop) {
+     Type* ty = binop->getType();
+     for (const auto& entry : binop_table) {
+        if (entry.opcode != binop->getOpcode())
+           continue;
+        Function* func = get_helper(type_prefix(ty) + "_" + entry.name, ty, {ty, ty});
+        if (inline_fast_path && entry.opcode != Instruction::FRem) {
+           func = get_fast_path(func, entry.opcode);
+           ++NumFastPath;
+        }
+        IRBuilder<> b(binop);
+        ++NumArith;
+        return call_helper(b, func, {binop->getOperand(0), binop->getOperand(1)});
+     }
+     return nullptr;
+  }
+
+  Value* softfloat_lowering::lower_fcmp(FCmpInst* cmp) {
+     Type* ty = cmp->getOperand(0)->getType();
+     Value* lhs = cmp->getOperand(0);
+     Value* rhs = cmp->getOperand(1);
+     IRBuilder<> b(cmp);
+     ++NumCompare;
+     switch (cmp->getPredicate()) {
+        case CmpInst::FCMP_FALSE:
+           return b.getFalse();
+        case CmpInst::FCMP_TRUE:
+           return b.getTrue();
+        case CmpInst::FCMP_UNO:
+           ++NumBitwise;
+           return b.CreateOr(create_is_nan(b, lhs), create_is_nan(b, rhs));
+        case CmpInst::FCMP_ORD:
+           ++NumBitwise;
+           return b.CreateNot(b.CreateOr(create_is_nan(b, lhs), create_is_nan(b, rhs)));
+        default:
+           break;
+     }
+
+     for (const auto& entry : fcmp_table) {
+        if (entry.pred != cmp->getPredicate())
+           continue;
+        auto compare = [&](const char* name) {
+           Function* func = get_helper(type_prefix(ty) + "_" + name, b.getInt32Ty(), {ty, ty});
+           return b.CreateICmpNE(call_helper(b, func, {lhs, rhs}), b.getInt32(0));
+        };
+        Value* res = compare(entry.first);
+        if (entry.second)
+           res = b.CreateOr(res, compare(entry.second));
+        return entry.negate ? b.CreateNot(res) : res;
+     }
+     llvm_unreachable("unhandled fcmp predicate");
+  }
+
+  Value* softfloat_lowering::lower_cast(CastInst* cast) {
+     Type* src = cast->getSrcTy();
+     Type* dst = cast->getDestTy();
+     IRBuilder<> b(cast);
+     switch (cast->getOpcode()) {
+        case Instruction::FPExt:
+           if (!src->isFloatTy() || !dst->isDoubleTy())
+              return nullptr;
+           ++NumConvert;
+           return call_helper(b, get_helper("f32_promote", dst, {src}), {cast->getOperand(0)});
+        case Instruction::FPTrunc:
+           if (!src->isDoubleTy() || !dst->isFloatTy())
+              return nullptr;
+           ++NumConvert;
+           return call_helper(b, get_helper("f64_demote", dst, {src}), {cast->getOperand(0)});
+        case Instruction::FPToSI:
+        case Instruction::FPToUI: {
+           if (!is_softfloat_type(src) || !dst->isIntegerTy() || dst->getIntegerBitWidth() > 64)
+              return nullptr;
+           bool is_signed = cast->getOpcode() == Instruction::FPToSI;
+           IntegerType* int_ty = dst->getIntegerBitWidth() > 32 ? b.getInt64Ty() : b.getInt32Ty();
+           Function* func = get_helper(type_prefix(src) + "_trunc_" + type_prefix(int_ty) + (is_signed ? "s" : "u"),
+                                       int_ty, {src});
+           ++NumConvert;
+           return b.CreateTrunc(call_helper(b, func, {cast->getOperand(0)}), dst);
+        }
+        case Instruction::SIToFP:
+        case Instruction::UIToFP: {
+           if (!is_softfloat_type(dst) || !src->isIntegerTy() || src->getIntegerBitWidth() > 64)
+              return nullptr;
+           bool is_signed = cast->getOpcode() == Instruction::SIToFP;
+           IntegerType* int_ty = src->getIntegerBitWidth() > 32 ? b.getInt64Ty() : b.getInt32Ty();
+           Value* arg = is_signed ? b.CreateSExt(cast->getOperand(0), int_ty)
+                                  : b.CreateZExt(cast->getOperand(0), int_ty);
+           Function* func = get_helper((is_signed ? "" : "u") + type_prefix(int_ty) + "_to_" + type_prefix(dst),
+                                       dst, {int_ty});
+           ++NumConvert;
+           return call_helper(b, func, {arg});
+        }
+        default:
+           return nullptr;
+     }
+  }
+
+  Value* softfloat_lowering::lower_intrinsic(IntrinsicInst* ii) {
+     Type* ty = ii->getType();
+     if (!is_softfloat_type(ty))
+        return nullptr;
+     IRBuilder<> b(ii);
+     float_format fmt = get_format(ty);
+     Value* mag_mask = fmt.c(~0ull >> (65 - fmt.width()));
+     switch (ii->getIntrinsicID()) {
+        case Intrinsic::fabs:
+           ++NumIntrinsic;
+           ++NumBitwise;
+           return b.CreateBitCast(b.CreateAnd(b.CreateBitCast(ii->getArgOperand(0), fmt.int_ty), mag_mask), ty);
+        case Intrinsic::copysign: {
+           ++NumIntrinsic;
+           ++NumBitwise;
+           Value* mag  = b.CreateAnd(b.CreateBitCast(ii->getArgOperand(0), fmt.int_ty), mag_mask);
+           Value* sign = b.CreateAnd(b.CreateBitCast(ii->getArgOperand(1), fmt.int_ty), fmt.sign());
+           return b.CreateBitCast(b.CreateOr(mag, sign), ty);
+        }
+        default:
+           break;
+     }
+     for (const auto& entry : intrinsic_table) {
+        if (entry.id != ii->getIntrinsicID())
+           continue;
+        ++NumIntrinsic;
+        Function* func = get_helper(type_prefix(ty) + "_" + entry.name, ty, {ty});
+        return call_helper(b, func, {ii->getArgOperand(0)});
+     }
+     return nullptr;
+  }
+
+  // Lower one FP instruction to softfloat intrinsics, returning its
+  // replacement, or null when the instruction is left alone.
+  Value* softfloat_lowering::lower(Instruction* inst) {
+     if (auto* binop = dyn_cast<BinaryOperator>(inst))
+        return is_softfloat_type(binop->getType()) ? lower_binop(binop) : nullptr;
+     if (auto* cmp = dyn_cast<FCmpInst>(inst))
+        return is_softfloat_type(cmp->getOperand(0)->getType()) ? lower_fcmp(cmp) : nullptr;
+     if (auto* cast = dyn_cast<CastInst>(inst))
+        return lower_cast(cast);
+     if (auto* ii = dyn_cast<IntrinsicInst>(inst))
+        return lower_intrinsic(ii);
+     return nullptr;
+  }
+
+  bool softfloat_lowering::run(Function& f, std::vector<Instruction*> worklist) {
+     if (worklist.empty())
+        return false;
+
+     bool changed = fold_conversions(f);
+     if (inline_fast_path)
+        changed |= fold_binops(f);
+     // the folds erase and create instructions, rescan what is left
+     if (changed)
+        worklist = scan_function(f);
+
+     for (Instruction* inst : worklist) {
+        if (auto* alloca_inst = dyn_cast<AllocaInst>(inst)) {
+           alloca_inst->setAllocatedType(Type::getFP128Ty(f.getContext()));
+           changed = true;
+        } else if (Value* repl = lower(inst)) {
+           inst->replaceAllUsesWith(repl);
+           inst->eraseFromParent();
+           ++NumLowered;
+           changed = true;
+        }
+     }
+     return changed;
+  }
+
+  // Pre-scan of a function for the softfloat lowering, see scan_function.
+  class SnaxSoftfloatScan : public AnalysisInfoMixin<SnaxSoftfloatScan> {
+     friend AnalysisInfoMixin<SnaxSoftfloatScan>;
+     static AnalysisKey Key;
+
+  public:
+     // The instructions of the function to lower, in program order.
+     class Result {
+        public:
+           explicit Result(std::vector<Instruction*> worklist) : worklist(std::move(worklist)) {}
+
+           const std::vector<Instruction*>& get_worklist()const { return worklist; }
+
+           // The worklist points at instructions of the function, so any
+           // pass that doesn't explicitly preserve the scan may have left it
+           // dangling.
+           bool invalidate(Function&, const PreservedAnalyses& pa, FunctionAnalysisManager::Invalidator&) {
+              auto pac = pa.getChecker<SnaxSoftfloatScan>();
+              return !pac.preserved() && !pac.preservedSet<AllAnalysesOn<Function>>();
+           }
+
+        private:
+           std::vector<Instruction*> worklist;
+     };
+
+     Result run(Function& f, FunctionAnalysisManager&) { return Result(scan_function(f)); }
+  };
+
+  AnalysisKey SnaxSoftfloatScan::Key;
+
+  // SnaxSoftfloat - Lower every FP operation of the module to softfloat
+  // intrinsics.  This is a module pass so the intrinsic declarations and
+  // fast-path wrappers it adds are created once, in program order.
+  struct SnaxSoftfloat : public PassInfoMixin<SnaxSoftfloat> {
+     PreservedAnalyses run(Module& m, ModuleAnalysisManager& mam) {
+        FunctionAnalysisManager& fam = mam.getResult<FunctionAnalysisManagerModuleProxy>(m).getManager();
+        softfloat_lowering lowering(m);
+
+        // snapshot the definitions, the lowering appends wrappers to the module
+        std::vector<Function*> funcs;
+        for (Function& f : m)
+           if (!f.isDeclaration())
+              funcs.push_back(&f);
+
+        bool changed = false;
+        for (Function* f : funcs) {
+           const std::vector<Instruction*>& worklist = fam.getResult<SnaxSoftfloatScan>(*f).get_worklist();
+           if (worklist.empty())
+              continue;
+           if (lowering.run(*f, worklist)) {
+              fam.invalidate(*f, PreservedAnalyses::none());
+              changed = true;
+           }
+        }
+        return changed ? PreservedAnalyses::none() : PreservedAnalyses::all();
+     }
+  };
+
   // SnaxSoftfloat - Mutate the apply function as needed 
   struct SnaxSoftfloatPass : public FunctionPass {
     static char ID; 
     SnaxSoftfloatPass() : FunctionPass(ID) {}
-  
+
+    bool doInitialization(Module &m) override {
+       lowering.reset(new softfloat_lowering(m));
+       return false;
+    }
+
     bool runOnFunction(Function &f) override {
-       Function* f32add = (Function*)f.getParent()->getOrInsertFunction("_snax_f32_add", AttributeList{},
-                                                                       Type::getFloatTy(f.getContext()),
-                                                                       Type::getFloatTy(f.getContext()),
-                                                                       Type::getFloatTy(f.getContext()));
-       Function* f32sub = (Function*)f.getParent()->getOrInsertFunction("_snax_f32_sub", AttributeList{},
-                                                                       Type::getFloatTy(f.getContext()),
-                                                                       Type::getFloatTy(f.getContext()),
-                                                                       Type::getFloatTy(f.getContext()));
-       Function* f32mul = (Function*)f.getParent()->getOrInsertFunction("_snax_f32_mul", AttributeList{},
-                                                                       Type::getFloatTy(f.getContext()),
-                                                                       Type::getFloatTy(f.getContext()),
-                                                                       Type::getFloatTy(f.getContext()));
-       Function* f32div = (Function*)f.getParent()->getOrInsertFunction("_snax_f32_div", AttributeList{},
-                                                                       Type::getFloatTy(f.getContext()),
-                                                                       Type::getFloatTy(f.getContext()),
-                                                                       Type::getFloatTy(f.getContext()));
-       Function* f32rem = (Function*)f.getParent()->getOrInsertFunction("_snax_f32_rem", AttributeList{},
-                                                                       Type::getFloatTy(f.getContext()),
-                                                                       Type::getFloatTy(f.getContext()),
-                                                                       Type::getFloatTy(f.getContext()));
-
-       Function* f64add = (Function*)f.getParent()->getOrInsertFunction("_snax_f64_add", AttributeList{},
-                                                                       Type::getFloatTy(f.getContext()),
-                                                                       Type::getFloatTy(f.getContext()),
-                                                                       Type::getFloatTy(f.getContext()));
-       Function* f64sub = (Function*)f.getParent()->getOrInsertFunction("_snax_f64_sub", AttributeList{},
-                                                                       Type::getFloatTy(f.getContext()),
-                                                                       Type::getFloatTy(f.getContext()),
-                                                                       Type::getFloatTy(f.getContext()));
-       Function* f64mul = (Function*)f.getParent()->getOrInsertFunction("_snax_f64_mul", AttributeList{},
-                                                                       Type::getFloatTy(f.getContext()),
-                                                                       Type::getFloatTy(f.getContext()),
-                                                                       Type::getFloatTy(f.getContext()));
-       Function* f64div = (Function*)f.getParent()->getOrInsertFunction("_snax_f64_div", AttributeList{},
-                                                                       Type::getFloatTy(f.getContext()),
-                                                                       Type::getFloatTy(f.getContext()),
-                                                                       Type::getFloatTy(f.getContext()));
-       Function* f64rem = (Function*)f.getParent()->getOrInsertFunction("_snax_f64_rem", AttributeList{},
-                                                                       Type::getFloatTy(f.getContext()),
-                                                                       Type::getFloatTy(f.getContext()),
-                                                                       Type::getFloatTy(f.getContext()));
-
-
-       bool changed = false;
-       std::set<std::pair<Instruction*, Instruction*>> working_set;
-       for ( Function::iterator bb = f.begin(); bb != f.end(); bb++ ) {
-          for ( BasicBlock::iterator i = bb->begin(); i != bb->end(); i++ ) {
-             Instruction* inst = &*i;
-             if (AllocaInst* alloca_inst = dyn_cast<AllocaInst>(&*inst)) {
-                if (alloca_inst->getAllocatedType()->getTypeID() == Type::TypeID::X86_FP80TyID) {
-                   alloca_inst->setAllocatedType(Type::getFP128Ty(f.getContext()));
-                }
-             }
-             else if (BitCastInst* bc = dyn_cast<BitCastInst>(&*inst)) {
-                auto src_ty  = bc->getSrcTy();
-                auto dest_ty = bc->getDestTy();
-                /*
-                if (bc->get->getType()->getTypeID() == Type::TypeID::X86_FP80TyID) {
-                   outs() << *(bc->getOperand(0)->getType()) <<  (*bc) << "\n";
-                }
-                */
-             }
-             else if (BinaryOperator* binop = dyn_cast<BinaryOperator>(&*inst)) {
-                Function* func = nullptr;
-                Type::TypeID tyid = binop->getOperand(0)->getType()->getTypeID();
-                switch (i->getOpcode()) {
-                   case Instruction::FAdd:
-                      if (tyid == Type::TypeID::FloatTyID)
-                        func = f32add;
-                      else if (tyid == Type::TypeID::DoubleTyID)
-                        func = f64add;
-                      break;
-                   case Instruction::FSub:
-                      if (tyid == Type::TypeID::FloatTyID)
-                        func = f32sub;
-                      else if (tyid == Type::TypeID::DoubleTyID)
-                        func = f64sub;
-                      break;
-                   case Instruction::FMul:
-                      if (tyid == Type::TypeID::FloatTyID)
-                        func = f32mul;
-                      else if (tyid == Type::TypeID::DoubleTyID)
-                        func = f64mul;
-                      break;
-                   case Instruction::FDiv:
-                      if (tyid == Type::TypeID::FloatTyID)
-                        func = f32div;
-                      else if (tyid == Type::TypeID::DoubleTyID)
-                        func = f64div;
-                      break;
-                }
-                if (func) {
-                   CallInst* f_call = CallInst::Create(func, {binop->getOperand(0), binop->getOperand(1)});
-                   working_set.insert({binop, f_call});
-                   changed = true;
-                }
-             }
-          }
-       }
-       for (auto item : working_set) {
-          ReplaceInstWithInst(std::get<0>(item), std::get<1>(item));
-          //outs() << (*(std::get<1>(item)->getParent()));
-       }
- 
-       return changed;
+       return lowering->run(f, scan_function(f));
     }
+
+    std::unique_ptr<softfloat_lowering> lowering;
   };
 }
 
@@ -152,3 +822,26 @@ static RegisterPass<SnaxSoftfloatPass> X("softfloat_fixup", "Snax Softfloat Fixu
 
 static void registerSnaxSoftfloatPass(const PassManagerBuilder&, legacy::PassManagerBase& PM) { PM.add(new SnaxSoftfloatPass()); }
 static RegisterStandardPasses RegisterMyPass(PassManagerBuilder::EP_EarlyAsPossible, registerSnaxSoftfloatPass);
+
+static void registerSnaxSoftfloatCallbacks(PassBuilder& PB) {
+   PB.registerAnalysisRegistrationCallback([](FunctionAnalysisManager& FAM) {
+      FAM.registerPass([] { return SnaxSoftfloatScan(); });
+   });
+   PB.registerPipelineParsingCallback(
+      [](StringRef Name, ModulePassManager& MPM, ArrayRef<PassBuilder::PipelineElement>) {
+         if (Name == "snax-softfloat") {
+            MPM.addPass(SnaxSoftfloat());
+            return true;
+         }
+         return false;
+      });
+   PB.registerPipelineStartEPCallback([](ModulePassManager& MPM) {
+      MPM.addPass(SnaxSoftfloat());
+   });
+}
+
+extern "C" ::llvm::PassPluginLibraryInfo LLVM_ATTRIBUTE_WEAK
+llvmGetPassPluginInfo() {
+   return {LLVM_PLUGIN_API_VERSION, "SnaxSoftfloat", LLVM_VERSION_STRING,
+           registerSnaxSoftfloatCallbacks};
+}
@@ -0,0 +1,91 @@
+; RUN: opt < %s -cost-model -analyze -mtriple=wasm32-unknown-unknown -mattr=+simd128 | FileCheck %s --check-prefix=SIMD
+; RUN: opt < %s -cost-model -analyze -mtriple=wasm32-unknown-unknown | FileCheck %s --check-prefix=NOSIMD
+
+; Only add, sub and mul are selected for the 128-bit vector types so far;
+; every other operation on them is priced out of reach of the vectorizers.
+; Without +simd128 vectors are scalarized and nothing is priced out.
+
+target datalayout = "e-m:e-p:32:32-i64:64-n32:64-S128"
+target triple = "wasm32-unknown-unknown"
+
+; NOSIMD-NOT: cost of 65536
+
+define void @arith(<4 x i32> %a, <8 x i16> %b, <16 x i8> %c, <4 x float> %d, <8 x i32> %e) {
+; SIMD-LABEL: 'arith'
+; SIMD: cost of 1 for instruction: %add = add <4 x i32> %a, %a
+; SIMD: cost of 1 for instruction: %sub = sub <8 x i16> %b, %b
+; SIMD: cost of 1 for instruction: %mul = mul <16 x i8> %c, %c
+; SIMD: cost of 1 for instruction: %fadd = fadd <4 x float> %d, %d
+; SIMD: cost of 1 for instruction: %fmul = fmul <4 x float> %d, %d
+; SIMD: cost of 2 for instruction: %split = add <8 x i32> %e, %e
+; SIMD: cost of 65536 for instruction: %shl = shl <4 x i32> %a, %a
+; SIMD: cost of 65536 for instruction: %and = and <4 x i32> %a, %a
+; SIMD: cost of 65536 for instruction: %sdiv = sdiv <4 x i32> %a, %a
+; SIMD: cost of 65536 for instruction: %fdiv = fdiv <4 x float> %d, %d
+  %add = add <4 x i32> %a, %a
+  %sub = sub <8 x i16> %b, %b
+  %mul = mul <16 x i8> %c, %c
+  %fadd = fadd <4 x float> %d, %d
+  %fmul = fmul <4 x float> %d, %d
+  %split = add <8 x i32> %e, %e
+  %shl = shl <4 x i32> %a, %a
+  %and = and <4 x i32> %a, %a
+  %sdiv = sdiv <4 x i32> %a, %a
+  %fdiv = fdiv <4 x float> %d, %d
+  ret void
+}
+
+define void @memory(<4 x i32>* %p, <16 x i8>* %q) {
+; SIMD-LABEL: 'memory'
+; SIMD: cost of 65536 for instruction: %v = load <4 x i32>, <4 x i32>* %p
+; SIMD: cost of 65536 for instruction: %w = load <16 x i8>, <16 x i8>* %q
+; SIMD: cost of 65536 for instruction: store <4 x i32> %v, <4 x i32>* %p
+  %v = load <4 x i32>, <4 x i32>* %p
+  %w = load <16 x i8>, <16 x i8>* %q
+  store <4 x i32> %v, <4 x i32>* %p
+  ret void
+}
+
+define void @lanes(<4 x i32> %a, <4 x float> %d, i32 %x) {
+; SIMD-LABEL: 'lanes'
+; SIMD: cost of 65536 for instruction: %ext = extractelement <4 x i32> %a, i32 0
+; SIMD: cost of 65536 for instruction: %ins = insertelement <4 x i32> %a, i32 %x, i32 1
+; SIMD: cost of 65536 for instruction: %rev = shufflevector <4 x i32> %a, <4 x i32> undef, <4 x i32> <i32 3, i32 2, i32 1, i32 0>
+; SIMD: cost of 65536 for instruction: %mix = shufflevector <4 x i32> %a, <4 x i32> %a, <4 x i32> <i32 0, i32 5, i32 2, i32 7>
+  %ext = extractelement <4 x i32> %a, i32 0
+  %ins = insertelement <4 x i32> %a, i32 %x, i32 1
+  %rev = shufflevector <4 x i32> %a, <4 x i32> undef, <4 x i32> <i32 3, i32 2, i32 1, i32 0>
+  %mix = shufflevector <4 x i32> %a, <4 x i32> %a, <4 x i32> <i32 0, i32 5, i32 2, i32 7>
+  ret void
+}
+
+define void @casts(<4 x i32> %a, <4 x float> %d, <4 x i8> %n) {
+; SIMD-LABEL: 'casts'
+; SIMD: cost of 65536 for instruction: %sitofp = sitofp <4 x i32> %a to <4 x float>
+; SIMD: cost of 65536 for instruction: %fptoui = fptoui <4 x float> %d to <4 x i32>
+; SIMD: cost of 65536 for instruction: %bitcast = bitcast <4 x i32> %a to <4 x float>
+; SIMD: cost of 65536 for instruction: %zext = zext <4 x i8> %n to <4 x i32>
+  %sitofp = sitofp <4 x i32> %a to <4 x float>
+  %fptoui = fptoui <4 x float> %d to <4 x i32>
+  %bitcast = bitcast <4 x i32> %a to <4 x float>
+  %zext = zext <4 x i8> %n to <4 x i32>
+  ret void
+}
+
+define void @cmpsel(<4 x i32> %a, <4 x i32> %b) {
+; SIMD-LABEL: 'cmpsel'
+; SIMD: cost of 65536 for instruction: %cmp = icmp slt <4 x i32> %a, %b
+; SIMD: cost of 65536 for instruction: %sel = select <4 x i1> %cmp, <4 x i32> %a, <4 x i32> %b
+  %cmp = icmp slt <4 x i32> %a, %b
+  %sel = select <4 x i1> %cmp, <4 x i32> %a, <4 x i32> %b
+  ret void
+}
+
+define void @scalar(i32 %x, i32* %p) {
+; SIMD-LABEL: 'scalar'
+; SIMD: cost of 1 for instruction: %add = add i32 %x, %x
+; SIMD: cost of 1 for instruction: %v = load i32, i32* %p
+  %add = add i32 %x, %x
+  %v = load i32, i32* %p
+  ret void
+}
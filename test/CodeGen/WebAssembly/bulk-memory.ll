@@ -0,0 +1,124 @@
+; RUN: llc < %s -asm-verbose=false -disable-wasm-fallthrough-return-opt -disable-wasm-explicit-locals | FileCheck %s --check-prefixes=CHECK,LIBCALL
+; RUN: llc < %s -asm-verbose=false -disable-wasm-fallthrough-return-opt -disable-wasm-explicit-locals -mattr=+bulk-memory | FileCheck %s --check-prefixes=CHECK,BULK
+; RUN: llc < %s -asm-verbose=false -disable-wasm-fallthrough-return-opt -disable-wasm-explicit-locals -mattr=+bulk-memory -wasm-bulk-memory-inline-stores=0 | FileCheck %s --check-prefixes=CHECK,BULK-ONLY
+
+; Compare the three ways memcpy, memmove and memset are lowered: a libcall,
+; an inline load/store sequence for small constant sizes, and the bulk memory
+; memory.copy and memory.fill instructions.
+
+target datalayout = "e-m:e-p:32:32-i64:64-n32:64-S128"
+target triple = "wasm32-unknown-unknown"
+
+declare void @llvm.memcpy.p0i8.p0i8.i32(i8* nocapture, i8* nocapture readonly, i32, i1)
+declare void @llvm.memmove.p0i8.p0i8.i32(i8* nocapture, i8* nocapture readonly, i32, i1)
+declare void @llvm.memset.p0i8.i32(i8* nocapture, i8, i32, i1)
+declare void @llvm.memcpy.p0i8.p0i8.i64(i8* nocapture, i8* nocapture readonly, i64, i1)
+declare void @llvm.memset.p0i8.i64(i8* nocapture, i8, i64, i1)
+
+; CHECK-LABEL: copy:
+; LIBCALL:        i32.call $drop=, memcpy@FUNCTION, $0, $1, $2{{$}}
+; BULK:           memory.copy $0, $1, $2{{$}}
+; BULK-ONLY:      memory.copy $0, $1, $2{{$}}
+; CHECK-NEXT:     return{{$}}
+define void @copy(i8* %dst, i8* %src, i32 %len) {
+  call void @llvm.memcpy.p0i8.p0i8.i32(i8* %dst, i8* %src, i32 %len, i1 false)
+  ret void
+}
+
+; CHECK-LABEL: move:
+; LIBCALL:        i32.call $drop=, memmove@FUNCTION, $0, $1, $2{{$}}
+; BULK:           memory.copy $0, $1, $2{{$}}
+; BULK-ONLY:      memory.copy $0, $1, $2{{$}}
+; CHECK-NEXT:     return{{$}}
+define void @move(i8* %dst, i8* %src, i32 %len) {
+  call void @llvm.memmove.p0i8.p0i8.i32(i8* %dst, i8* %src, i32 %len, i1 false)
+  ret void
+}
+
+; CHECK-LABEL: set:
+; LIBCALL:        i32.call $drop=, memset@FUNCTION, $0, $1, $2{{$}}
+; BULK:           memory.fill $0, $1, $2{{$}}
+; BULK-ONLY:      memory.fill $0, $1, $2{{$}}
+; CHECK-NEXT:     return{{$}}
+define void @set(i8* %dst, i8 %val, i32 %len) {
+  call void @llvm.memset.p0i8.i32(i8* %dst, i8 %val, i32 %len, i1 false)
+  ret void
+}
+
+; Small constant sizes are expanded inline unless the inline limit is zero.
+
+; CHECK-LABEL: copy_16:
+; LIBCALL-NOT:    memcpy
+; LIBCALL:        i64.store
+; BULK-NOT:       memory.copy
+; BULK:           i64.store
+; BULK-ONLY:      i32.const $push[[L:[0-9]+]]=, 16{{$}}
+; BULK-ONLY-NEXT: memory.copy $0, $1, $pop[[L]]{{$}}
+; CHECK:          return{{$}}
+define void @copy_16(i8* align 8 %dst, i8* align 8 %src) {
+  call void @llvm.memcpy.p0i8.p0i8.i32(i8* align 8 %dst, i8* align 8 %src, i32 16, i1 false)
+  ret void
+}
+
+; CHECK-LABEL: set_16:
+; LIBCALL-NOT:    memset
+; LIBCALL:        i64.store
+; BULK-NOT:       memory.fill
+; BULK:           i64.store
+; BULK-ONLY-DAG:  i32.const $push[[V:[0-9]+]]=, 0{{$}}
+; BULK-ONLY-DAG:  i32.const $push[[L:[0-9]+]]=, 16{{$}}
+; BULK-ONLY:      memory.fill $0, $pop[[V]], $pop[[L]]{{$}}
+; CHECK:          return{{$}}
+define void @set_16(i8* align 8 %dst) {
+  call void @llvm.memset.p0i8.i32(i8* align 8 %dst, i8 0, i32 16, i1 false)
+  ret void
+}
+
+; Constant sizes past the inline limit use the bulk memory instructions when
+; they are available.
+
+; CHECK-LABEL: copy_1024:
+; CHECK:          i32.const $push[[L:[0-9]+]]=, 1024{{$}}
+; LIBCALL-NEXT:   i32.call $drop=, memcpy@FUNCTION, $0, $1, $pop[[L]]{{$}}
+; BULK-NEXT:      memory.copy $0, $1, $pop[[L]]{{$}}
+; BULK-ONLY-NEXT: memory.copy $0, $1, $pop[[L]]{{$}}
+; CHECK-NEXT:     return{{$}}
+define void @copy_1024(i8* %dst, i8* %src) {
+  call void @llvm.memcpy.p0i8.p0i8.i32(i8* %dst, i8* %src, i32 1024, i1 false)
+  ret void
+}
+
+; CHECK-LABEL: set_1024:
+; LIBCALL:        i32.call $drop=, memset@FUNCTION, $0, $1, $pop{{[0-9]+}}{{$}}
+; BULK:           memory.fill $0, $1, $pop{{[0-9]+}}{{$}}
+; BULK-ONLY:      memory.fill $0, $1, $pop{{[0-9]+}}{{$}}
+; CHECK-NEXT:     return{{$}}
+define void @set_1024(i8* %dst, i8 %val) {
+  call void @llvm.memset.p0i8.i32(i8* %dst, i8 %val, i32 1024, i1 false)
+  ret void
+}
+
+; The length of the i64 intrinsics is wrapped to the i32 that memory.copy and
+; memory.fill take on wasm32.
+
+; CHECK-LABEL: copy_i64_len:
+; CHECK:          i32.wrap/i64 $push[[L:[0-9]+]]=, $2{{$}}
+; LIBCALL-NEXT:   i32.call $drop=, memcpy@FUNCTION, $0, $1, $pop[[L]]{{$}}
+; BULK-NEXT:      memory.copy $0, $1, $pop[[L]]{{$}}
+; BULK-ONLY-NEXT: memory.copy $0, $1, $pop[[L]]{{$}}
+; CHECK-NEXT:     return{{$}}
+define void @copy_i64_len(i8* %dst, i8* %src, i64 %len) {
+  call void @llvm.memcpy.p0i8.p0i8.i64(i8* %dst, i8* %src, i64 %len, i1 false)
+  ret void
+}
+
+; CHECK-LABEL: set_i64_len:
+; CHECK:          i32.wrap/i64 $push[[L:[0-9]+]]=, $2{{$}}
+; LIBCALL-NEXT:   i32.call $drop=, memset@FUNCTION, $0, $1, $pop[[L]]{{$}}
+; BULK-NEXT:      memory.fill $0, $1, $pop[[L]]{{$}}
+; BULK-ONLY-NEXT: memory.fill $0, $1, $pop[[L]]{{$}}
+; CHECK-NEXT:     return{{$}}
+define void @set_i64_len(i8* %dst, i8 %val, i64 %len) {
+  call void @llvm.memset.p0i8.i64(i8* %dst, i8 %val, i64 %len, i1 false)
+  ret void
+}
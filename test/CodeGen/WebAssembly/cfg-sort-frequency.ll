@@ -0,0 +1,87 @@
+; RUN: llc < %s -asm-verbose=false -disable-block-placement -verify-machineinstrs | FileCheck --check-prefixes=CHECK,NOPLACE %s
+; RUN: llc < %s -asm-verbose=false -verify-machineinstrs | FileCheck %s
+; RUN: llc < %s -asm-verbose=false -disable-block-placement -verify-machineinstrs -wasm-cfg-sort-by-frequency | FileCheck --check-prefixes=FREQ,FREQ-NOPLACE %s
+; RUN: llc < %s -asm-verbose=false -verify-machineinstrs -wasm-cfg-sort-by-frequency | FileCheck --check-prefix=FREQ %s
+; RUN: llc < %s -stats -o /dev/null 2>&1 | FileCheck --check-prefix=STATS %s
+; RUN: llc < %s -wasm-cfg-sort-by-frequency -stats -o /dev/null 2>&1 | FileCheck --check-prefix=STATS %s
+; REQUIRES: asserts
+
+; Test that CFGSort can place the most frequently executed successor of a
+; block right after it, and that CFGStackify reports what it placed.
+
+target datalayout = "e-m:e-p:32:32-i64:64-n32:64-S128"
+target triple = "wasm32-unknown-unknown"
+
+declare void @cold_path()
+declare void @hot_path()
+
+; Outside loops, block placement already puts the hot successor first, so
+; this only differs when it is disabled.
+
+; NOPLACE-LABEL:      hot_second:
+; NOPLACE:            br_if
+; NOPLACE:            call cold_path@FUNCTION{{$}}
+; NOPLACE:            call hot_path@FUNCTION{{$}}
+; FREQ-NOPLACE-LABEL: hot_second:
+; FREQ-NOPLACE:       br_if
+; FREQ-NOPLACE:       call hot_path@FUNCTION{{$}}
+; FREQ-NOPLACE:       call cold_path@FUNCTION{{$}}
+define void @hot_second(i1 %c) {
+entry:
+  br i1 %c, label %cold, label %hot, !prof !0
+cold:
+  call void @cold_path()
+  br label %exit
+hot:
+  call void @hot_path()
+  br label %exit
+exit:
+  ret void
+}
+
+; Inside a loop CFGSort orders the blocks itself, so the hot path only
+; falls through in the frequency mode.
+
+; CHECK-LABEL: hot_loop:
+; CHECK:       loop
+; CHECK:       br_if
+; CHECK:       call cold_path@FUNCTION{{$}}
+; CHECK-NEXT:  br 1{{$}}
+; CHECK:       call hot_path@FUNCTION{{$}}
+; FREQ-LABEL:  hot_loop:
+; FREQ:        loop
+; FREQ:        br_if
+; FREQ:        call hot_path@FUNCTION{{$}}
+; FREQ-NEXT:   br 1{{$}}
+; FREQ:        call cold_path@FUNCTION{{$}}
+define void @hot_loop(i32 %n, i32 %k) {
+entry:
+  br label %loop
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %latch ]
+  %c = icmp eq i32 %i, %k
+  br i1 %c, label %cold, label %hot, !prof !0
+cold:
+  call void @cold_path()
+  br label %latch
+hot:
+  call void @hot_path()
+  br label %latch
+latch:
+  %next = add i32 %i, 1
+  %done = icmp eq i32 %next, %n
+  br i1 %done, label %exit, label %loop
+exit:
+  ret void
+}
+
+; The frequency mode changes which path falls through, not how many markers
+; and branches the functions need, so the counts are the same in both modes.
+
+; STATS-DAG: 5 wasm-cfg-sort{{ +}}- Number of blocks placed after a predecessor
+; STATS-DAG: 3 wasm-cfg-stackify{{ +}}- Number of block markers placed
+; STATS-DAG: 1 wasm-cfg-stackify{{ +}}- Number of loop markers placed
+; STATS-DAG: 4 wasm-cfg-stackify{{ +}}- Number of branch instructions
+; STATS-DAG: 3 wasm-cfg-stackify{{ +}}- Maximum nesting depth of blocks and loops
+
+!0 = !{!"branch_weights", i32 1, i32 1000}
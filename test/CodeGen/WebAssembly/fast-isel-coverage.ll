@@ -0,0 +1,61 @@
+; RUN: llc < %s -asm-verbose=false -fast-isel -fast-isel-abort=3 \
+; RUN:   -mattr=+atomics,+sign-ext -verify-machineinstrs \
+; RUN:   -disable-wasm-explicit-locals | FileCheck %s
+
+; Test that FastISel selects atomic loads, sign-extension operators and calls
+; through constant casts without falling back to SelectionDAG.
+
+target datalayout = "e-m:e-p:32:32-i64:64-n32:64-S128"
+target triple = "wasm32-unknown-unknown"
+
+; CHECK-LABEL: atomic_load_i32:
+; CHECK: i32.atomic.load $push{{[0-9]+}}=, 0($0){{$}}
+define i32 @atomic_load_i32(i32* %p) {
+  %v = load atomic i32, i32* %p seq_cst, align 4
+  ret i32 %v
+}
+
+; CHECK-LABEL: atomic_load_i64:
+; CHECK: i64.atomic.load $push{{[0-9]+}}=, 0($0){{$}}
+define i64 @atomic_load_i64(i64* %p) {
+  %v = load atomic i64, i64* %p acquire, align 8
+  ret i64 %v
+}
+
+; CHECK-LABEL: atomic_load_i8:
+; CHECK: i32.atomic.load8_u $push{{[0-9]+}}=, 0($0){{$}}
+define i8 @atomic_load_i8(i8* %p) {
+  %v = load atomic i8, i8* %p monotonic, align 1
+  ret i8 %v
+}
+
+; CHECK-LABEL: sext_i8:
+; CHECK: i32.extend8_s $push{{[0-9]+}}=, $0{{$}}
+define signext i8 @sext_i8(i8 %x) {
+  ret i8 %x
+}
+
+; CHECK-LABEL: sext_i16_i64:
+; CHECK: i32.extend16_s $push[[L0:[0-9]+]]=, $0{{$}}
+; CHECK: i64.extend_s/i32 $push{{[0-9]+}}=, $pop[[L0]]{{$}}
+define i64 @sext_i16_i64(i16 %x) {
+  %y = sext i16 %x to i64
+  ret i64 %y
+}
+
+; CHECK-LABEL: call_int_round_trip:
+; CHECK-NEXT: call void_nullary@FUNCTION{{$}}
+declare void @void_nullary()
+define void @call_int_round_trip() {
+  call void inttoptr (i32 ptrtoint (void ()* @void_nullary to i32) to void ()*)()
+  ret void
+}
+
+; CHECK-LABEL: call_constant_cast:
+; CHECK: i32.const $push[[L0:[0-9]+]]=, 42{{$}}
+; CHECK: call_indirect $pop[[L0]]{{$}}
+define void @call_constant_cast() {
+  call void inttoptr (i32 42 to void ()*)()
+  ret void
+}
+
@@ -0,0 +1,13 @@
+; RUN: llc < %s -fast-isel -stats 2>&1 | FileCheck %s
+; REQUIRES: asserts
+
+; Test that FastISel counts the instructions it leaves to SelectionDAG.
+
+target datalayout = "e-m:e-p:32:32-i64:64-n32:64-S128"
+target triple = "wasm32-unknown-unknown"
+
+; CHECK: {{[0-9]+}} wasm-fastisel{{ +}}- Number of vector operations left to SelectionDAG
+define <4 x i32> @vector_add(<4 x i32> %a, <4 x i32> %b) {
+  %c = add <4 x i32> %a, %b
+  ret <4 x i32> %c
+}
@@ -0,0 +1,139 @@
+; RUN: llc < %s -asm-verbose=false -verify-machineinstrs -disable-block-placement -disable-wasm-explicit-locals | FileCheck %s
+; RUN: llc < %s -asm-verbose=false -verify-machineinstrs -disable-block-placement -disable-wasm-explicit-locals -wasm-irreducible-duplication-budget=4 | FileCheck --check-prefix=BUDGET %s
+
+; Test that irreducible control flow is made reducible by duplicating blocks
+; when that's cheap enough, and with a br_table dispatcher otherwise.
+
+target datalayout = "e-m:e-p:32:32-i64:64-n32:64-S128"
+target triple = "wasm32-unknown-unknown"
+
+; A loop with two entries. The smaller entry block is duplicated, so the
+; branches stay direct.
+
+; CHECK-LABEL: two_entries:
+; CHECK-NOT:   br_table
+; CHECK:       loop
+; CHECK-NOT:   br_table
+; CHECK:       end_function
+; BUDGET-LABEL: two_entries:
+; BUDGET:       br_table
+define void @two_entries(double* %arg, i32 %arg1, i32 %arg2, i32 %arg3) {
+bb:
+  %tmp = icmp eq i32 %arg2, 0
+  br i1 %tmp, label %bb6, label %bb3
+
+bb3:
+  %tmp4 = getelementptr double, double* %arg, i32 %arg3
+  %tmp5 = load double, double* %tmp4, align 4
+  br label %bb13
+
+bb6:
+  %tmp7 = phi i32 [ %tmp18, %bb13 ], [ 0, %bb ]
+  %tmp8 = icmp slt i32 %tmp7, %arg1
+  br i1 %tmp8, label %bb9, label %bb19
+
+bb9:
+  %tmp10 = getelementptr double, double* %arg, i32 %tmp7
+  %tmp11 = load double, double* %tmp10, align 4
+  %tmp12 = fmul double %tmp11, 2.300000e+00
+  store double %tmp12, double* %tmp10, align 4
+  br label %bb13
+
+bb13:
+  %tmp14 = phi double [ %tmp5, %bb3 ], [ %tmp12, %bb9 ]
+  %tmp15 = phi i32 [ undef, %bb3 ], [ %tmp7, %bb9 ]
+  %tmp16 = getelementptr double, double* %arg, i32 %tmp15
+  %tmp17 = fadd double %tmp14, 1.300000e+00
+  store double %tmp17, double* %tmp16, align 4
+  %tmp18 = add nsw i32 %tmp15, 1
+  br label %bb6
+
+bb19:
+  ret void
+}
+
+; Regions containing natural loops aren't duplicated.
+
+; CHECK-LABEL: inner_loop:
+; CHECK:       br_table
+define void @inner_loop(double* %arg, i32 %arg1, i32 %arg2, i32 %arg3) {
+bb:
+  %tmp = icmp eq i32 %arg2, 0
+  br i1 %tmp, label %bb6, label %bb3
+
+bb3:
+  %tmp4 = getelementptr double, double* %arg, i32 %arg3
+  %tmp5 = load double, double* %tmp4, align 4
+  br label %bb13
+
+bb6:
+  %tmp7 = phi i32 [ %tmp18, %bb13 ], [ 0, %bb ]
+  %tmp8 = icmp slt i32 %tmp7, %arg1
+  br i1 %tmp8, label %bb9, label %bb19
+
+bb9:
+  %tmp10 = getelementptr double, double* %arg, i32 %tmp7
+  %tmp11 = load double, double* %tmp10, align 4
+  %tmp12 = fmul double %tmp11, 2.300000e+00
+  store double %tmp12, double* %tmp10, align 4
+  br label %bb10
+
+bb10:
+  %p = phi i32 [ 0, %bb9 ], [ %pn, %bb10 ]
+  %pn = add i32 %p, 1
+  %c = icmp slt i32 %pn, 256
+  br i1 %c, label %bb10, label %bb13
+
+bb13:
+  %tmp14 = phi double [ %tmp5, %bb3 ], [ %tmp12, %bb10 ]
+  %tmp15 = phi i32 [ undef, %bb3 ], [ %tmp7, %bb10 ]
+  %tmp16 = getelementptr double, double* %arg, i32 %tmp15
+  %tmp17 = fadd double %tmp14, 1.300000e+00
+  store double %tmp17, double* %tmp16, align 4
+  %tmp18 = add nsw i32 %tmp15, 1
+  br label %bb6
+
+bb19:
+  ret void
+}
+
+; A state machine where every state can be entered from outside the loop.
+
+; CHECK-LABEL: state_machine:
+; CHECK-NOT:   br_table
+; CHECK:       end_function
+define i32 @state_machine(i32 %start, i32* %input) {
+entry:
+  switch i32 %start, label %s0 [
+    i32 1, label %s1
+    i32 2, label %s2
+  ]
+
+s0:
+  %i0 = phi i32 [ 0, %entry ], [ %n2, %s2 ]
+  %p0 = getelementptr i32, i32* %input, i32 %i0
+  %v0 = load i32, i32* %p0
+  %n0 = add i32 %i0, 1
+  %c0 = icmp eq i32 %v0, 0
+  br i1 %c0, label %done, label %s1
+
+s1:
+  %i1 = phi i32 [ 0, %entry ], [ %n0, %s0 ]
+  %p1 = getelementptr i32, i32* %input, i32 %i1
+  %v1 = load i32, i32* %p1
+  %n1 = add i32 %i1, 1
+  %c1 = icmp eq i32 %v1, 1
+  br i1 %c1, label %done, label %s2
+
+s2:
+  %i2 = phi i32 [ 0, %entry ], [ %n1, %s1 ]
+  %p2 = getelementptr i32, i32* %input, i32 %i2
+  %v2 = load i32, i32* %p2
+  %n2 = add i32 %i2, 1
+  %c2 = icmp eq i32 %v2, 2
+  br i1 %c2, label %done, label %s0
+
+done:
+  %r = phi i32 [ %i0, %s0 ], [ %i1, %s1 ], [ %i2, %s2 ]
+  ret i32 %r
+}
@@ -0,0 +1,425 @@
+; RUN: llc < %s -asm-verbose=false -verify-machineinstrs | FileCheck %s
+; RUN: llc < %s -asm-verbose=false -disable-wasm-local-coloring | FileCheck --check-prefix=NOCOLOR %s
+
+; Test that when a function has more than 128 locals, local coloring gives the
+; most frequently used ones the indices with a one-byte LEB encoding.
+
+target datalayout = "e-m:e-p:32:32-i64:64-n32:64-S128"
+target triple = "wasm32-unknown-unknown"
+
+declare i32 @get()
+declare void @use(i32)
+
+; All 130 values are live at once, and %v129 is used the most.
+
+; CHECK-LABEL: many_locals:
+; CHECK:       i32.call $push[[C0:[0-9]+]]=, get@FUNCTION{{$}}
+; CHECK-NEXT:  set_local 1, $pop[[C0]]{{$}}
+; CHECK:       set_local 129, $pop{{[0-9]+}}{{$}}
+; CHECK-NEXT:  i32.call $push[[C1:[0-9]+]]=, get@FUNCTION{{$}}
+; CHECK-NEXT:  set_local 0, $pop[[C1]]{{$}}
+; CHECK-NEXT:  get_local $push{{[0-9]+}}=, 1{{$}}
+; NOCOLOR-LABEL: many_locals:
+; NOCOLOR:       i32.call $push[[C0:[0-9]+]]=, get@FUNCTION{{$}}
+; NOCOLOR-NEXT:  set_local 0, $pop[[C0]]{{$}}
+; NOCOLOR:       set_local 128, $pop{{[0-9]+}}{{$}}
+; NOCOLOR-NEXT:  i32.call $push[[C1:[0-9]+]]=, get@FUNCTION{{$}}
+; NOCOLOR-NEXT:  set_local 129, $pop[[C1]]{{$}}
+; NOCOLOR-NEXT:  get_local $push{{[0-9]+}}=, 0{{$}}
+define void @many_locals() {
+  %v0 = call i32 @get()
+  %v1 = call i32 @get()
+  %v2 = call i32 @get()
+  %v3 = call i32 @get()
+  %v4 = call i32 @get()
+  %v5 = call i32 @get()
+  %v6 = call i32 @get()
+  %v7 = call i32 @get()
+  %v8 = call i32 @get()
+  %v9 = call i32 @get()
+  %v10 = call i32 @get()
+  %v11 = call i32 @get()
+  %v12 = call i32 @get()
+  %v13 = call i32 @get()
+  %v14 = call i32 @get()
+  %v15 = call i32 @get()
+  %v16 = call i32 @get()
+  %v17 = call i32 @get()
+  %v18 = call i32 @get()
+  %v19 = call i32 @get()
+  %v20 = call i32 @get()
+  %v21 = call i32 @get()
+  %v22 = call i32 @get()
+  %v23 = call i32 @get()
+  %v24 = call i32 @get()
+  %v25 = call i32 @get()
+  %v26 = call i32 @get()
+  %v27 = call i32 @get()
+  %v28 = call i32 @get()
+  %v29 = call i32 @get()
+  %v30 = call i32 @get()
+  %v31 = call i32 @get()
+  %v32 = call i32 @get()
+  %v33 = call i32 @get()
+  %v34 = call i32 @get()
+  %v35 = call i32 @get()
+  %v36 = call i32 @get()
+  %v37 = call i32 @get()
+  %v38 = call i32 @get()
+  %v39 = call i32 @get()
+  %v40 = call i32 @get()
+  %v41 = call i32 @get()
+  %v42 = call i32 @get()
+  %v43 = call i32 @get()
+  %v44 = call i32 @get()
+  %v45 = call i32 @get()
+  %v46 = call i32 @get()
+  %v47 = call i32 @get()
+  %v48 = call i32 @get()
+  %v49 = call i32 @get()
+  %v50 = call i32 @get()
+  %v51 = call i32 @get()
+  %v52 = call i32 @get()
+  %v53 = call i32 @get()
+  %v54 = call i32 @get()
+  %v55 = call i32 @get()
+  %v56 = call i32 @get()
+  %v57 = call i32 @get()
+  %v58 = call i32 @get()
+  %v59 = call i32 @get()
+  %v60 = call i32 @get()
+  %v61 = call i32 @get()
+  %v62 = call i32 @get()
+  %v63 = call i32 @get()
+  %v64 = call i32 @get()
+  %v65 = call i32 @get()
+  %v66 = call i32 @get()
+  %v67 = call i32 @get()
+  %v68 = call i32 @get()
+  %v69 = call i32 @get()
+  %v70 = call i32 @get()
+  %v71 = call i32 @get()
+  %v72 = call i32 @get()
+  %v73 = call i32 @get()
+  %v74 = call i32 @get()
+  %v75 = call i32 @get()
+  %v76 = call i32 @get()
+  %v77 = call i32 @get()
+  %v78 = call i32 @get()
+  %v79 = call i32 @get()
+  %v80 = call i32 @get()
+  %v81 = call i32 @get()
+  %v82 = call i32 @get()
+  %v83 = call i32 @get()
+  %v84 = call i32 @get()
+  %v85 = call i32 @get()
+  %v86 = call i32 @get()
+  %v87 = call i32 @get()
+  %v88 = call i32 @get()
+  %v89 = call i32 @get()
+  %v90 = call i32 @get()
+  %v91 = call i32 @get()
+  %v92 = call i32 @get()
+  %v93 = call i32 @get()
+  %v94 = call i32 @get()
+  %v95 = call i32 @get()
+  %v96 = call i32 @get()
+  %v97 = call i32 @get()
+  %v98 = call i32 @get()
+  %v99 = call i32 @get()
+  %v100 = call i32 @get()
+  %v101 = call i32 @get()
+  %v102 = call i32 @get()
+  %v103 = call i32 @get()
+  %v104 = call i32 @get()
+  %v105 = call i32 @get()
+  %v106 = call i32 @get()
+  %v107 = call i32 @get()
+  %v108 = call i32 @get()
+  %v109 = call i32 @get()
+  %v110 = call i32 @get()
+  %v111 = call i32 @get()
+  %v112 = call i32 @get()
+  %v113 = call i32 @get()
+  %v114 = call i32 @get()
+  %v115 = call i32 @get()
+  %v116 = call i32 @get()
+  %v117 = call i32 @get()
+  %v118 = call i32 @get()
+  %v119 = call i32 @get()
+  %v120 = call i32 @get()
+  %v121 = call i32 @get()
+  %v122 = call i32 @get()
+  %v123 = call i32 @get()
+  %v124 = call i32 @get()
+  %v125 = call i32 @get()
+  %v126 = call i32 @get()
+  %v127 = call i32 @get()
+  %v128 = call i32 @get()
+  %v129 = call i32 @get()
+  call void @use(i32 %v0)
+  call void @use(i32 %v1)
+  call void @use(i32 %v2)
+  call void @use(i32 %v3)
+  call void @use(i32 %v4)
+  call void @use(i32 %v5)
+  call void @use(i32 %v6)
+  call void @use(i32 %v7)
+  call void @use(i32 %v8)
+  call void @use(i32 %v9)
+  call void @use(i32 %v10)
+  call void @use(i32 %v11)
+  call void @use(i32 %v12)
+  call void @use(i32 %v13)
+  call void @use(i32 %v14)
+  call void @use(i32 %v15)
+  call void @use(i32 %v16)
+  call void @use(i32 %v17)
+  call void @use(i32 %v18)
+  call void @use(i32 %v19)
+  call void @use(i32 %v20)
+  call void @use(i32 %v21)
+  call void @use(i32 %v22)
+  call void @use(i32 %v23)
+  call void @use(i32 %v24)
+  call void @use(i32 %v25)
+  call void @use(i32 %v26)
+  call void @use(i32 %v27)
+  call void @use(i32 %v28)
+  call void @use(i32 %v29)
+  call void @use(i32 %v30)
+  call void @use(i32 %v31)
+  call void @use(i32 %v32)
+  call void @use(i32 %v33)
+  call void @use(i32 %v34)
+  call void @use(i32 %v35)
+  call void @use(i32 %v36)
+  call void @use(i32 %v37)
+  call void @use(i32 %v38)
+  call void @use(i32 %v39)
+  call void @use(i32 %v40)
+  call void @use(i32 %v41)
+  call void @use(i32 %v42)
+  call void @use(i32 %v43)
+  call void @use(i32 %v44)
+  call void @use(i32 %v45)
+  call void @use(i32 %v46)
+  call void @use(i32 %v47)
+  call void @use(i32 %v48)
+  call void @use(i32 %v49)
+  call void @use(i32 %v50)
+  call void @use(i32 %v51)
+  call void @use(i32 %v52)
+  call void @use(i32 %v53)
+  call void @use(i32 %v54)
+  call void @use(i32 %v55)
+  call void @use(i32 %v56)
+  call void @use(i32 %v57)
+  call void @use(i32 %v58)
+  call void @use(i32 %v59)
+  call void @use(i32 %v60)
+  call void @use(i32 %v61)
+  call void @use(i32 %v62)
+  call void @use(i32 %v63)
+  call void @use(i32 %v64)
+  call void @use(i32 %v65)
+  call void @use(i32 %v66)
+  call void @use(i32 %v67)
+  call void @use(i32 %v68)
+  call void @use(i32 %v69)
+  call void @use(i32 %v70)
+  call void @use(i32 %v71)
+  call void @use(i32 %v72)
+  call void @use(i32 %v73)
+  call void @use(i32 %v74)
+  call void @use(i32 %v75)
+  call void @use(i32 %v76)
+  call void @use(i32 %v77)
+  call void @use(i32 %v78)
+  call void @use(i32 %v79)
+  call void @use(i32 %v80)
+  call void @use(i32 %v81)
+  call void @use(i32 %v82)
+  call void @use(i32 %v83)
+  call void @use(i32 %v84)
+  call void @use(i32 %v85)
+  call void @use(i32 %v86)
+  call void @use(i32 %v87)
+  call void @use(i32 %v88)
+  call void @use(i32 %v89)
+  call void @use(i32 %v90)
+  call void @use(i32 %v91)
+  call void @use(i32 %v92)
+  call void @use(i32 %v93)
+  call void @use(i32 %v94)
+  call void @use(i32 %v95)
+  call void @use(i32 %v96)
+  call void @use(i32 %v97)
+  call void @use(i32 %v98)
+  call void @use(i32 %v99)
+  call void @use(i32 %v100)
+  call void @use(i32 %v101)
+  call void @use(i32 %v102)
+  call void @use(i32 %v103)
+  call void @use(i32 %v104)
+  call void @use(i32 %v105)
+  call void @use(i32 %v106)
+  call void @use(i32 %v107)
+  call void @use(i32 %v108)
+  call void @use(i32 %v109)
+  call void @use(i32 %v110)
+  call void @use(i32 %v111)
+  call void @use(i32 %v112)
+  call void @use(i32 %v113)
+  call void @use(i32 %v114)
+  call void @use(i32 %v115)
+  call void @use(i32 %v116)
+  call void @use(i32 %v117)
+  call void @use(i32 %v118)
+  call void @use(i32 %v119)
+  call void @use(i32 %v120)
+  call void @use(i32 %v121)
+  call void @use(i32 %v122)
+  call void @use(i32 %v123)
+  call void @use(i32 %v124)
+  call void @use(i32 %v125)
+  call void @use(i32 %v126)
+  call void @use(i32 %v127)
+  call void @use(i32 %v128)
+  call void @use(i32 %v129)
+  call void @use(i32 %v0)
+  call void @use(i32 %v1)
+  call void @use(i32 %v2)
+  call void @use(i32 %v3)
+  call void @use(i32 %v4)
+  call void @use(i32 %v5)
+  call void @use(i32 %v6)
+  call void @use(i32 %v7)
+  call void @use(i32 %v8)
+  call void @use(i32 %v9)
+  call void @use(i32 %v10)
+  call void @use(i32 %v11)
+  call void @use(i32 %v12)
+  call void @use(i32 %v13)
+  call void @use(i32 %v14)
+  call void @use(i32 %v15)
+  call void @use(i32 %v16)
+  call void @use(i32 %v17)
+  call void @use(i32 %v18)
+  call void @use(i32 %v19)
+  call void @use(i32 %v20)
+  call void @use(i32 %v21)
+  call void @use(i32 %v22)
+  call void @use(i32 %v23)
+  call void @use(i32 %v24)
+  call void @use(i32 %v25)
+  call void @use(i32 %v26)
+  call void @use(i32 %v27)
+  call void @use(i32 %v28)
+  call void @use(i32 %v29)
+  call void @use(i32 %v30)
+  call void @use(i32 %v31)
+  call void @use(i32 %v32)
+  call void @use(i32 %v33)
+  call void @use(i32 %v34)
+  call void @use(i32 %v35)
+  call void @use(i32 %v36)
+  call void @use(i32 %v37)
+  call void @use(i32 %v38)
+  call void @use(i32 %v39)
+  call void @use(i32 %v40)
+  call void @use(i32 %v41)
+  call void @use(i32 %v42)
+  call void @use(i32 %v43)
+  call void @use(i32 %v44)
+  call void @use(i32 %v45)
+  call void @use(i32 %v46)
+  call void @use(i32 %v47)
+  call void @use(i32 %v48)
+  call void @use(i32 %v49)
+  call void @use(i32 %v50)
+  call void @use(i32 %v51)
+  call void @use(i32 %v52)
+  call void @use(i32 %v53)
+  call void @use(i32 %v54)
+  call void @use(i32 %v55)
+  call void @use(i32 %v56)
+  call void @use(i32 %v57)
+  call void @use(i32 %v58)
+  call void @use(i32 %v59)
+  call void @use(i32 %v60)
+  call void @use(i32 %v61)
+  call void @use(i32 %v62)
+  call void @use(i32 %v63)
+  call void @use(i32 %v64)
+  call void @use(i32 %v65)
+  call void @use(i32 %v66)
+  call void @use(i32 %v67)
+  call void @use(i32 %v68)
+  call void @use(i32 %v69)
+  call void @use(i32 %v70)
+  call void @use(i32 %v71)
+  call void @use(i32 %v72)
+  call void @use(i32 %v73)
+  call void @use(i32 %v74)
+  call void @use(i32 %v75)
+  call void @use(i32 %v76)
+  call void @use(i32 %v77)
+  call void @use(i32 %v78)
+  call void @use(i32 %v79)
+  call void @use(i32 %v80)
+  call void @use(i32 %v81)
+  call void @use(i32 %v82)
+  call void @use(i32 %v83)
+  call void @use(i32 %v84)
+  call void @use(i32 %v85)
+  call void @use(i32 %v86)
+  call void @use(i32 %v87)
+  call void @use(i32 %v88)
+  call void @use(i32 %v89)
+  call void @use(i32 %v90)
+  call void @use(i32 %v91)
+  call void @use(i32 %v92)
+  call void @use(i32 %v93)
+  call void @use(i32 %v94)
+  call void @use(i32 %v95)
+  call void @use(i32 %v96)
+  call void @use(i32 %v97)
+  call void @use(i32 %v98)
+  call void @use(i32 %v99)
+  call void @use(i32 %v100)
+  call void @use(i32 %v101)
+  call void @use(i32 %v102)
+  call void @use(i32 %v103)
+  call void @use(i32 %v104)
+  call void @use(i32 %v105)
+  call void @use(i32 %v106)
+  call void @use(i32 %v107)
+  call void @use(i32 %v108)
+  call void @use(i32 %v109)
+  call void @use(i32 %v110)
+  call void @use(i32 %v111)
+  call void @use(i32 %v112)
+  call void @use(i32 %v113)
+  call void @use(i32 %v114)
+  call void @use(i32 %v115)
+  call void @use(i32 %v116)
+  call void @use(i32 %v117)
+  call void @use(i32 %v118)
+  call void @use(i32 %v119)
+  call void @use(i32 %v120)
+  call void @use(i32 %v121)
+  call void @use(i32 %v122)
+  call void @use(i32 %v123)
+  call void @use(i32 %v124)
+  call void @use(i32 %v125)
+  call void @use(i32 %v126)
+  call void @use(i32 %v127)
+  call void @use(i32 %v128)
+  call void @use(i32 %v129)
+  call void @use(i32 %v129)
+  call void @use(i32 %v129)
+  call void @use(i32 %v129)
+  call void @use(i32 %v129)
+  ret void
+}
@@ -0,0 +1,221 @@
+; RUN: llc < %s -asm-verbose=false -disable-block-placement -verify-machineinstrs | FileCheck %s
+; RUN: llc < %s -asm-verbose=false -disable-block-placement -disable-wasm-local-coloring | FileCheck --check-prefix=NOCOLOR %s
+
+; Test that locals which don't interfere share a slot after ExplicitLocals.
+
+target datalayout = "e-m:e-p:32:32-i64:64-n32:64-S128"
+target triple = "wasm32-unknown-unknown"
+
+declare i32 @get_i32()
+declare i64 @get_i64()
+declare float @get_f32()
+declare double @get_f64()
+declare void @use_i32(i32)
+declare void @use_i64(i64)
+declare void @use_f32(float)
+declare void @use_f64(double)
+
+; %a is live until the sub, so RegColoring can't give %b its register, but the
+; get_local of %a is emitted before the tree computing %d, so %b can be tee'd
+; into the same local.
+
+; CHECK-LABEL: early_read_i32:
+; CHECK-NEXT:  .result i32{{$}}
+; CHECK-NEXT:  .local i32{{$}}
+; CHECK-NEXT:  i32.call $push[[C0:[0-9]+]]=, get_i32@FUNCTION{{$}}
+; CHECK-NEXT:  tee_local $push[[T0:[0-9]+]]=, 0, $pop[[C0]]{{$}}
+; CHECK-NEXT:  call use_i32@FUNCTION, $pop[[T0]]{{$}}
+; CHECK-NEXT:  get_local $push[[A:[0-9]+]]=, 0{{$}}
+; CHECK-NEXT:  i32.call $push[[C1:[0-9]+]]=, get_i32@FUNCTION{{$}}
+; CHECK-NEXT:  tee_local $push[[T1:[0-9]+]]=, 0, $pop[[C1]]{{$}}
+; CHECK-NEXT:  get_local $push[[B0:[0-9]+]]=, 0{{$}}
+; CHECK-NEXT:  i32.mul $push[[M:[0-9]+]]=, $pop[[T1]], $pop[[B0]]{{$}}
+; CHECK-NEXT:  get_local $push[[B1:[0-9]+]]=, 0{{$}}
+; CHECK-NEXT:  i32.xor $push[[X:[0-9]+]]=, $pop[[M]], $pop[[B1]]{{$}}
+; CHECK-NEXT:  i32.sub $push{{[0-9]+}}=, $pop[[A]], $pop[[X]]{{$}}
+; NOCOLOR-LABEL: early_read_i32:
+; NOCOLOR-NEXT:  .result i32{{$}}
+; NOCOLOR-NEXT:  .local i32, i32{{$}}
+; NOCOLOR:       tee_local $push{{[0-9]+}}=, 1, $pop{{[0-9]+}}{{$}}
+define i32 @early_read_i32() {
+  %a = call i32 @get_i32()
+  call void @use_i32(i32 %a)
+  %b = call i32 @get_i32()
+  %c = mul i32 %b, %b
+  %d = xor i32 %c, %b
+  %r = sub i32 %a, %d
+  ret i32 %r
+}
+
+; The same for the other types, which each get their own slots.
+
+; CHECK-LABEL: early_read_i64:
+; CHECK-NEXT:  .result i64{{$}}
+; CHECK-NEXT:  .local i64{{$}}
+; NOCOLOR-LABEL: early_read_i64:
+; NOCOLOR-NEXT:  .result i64{{$}}
+; NOCOLOR-NEXT:  .local i64, i64{{$}}
+define i64 @early_read_i64() {
+  %a = call i64 @get_i64()
+  call void @use_i64(i64 %a)
+  %b = call i64 @get_i64()
+  %c = mul i64 %b, %b
+  %d = xor i64 %c, %b
+  %r = sub i64 %a, %d
+  ret i64 %r
+}
+
+; CHECK-LABEL: early_read_f32:
+; CHECK-NEXT:  .result f32{{$}}
+; CHECK-NEXT:  .local f32{{$}}
+; NOCOLOR-LABEL: early_read_f32:
+; NOCOLOR-NEXT:  .result f32{{$}}
+; NOCOLOR-NEXT:  .local f32, f32{{$}}
+define float @early_read_f32() {
+  %a = call float @get_f32()
+  call void @use_f32(float %a)
+  %b = call float @get_f32()
+  %c = fmul float %b, %b
+  %d = fadd float %c, %b
+  %r = fsub float %a, %d
+  ret float %r
+}
+
+; CHECK-LABEL: early_read_f64:
+; CHECK-NEXT:  .result f64{{$}}
+; CHECK-NEXT:  .local f64{{$}}
+; NOCOLOR-LABEL: early_read_f64:
+; NOCOLOR-NEXT:  .result f64{{$}}
+; NOCOLOR-NEXT:  .local f64, f64{{$}}
+define double @early_read_f64() {
+  %a = call double @get_f64()
+  call void @use_f64(double %a)
+  %b = call double @get_f64()
+  %c = fmul double %b, %b
+  %d = fadd double %c, %b
+  %r = fsub double %a, %d
+  ret double %r
+}
+
+; Locals of different types never share a slot.
+
+; CHECK-LABEL: mixed_types:
+; CHECK-NEXT:  .result i64{{$}}
+; CHECK-NEXT:  .local i64, i32{{$}}
+; NOCOLOR-LABEL: mixed_types:
+; NOCOLOR-NEXT:  .result i64{{$}}
+; NOCOLOR-NEXT:  .local i64, i32{{$}}
+define i64 @mixed_types() {
+  %a = call i64 @get_i64()
+  call void @use_i64(i64 %a)
+  %b = call i32 @get_i32()
+  %c = mul i32 %b, %b
+  %d = xor i32 %c, %b
+  %e = zext i32 %d to i64
+  %r = sub i64 %a, %e
+  ret i64 %r
+}
+
+; %x is read on the first iteration before it's written, so its local (which
+; RegColoring shares with %b) relies on being zero-initialized and must not be
+; merged with the local of %a, even though the exit block alone would allow it.
+
+; CHECK-LABEL: entry_live:
+; CHECK-NEXT:  .param i32{{$}}
+; CHECK-NEXT:  .result i32{{$}}
+; CHECK-NEXT:  .local i32, i32{{$}}
+; CHECK:       loop
+; CHECK-NEXT:  get_local $push{{[0-9]+}}=, 1{{$}}
+; CHECK-NEXT:  call use_i32@FUNCTION, $pop{{[0-9]+}}{{$}}
+; CHECK:       end_loop
+; CHECK-NEXT:  i32.call $push[[C0:[0-9]+]]=, get_i32@FUNCTION{{$}}
+; CHECK-NEXT:  tee_local $push[[T0:[0-9]+]]=, 2, $pop[[C0]]{{$}}
+; CHECK-NEXT:  call use_i32@FUNCTION, $pop[[T0]]{{$}}
+; CHECK-NEXT:  get_local $push{{[0-9]+}}=, 2{{$}}
+; CHECK-NEXT:  i32.call $push[[C1:[0-9]+]]=, get_i32@FUNCTION{{$}}
+; CHECK-NEXT:  tee_local $push{{[0-9]+}}=, 1, $pop[[C1]]{{$}}
+; NOCOLOR-LABEL: entry_live:
+; NOCOLOR-NEXT:  .param i32{{$}}
+; NOCOLOR-NEXT:  .result i32{{$}}
+; NOCOLOR-NEXT:  .local i32, i32{{$}}
+define i32 @entry_live(i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %x = phi i32 [ undef, %entry ], [ %y, %loop ]
+  %i = phi i32 [ %n, %entry ], [ %j, %loop ]
+  call void @use_i32(i32 %x)
+  %y = call i32 @get_i32()
+  call void @use_i32(i32 %y)
+  %j = add i32 %i, -1
+  %c = icmp ne i32 %j, 0
+  br i1 %c, label %loop, label %exit
+
+exit:
+  %a = call i32 @get_i32()
+  call void @use_i32(i32 %a)
+  %b = call i32 @get_i32()
+  %m = mul i32 %b, %b
+  %d = xor i32 %m, %b
+  %r = sub i32 %a, %d
+  %s = add i32 %r, %j
+  ret i32 %s
+}
+
+; FixIrreducibleControlFlow duplicates small irreducible regions instead of
+; adding a dispatch block, so no label local is needed here and there's
+; nothing left to merge.
+
+; CHECK-LABEL: irreducible:
+; CHECK-NEXT:  .param i32, i32, i32, i32{{$}}
+; CHECK-NEXT:  .local f64{{$}}
+; NOCOLOR-LABEL: irreducible:
+; NOCOLOR-NEXT:  .param i32, i32, i32, i32{{$}}
+; NOCOLOR-NEXT:  .local f64{{$}}
+define void @irreducible(double* %arg, i32 %arg1, i32 %arg2, i32 %arg3) {
+bb:
+  %tmp = icmp eq i32 %arg2, 0
+  br i1 %tmp, label %bb6, label %bb3
+
+bb3:
+  %tmp4 = getelementptr double, double* %arg, i32 %arg3
+  %tmp5 = load double, double* %tmp4, align 4
+  br label %bb13
+
+bb6:
+  %tmp7 = phi i32 [ %tmp18, %bb13 ], [ 0, %bb ]
+  %tmp8 = icmp slt i32 %tmp7, %arg1
+  br i1 %tmp8, label %bb9, label %bb19
+
+bb9:
+  %tmp10 = getelementptr double, double* %arg, i32 %tmp7
+  %tmp11 = load double, double* %tmp10, align 4
+  %tmp12 = fmul double %tmp11, 2.300000e+00
+  store double %tmp12, double* %tmp10, align 4
+  br label %bb13
+
+bb13:
+  %tmp14 = phi double [ %tmp5, %bb3 ], [ %tmp12, %bb9 ]
+  %tmp15 = phi i32 [ undef, %bb3 ], [ %tmp7, %bb9 ]
+  %tmp16 = getelementptr double, double* %arg, i32 %tmp15
+  %tmp17 = fadd double %tmp14, 1.300000e+00
+  store double %tmp17, double* %tmp16, align 4
+  %tmp18 = add nsw i32 %tmp15, 1
+  br label %bb6
+
+bb19:
+  ret void
+}
+
+; Functions that only use the value stack don't gain any locals.
+
+; CHECK-LABEL: straight_line:
+; CHECK-NEXT:  .param i32, i32{{$}}
+; CHECK-NEXT:  .result i32{{$}}
+; CHECK-NOT:   .local
+define i32 @straight_line(i32 %x, i32 %y) {
+  %a = add i32 %x, %y
+  %b = mul i32 %a, %a
+  ret i32 %b
+}
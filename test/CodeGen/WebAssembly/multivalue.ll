@@ -0,0 +1,121 @@
+; RUN: llc < %s -asm-verbose=false -disable-wasm-fallthrough-return-opt -wasm-temporary-workarounds=false -mattr=+multivalue | FileCheck --check-prefixes=CHECK,MULTI %s
+; RUN: llc < %s -asm-verbose=false -disable-wasm-fallthrough-return-opt -wasm-temporary-workarounds=false | FileCheck --check-prefixes=CHECK,NOMULTI %s
+
+; Test that small aggregates are returned as multiple values with the
+; multivalue feature, and through a pointer to memory without it.
+
+target datalayout = "e-m:e-p:32:32-i64:64-n32:64-S128"
+target triple = "wasm32-unknown-unknown"
+
+%pair = type { i32, i32 }
+%mixed = type { i32, i64, float, double }
+%five = type { i32, i32, i32, i32, i32 }
+
+declare %pair @pair_callee()
+
+; CHECK-LABEL: pair_args:
+; MULTI-NEXT:   .param i32, i32{{$}}
+; MULTI-NEXT:   .result i32, i32{{$}}
+; MULTI-NEXT:   get_local $push[[L0:[0-9]+]]=, 0{{$}}
+; MULTI-NEXT:   get_local $push[[L1:[0-9]+]]=, 1{{$}}
+; MULTI-NEXT:   return $pop[[L0]], $pop[[L1]]{{$}}
+; NOMULTI-NEXT: .param i32, i32, i32{{$}}
+; NOMULTI-NOT:  .result
+; NOMULTI:      i32.store
+; NOMULTI:      return{{$}}
+define %pair @pair_args(i32 %a, i32 %b) {
+  %t = insertvalue %pair undef, i32 %a, 0
+  %u = insertvalue %pair %t, i32 %b, 1
+  ret %pair %u
+}
+
+; CHECK-LABEL: mixed:
+; MULTI-NEXT:   .param i32, i64, f32, f64{{$}}
+; MULTI-NEXT:   .result i32, i64, f32, f64{{$}}
+; MULTI:        return $pop{{[0-9]+}}, $pop{{[0-9]+}}, $pop{{[0-9]+}}, $pop{{[0-9]+}}{{$}}
+; NOMULTI-NEXT: .param i32, i32, i64, f32, f64{{$}}
+; NOMULTI-NOT:  .result
+define %mixed @mixed(i32 %a, i64 %b, float %c, double %d) {
+  %t0 = insertvalue %mixed undef, i32 %a, 0
+  %t1 = insertvalue %mixed %t0, i64 %b, 1
+  %t2 = insertvalue %mixed %t1, float %c, 2
+  %t3 = insertvalue %mixed %t2, double %d, 3
+  ret %mixed %t3
+}
+
+; Legalization splits an i128 into two i64 values.
+
+; CHECK-LABEL: wide:
+; MULTI-NEXT:   .param i64, i64{{$}}
+; MULTI-NEXT:   .result i64, i64{{$}}
+; MULTI:        return $pop{{[0-9]+}}, $pop{{[0-9]+}}{{$}}
+; NOMULTI-NEXT: .param i32, i64, i64{{$}}
+; NOMULTI-NOT:  .result
+define i128 @wide(i128 %x) {
+  ret i128 %x
+}
+
+; Aggregates with more values than the limit still go through memory.
+
+; CHECK-LABEL: five:
+; CHECK-NEXT:   .param i32, i32{{$}}
+; CHECK-NOT:    .result
+; CHECK:        i32.store
+define %five @five(i32 %a) {
+  %t0 = insertvalue %five undef, i32 %a, 0
+  %t1 = insertvalue %five %t0, i32 %a, 1
+  %t2 = insertvalue %five %t1, i32 %a, 2
+  %t3 = insertvalue %five %t2, i32 %a, 3
+  %t4 = insertvalue %five %t3, i32 %a, 4
+  ret %five %t4
+}
+
+; The results of a multivalue call are taken off the stack last to first.
+
+; CHECK-LABEL: call_pair:
+; MULTI-NEXT:   .result i32{{$}}
+; MULTI-NEXT:   .local i32, i32{{$}}
+; MULTI-NEXT:   call pair_callee@FUNCTION{{$}}
+; MULTI-NEXT:   set_local [[B:[0-9]+]], $pop{{[0-9]+}}{{$}}
+; MULTI-NEXT:   set_local [[A:[0-9]+]], $pop{{[0-9]+}}{{$}}
+; MULTI-NEXT:   get_local $push[[L0:[0-9]+]]=, [[A]]{{$}}
+; MULTI-NEXT:   get_local $push[[L1:[0-9]+]]=, [[B]]{{$}}
+; MULTI-NEXT:   i32.sub $push[[L2:[0-9]+]]=, $pop[[L0]], $pop[[L1]]{{$}}
+; MULTI-NEXT:   return $pop[[L2]]{{$}}
+; NOMULTI:      call pair_callee@FUNCTION, $pop{{[0-9]+}}{{$}}
+; NOMULTI:      i32.load
+define i32 @call_pair() {
+  %p = call %pair @pair_callee()
+  %a = extractvalue %pair %p, 0
+  %b = extractvalue %pair %p, 1
+  %s = sub i32 %a, %b
+  ret i32 %s
+}
+
+; Unused results are dropped.
+
+; CHECK-LABEL: call_pair_first:
+; MULTI:        call pair_callee@FUNCTION{{$}}
+; MULTI-NEXT:   drop $pop{{[0-9]+}}{{$}}
+; MULTI-NEXT:   set_local [[A:[0-9]+]], $pop{{[0-9]+}}{{$}}
+; MULTI-NEXT:   get_local $push[[L0:[0-9]+]]=, [[A]]{{$}}
+; MULTI-NEXT:   return $pop[[L0]]{{$}}
+define i32 @call_pair_first() {
+  %p = call %pair @pair_callee()
+  %a = extractvalue %pair %p, 0
+  ret i32 %a
+}
+
+; CHECK-LABEL: call_indirect_pair:
+; MULTI-NEXT:   .param i32{{$}}
+; MULTI-NEXT:   .result i32, i32{{$}}
+; MULTI:        call_indirect $pop{{[0-9]+}}{{$}}
+; MULTI-NEXT:   set_local [[B:[0-9]+]], $pop{{[0-9]+}}{{$}}
+; MULTI-NEXT:   set_local [[A:[0-9]+]], $pop{{[0-9]+}}{{$}}
+; MULTI-NEXT:   get_local $push[[L0:[0-9]+]]=, [[A]]{{$}}
+; MULTI-NEXT:   get_local $push[[L1:[0-9]+]]=, [[B]]{{$}}
+; MULTI-NEXT:   return $pop[[L0]], $pop[[L1]]{{$}}
+define %pair @call_indirect_pair(%pair ()* %f) {
+  %p = call %pair %f()
+  ret %pair %p
+}
@@ -0,0 +1,107 @@
+; RUN: llc < %s -asm-verbose=false -disable-wasm-fallthrough-return-opt -disable-wasm-explicit-locals -verify-machineinstrs | FileCheck %s
+; RUN: llc < %s -asm-verbose=false -disable-wasm-fallthrough-return-opt -disable-wasm-explicit-locals -disable-wasm-stack-slot-promotion | FileCheck --check-prefix=NOPROMOTE %s
+
+; Test that stack slots whose address never escapes are kept in locals, and
+; that functions left without a frame don't touch __stack_pointer.
+
+target datalayout = "e-m:e-p:32:32-i64:64-n32:64-S128"
+target triple = "wasm32-unknown-unknown"
+
+declare void @use(i32*)
+
+; CHECK-LABEL: leaf_slot:
+; CHECK-NEXT:  .param i32{{$}}
+; CHECK-NEXT:  .result i32{{$}}
+; CHECK-NEXT:  return $0{{$}}
+; NOPROMOTE-LABEL: leaf_slot:
+; NOPROMOTE:       __stack_pointer
+define i32 @leaf_slot(i32 %x) {
+  %p = alloca i32
+  store i32 %x, i32* %p
+  %v = load i32, i32* %p
+  ret i32 %v
+}
+
+; CHECK-LABEL: loop_slot:
+; CHECK-NOT:   {{__stack_pointer|i32.load|i32.store}}
+; CHECK:       loop
+; CHECK-NOT:   {{__stack_pointer|i32.load|i32.store}}
+; CHECK:       return ${{[0-9]+}}{{$}}
+define i32 @loop_slot(i32 %n) {
+entry:
+  %acc = alloca i32
+  store i32 0, i32* %acc
+  br label %loop
+loop:
+  %i = phi i32 [0, %entry], [%i.next, %loop]
+  %a = load i32, i32* %acc
+  %a.next = add i32 %a, %i
+  store i32 %a.next, i32* %acc
+  %i.next = add i32 %i, 1
+  %c = icmp slt i32 %i.next, %n
+  br i1 %c, label %loop, label %exit
+exit:
+  %r = load i32, i32* %acc
+  ret i32 %r
+}
+
+; Values that are stored and never loaded disappear with the slot.
+
+; CHECK-LABEL: dead_store:
+; CHECK-NEXT:  .param f64{{$}}
+; CHECK-NEXT:  return{{$}}
+define void @dead_store(double %x) {
+  %p = alloca double
+  store double %x, double* %p
+  ret void
+}
+
+; Slots whose address escapes stay in memory.
+
+; CHECK-LABEL: escaped:
+; CHECK:       get_global $push{{[0-9]+}}=, __stack_pointer{{$}}
+; CHECK:       i32.store
+; CHECK:       call use@FUNCTION
+; CHECK:       i32.load
+define i32 @escaped() {
+  %p = alloca i32
+  store i32 1, i32* %p
+  call void @use(i32* %p)
+  %v = load i32, i32* %p
+  ret i32 %v
+}
+
+; So do slots that are accessed in pieces or as different types.
+
+; CHECK-LABEL: partial:
+; CHECK:       __stack_pointer
+; CHECK:       i64.store
+; CHECK:       i32.load
+define i32 @partial(i64 %x) {
+  %p = alloca i64
+  store i64 %x, i64* %p
+  %q = bitcast i64* %p to i32*
+  %v = load i32, i32* %q
+  ret i32 %v
+}
+
+; CHECK-LABEL: punned:
+; CHECK:       __stack_pointer
+; CHECK:       f32.store
+; CHECK:       i32.load
+define i32 @punned(float %x) {
+  %p = alloca float
+  store float %x, float* %p
+  %q = bitcast float* %p to i32*
+  %v = load i32, i32* %q
+  ret i32 %v
+}
+
+; CHECK-LABEL: volatile_slot:
+; CHECK:       __stack_pointer
+; CHECK:       i32.store
+define void @volatile_slot(i32 %x) {
+  %p = alloca i32
+  store volatile i32 %x, i32* %p
+  ret void
+}
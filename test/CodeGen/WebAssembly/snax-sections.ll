@@ -0,0 +1,66 @@
+; RUN: llc < %s -asm-verbose=false | FileCheck %s
+
+; Test that the Snax tables are emitted sorted, without duplicates, and with
+; a format byte and an entry count header.
+
+target datalayout = "e-m:e-p:32:32-i64:64-n32:64-S128"
+target triple = "wasm32-unknown-unknown"
+
+declare void @send_inline() #0
+declare void @prints() #0
+declare void @unlisted()
+
+define void @transfer() #1 {
+  ret void
+}
+
+define void @issue() #2 {
+  ret void
+}
+
+define void @issue_alias() #2 {
+  ret void
+}
+
+define void @on_transfer() #3 {
+  ret void
+}
+
+define void @abi() #4 {
+  call void @send_inline()
+  call void @prints()
+  call void @unlisted()
+  ret void
+}
+
+attributes #0 = { "snax_wasm_import" }
+attributes #1 = { "snax_wasm_action"="transfer" }
+attributes #2 = { "snax_wasm_action"="issue" }
+attributes #3 = { "snax_wasm_notify"="snax.token::transfer" }
+attributes #4 = { "snax_wasm_abi"="{}" }
+
+; CHECK:      .section .imports,"",@
+; CHECK-NEXT: .int8 0
+; CHECK-NEXT: .int8 2
+; CHECK-NEXT: .int8 6
+; CHECK-NEXT: .ascii "prints"
+; CHECK-NEXT: .int8 11
+; CHECK-NEXT: .ascii "send_inline"
+
+; CHECK:      .section .snax_abi,"",@
+; CHECK-NEXT: .int8 2
+; CHECK-NEXT: .ascii "{}"
+
+; CHECK:      .section .snax_actions,"",@
+; CHECK-NEXT: .int8 0
+; CHECK-NEXT: .int8 2
+; CHECK-NEXT: .int8 5
+; CHECK-NEXT: .ascii "issue"
+; CHECK-NEXT: .int8 8
+; CHECK-NEXT: .ascii "transfer"
+
+; CHECK:      .section .snax_notify,"",@
+; CHECK-NEXT: .int8 0
+; CHECK-NEXT: .int8 1
+; CHECK-NEXT: .int8 20
+; CHECK-NEXT: .ascii "snax.token::transfer"
@@ -0,0 +1,18 @@
+; RUN: llc < %s -asm-verbose=false -wasm-temporary-workarounds=false -mattr=+tail-call | FileCheck %s
+; RUN: not llc < %s -asm-verbose=false -wasm-temporary-workarounds=false 2>&1 | FileCheck --check-prefix=ERROR %s
+
+; Test that musttail calls are lowered to return_call, and are rejected
+; without the tail-call feature instead of silently becoming regular calls.
+
+target datalayout = "e-m:e-p:32:32-i64:64-n32:64-S128"
+target triple = "wasm32-unknown-unknown"
+
+declare i32 @i32_unary(i32)
+
+; CHECK-LABEL: musttail:
+; CHECK:       return_call i32_unary@FUNCTION, $pop{{[0-9]+}}{{$}}
+; ERROR:       WebAssembly doesn't support tail call without the tail-call feature
+define i32 @musttail(i32 %x) {
+  %t = musttail call i32 @i32_unary(i32 %x)
+  ret i32 %t
+}
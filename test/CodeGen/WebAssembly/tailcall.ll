@@ -0,0 +1,91 @@
+; RUN: llc < %s -asm-verbose=false -disable-wasm-fallthrough-return-opt -wasm-temporary-workarounds=false -mattr=+tail-call | FileCheck --check-prefixes=CHECK,TAIL %s
+; RUN: llc < %s -asm-verbose=false -disable-wasm-fallthrough-return-opt -wasm-temporary-workarounds=false | FileCheck --check-prefixes=CHECK,NOTAIL %s
+
+; Test that tail calls are lowered to return_call and return_call_indirect
+; with the tail-call feature, and to regular calls without it.
+
+target datalayout = "e-m:e-p:32:32-i64:64-n32:64-S128"
+target triple = "wasm32-unknown-unknown"
+
+%SmallStruct = type { i32 }
+
+declare i32 @i32_unary(i32)
+declare void @void_nullary()
+declare void @byval_func(%SmallStruct* byval)
+declare void @vararg_func(i32, ...)
+
+; CHECK-LABEL: recursive:
+; CHECK-NEXT:  .param i32{{$}}
+; CHECK-NEXT:  .result i32{{$}}
+; CHECK-NEXT:  get_local $push[[L0:[0-9]+]]=, 0{{$}}
+; TAIL-NEXT:   return_call recursive@FUNCTION, $pop[[L0]]{{$}}
+; TAIL-NEXT:   end_function
+; NOTAIL-NEXT: i32.call $push[[NUM:[0-9]+]]=, recursive@FUNCTION, $pop[[L0]]{{$}}
+; NOTAIL-NEXT: return $pop[[NUM]]{{$}}
+define i32 @recursive(i32 %x) {
+  %t = tail call i32 @recursive(i32 %x)
+  ret i32 %t
+}
+
+; CHECK-LABEL: direct_void:
+; TAIL-NEXT:   return_call void_nullary@FUNCTION{{$}}
+; NOTAIL-NEXT: call void_nullary@FUNCTION{{$}}
+; NOTAIL-NEXT: return{{$}}
+define void @direct_void() {
+  tail call void @void_nullary()
+  ret void
+}
+
+; CHECK-LABEL: indirect:
+; CHECK-NEXT:  .param i32, i32{{$}}
+; CHECK-NEXT:  .result i32{{$}}
+; CHECK-NEXT:  get_local $push[[L0:[0-9]+]]=, 1{{$}}
+; CHECK-NEXT:  get_local $push[[L1:[0-9]+]]=, 0{{$}}
+; TAIL-NEXT:   return_call_indirect $pop[[L0]], $pop[[L1]]{{$}}
+; NOTAIL-NEXT: i32.call_indirect $push[[NUM:[0-9]+]]=, $pop[[L0]], $pop[[L1]]{{$}}
+; NOTAIL-NEXT: return $pop[[NUM]]{{$}}
+define i32 @indirect(i32 (i32)* %callee, i32 %x) {
+  %t = tail call i32 %callee(i32 %x)
+  ret i32 %t
+}
+
+; A return_call returns the callee's results, so they must match ours.
+
+; CHECK-LABEL: mismatched_results:
+; CHECK:       i32.call $push[[L0:[0-9]+]]=, i32_unary@FUNCTION, $pop{{[0-9]+}}{{$}}
+; CHECK-NEXT:  drop $pop[[L0]]{{$}}
+; CHECK-NEXT:  return{{$}}
+define void @mismatched_results(i32 %x) {
+  %t = tail call i32 @i32_unary(i32 %x)
+  ret void
+}
+
+; Calls whose arguments live in this frame can't be tail calls.
+
+; CHECK-LABEL: byval:
+; CHECK:       call byval_func@FUNCTION, $pop{{[0-9]+}}{{$}}
+; CHECK-NOT:   return_call
+; CHECK:       return{{$}}
+define void @byval(%SmallStruct* %p) {
+  tail call void @byval_func(%SmallStruct* byval %p)
+  ret void
+}
+
+; CHECK-LABEL: vararg:
+; CHECK:       call vararg_func@FUNCTION, $pop{{[0-9]+}}, $pop{{[0-9]+}}{{$}}
+; CHECK-NOT:   return_call
+; CHECK:       return{{$}}
+define void @vararg() {
+  tail call void (i32, ...) @vararg_func(i32 1, i32 2)
+  ret void
+}
+
+; Calls that aren't marked tail stay regular calls.
+
+; CHECK-LABEL: not_tail:
+; CHECK:       i32.call $push[[NUM:[0-9]+]]=, i32_unary@FUNCTION, $pop{{[0-9]+}}{{$}}
+; CHECK-NEXT:  return $pop[[NUM]]{{$}}
+define i32 @not_tail(i32 %x) {
+  %t = call i32 @i32_unary(i32 %x)
+  ret i32 %t
+}
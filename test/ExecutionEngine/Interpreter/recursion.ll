@@ -0,0 +1,45 @@
+; RUN: %lli -force-interpreter %s
+
+; Each frame keeps its own values, including the ones produced by intrinsics
+; lowered while outer frames of the same function are still live.
+
+declare i32 @llvm.ctpop.i32(i32)
+
+define i32 @g(i32 %n) {
+entry:
+  %small = icmp slt i32 %n, 2
+  br i1 %small, label %done, label %recurse
+
+recurse:
+  %n1 = sub i32 %n, 1
+  %g1 = call i32 @g(i32 %n1)
+  %n2 = sub i32 %n, 2
+  %g2 = call i32 @g(i32 %n2)
+  %bits = call i32 @llvm.ctpop.i32(i32 %n)
+  %sum = add i32 %g1, %g2
+  %r = add i32 %sum, %bits
+  br label %done
+
+done:
+  %result = phi i32 [ %n, %entry ], [ %r, %recurse ]
+  ret i32 %result
+}
+
+define i32 @main() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %acc = phi i32 [ 0, %entry ], [ %acc.next, %loop ]
+  %v = call i32 @g(i32 12)
+  %acc.next = add i32 %acc, %v
+  %i.next = add i32 %i, 1
+  %again = icmp slt i32 %i.next, 3
+  br i1 %again, label %loop, label %exit
+
+exit:
+  %ok = icmp eq i32 %acc.next, 1467
+  %ret = select i1 %ok, i32 0, i32 1
+  ret i32 %ret
+}
@@ -0,0 +1,65 @@
+; RUN: lli -jit-kind=orc-lazy -orc-lazy-debug=funcs-to-stdout -orc-lazy-speculate=in-place %s | FileCheck %s
+; RUN: lli -jit-kind=orc-lazy -orc-lazy-debug=funcs-to-stdout %s | FileCheck --check-prefix=LAZY %s
+;
+; Test that the direct callees of a compiled function are compiled before
+; they're called, but not their callees in turn, nor functions the profile
+; says are never called.
+;
+; CHECK: [ main ]
+; CHECK-NEXT: [ foo ]
+; CHECK-NEXT: main
+; CHECK-NEXT: foo
+; CHECK-NOT: [ {{bar|cold}} ]
+;
+; LAZY: [ main ]
+; LAZY-NEXT: main
+; LAZY-NEXT: [ foo ]
+; LAZY-NEXT: foo
+
+@str.main = private unnamed_addr constant [5 x i8] c"main\00"
+@str.foo = private unnamed_addr constant [4 x i8] c"foo\00"
+@str.bar = private unnamed_addr constant [4 x i8] c"bar\00"
+
+define i32 @main(i32 %argc, i8** nocapture readnone %argv) {
+entry:
+  %0 = tail call i32 @puts(i8* getelementptr inbounds ([5 x i8], [5 x i8]* @str.main, i64 0, i64 0))
+  %many = icmp sgt i32 %argc, 5
+  br i1 %many, label %unlikely, label %call_foo
+
+unlikely:
+  tail call void @cold()
+  br label %call_foo
+
+call_foo:
+  tail call void @foo(i32 %argc)
+  ret i32 0
+}
+
+define void @foo(i32 %n) {
+entry:
+  %many = icmp sgt i32 %n, 5
+  br i1 %many, label %call_bar, label %exit
+
+call_bar:
+  tail call void @bar()
+  br label %exit
+
+exit:
+  %0 = tail call i32 @puts(i8* getelementptr inbounds ([4 x i8], [4 x i8]* @str.foo, i64 0, i64 0))
+  ret void
+}
+
+define void @bar() {
+entry:
+  %0 = tail call i32 @puts(i8* getelementptr inbounds ([4 x i8], [4 x i8]* @str.bar, i64 0, i64 0))
+  ret void
+}
+
+define void @cold() !prof !0 {
+entry:
+  ret void
+}
+
+declare i32 @puts(i8* nocapture readonly)
+
+!0 = !{!"function_entry_count", i64 0}
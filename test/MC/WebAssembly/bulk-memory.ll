@@ -0,0 +1,28 @@
+; RUN: llc -filetype=obj -mattr=+bulk-memory %s -o - | obj2yaml | FileCheck %s
+
+; Check the encoding of memory.copy and memory.fill: the 0xfc prefix, the
+; opcode and the memory index immediates.
+
+target triple = "wasm32-unknown-unknown"
+
+declare void @llvm.memcpy.p0i8.p0i8.i32(i8* nocapture, i8* nocapture readonly, i32, i1)
+declare void @llvm.memset.p0i8.i32(i8* nocapture, i8, i32, i1)
+
+define void @copy(i8* %dst, i8* %src, i32 %len) {
+  call void @llvm.memcpy.p0i8.p0i8.i32(i8* %dst, i8* %src, i32 %len, i1 false)
+  ret void
+}
+
+define void @set(i8* %dst, i8 %val, i32 %len) {
+  call void @llvm.memset.p0i8.i32(i8* %dst, i8 %val, i32 %len, i1 false)
+  ret void
+}
+
+; CHECK:        - Type:            CODE
+; CHECK-NEXT:     Functions:
+; CHECK-NEXT:       - Index:           0
+; CHECK-NEXT:         Locals:
+; CHECK-NEXT:         Body:            200020012002FC0A00000B
+; CHECK-NEXT:       - Index:           1
+; CHECK-NEXT:         Locals:
+; CHECK-NEXT:         Body:            200020012002FC0B000B
@@ -0,0 +1,18 @@
+; RUN: not llc -filetype=obj -wasm-compact-object %s -o /dev/null 2>&1 | FileCheck %s
+; RUN: not llc -filetype=obj -wasm-compact-object %S/Inputs/compact-object-debug-info.ll -o /dev/null 2>&1 | FileCheck --check-prefix=DEBUG %s
+
+; A compact object is final, so it can't leave a data address for a linker
+; to fill in. Nor can it refer to code offsets, as debug info does, since
+; compacting the function bodies moves the code.
+
+target triple = "wasm32-unknown-unknown"
+
+@ext_data = external global i32
+
+define i32* @p() {
+entry:
+  ret i32* @ext_data
+}
+
+; CHECK: LLVM ERROR: undefined data symbol in compact wasm object: ext_data
+; DEBUG: LLVM ERROR: compact wasm objects can't refer to code offsets
@@ -0,0 +1,109 @@
+; RUN: llc -filetype=obj %s -o - | obj2yaml | FileCheck --check-prefix=PADDED %s
+; RUN: llc -filetype=obj -wasm-compact-object %s -o %t.o
+; RUN: obj2yaml %t.o | FileCheck --check-prefix=COMPACT %s
+; RUN: llvm-readobj -s %t.o | FileCheck --check-prefix=SECTIONS %s
+
+; The same module written normally, with every relocated LEB padded to five
+; bytes, and as a compact final object, with the relocations resolved at
+; their minimal width and no linking or reloc sections. The compact object
+; must still be readable by the object file reader.
+
+target triple = "wasm32-unknown-unknown"
+
+@g = global i32 7, align 4
+@fp = global void ()* @f, align 4
+; Puts @far at address 208, which takes two bytes as an LEB or SLEB.
+@pad = global [200 x i8] zeroinitializer, align 1
+@far = global i32 9, align 4
+
+declare void @ext()
+declare void @use(i32*)
+
+define void @f() {
+entry:
+  call void @ext()
+  ret void
+}
+
+define i32* @p() {
+entry:
+  ret i32* @g
+}
+
+define i32* @q() {
+entry:
+  ret i32* @far
+}
+
+define i32 @load_far() {
+entry:
+  %v = load i32, i32* @far
+  ret i32 %v
+}
+
+define void ()* @fptr() {
+entry:
+  ret void ()* @f
+}
+
+define void @callind(void ()* %fn) {
+entry:
+  call void %fn()
+  ret void
+}
+
+define void @sp() {
+entry:
+  %a = alloca i32
+  call void @use(i32* %a)
+  ret void
+}
+
+; PADDED:      - Type: CODE
+; PADDED-NEXT:   Relocations:
+; PADDED-NEXT:     - Type: R_WEBASSEMBLY_FUNCTION_INDEX_LEB
+; PADDED:          - Type: R_WEBASSEMBLY_MEMORY_ADDR_SLEB
+; PADDED:          - Type: R_WEBASSEMBLY_MEMORY_ADDR_SLEB
+; PADDED:          - Type: R_WEBASSEMBLY_MEMORY_ADDR_LEB
+; PADDED:          - Type: R_WEBASSEMBLY_TABLE_INDEX_SLEB
+; PADDED:          - Type: R_WEBASSEMBLY_TYPE_INDEX_LEB
+; PADDED:          - Type: R_WEBASSEMBLY_GLOBAL_INDEX_LEB
+; PADDED:        Functions:
+; PADDED:            Body: 1080808080000B
+; PADDED:            Body: 4180808080000B
+; PADDED:            Body: 41D0818080000B
+; PADDED:            Body: 41002802D0818080000B
+; PADDED:            Body: 4181808080000B
+; PADDED:            Body: 2000118080808000000B
+; PADDED:            Body: 23808080800041106B22002480808080002000410C6A108180808000200041106A2480808080000B
+; PADDED:      - Type: DATA
+; PADDED-NEXT:   Relocations:
+; PADDED-NEXT:     - Type: R_WEBASSEMBLY_TABLE_INDEX_I32
+; PADDED:      - Type: CUSTOM
+; PADDED-NEXT:   Name: linking
+
+; Each relocation is resolved in place: the call to @ext, the addresses of
+; @g and @far (0xD0 0x01 as an SLEB, and as the LEB offset of the load), the
+; table index of @f, the type index of the call_indirect, and the global
+; index of __stack_pointer. The data section holds @f's table index.
+; COMPACT:      - Type: CODE
+; COMPACT-NEXT:   Functions:
+; COMPACT:            Body: 10000B
+; COMPACT:            Body: 41000B
+; COMPACT:            Body: 41D0010B
+; COMPACT:            Body: 41002802D0010B
+; COMPACT:            Body: 41010B
+; COMPACT:            Body: 20001100000B
+; COMPACT:            Body: 230041106B220024002000410C6A1001200041106A24000B
+; COMPACT:      - Type: DATA
+; COMPACT-NOT:  Relocations:
+; COMPACT:          Value: 4
+; COMPACT-NEXT:   Content: '01000000'
+; COMPACT:          Value: 208
+; COMPACT-NEXT:   Content: '09000000'
+; COMPACT-NOT:  Type: CUSTOM
+
+; SECTIONS:      Type: CODE (0xA)
+; SECTIONS-NEXT: Size: 67
+; SECTIONS:      Type: DATA (0xB)
+; SECTIONS-NOT:  Type: CUSTOM
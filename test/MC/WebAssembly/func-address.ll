@@ -16,7 +16,8 @@ entry:
 
 ; take the address of the third import.  This should generate a TABLE_INDEX
 ; relocation with index of 0 since its the first and only address taken
-; function.
+; function. The alloca doesn't escape, so it lives in a local and the function
+; doesn't touch __stack_pointer.
 define hidden void @call_indirect() #0 {
 entry:
   %adr = alloca i32 ()*, align 4
@@ -40,13 +41,8 @@ entry:
 ; CHECK-NEXT:       Symbol: import2
 ; CHECK-NEXT:     }
 ; CHECK-NEXT:     Relocation {
-; CHECK-NEXT:       Type: R_WEBASSEMBLY_GLOBAL_INDEX_LEB (7)
-; CHECK-NEXT:       Offset: 0x15
-; CHECK-NEXT:       Symbol: __stack_pointer
-; CHECK-NEXT:     }
-; CHECK-NEXT:     Relocation {
 ; CHECK-NEXT:       Type: R_WEBASSEMBLY_TABLE_INDEX_SLEB (1)
-; CHECK-NEXT:       Offset: 0x1E
+; CHECK-NEXT:       Offset: 0x15
 ; CHECK-NEXT:       Symbol: import3
 ; CHECK-NEXT:     }
 ; CHECK-NEXT:   }
@@ -0,0 +1,40 @@
+; RUN: llc -filetype=obj -mattr=+multivalue %s -o - | obj2yaml | FileCheck %s
+
+; Check that signatures with multiple results are written to the type
+; section, including the type of a multivalue call_indirect.
+
+target triple = "wasm32-unknown-unknown"
+
+%pair = type { i32, i64 }
+
+define %pair @pair(i32 %a, i64 %b) {
+  %t = insertvalue %pair undef, i32 %a, 0
+  %u = insertvalue %pair %t, i64 %b, 1
+  ret %pair %u
+}
+
+define %pair @call_indirect_pair(%pair ()* %f) {
+  %p = call %pair %f()
+  ret %pair %p
+}
+
+; CHECK:        - Type:            TYPE
+; CHECK-NEXT:     Signatures:
+; CHECK-NEXT:       - Index:           0
+; CHECK-NEXT:         ReturnType:      I32
+; CHECK-NEXT:         ParamTypes:
+; CHECK-NEXT:           - I32
+; CHECK-NEXT:           - I64
+; CHECK-NEXT:         ExtraReturnTypes:
+; CHECK-NEXT:           - I64
+; CHECK-NEXT:       - Index:           1
+; CHECK-NEXT:         ReturnType:      I32
+; CHECK-NEXT:         ParamTypes:
+; CHECK-NEXT:           - I32
+; CHECK-NEXT:         ExtraReturnTypes:
+; CHECK-NEXT:           - I64
+; CHECK-NEXT:       - Index:           2
+; CHECK-NEXT:         ReturnType:      I32
+; CHECK-NEXT:         ParamTypes:
+; CHECK-NEXT:         ExtraReturnTypes:
+; CHECK-NEXT:           - I64
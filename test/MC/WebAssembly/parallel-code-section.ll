@@ -0,0 +1,827 @@
+; RUN: llc -filetype=obj %s -o %t.parallel.o
+; RUN: llc -filetype=obj -wasm-serial-code-section %s -o %t.serial.o
+; RUN: cmp %t.parallel.o %t.serial.o
+; RUN: obj2yaml %t.parallel.o | FileCheck %s
+
+; Modules with at least 64 functions have their function bodies encoded in
+; parallel. Check that the result is byte-for-byte the same as encoding them
+; one after another, including the relocations that cross between bodies.
+
+target triple = "wasm32-unknown-unknown"
+
+@g = global [80 x i32] zeroinitializer, align 4
+
+declare i32 @ext(i32)
+
+define i32 @f0(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 0
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @ext(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f1(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 1
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f0(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f2(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 2
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f1(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f3(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 3
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f2(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f4(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 4
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f3(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f5(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 5
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f4(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f6(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 6
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f5(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f7(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 7
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f6(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f8(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 8
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f7(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f9(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 9
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f8(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f10(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 10
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f9(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f11(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 11
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f10(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f12(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 12
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f11(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f13(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 13
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f12(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f14(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 14
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f13(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f15(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 15
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f14(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f16(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 16
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f15(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f17(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 17
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f16(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f18(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 18
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f17(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f19(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 19
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f18(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f20(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 20
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f19(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f21(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 21
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f20(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f22(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 22
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f21(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f23(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 23
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f22(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f24(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 24
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f23(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f25(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 25
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f24(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f26(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 26
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f25(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f27(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 27
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f26(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f28(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 28
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f27(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f29(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 29
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f28(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f30(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 30
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f29(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f31(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 31
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f30(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f32(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 32
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f31(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f33(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 33
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f32(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f34(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 34
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f33(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f35(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 35
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f34(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f36(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 36
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f35(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f37(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 37
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f36(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f38(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 38
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f37(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f39(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 39
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f38(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f40(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 40
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f39(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f41(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 41
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f40(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f42(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 42
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f41(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f43(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 43
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f42(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f44(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 44
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f43(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f45(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 45
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f44(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f46(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 46
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f45(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f47(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 47
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f46(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f48(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 48
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f47(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f49(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 49
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f48(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f50(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 50
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f49(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f51(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 51
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f50(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f52(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 52
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f51(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f53(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 53
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f52(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f54(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 54
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f53(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f55(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 55
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f54(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f56(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 56
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f55(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f57(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 57
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f56(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f58(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 58
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f57(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f59(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 59
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f58(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f60(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 60
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f59(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f61(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 61
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f60(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f62(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 62
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f61(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f63(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 63
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f62(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f64(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 64
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f63(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f65(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 65
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f64(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f66(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 66
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f65(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f67(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 67
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f66(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f68(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 68
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f67(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f69(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 69
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f68(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f70(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 70
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f69(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f71(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 71
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f70(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f72(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 72
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f71(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f73(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 73
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f72(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f74(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 74
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f73(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f75(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 75
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f74(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f76(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 76
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f75(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f77(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 77
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f76(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f78(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 78
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f77(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+define i32 @f79(i32 %x) {
+entry:
+  %p = getelementptr [80 x i32], [80 x i32]* @g, i32 0, i32 79
+  %v = load i32, i32* %p
+  %a = add i32 %v, %x
+  %c = call i32 @f78(i32 %a)
+  store i32 %c, i32* %p
+  ret i32 %c
+}
+
+; The first and last bodies, with their relocations resolved.
+
+; CHECK:      - Type: CODE
+; CHECK-NEXT:   Relocations:
+; CHECK:        Functions:
+; CHECK-NEXT:     - Index: 1
+; CHECK-NEXT:       Locals:
+; CHECK-NEXT:       Body: 410041002802808080800020006A10808080800022003602808080800020000B
+; CHECK:          - Index: 80
+; CHECK-NEXT:       Locals:
+; CHECK-NEXT:       Body: 410041002802BC8280800020006A10CF8080800022003602BC8280800020000B
+; CHECK-NEXT:   - Type: DATA
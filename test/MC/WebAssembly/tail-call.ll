@@ -0,0 +1,35 @@
+; RUN: llc -filetype=obj -mattr=+tail-call %s -o - | obj2yaml | FileCheck %s
+
+; Check the encoding of return_call and return_call_indirect, and that their
+; function and type index operands get relocations like call and
+; call_indirect.
+
+target triple = "wasm32-unknown-unknown"
+
+declare i32 @callee(i32)
+
+define i32 @direct(i32 %x) {
+  %t = tail call i32 @callee(i32 %x)
+  ret i32 %t
+}
+
+define i32 @indirect(i32 (i32)* %f, i32 %x) {
+  %t = tail call i32 %f(i32 %x)
+  ret i32 %t
+}
+
+; CHECK:        - Type:            CODE
+; CHECK-NEXT:     Relocations:
+; CHECK-NEXT:       - Type:            R_WEBASSEMBLY_FUNCTION_INDEX_LEB
+; CHECK-NEXT:         Index:           {{[0-9]+}}
+; CHECK-NEXT:         Offset:          0x00000006
+; CHECK-NEXT:       - Type:            R_WEBASSEMBLY_TYPE_INDEX_LEB
+; CHECK-NEXT:         Index:           0
+; CHECK-NEXT:         Offset:          0x00000013
+; CHECK-NEXT:     Functions:
+; CHECK-NEXT:       - Index:           1
+; CHECK-NEXT:         Locals:
+; CHECK-NEXT:         Body:            20001280808080000B
+; CHECK-NEXT:       - Index:           2
+; CHECK-NEXT:         Locals:
+; CHECK-NEXT:         Body:            20012000138080808000000B
@@ -0,0 +1,101 @@
+; RUN: opt < %s -loop-vectorize -S -mtriple=wasm32-unknown-unknown -mattr=+simd128 | FileCheck %s
+
+; SIMD128 can't load or store a vector yet, so none of these kernels may be
+; vectorized, however cheap their arithmetic is.
+
+target datalayout = "e-m:e-p:32:32-i64:64-n32:64-S128"
+target triple = "wasm32-unknown-unknown"
+
+; CHECK-NOT: x i8>
+; CHECK-NOT: x i32>
+; CHECK-NOT: x i64>
+
+; A memcpy-like byte copy.
+define void @copy(i8* noalias %dst, i8* noalias %src, i32 %n) {
+entry:
+  %cmp = icmp sgt i32 %n, 0
+  br i1 %cmp, label %loop, label %exit
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %s = getelementptr inbounds i8, i8* %src, i32 %i
+  %v = load i8, i8* %s, align 1
+  %d = getelementptr inbounds i8, i8* %dst, i32 %i
+  store i8 %v, i8* %d, align 1
+  %i.next = add nuw nsw i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+; Element-wise addition of two word arrays.
+define void @add_words(i32* noalias %dst, i32* noalias %a, i32* noalias %b, i32 %n) {
+entry:
+  %cmp = icmp sgt i32 %n, 0
+  br i1 %cmp, label %loop, label %exit
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %pa = getelementptr inbounds i32, i32* %a, i32 %i
+  %va = load i32, i32* %pa, align 4
+  %pb = getelementptr inbounds i32, i32* %b, i32 %i
+  %vb = load i32, i32* %pb, align 4
+  %sum = add i32 %va, %vb
+  %pd = getelementptr inbounds i32, i32* %dst, i32 %i
+  store i32 %sum, i32* %pd, align 4
+  %i.next = add nuw nsw i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+; A multiplicative byte hash, reduced over the input.
+define i32 @hash(i8* %p, i32 %n) {
+entry:
+  %cmp = icmp sgt i32 %n, 0
+  br i1 %cmp, label %loop, label %exit
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %h = phi i32 [ 0, %entry ], [ %h.next, %loop ]
+  %pc = getelementptr inbounds i8, i8* %p, i32 %i
+  %c = load i8, i8* %pc, align 1
+  %cz = zext i8 %c to i32
+  %m = mul i32 %cz, 16777619
+  %h.next = add i32 %h, %m
+  %i.next = add nuw nsw i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %r = phi i32 [ 0, %entry ], [ %h.next, %loop ]
+  ret i32 %r
+}
+
+; Multiplying a big integer by a word: the limb products can be computed
+; independently, the carry is propagated separately.
+define void @mul_limbs(i64* noalias %dst, i32* noalias %a, i32 %k, i32 %n) {
+entry:
+  %cmp = icmp sgt i32 %n, 0
+  %kz = zext i32 %k to i64
+  br i1 %cmp, label %loop, label %exit
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %pa = getelementptr inbounds i32, i32* %a, i32 %i
+  %va = load i32, i32* %pa, align 4
+  %vz = zext i32 %va to i64
+  %prod = mul i64 %vz, %kz
+  %pd = getelementptr inbounds i64, i64* %dst, i32 %i
+  store i64 %prod, i64* %pd, align 8
+  %i.next = add nuw nsw i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
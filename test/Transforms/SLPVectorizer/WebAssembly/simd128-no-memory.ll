@@ -0,0 +1,41 @@
+; RUN: opt < %s -slp-vectorizer -S -mtriple=wasm32-unknown-unknown -mattr=+simd128 | FileCheck %s
+
+; Four independent word additions would make a single i32x4.add, but the
+; operands would have to be loaded and stored as vectors, which SIMD128 can't
+; do yet, so the code has to stay scalar.
+
+target datalayout = "e-m:e-p:32:32-i64:64-n32:64-S128"
+target triple = "wasm32-unknown-unknown"
+
+; CHECK-LABEL: @add4(
+; CHECK-NOT: <4 x i32>
+; CHECK: ret void
+define void @add4(i32* noalias %dst, i32* noalias %a, i32* noalias %b) {
+entry:
+  %a0 = load i32, i32* %a, align 4
+  %b0 = load i32, i32* %b, align 4
+  %s0 = add i32 %a0, %b0
+  store i32 %s0, i32* %dst, align 4
+  %pa1 = getelementptr inbounds i32, i32* %a, i32 1
+  %pb1 = getelementptr inbounds i32, i32* %b, i32 1
+  %pd1 = getelementptr inbounds i32, i32* %dst, i32 1
+  %a1 = load i32, i32* %pa1, align 4
+  %b1 = load i32, i32* %pb1, align 4
+  %s1 = add i32 %a1, %b1
+  store i32 %s1, i32* %pd1, align 4
+  %pa2 = getelementptr inbounds i32, i32* %a, i32 2
+  %pb2 = getelementptr inbounds i32, i32* %b, i32 2
+  %pd2 = getelementptr inbounds i32, i32* %dst, i32 2
+  %a2 = load i32, i32* %pa2, align 4
+  %b2 = load i32, i32* %pb2, align 4
+  %s2 = add i32 %a2, %b2
+  store i32 %s2, i32* %pd2, align 4
+  %pa3 = getelementptr inbounds i32, i32* %a, i32 3
+  %pb3 = getelementptr inbounds i32, i32* %b, i32 3
+  %pd3 = getelementptr inbounds i32, i32* %dst, i32 3
+  %a3 = load i32, i32* %pa3, align 4
+  %b3 = load i32, i32* %pb3, align 4
+  %s3 = add i32 %a3, %b3
+  store i32 %s3, i32* %pd3, align 4
+  ret void
+}
@@ -0,0 +1,30 @@
+; RUN: opt < %s -load=%llvmshlibdir/LLVMSnaxApply%shlibext -apply_fixup -snax-apply-whole-program -S | FileCheck %s
+; RUN: opt < %s -load=%llvmshlibdir/LLVMSnaxApply%shlibext -apply_fixup -S | FileCheck --check-prefix=PARTIAL %s
+; REQUIRES: loadable_module
+
+; Test that when every constructor is evaluated and nothing registers a
+; destructor, a whole program entry point doesn't call __wasm_call_ctors or
+; __cxa_finalize.
+
+@counter = global i32 0
+
+; CHECK: @counter = global i32 42
+; CHECK: @llvm.global_ctors = appending global [0 x { i32, void ()*, i8* }] zeroinitializer
+
+@llvm.global_ctors = appending global [1 x { i32, void ()*, i8* }] [{ i32, void ()*, i8* } { i32 65535, void ()* @init_counter, i8* null }]
+
+define internal void @init_counter() {
+  store i32 42, i32* @counter
+  ret void
+}
+
+; CHECK-LABEL: define void @apply(
+; CHECK-NEXT:    ret void
+
+; PARTIAL-LABEL: define void @apply(
+; PARTIAL-NEXT:    call void @__wasm_call_ctors()
+; PARTIAL-NEXT:    call void @__cxa_finalize(i32 0)
+; PARTIAL-NEXT:    ret void
+define void @apply(i64 %receiver, i64 %code, i64 %action) {
+  ret void
+}
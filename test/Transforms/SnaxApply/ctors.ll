@@ -0,0 +1,61 @@
+; RUN: opt < %s -load=%llvmshlibdir/LLVMSnaxApply%shlibext -apply_fixup -S | FileCheck %s
+; RUN: opt < %s -load=%llvmshlibdir/LLVMSnaxApply%shlibext -apply_fixup -snax-apply-whole-program -S | FileCheck --check-prefix=WHOLE %s
+; REQUIRES: loadable_module
+
+; Test that constructors the evaluator can run are folded into the
+; initializers of the globals they write, and that ones it can't run, and the
+; ones after them, are left alone.
+
+@counter = global i32 0
+@table = global [2 x i32] zeroinitializer
+@handle = global i32 0
+@late = global i32 0
+
+; CHECK: @counter = global i32 42
+; CHECK: @table = global [2 x i32] zeroinitializer
+; CHECK: @handle = global i32 0
+; CHECK: @late = global i32 0
+; CHECK: @llvm.global_ctors = appending global [3 x { i32, void ()*, i8* }] [{ i32, void ()*, i8* } { i32 65535, void ()* @init_table, i8* null }, { i32, void ()*, i8* } { i32 65535, void ()* @init_handle, i8* null }, { i32, void ()*, i8* } { i32 65535, void ()* @init_late, i8* null }]
+
+@llvm.global_ctors = appending global [4 x { i32, void ()*, i8* }] [{ i32, void ()*, i8* } { i32 65535, void ()* @init_counter, i8* null }, { i32, void ()*, i8* } { i32 65535, void ()* @init_table, i8* null }, { i32, void ()*, i8* } { i32 65535, void ()* @init_handle, i8* null }, { i32, void ()*, i8* } { i32 65535, void ()* @init_late, i8* null }]
+
+define internal void @init_counter() {
+  store i32 42, i32* @counter
+  ret void
+}
+
+; Stores into part of a global aren't folded.
+define internal void @init_table() {
+  %p = getelementptr [2 x i32], [2 x i32]* @table, i32 0, i32 1
+  store i32 7, i32* %p
+  ret void
+}
+
+declare i32 @open_handle()
+
+; Calls to unknown functions can't be evaluated.
+define internal void @init_handle() {
+  %h = call i32 @open_handle()
+  store i32 %h, i32* @handle
+  ret void
+}
+
+; This one could be evaluated, but must still run after the ones before it.
+define internal void @init_late() {
+  store i32 1, i32* @late
+  ret void
+}
+
+; Constructors are left to run, so the entry point calls them either way.
+
+; CHECK-LABEL: define void @apply(
+; CHECK-NEXT:    call void @__wasm_call_ctors()
+; CHECK-NEXT:    call void @__cxa_finalize(i32 0)
+; CHECK-NEXT:    ret void
+
+; WHOLE-LABEL: define void @apply(
+; WHOLE-NEXT:    call void @__wasm_call_ctors()
+; WHOLE-NEXT:    ret void
+define void @apply(i64 %receiver, i64 %code, i64 %action) {
+  ret void
+}
@@ -0,0 +1,63 @@
+; RUN: opt < %s -load=%llvmshlibdir/LLVMSnaxApply%shlibext -apply_fixup -S | FileCheck %s
+; REQUIRES: loadable_module
+
+; Test that an entry point with several returns gets a single epilogue that
+; calls __cxa_finalize, and that other functions are left alone.
+
+; CHECK-LABEL: define i32 @apply(
+; CHECK:       entry:
+; CHECK-NEXT:    call void @__wasm_call_ctors()
+; CHECK:       early:
+; CHECK-NEXT:    br label %epilogue
+; CHECK:       zero:
+; CHECK-NEXT:    br label %epilogue
+; CHECK:       other:
+; CHECK-NEXT:    br label %epilogue
+; CHECK:       epilogue:
+; CHECK-NEXT:    %retval = phi i32 [ 1, %early ], [ 2, %zero ], [ 3, %other ]
+; CHECK-NEXT:    call void @__cxa_finalize(i32 0)
+; CHECK-NEXT:    ret i32 %retval
+; CHECK-NOT:   ret
+; CHECK:       }
+define i32 @apply(i64 %receiver, i64 %code, i64 %action) {
+entry:
+  %c = icmp eq i64 %code, 0
+  br i1 %c, label %early, label %late
+early:
+  ret i32 1
+late:
+  %d = icmp eq i64 %action, 0
+  br i1 %d, label %zero, label %other
+zero:
+  ret i32 2
+other:
+  ret i32 3
+}
+
+; Functions marked as entry points get the same treatment.
+
+; CHECK-LABEL: define void @entry_attr()
+; CHECK-NEXT:    call void @__wasm_call_ctors()
+; CHECK-NEXT:    call void @__cxa_finalize(i32 0)
+; CHECK-NEXT:    ret void
+define void @entry_attr() #0 {
+  ret void
+}
+
+; CHECK-LABEL: define i32 @not_entry(
+; CHECK-NOT:     call
+; CHECK:         ret i32 0
+; CHECK-NOT:     call
+; CHECK:         ret i32 1
+; CHECK-NOT:     call
+; CHECK:       }
+define i32 @not_entry(i32 %x) {
+  %c = icmp eq i32 %x, 0
+  br i1 %c, label %a, label %b
+a:
+  ret i32 0
+b:
+  ret i32 1
+}
+
+attributes #0 = { "snax_wasm_entry" }
@@ -0,0 +1,120 @@
+; RUN: opt < %s -load=%llvmshlibdir/LLVMSnaxSoftfloat%shlibext -softfloat_fixup -snax-softfloat-inline -S | FileCheck %s
+; RUN: opt < %s -load=%llvmshlibdir/LLVMSnaxSoftfloat%shlibext -softfloat_fixup -S | FileCheck --check-prefix=NOINLINE %s
+; REQUIRES: loadable_module
+
+; Test that -snax-softfloat-inline routes arithmetic through a wrapper with an
+; integer-only fast path, which sends zero, subnormal, infinite and NaN
+; operands and results that aren't normal to the softfloat intrinsic.
+
+define float @add(float %a, float %b) {
+; CHECK-LABEL: @add(
+; CHECK-NEXT:    [[TMP1:%.*]] = call float @___snax_f32_add_fast(float [[A:%.*]], float [[B:%.*]])
+; CHECK-NEXT:    ret float [[TMP1]]
+;
+; NOINLINE-LABEL: @add(
+; NOINLINE-NEXT:    [[TMP1:%.*]] = call float @_snax_f32_add(float [[A:%.*]], float [[B:%.*]])
+; NOINLINE-NEXT:    ret float [[TMP1]]
+;
+  %r = fadd float %a, %b
+  ret float %r
+}
+
+define double @sub(double %a, double %b) {
+; CHECK-LABEL: @sub(
+; CHECK-NEXT:    [[TMP1:%.*]] = call double @___snax_f64_sub_fast(double [[A:%.*]], double [[B:%.*]])
+; CHECK-NEXT:    ret double [[TMP1]]
+;
+; NOINLINE-LABEL: @sub(
+; NOINLINE-NEXT:    [[TMP1:%.*]] = call double @_snax_f64_sub(double [[A:%.*]], double [[B:%.*]])
+; NOINLINE-NEXT:    ret double [[TMP1]]
+;
+  %r = fsub double %a, %b
+  ret double %r
+}
+
+define float @mul(float %a, float %b) {
+; CHECK-LABEL: @mul(
+; CHECK-NEXT:    [[TMP1:%.*]] = call float @___snax_f32_mul_fast(float [[A:%.*]], float [[B:%.*]])
+; CHECK-NEXT:    ret float [[TMP1]]
+;
+; NOINLINE-LABEL: @mul(
+; NOINLINE-NEXT:    [[TMP1:%.*]] = call float @_snax_f32_mul(float [[A:%.*]], float [[B:%.*]])
+; NOINLINE-NEXT:    ret float [[TMP1]]
+;
+  %r = fmul float %a, %b
+  ret float %r
+}
+
+define double @div(double %a, double %b) {
+; CHECK-LABEL: @div(
+; CHECK-NEXT:    [[TMP1:%.*]] = call double @___snax_f64_div_fast(double [[A:%.*]], double [[B:%.*]])
+; CHECK-NEXT:    ret double [[TMP1]]
+;
+; NOINLINE-LABEL: @div(
+; NOINLINE-NEXT:    [[TMP1:%.*]] = call double @_snax_f64_div(double [[A:%.*]], double [[B:%.*]])
+; NOINLINE-NEXT:    ret double [[TMP1]]
+;
+  %r = fdiv double %a, %b
+  ret double %r
+}
+
+define float @rem(float %a, float %b) {
+; CHECK-LABEL: @rem(
+; CHECK-NEXT:    [[TMP1:%.*]] = call float @_snax_f32_rem(float [[A:%.*]], float [[B:%.*]])
+; CHECK-NEXT:    ret float [[TMP1]]
+;
+; NOINLINE-LABEL: @rem(
+; NOINLINE-NEXT:    [[TMP1:%.*]] = call float @_snax_f32_rem(float [[A:%.*]], float [[B:%.*]])
+; NOINLINE-NEXT:    ret float [[TMP1]]
+;
+  %r = frem float %a, %b
+  ret float %r
+}
+
+define float @add_again(float %a, float %b) {
+; CHECK-LABEL: @add_again(
+; CHECK-NEXT:    [[TMP1:%.*]] = call float @___snax_f32_add_fast(float [[A:%.*]], float [[B:%.*]])
+; CHECK-NEXT:    ret float [[TMP1]]
+;
+; NOINLINE-LABEL: @add_again(
+; NOINLINE-NEXT:    [[TMP1:%.*]] = call float @_snax_f32_add(float [[A:%.*]], float [[B:%.*]])
+; NOINLINE-NEXT:    ret float [[TMP1]]
+;
+  %r = fadd float %a, %b
+  ret float %r
+}
+
+; Each wrapper is emitted once, and falls back to the intrinsic when an
+; operand's exponent is all zeros or all ones, or when the result isn't a
+; normal number.
+
+; CHECK-LABEL: define internal float @___snax_f32_add_fast(float, float)
+; CHECK:       entry:
+; CHECK:         icmp eq i32 {{%.*}}, 255
+; CHECK:         icmp eq i32 {{%.*}}, 0
+; CHECK:         br i1 {{%.*}}, label %slow, label %fast
+; CHECK:       fast:
+; CHECK-NOT:     call float @_snax_f32_add
+; CHECK:         br i1 {{%.*}}, label %done, label %slow
+; CHECK:       done:
+; CHECK:         ret float
+; CHECK:       slow:
+; CHECK-NEXT:    [[R:%.*]] = call float @_snax_f32_add(float %0, float %1)
+; CHECK-NEXT:    ret float [[R]]
+
+; CHECK-LABEL: define internal double @___snax_f64_sub_fast(double, double)
+; CHECK:         icmp eq i64 {{%.*}}, 2047
+; CHECK:       slow:
+; CHECK-NEXT:    call double @_snax_f64_sub(double %0, double %1)
+
+; CHECK-LABEL: define internal float @___snax_f32_mul_fast(float, float)
+; CHECK:       slow:
+; CHECK-NEXT:    call float @_snax_f32_mul(float %0, float %1)
+
+; CHECK-LABEL: define internal double @___snax_f64_div_fast(double, double)
+; CHECK:       slow:
+; CHECK-NEXT:    call double @_snax_f64_div(double %0, double %1)
+
+; CHECK-NOT:   define internal {{.*}}_fast
+
+; NOINLINE-NOT: _fast
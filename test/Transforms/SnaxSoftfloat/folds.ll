@@ -0,0 +1,324 @@
+; RUN: opt < %s -load=%llvmshlibdir/LLVMSnaxSoftfloat%shlibext -softfloat_fixup -snax-softfloat-inline -S | FileCheck %s
+; REQUIRES: loadable_module
+
+; Test the folds done before lowering. They must give the same bits as the
+; softfloat operation they replace.
+
+; Adding -0.0 is the identity, even for -0.0 and NaNs.
+define float @fadd_negzero(float %a) {
+; CHECK-LABEL: @fadd_negzero(
+; CHECK-NEXT:    ret float [[A:%.*]]
+;
+  %r = fadd float %a, -0.0
+  ret float %r
+}
+
+define float @fadd_negzero_lhs(float %a) {
+; CHECK-LABEL: @fadd_negzero_lhs(
+; CHECK-NEXT:    ret float [[A:%.*]]
+;
+  %r = fadd float -0.0, %a
+  ret float %r
+}
+
+; Adding +0.0 turns -0.0 into +0.0, so it's kept.
+define float @fadd_poszero(float %a) {
+; CHECK-LABEL: @fadd_poszero(
+; CHECK-NEXT:    [[TMP1:%.*]] = call float @___snax_f32_add_fast(float [[A:%.*]], float 0.000000e+00)
+; CHECK-NEXT:    ret float [[TMP1]]
+;
+  %r = fadd float %a, 0.0
+  ret float %r
+}
+
+define double @fsub_poszero(double %a) {
+; CHECK-LABEL: @fsub_poszero(
+; CHECK-NEXT:    ret double [[A:%.*]]
+;
+  %r = fsub double %a, 0.0
+  ret double %r
+}
+
+; Subtracting -0.0 turns -0.0 into +0.0, so it's kept.
+define double @fsub_negzero(double %a) {
+; CHECK-LABEL: @fsub_negzero(
+; CHECK-NEXT:    [[TMP1:%.*]] = call double @___snax_f64_sub_fast(double [[A:%.*]], double -0.000000e+00)
+; CHECK-NEXT:    ret double [[TMP1]]
+;
+  %r = fsub double %a, -0.0
+  ret double %r
+}
+
+; -0.0 - x is a negation, which flips the sign of NaNs too.
+define double @fsub_neg(double %a) {
+; CHECK-LABEL: @fsub_neg(
+; CHECK-NEXT:    [[TMP1:%.*]] = bitcast double [[A:%.*]] to i64
+; CHECK-NEXT:    [[TMP2:%.*]] = xor i64 [[TMP1]], -9223372036854775808
+; CHECK-NEXT:    [[TMP3:%.*]] = bitcast i64 [[TMP2]] to double
+; CHECK-NEXT:    ret double [[TMP3]]
+;
+  %r = fsub double -0.0, %a
+  ret double %r
+}
+
+; 0.0 - x gives +0.0 for x = +0.0, so it isn't a negation.
+define double @fsub_poszero_lhs(double %a) {
+; CHECK-LABEL: @fsub_poszero_lhs(
+; CHECK-NEXT:    [[TMP1:%.*]] = call double @___snax_f64_sub_fast(double 0.000000e+00, double [[A:%.*]])
+; CHECK-NEXT:    ret double [[TMP1]]
+;
+  %r = fsub double 0.0, %a
+  ret double %r
+}
+
+define float @fmul_one(float %a) {
+; CHECK-LABEL: @fmul_one(
+; CHECK-NEXT:    ret float [[A:%.*]]
+;
+  %r = fmul float 1.0, %a
+  ret float %r
+}
+
+define float @fmul_minus_one(float %a) {
+; CHECK-LABEL: @fmul_minus_one(
+; CHECK-NEXT:    [[TMP1:%.*]] = bitcast float [[A:%.*]] to i32
+; CHECK-NEXT:    [[TMP2:%.*]] = xor i32 [[TMP1]], -2147483648
+; CHECK-NEXT:    [[TMP3:%.*]] = bitcast i32 [[TMP2]] to float
+; CHECK-NEXT:    ret float [[TMP3]]
+;
+  %r = fmul float %a, -1.0
+  ret float %r
+}
+
+; x * 0.0 depends on the sign of x and is NaN for infinities.
+define float @fmul_zero(float %a) {
+; CHECK-LABEL: @fmul_zero(
+; CHECK-NEXT:    [[TMP1:%.*]] = call float @___snax_f32_mul_fast(float [[A:%.*]], float 0.000000e+00)
+; CHECK-NEXT:    ret float [[TMP1]]
+;
+  %r = fmul float %a, 0.0
+  ret float %r
+}
+
+define double @fdiv_one(double %a) {
+; CHECK-LABEL: @fdiv_one(
+; CHECK-NEXT:    ret double [[A:%.*]]
+;
+  %r = fdiv double %a, 1.0
+  ret double %r
+}
+
+define double @fdiv_minus_one(double %a) {
+; CHECK-LABEL: @fdiv_minus_one(
+; CHECK-NEXT:    [[TMP1:%.*]] = bitcast double [[A:%.*]] to i64
+; CHECK-NEXT:    [[TMP2:%.*]] = xor i64 [[TMP1]], -9223372036854775808
+; CHECK-NEXT:    [[TMP3:%.*]] = bitcast i64 [[TMP2]] to double
+; CHECK-NEXT:    ret double [[TMP3]]
+;
+  %r = fdiv double %a, -1.0
+  ret double %r
+}
+
+define float @fdiv_pow2(float %a) {
+; CHECK-LABEL: @fdiv_pow2(
+; CHECK-NEXT:    [[TMP1:%.*]] = call float @___snax_f32_mul_fast(float [[A:%.*]], float 2.500000e-01)
+; CHECK-NEXT:    ret float [[TMP1]]
+;
+  %r = fdiv float %a, 4.0
+  ret float %r
+}
+
+; 2^-126 is the smallest normal float; its inverse is 2^126.
+define float @fdiv_min_normal(float %a) {
+; CHECK-LABEL: @fdiv_min_normal(
+; CHECK-NEXT:    [[TMP1:%.*]] = call float @___snax_f32_mul_fast(float [[A:%.*]], float 0x47D0000000000000)
+; CHECK-NEXT:    ret float [[TMP1]]
+;
+  %r = fdiv float %a, 0x3810000000000000
+  ret float %r
+}
+
+; The inverse of 2^127 is subnormal, and the inverse of a subnormal isn't
+; representable, so neither division is turned into a multiply.
+define float @fdiv_inverse_subnormal(float %a) {
+; CHECK-LABEL: @fdiv_inverse_subnormal(
+; CHECK-NEXT:    [[TMP1:%.*]] = call float @___snax_f32_div_fast(float [[A:%.*]], float 0x47E0000000000000)
+; CHECK-NEXT:    ret float [[TMP1]]
+;
+  %r = fdiv float %a, 0x47E0000000000000
+  ret float %r
+}
+
+define float @fdiv_subnormal(float %a) {
+; CHECK-LABEL: @fdiv_subnormal(
+; CHECK-NEXT:    [[TMP1:%.*]] = call float @___snax_f32_div_fast(float [[A:%.*]], float 0x36A0000000000000)
+; CHECK-NEXT:    ret float [[TMP1]]
+;
+  %r = fdiv float %a, 0x36A0000000000000
+  ret float %r
+}
+
+define float @fdiv_not_pow2(float %a) {
+; CHECK-LABEL: @fdiv_not_pow2(
+; CHECK-NEXT:    [[TMP1:%.*]] = call float @___snax_f32_div_fast(float [[A:%.*]], float 3.000000e+00)
+; CHECK-NEXT:    ret float [[TMP1]]
+;
+  %r = fdiv float %a, 3.0
+  ret float %r
+}
+
+; Constant operations are evaluated with round-to-nearest-even.
+define float @const_tie_to_even() {
+; CHECK-LABEL: @const_tie_to_even(
+; CHECK-NEXT:    ret float 1.000000e+00
+;
+  %r = fadd float 1.0, 0x3E70000000000000
+  ret float %r
+}
+
+define float @const_round_up() {
+; CHECK-LABEL: @const_round_up(
+; CHECK-NEXT:    ret float 0x3FF0000020000000
+;
+  %r = fadd float 1.0, 0x3E70000020000000
+  ret float %r
+}
+
+define float @const_subnormal() {
+; CHECK-LABEL: @const_subnormal(
+; CHECK-NEXT:    ret float 0x3800000000000000
+;
+  %r = fmul float 0x3810000000000000, 0.5
+  ret float %r
+}
+
+define double @const_nan() {
+; CHECK-LABEL: @const_nan(
+; CHECK-NEXT:    ret double 0x7FF8000000000000
+;
+  %r = fmul double 0x7FF8000000000000, 2.0
+  ret double %r
+}
+
+define double @const_negzero() {
+; CHECK-LABEL: @const_negzero(
+; CHECK-NEXT:    ret double -0.000000e+00
+;
+  %r = fadd double -0.0, -0.0
+  ret double %r
+}
+
+; Chains are only reassociated when the instructions allow it.
+define float @reassoc_chain(float %a) {
+; CHECK-LABEL: @reassoc_chain(
+; CHECK-NEXT:    [[TMP1:%.*]] = call float @___snax_f32_add_fast(float [[A:%.*]], float 3.000000e+00)
+; CHECK-NEXT:    ret float [[TMP1]]
+;
+  %t = fadd reassoc float %a, 1.0
+  %r = fadd reassoc float %t, 2.0
+  ret float %r
+}
+
+define float @no_reassoc_chain(float %a) {
+; CHECK-LABEL: @no_reassoc_chain(
+; CHECK-NEXT:    [[TMP1:%.*]] = call float @___snax_f32_add_fast(float [[A:%.*]], float 1.000000e+00)
+; CHECK-NEXT:    [[TMP2:%.*]] = call float @___snax_f32_add_fast(float [[TMP1]], float 2.000000e+00)
+; CHECK-NEXT:    ret float [[TMP2]]
+;
+  %t = fadd float %a, 1.0
+  %r = fadd float %t, 2.0
+  ret float %r
+}
+
+define double @mul_acc(double %x, double %y, double %z) {
+; CHECK-LABEL: @mul_acc(
+; CHECK-NEXT:    [[TMP1:%.*]] = call double @___snax_f64_add_fast(double [[Y:%.*]], double [[Z:%.*]])
+; CHECK-NEXT:    [[TMP2:%.*]] = call double @___snax_f64_mul_fast(double [[X:%.*]], double [[TMP1]])
+; CHECK-NEXT:    ret double [[TMP2]]
+;
+  %xy = fmul reassoc double %x, %y
+  %xz = fmul reassoc double %z, %x
+  %r = fadd reassoc double %xy, %xz
+  ret double %r
+}
+
+; Conversion round trips that are exact are folded away.
+define float @trunc_ext(float %a) {
+; CHECK-LABEL: @trunc_ext(
+; CHECK-NEXT:    [[TMP1:%.*]] = call double @_snax_f32_promote(float [[A:%.*]])
+; CHECK-NEXT:    ret float [[A]]
+;
+  %e = fpext float %a to double
+  %r = fptrunc double %e to float
+  ret float %r
+}
+
+; The other way round loses precision.
+define double @ext_trunc(double %a) {
+; CHECK-LABEL: @ext_trunc(
+; CHECK-NEXT:    [[TMP1:%.*]] = call float @_snax_f64_demote(double [[A:%.*]])
+; CHECK-NEXT:    [[TMP2:%.*]] = call double @_snax_f32_promote(float [[TMP1]])
+; CHECK-NEXT:    ret double [[TMP2]]
+;
+  %t = fptrunc double %a to float
+  %r = fpext float %t to double
+  ret double %r
+}
+
+define i16 @int_round_trip(i16 %a) {
+; CHECK-LABEL: @int_round_trip(
+; CHECK-NEXT:    [[TMP1:%.*]] = sext i16 [[A:%.*]] to i32
+; CHECK-NEXT:    [[TMP2:%.*]] = call float @_snax_i32_to_f32(i32 [[TMP1]])
+; CHECK-NEXT:    ret i16 [[A]]
+;
+  %f = sitofp i16 %a to float
+  %r = fptosi float %f to i16
+  ret i16 %r
+}
+
+define i32 @uint_round_trip_f64(i32 %a) {
+; CHECK-LABEL: @uint_round_trip_f64(
+; CHECK-NEXT:    [[TMP1:%.*]] = call double @_snax_ui32_to_f64(i32 [[A:%.*]])
+; CHECK-NEXT:    ret i32 [[A]]
+;
+  %f = uitofp i32 %a to double
+  %r = fptoui double %f to i32
+  ret i32 %r
+}
+
+; A float can't hold every i32.
+define i32 @int_round_trip_inexact(i32 %a) {
+; CHECK-LABEL: @int_round_trip_inexact(
+; CHECK-NEXT:    [[TMP1:%.*]] = call float @_snax_i32_to_f32(i32 [[A:%.*]])
+; CHECK-NEXT:    [[TMP2:%.*]] = call i32 @_snax_f32_trunc_i32s(float [[TMP1]])
+; CHECK-NEXT:    ret i32 [[TMP2]]
+;
+  %f = sitofp i32 %a to float
+  %r = fptosi float %f to i32
+  ret i32 %r
+}
+
+define i32 @mixed_round_trip(i32 %a) {
+; CHECK-LABEL: @mixed_round_trip(
+; CHECK-NEXT:    [[TMP1:%.*]] = call double @_snax_ui32_to_f64(i32 [[A:%.*]])
+; CHECK-NEXT:    [[TMP2:%.*]] = call i32 @_snax_f64_trunc_i32s(double [[TMP1]])
+; CHECK-NEXT:    ret i32 [[TMP2]]
+;
+  %f = uitofp i32 %a to double
+  %r = fptosi double %f to i32
+  ret i32 %r
+}
+
+define i1 @fcmp_ext(float %a, float %b) {
+; CHECK-LABEL: @fcmp_ext(
+; CHECK-NEXT:    [[TMP1:%.*]] = call double @_snax_f32_promote(float [[A:%.*]])
+; CHECK-NEXT:    [[TMP2:%.*]] = call double @_snax_f32_promote(float [[B:%.*]])
+; CHECK-NEXT:    [[TMP3:%.*]] = call i32 @_snax_f32_lt(float [[A]], float [[B]])
+; CHECK-NEXT:    [[TMP4:%.*]] = icmp ne i32 [[TMP3]], 0
+; CHECK-NEXT:    ret i1 [[TMP4]]
+;
+  %ea = fpext float %a to double
+  %eb = fpext float %b to double
+  %r = fcmp olt double %ea, %eb
+  ret i1 %r
+}
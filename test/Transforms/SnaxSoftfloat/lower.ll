@@ -0,0 +1,409 @@
+; RUN: opt < %s -load=%llvmshlibdir/LLVMSnaxSoftfloat%shlibext -softfloat_fixup -S | FileCheck %s
+; REQUIRES: loadable_module
+
+; Test that each FP operation is lowered as its lowering table says.
+
+define float @fadd(float %a, float %b) {
+; CHECK-LABEL: @fadd(
+; CHECK-NEXT:    [[TMP1:%.*]] = call float @_snax_f32_add(float [[A:%.*]], float [[B:%.*]])
+; CHECK-NEXT:    ret float [[TMP1]]
+;
+  %r = fadd float %a, %b
+  ret float %r
+}
+
+define double @fsub(double %a, double %b) {
+; CHECK-LABEL: @fsub(
+; CHECK-NEXT:    [[TMP1:%.*]] = call double @_snax_f64_sub(double [[A:%.*]], double [[B:%.*]])
+; CHECK-NEXT:    ret double [[TMP1]]
+;
+  %r = fsub double %a, %b
+  ret double %r
+}
+
+define float @fmul(float %a, float %b) {
+; CHECK-LABEL: @fmul(
+; CHECK-NEXT:    [[TMP1:%.*]] = call float @_snax_f32_mul(float [[A:%.*]], float [[B:%.*]])
+; CHECK-NEXT:    ret float [[TMP1]]
+;
+  %r = fmul float %a, %b
+  ret float %r
+}
+
+define double @fdiv(double %a, double %b) {
+; CHECK-LABEL: @fdiv(
+; CHECK-NEXT:    [[TMP1:%.*]] = call double @_snax_f64_div(double [[A:%.*]], double [[B:%.*]])
+; CHECK-NEXT:    ret double [[TMP1]]
+;
+  %r = fdiv double %a, %b
+  ret double %r
+}
+
+define float @frem(float %a, float %b) {
+; CHECK-LABEL: @frem(
+; CHECK-NEXT:    [[TMP1:%.*]] = call float @_snax_f32_rem(float [[A:%.*]], float [[B:%.*]])
+; CHECK-NEXT:    ret float [[TMP1]]
+;
+  %r = frem float %a, %b
+  ret float %r
+}
+
+define i1 @fcmp_oeq(float %a, float %b) {
+; CHECK-LABEL: @fcmp_oeq(
+; CHECK-NEXT:    [[TMP1:%.*]] = call i32 @_snax_f32_eq(float [[A:%.*]], float [[B:%.*]])
+; CHECK-NEXT:    [[TMP2:%.*]] = icmp ne i32 [[TMP1]], 0
+; CHECK-NEXT:    ret i1 [[TMP2]]
+;
+  %r = fcmp oeq float %a, %b
+  ret i1 %r
+}
+
+define i1 @fcmp_ogt(float %a, float %b) {
+; CHECK-LABEL: @fcmp_ogt(
+; CHECK-NEXT:    [[TMP1:%.*]] = call i32 @_snax_f32_gt(float [[A:%.*]], float [[B:%.*]])
+; CHECK-NEXT:    [[TMP2:%.*]] = icmp ne i32 [[TMP1]], 0
+; CHECK-NEXT:    ret i1 [[TMP2]]
+;
+  %r = fcmp ogt float %a, %b
+  ret i1 %r
+}
+
+define i1 @fcmp_oge(float %a, float %b) {
+; CHECK-LABEL: @fcmp_oge(
+; CHECK-NEXT:    [[TMP1:%.*]] = call i32 @_snax_f32_ge(float [[A:%.*]], float [[B:%.*]])
+; CHECK-NEXT:    [[TMP2:%.*]] = icmp ne i32 [[TMP1]], 0
+; CHECK-NEXT:    ret i1 [[TMP2]]
+;
+  %r = fcmp oge float %a, %b
+  ret i1 %r
+}
+
+define i1 @fcmp_olt(double %a, double %b) {
+; CHECK-LABEL: @fcmp_olt(
+; CHECK-NEXT:    [[TMP1:%.*]] = call i32 @_snax_f64_lt(double [[A:%.*]], double [[B:%.*]])
+; CHECK-NEXT:    [[TMP2:%.*]] = icmp ne i32 [[TMP1]], 0
+; CHECK-NEXT:    ret i1 [[TMP2]]
+;
+  %r = fcmp olt double %a, %b
+  ret i1 %r
+}
+
+define i1 @fcmp_ole(double %a, double %b) {
+; CHECK-LABEL: @fcmp_ole(
+; CHECK-NEXT:    [[TMP1:%.*]] = call i32 @_snax_f64_le(double [[A:%.*]], double [[B:%.*]])
+; CHECK-NEXT:    [[TMP2:%.*]] = icmp ne i32 [[TMP1]], 0
+; CHECK-NEXT:    ret i1 [[TMP2]]
+;
+  %r = fcmp ole double %a, %b
+  ret i1 %r
+}
+
+define i1 @fcmp_one(double %a, double %b) {
+; CHECK-LABEL: @fcmp_one(
+; CHECK-NEXT:    [[TMP1:%.*]] = call i32 @_snax_f64_lt(double [[A:%.*]], double [[B:%.*]])
+; CHECK-NEXT:    [[TMP2:%.*]] = icmp ne i32 [[TMP1]], 0
+; CHECK-NEXT:    [[TMP3:%.*]] = call i32 @_snax_f64_gt(double [[A]], double [[B]])
+; CHECK-NEXT:    [[TMP4:%.*]] = icmp ne i32 [[TMP3]], 0
+; CHECK-NEXT:    [[TMP5:%.*]] = or i1 [[TMP2]], [[TMP4]]
+; CHECK-NEXT:    ret i1 [[TMP5]]
+;
+  %r = fcmp one double %a, %b
+  ret i1 %r
+}
+
+define i1 @fcmp_ueq(float %a, float %b) {
+; CHECK-LABEL: @fcmp_ueq(
+; CHECK-NEXT:    [[TMP1:%.*]] = call i32 @_snax_f32_lt(float [[A:%.*]], float [[B:%.*]])
+; CHECK-NEXT:    [[TMP2:%.*]] = icmp ne i32 [[TMP1]], 0
+; CHECK-NEXT:    [[TMP3:%.*]] = call i32 @_snax_f32_gt(float [[A]], float [[B]])
+; CHECK-NEXT:    [[TMP4:%.*]] = icmp ne i32 [[TMP3]], 0
+; CHECK-NEXT:    [[TMP5:%.*]] = or i1 [[TMP2]], [[TMP4]]
+; CHECK-NEXT:    [[TMP6:%.*]] = xor i1 [[TMP5]], true
+; CHECK-NEXT:    ret i1 [[TMP6]]
+;
+  %r = fcmp ueq float %a, %b
+  ret i1 %r
+}
+
+define i1 @fcmp_ugt(float %a, float %b) {
+; CHECK-LABEL: @fcmp_ugt(
+; CHECK-NEXT:    [[TMP1:%.*]] = call i32 @_snax_f32_le(float [[A:%.*]], float [[B:%.*]])
+; CHECK-NEXT:    [[TMP2:%.*]] = icmp ne i32 [[TMP1]], 0
+; CHECK-NEXT:    [[TMP3:%.*]] = xor i1 [[TMP2]], true
+; CHECK-NEXT:    ret i1 [[TMP3]]
+;
+  %r = fcmp ugt float %a, %b
+  ret i1 %r
+}
+
+define i1 @fcmp_uge(float %a, float %b) {
+; CHECK-LABEL: @fcmp_uge(
+; CHECK-NEXT:    [[TMP1:%.*]] = call i32 @_snax_f32_lt(float [[A:%.*]], float [[B:%.*]])
+; CHECK-NEXT:    [[TMP2:%.*]] = icmp ne i32 [[TMP1]], 0
+; CHECK-NEXT:    [[TMP3:%.*]] = xor i1 [[TMP2]], true
+; CHECK-NEXT:    ret i1 [[TMP3]]
+;
+  %r = fcmp uge float %a, %b
+  ret i1 %r
+}
+
+define i1 @fcmp_ult(float %a, float %b) {
+; CHECK-LABEL: @fcmp_ult(
+; CHECK-NEXT:    [[TMP1:%.*]] = call i32 @_snax_f32_ge(float [[A:%.*]], float [[B:%.*]])
+; CHECK-NEXT:    [[TMP2:%.*]] = icmp ne i32 [[TMP1]], 0
+; CHECK-NEXT:    [[TMP3:%.*]] = xor i1 [[TMP2]], true
+; CHECK-NEXT:    ret i1 [[TMP3]]
+;
+  %r = fcmp ult float %a, %b
+  ret i1 %r
+}
+
+define i1 @fcmp_ule(float %a, float %b) {
+; CHECK-LABEL: @fcmp_ule(
+; CHECK-NEXT:    [[TMP1:%.*]] = call i32 @_snax_f32_gt(float [[A:%.*]], float [[B:%.*]])
+; CHECK-NEXT:    [[TMP2:%.*]] = icmp ne i32 [[TMP1]], 0
+; CHECK-NEXT:    [[TMP3:%.*]] = xor i1 [[TMP2]], true
+; CHECK-NEXT:    ret i1 [[TMP3]]
+;
+  %r = fcmp ule float %a, %b
+  ret i1 %r
+}
+
+define i1 @fcmp_une(float %a, float %b) {
+; CHECK-LABEL: @fcmp_une(
+; CHECK-NEXT:    [[TMP1:%.*]] = call i32 @_snax_f32_ne(float [[A:%.*]], float [[B:%.*]])
+; CHECK-NEXT:    [[TMP2:%.*]] = icmp ne i32 [[TMP1]], 0
+; CHECK-NEXT:    ret i1 [[TMP2]]
+;
+  %r = fcmp une float %a, %b
+  ret i1 %r
+}
+
+define i1 @fcmp_uno(float %a, float %b) {
+; CHECK-LABEL: @fcmp_uno(
+; CHECK-NEXT:    [[TMP1:%.*]] = bitcast float [[B:%.*]] to i32
+; CHECK-NEXT:    [[TMP2:%.*]] = and i32 [[TMP1]], 2147483647
+; CHECK-NEXT:    [[TMP3:%.*]] = icmp ugt i32 [[TMP2]], 2139095040
+; CHECK-NEXT:    [[TMP4:%.*]] = bitcast float [[A:%.*]] to i32
+; CHECK-NEXT:    [[TMP5:%.*]] = and i32 [[TMP4]], 2147483647
+; CHECK-NEXT:    [[TMP6:%.*]] = icmp ugt i32 [[TMP5]], 2139095040
+; CHECK-NEXT:    [[TMP7:%.*]] = or i1 [[TMP6]], [[TMP3]]
+; CHECK-NEXT:    ret i1 [[TMP7]]
+;
+  %r = fcmp uno float %a, %b
+  ret i1 %r
+}
+
+define i1 @fcmp_ord(double %a, double %b) {
+; CHECK-LABEL: @fcmp_ord(
+; CHECK-NEXT:    [[TMP1:%.*]] = bitcast double [[B:%.*]] to i64
+; CHECK-NEXT:    [[TMP2:%.*]] = and i64 [[TMP1]], 9223372036854775807
+; CHECK-NEXT:    [[TMP3:%.*]] = icmp ugt i64 [[TMP2]], 9218868437227405312
+; CHECK-NEXT:    [[TMP4:%.*]] = bitcast double [[A:%.*]] to i64
+; CHECK-NEXT:    [[TMP5:%.*]] = and i64 [[TMP4]], 9223372036854775807
+; CHECK-NEXT:    [[TMP6:%.*]] = icmp ugt i64 [[TMP5]], 9218868437227405312
+; CHECK-NEXT:    [[TMP7:%.*]] = or i1 [[TMP6]], [[TMP3]]
+; CHECK-NEXT:    [[TMP8:%.*]] = xor i1 [[TMP7]], true
+; CHECK-NEXT:    ret i1 [[TMP8]]
+;
+  %r = fcmp ord double %a, %b
+  ret i1 %r
+}
+
+define i1 @fcmp_true(float %a, float %b) {
+; CHECK-LABEL: @fcmp_true(
+; CHECK-NEXT:    ret i1 true
+;
+  %r = fcmp true float %a, %b
+  ret i1 %r
+}
+
+define i1 @fcmp_false(float %a, float %b) {
+; CHECK-LABEL: @fcmp_false(
+; CHECK-NEXT:    ret i1 false
+;
+  %r = fcmp false float %a, %b
+  ret i1 %r
+}
+
+define double @fpext(float %a) {
+; CHECK-LABEL: @fpext(
+; CHECK-NEXT:    [[TMP1:%.*]] = call double @_snax_f32_promote(float [[A:%.*]])
+; CHECK-NEXT:    ret double [[TMP1]]
+;
+  %r = fpext float %a to double
+  ret double %r
+}
+
+define float @fptrunc(double %a) {
+; CHECK-LABEL: @fptrunc(
+; CHECK-NEXT:    [[TMP1:%.*]] = call float @_snax_f64_demote(double [[A:%.*]])
+; CHECK-NEXT:    ret float [[TMP1]]
+;
+  %r = fptrunc double %a to float
+  ret float %r
+}
+
+define i32 @fptosi_i32(float %a) {
+; CHECK-LABEL: @fptosi_i32(
+; CHECK-NEXT:    [[TMP1:%.*]] = call i32 @_snax_f32_trunc_i32s(float [[A:%.*]])
+; CHECK-NEXT:    ret i32 [[TMP1]]
+;
+  %r = fptosi float %a to i32
+  ret i32 %r
+}
+
+define i64 @fptoui_i64(double %a) {
+; CHECK-LABEL: @fptoui_i64(
+; CHECK-NEXT:    [[TMP1:%.*]] = call i64 @_snax_f64_trunc_i64u(double [[A:%.*]])
+; CHECK-NEXT:    ret i64 [[TMP1]]
+;
+  %r = fptoui double %a to i64
+  ret i64 %r
+}
+
+define i8 @fptosi_i8(double %a) {
+; CHECK-LABEL: @fptosi_i8(
+; CHECK-NEXT:    [[TMP1:%.*]] = call i32 @_snax_f64_trunc_i32s(double [[A:%.*]])
+; CHECK-NEXT:    [[TMP2:%.*]] = trunc i32 [[TMP1]] to i8
+; CHECK-NEXT:    ret i8 [[TMP2]]
+;
+  %r = fptosi double %a to i8
+  ret i8 %r
+}
+
+define float @sitofp_i16(i16 %a) {
+; CHECK-LABEL: @sitofp_i16(
+; CHECK-NEXT:    [[TMP1:%.*]] = sext i16 [[A:%.*]] to i32
+; CHECK-NEXT:    [[TMP2:%.*]] = call float @_snax_i32_to_f32(i32 [[TMP1]])
+; CHECK-NEXT:    ret float [[TMP2]]
+;
+  %r = sitofp i16 %a to float
+  ret float %r
+}
+
+define double @uitofp_i64(i64 %a) {
+; CHECK-LABEL: @uitofp_i64(
+; CHECK-NEXT:    [[TMP1:%.*]] = call double @_snax_ui64_to_f64(i64 [[A:%.*]])
+; CHECK-NEXT:    ret double [[TMP1]]
+;
+  %r = uitofp i64 %a to double
+  ret double %r
+}
+
+define double @uitofp_i32(i32 %a) {
+; CHECK-LABEL: @uitofp_i32(
+; CHECK-NEXT:    [[TMP1:%.*]] = call double @_snax_ui32_to_f64(i32 [[A:%.*]])
+; CHECK-NEXT:    ret double [[TMP1]]
+;
+  %r = uitofp i32 %a to double
+  ret double %r
+}
+
+declare float @llvm.sqrt.f32(float)
+declare double @llvm.floor.f64(double)
+declare float @llvm.ceil.f32(float)
+declare double @llvm.trunc.f64(double)
+declare float @llvm.nearbyint.f32(float)
+declare double @llvm.rint.f64(double)
+declare float @llvm.fabs.f32(float)
+declare double @llvm.copysign.f64(double, double)
+
+define float @sqrt(float %a) {
+; CHECK-LABEL: @sqrt(
+; CHECK-NEXT:    [[TMP1:%.*]] = call float @_snax_f32_sqrt(float [[A:%.*]])
+; CHECK-NEXT:    ret float [[TMP1]]
+;
+  %r = call float @llvm.sqrt.f32(float %a)
+  ret float %r
+}
+
+define double @floor(double %a) {
+; CHECK-LABEL: @floor(
+; CHECK-NEXT:    [[TMP1:%.*]] = call double @_snax_f64_floor(double [[A:%.*]])
+; CHECK-NEXT:    ret double [[TMP1]]
+;
+  %r = call double @llvm.floor.f64(double %a)
+  ret double %r
+}
+
+define float @ceil(float %a) {
+; CHECK-LABEL: @ceil(
+; CHECK-NEXT:    [[TMP1:%.*]] = call float @_snax_f32_ceil(float [[A:%.*]])
+; CHECK-NEXT:    ret float [[TMP1]]
+;
+  %r = call float @llvm.ceil.f32(float %a)
+  ret float %r
+}
+
+define double @trunc(double %a) {
+; CHECK-LABEL: @trunc(
+; CHECK-NEXT:    [[TMP1:%.*]] = call double @_snax_f64_trunc(double [[A:%.*]])
+; CHECK-NEXT:    ret double [[TMP1]]
+;
+  %r = call double @llvm.trunc.f64(double %a)
+  ret double %r
+}
+
+define float @nearbyint(float %a) {
+; CHECK-LABEL: @nearbyint(
+; CHECK-NEXT:    [[TMP1:%.*]] = call float @_snax_f32_nearest(float [[A:%.*]])
+; CHECK-NEXT:    ret float [[TMP1]]
+;
+  %r = call float @llvm.nearbyint.f32(float %a)
+  ret float %r
+}
+
+define double @rint(double %a) {
+; CHECK-LABEL: @rint(
+; CHECK-NEXT:    [[TMP1:%.*]] = call double @_snax_f64_nearest(double [[A:%.*]])
+; CHECK-NEXT:    ret double [[TMP1]]
+;
+  %r = call double @llvm.rint.f64(double %a)
+  ret double %r
+}
+
+define float @fabs(float %a) {
+; CHECK-LABEL: @fabs(
+; CHECK-NEXT:    [[TMP1:%.*]] = bitcast float [[A:%.*]] to i32
+; CHECK-NEXT:    [[TMP2:%.*]] = and i32 [[TMP1]], 2147483647
+; CHECK-NEXT:    [[TMP3:%.*]] = bitcast i32 [[TMP2]] to float
+; CHECK-NEXT:    ret float [[TMP3]]
+;
+  %r = call float @llvm.fabs.f32(float %a)
+  ret float %r
+}
+
+define double @copysign(double %a, double %b) {
+; CHECK-LABEL: @copysign(
+; CHECK-NEXT:    [[TMP1:%.*]] = bitcast double [[A:%.*]] to i64
+; CHECK-NEXT:    [[TMP2:%.*]] = and i64 [[TMP1]], 9223372036854775807
+; CHECK-NEXT:    [[TMP3:%.*]] = bitcast double [[B:%.*]] to i64
+; CHECK-NEXT:    [[TMP4:%.*]] = and i64 [[TMP3]], -9223372036854775808
+; CHECK-NEXT:    [[TMP5:%.*]] = or i64 [[TMP2]], [[TMP4]]
+; CHECK-NEXT:    [[TMP6:%.*]] = bitcast i64 [[TMP5]] to double
+; CHECK-NEXT:    ret double [[TMP6]]
+;
+  %r = call double @llvm.copysign.f64(double %a, double %b)
+  ret double %r
+}
+
+define void @fp80() {
+; CHECK-LABEL: @fp80(
+; CHECK-NEXT:    [[P:%.*]] = alloca fp128
+; CHECK-NEXT:    ret void
+;
+  %p = alloca x86_fp80
+  ret void
+}
+
+; Functions without FP operations are left alone.
+
+define i32 @integer_only(i32 %a, i32 %b) {
+; CHECK-LABEL: @integer_only(
+; CHECK-NEXT:    [[R:%.*]] = add i32 [[A:%.*]], [[B:%.*]]
+; CHECK-NEXT:    ret i32 [[R]]
+;
+  %r = add i32 %a, %b
+  ret i32 %r
+}
@@ -0,0 +1,37 @@
+; RUN: opt < %s -load-pass-plugin=%llvmshlibdir/LLVMSnaxSoftfloat%shlibext -passes=snax-softfloat -S | FileCheck %s
+; RUN: opt < %s -load-pass-plugin=%llvmshlibdir/LLVMSnaxSoftfloat%shlibext -passes='function(instcombine),snax-softfloat' -S | FileCheck %s
+; REQUIRES: loadable_module
+
+; Test the new pass manager port, registered through the pass plugin
+; interface, and that functions without FP operations are skipped.
+
+define float @fadd(float %a, float %b) {
+; CHECK-LABEL: @fadd(
+; CHECK-NEXT:    [[TMP1:%.*]] = call float @_snax_f32_add(float [[A:%.*]], float [[B:%.*]])
+; CHECK-NEXT:    ret float [[TMP1]]
+;
+  %r = fadd float %a, %b
+  ret float %r
+}
+
+define i1 @fcmp(double %a, double %b) {
+; CHECK-LABEL: @fcmp(
+; CHECK-NEXT:    [[TMP1:%.*]] = call i32 @_snax_f64_lt(double [[A:%.*]], double [[B:%.*]])
+; CHECK-NEXT:    [[TMP2:%.*]] = icmp ne i32 [[TMP1]], 0
+; CHECK-NEXT:    [[TMP3:%.*]] = call i32 @_snax_f64_gt(double [[A]], double [[B]])
+; CHECK-NEXT:    [[TMP4:%.*]] = icmp ne i32 [[TMP3]], 0
+; CHECK-NEXT:    [[TMP5:%.*]] = or i1 [[TMP2]], [[TMP4]]
+; CHECK-NEXT:    ret i1 [[TMP5]]
+;
+  %r = fcmp one double %a, %b
+  ret i1 %r
+}
+
+define i32 @integer_only(i32 %a, i32 %b) {
+; CHECK-LABEL: @integer_only(
+; CHECK-NEXT:    [[R:%.*]] = add i32 [[A:%.*]], [[B:%.*]]
+; CHECK-NEXT:    ret i32 [[R]]
+;
+  %r = add i32 %a, %b
+  ret i32 %r
+}
@@ -0,0 +1,34 @@
+; RUN: opt < %s -load=%llvmshlibdir/LLVMSnaxSoftfloat%shlibext -softfloat_fixup -snax-softfloat-inline -S | FileCheck %s
+; REQUIRES: loadable_module
+
+; Only float and double are lowered to softfloat calls, so the folds must
+; leave other FP types alone even when the function also has float and
+; double operations to fold.
+
+define fp128 @fp128_neg(float %a, fp128 %b, fp128* %p) {
+; CHECK-LABEL: @fp128_neg(
+; CHECK-NEXT:    [[N:%.*]] = fsub fp128 0xL00000000000000008000000000000000, [[B:%.*]]
+; CHECK-NEXT:    [[M:%.*]] = fmul fp128 [[B]], 0xL0000000000000000BFFF000000000000
+; CHECK-NEXT:    store fp128 [[M]], fp128* [[P:%.*]]
+; CHECK-NEXT:    ret fp128 [[N]]
+;
+  %f = fadd float %a, -0.0
+  %n = fsub fp128 0xL00000000000000008000000000000000, %b
+  %m = fmul fp128 %b, 0xL0000000000000000BFFF000000000000
+  store fp128 %m, fp128* %p
+  ret fp128 %n
+}
+
+define half @half_neg(double %a, half %b, half* %p) {
+; CHECK-LABEL: @half_neg(
+; CHECK-NEXT:    [[N:%.*]] = fsub half 0xH8000, [[B:%.*]]
+; CHECK-NEXT:    [[M:%.*]] = fdiv half [[B]], 0xHBC00
+; CHECK-NEXT:    store half [[M]], half* [[P:%.*]]
+; CHECK-NEXT:    ret half [[N]]
+;
+  %d = fmul double %a, 1.0
+  %n = fsub half 0xH8000, %b
+  %m = fdiv half %b, 0xHBC00
+  store half %m, half* %p
+  ret half %n
+}
@@ -15,6 +15,7 @@
 #include "llvm/Support/DynamicLibrary.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/ThreadPool.h"
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
@@ -31,6 +32,12 @@ enum class DumpKind {
   DumpModsToDisk
 };
 
+enum class SpeculateKind {
+  NoSpeculate,
+  SpeculateInPlace,
+  SpeculateInBackground
+};
+
 } // end anonymous namespace
 
 static cl::opt<DumpKind> OrcDumpKind(
@@ -51,6 +58,18 @@ static cl::opt<bool> OrcInlineStubs("orc-lazy-inline-stubs",
                                     cl::desc("Try to inline stubs"),
                                     cl::init(true), cl::Hidden);
 
+static cl::opt<SpeculateKind> OrcSpeculate(
+    "orc-lazy-speculate",
+    cl::desc("Speculatively compile the callees of compiled functions."),
+    cl::init(SpeculateKind::NoSpeculate),
+    cl::values(clEnumValN(SpeculateKind::NoSpeculate, "none",
+                          "Only compile functions when they're called."),
+               clEnumValN(SpeculateKind::SpeculateInPlace, "in-place",
+                          "Compile callees right after their caller."),
+               clEnumValN(SpeculateKind::SpeculateInBackground, "background",
+                          "Compile callees on a background thread.")),
+    cl::Hidden);
+
 OrcLazyJIT::TransformFtor OrcLazyJIT::createDebugDumper() {
   switch (OrcDumpKind) {
   case DumpKind::NoDump:
@@ -131,10 +150,29 @@ int llvm::runOrcLazyJIT(std::vector<std::unique_ptr<Module>> Ms,
     return 1;
   }
 
+  // The speculation thread has to outlive the JIT, which waits for it.
+  std::unique_ptr<ThreadPool> SpeculationThread;
+
   // Everything looks good. Build the JIT.
   OrcLazyJIT J(std::move(TM), std::move(IndirectStubsMgrBuilder),
                OrcInlineStubs);
 
+  switch (OrcSpeculate) {
+  case SpeculateKind::NoSpeculate:
+    break;
+  case SpeculateKind::SpeculateInBackground:
+#if LLVM_ENABLE_THREADS
+    SpeculationThread = llvm::make_unique<ThreadPool>(1);
+    J.setSpeculationDispatcher([&](std::function<void()> Task) {
+      SpeculationThread->async(std::move(Task));
+    });
+    break;
+#endif
+  case SpeculateKind::SpeculateInPlace:
+    J.setSpeculationDispatcher([](std::function<void()> Task) { Task(); });
+    break;
+  }
+
   // Add the module, look up main and run it.
   for (auto &M : Ms)
     cantFail(J.addModule(std::move(M)));
@@ -206,6 +206,11 @@ public:
     return CODLayer.findSymbolIn(K, mangle(Name), true);
   }
 
+  void setSpeculationDispatcher(
+      CODLayerT::SpeculationDispatcherFtor DispatchSpeculation) {
+    CODLayer.setSpeculationDispatcher(std::move(DispatchSpeculation));
+  }
+
 private:
   std::string mangle(const std::string &Name) {
     std::string MangledName;
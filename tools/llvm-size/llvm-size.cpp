@@ -14,11 +14,13 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/ADT/APInt.h"
+#include "llvm/BinaryFormat/Magic.h"
 #include "llvm/Object/Archive.h"
 #include "llvm/Object/ELFObjectFile.h"
 #include "llvm/Object/MachO.h"
 #include "llvm/Object/MachOUniversal.h"
 #include "llvm/Object/ObjectFile.h"
+#include "llvm/Object/Wasm.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
@@ -526,12 +528,40 @@ static bool checkMachOAndArchFlags(ObjectFile *O, StringRef Filename) {
   return true;
 }
 
+/// Open @p file as createBinary() does, except that wasm modules are opened
+/// lazily: their sizes come from the section headers, so there's no need to
+/// decode the section bodies.
+static Expected<OwningBinary<Binary>> openBinary(StringRef file) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> FileOrErr =
+      MemoryBuffer::getFileOrSTDIN(file);
+  if (std::error_code EC = FileOrErr.getError())
+    return errorCodeToError(EC);
+  std::unique_ptr<MemoryBuffer> &Buffer = FileOrErr.get();
+
+  std::unique_ptr<Binary> Bin;
+  if (identify_magic(Buffer->getBuffer()) == file_magic::wasm_object) {
+    Expected<std::unique_ptr<WasmObjectFile>> ObjOrErr =
+        ObjectFile::createWasmObjectFile(Buffer->getMemBufferRef(),
+                                         /*Lazy=*/true);
+    if (!ObjOrErr)
+      return ObjOrErr.takeError();
+    Bin = std::move(ObjOrErr.get());
+  } else {
+    Expected<std::unique_ptr<Binary>> BinOrErr =
+        createBinary(Buffer->getMemBufferRef());
+    if (!BinOrErr)
+      return BinOrErr.takeError();
+    Bin = std::move(BinOrErr.get());
+  }
+  return OwningBinary<Binary>(std::move(Bin), std::move(Buffer));
+}
+
 /// Print the section sizes for @p file. If @p file is an archive, print the
 /// section sizes for each archive member.
 static void printFileSectionSizes(StringRef file) {
 
   // Attempt to open the binary.
-  Expected<OwningBinary<Binary>> BinaryOrErr = createBinary(file);
+  Expected<OwningBinary<Binary>> BinaryOrErr = openBinary(file);
   if (!BinaryOrErr) {
     error(BinaryOrErr.takeError(), file);
     return;
@@ -155,6 +155,8 @@ ErrorOr<WasmYAML::Object *> WasmDumper::dump() {
         Sig.ReturnType = FunctionSig.ReturnType;
         for (const auto &ParamType : FunctionSig.ParamTypes)
           Sig.ParamTypes.push_back(ParamType);
+        for (const auto &ReturnType : FunctionSig.ExtraReturnTypes)
+          Sig.ExtraReturnTypes.push_back(ReturnType);
         TypeSec->Signatures.push_back(Sig);
       }
       S = std::move(TypeSec);
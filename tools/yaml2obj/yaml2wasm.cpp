@@ -266,10 +266,16 @@ int WasmWriter::writeSectionContent(raw_ostream &OS,
     for (auto ParamType : Sig.ParamTypes)
       writeUint8(OS, ParamType);
     if (Sig.ReturnType == wasm::WASM_TYPE_NORESULT) {
+      if (!Sig.ExtraReturnTypes.empty()) {
+        errs() << "ExtraReturnTypes given without a ReturnType\n";
+        return 1;
+      }
       encodeULEB128(0, OS);
     } else {
-      encodeULEB128(1, OS);
+      encodeULEB128(1 + Sig.ExtraReturnTypes.size(), OS);
       writeUint8(OS, Sig.ReturnType);
+      for (auto ReturnType : Sig.ExtraReturnTypes)
+        writeUint8(OS, ReturnType);
     }
   }
   return 0;
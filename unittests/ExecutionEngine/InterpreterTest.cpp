@@ -0,0 +1,353 @@
+//===- InterpreterTest.cpp - Unit tests for the Interpreter ---------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/ExecutionEngine/GenericValue.h"
+#include "llvm/ExecutionEngine/Interpreter.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+#include <chrono>
+
+using namespace llvm;
+
+namespace {
+
+const char *InterpreterTestIR = R"(
+  define i32 @sum(i32 %n) {
+  entry:
+    %slot = alloca i32
+    store i32 %n, i32* %slot
+    %done = icmp eq i32 %n, 0
+    br i1 %done, label %exit, label %recurse
+  recurse:
+    %m = sub i32 %n, 1
+    %rest = call i32 @sum(i32 %m)
+    %v = load i32, i32* %slot
+    %r = add i32 %rest, %v
+    ret i32 %r
+  exit:
+    ret i32 0
+  }
+
+  define i64 @frame_address() {
+    %buf = alloca [1024 x i8]
+    %addr = ptrtoint [1024 x i8]* %buf to i64
+    ret i64 %addr
+  }
+
+  define i32 @fib(i32 %n) {
+  entry:
+    %small = icmp slt i32 %n, 2
+    br i1 %small, label %exit, label %recurse
+  recurse:
+    %n1 = sub i32 %n, 1
+    %f1 = call i32 @fib(i32 %n1)
+    %n2 = sub i32 %n, 2
+    %f2 = call i32 @fib(i32 %n2)
+    %r = add i32 %f1, %f2
+    ret i32 %r
+  exit:
+    ret i32 %n
+  }
+
+  ; The ctpop is lowered the first time it runs, in the deepest frame, while
+  ; every other frame of the function is waiting for its call to return.
+  define i32 @popsum(i32 %n) {
+  entry:
+    %done = icmp eq i32 %n, 0
+    br i1 %done, label %exit, label %recurse
+  recurse:
+    %m = sub i32 %n, 1
+    %rest = call i32 @popsum(i32 %m)
+    %bits = call i32 @llvm.ctpop.i32(i32 %n)
+    %r = add i32 %rest, %bits
+    br label %exit
+  exit:
+    %v = phi i32 [ 0, %entry ], [ %r, %recurse ]
+    ret i32 %v
+  }
+
+  declare i32 @llvm.ctpop.i32(i32)
+
+  ; Mixes most of what the bytecode handles into a running hash.
+  define i64 @mix(i64 %x) {
+  entry:
+    %buf = alloca [4 x i64]
+    %odd = alloca i24
+    %flag = alloca i1
+    %p0 = getelementptr [4 x i64], [4 x i64]* %buf, i64 0, i64 0
+    call void @llvm.memset.p0i8.i64(i8* bitcast (i64* @scratch to i8*), i8 7,
+                                    i64 8, i1 false)
+    %lo = trunc i64 %x to i32
+    %b8 = trunc i64 %x to i8
+    %s8 = sext i8 %b8 to i64
+    %q = sdiv i32 %lo, -7
+    %r = srem i32 %lo, 13
+    %u = udiv i32 %lo, 5
+    %min = sdiv i32 -2147483648, -1
+    %sh = shl i32 %lo, 35
+    %as = ashr i8 %b8, 3
+    %ase = sext i8 %as to i32
+    %f = sitofp i32 %lo to float
+    %d = uitofp i64 %x to double
+    %fd = fpext float %f to double
+    %m = fmul double %d, 1.5
+    %dv = fdiv double %m, %fd
+    %ft = fptrunc double %dv to float
+    %bits = bitcast float %ft to i32
+    %back = fptosi double %m to i64
+    %nan = fdiv double 0.0, 0.0
+    %uno = fcmp uno double %nan, %d
+    %olt = fcmp olt double %nan, %d
+    %slt = icmp slt i8 %b8, 0
+    %sel = select i1 %slt, i32 %q, i32 %r
+    store i24 -1, i24* %odd
+    %odd.v = load i24, i24* %odd
+    store i1 %uno, i1* %flag
+    %flag.v = load i1, i1* %flag
+    %p.idx = and i64 %x, 3
+    %p = getelementptr [4 x i64], [4 x i64]* %buf, i64 0, i64 %p.idx
+    store i64 %back, i64* %p
+    %bp = bitcast [4 x i64]* %buf to i8*
+    %bp8 = getelementptr i8, i8* %bp, i64 8
+    %bp0 = bitcast i64* %p0 to i8*
+    call void @llvm.memcpy.p0i8.p0i8.i64(i8* %bp8, i8* %bp0, i64 8, i1 false)
+    %v1 = load i64, i64* %p
+    %scr = load i64, i64* @scratch
+    br label %loop
+
+  loop:
+    ; %a and %b swap every iteration.
+    %i = phi i32 [ 0, %entry ], [ %i.next, %next ]
+    %a = phi i64 [ %x, %entry ], [ %b, %next ]
+    %b = phi i64 [ 17, %entry ], [ %a, %next ]
+    %k = and i32 %i, 3
+    switch i32 %k, label %next [ i32 0, label %zero
+                                 i32 2, label %two ]
+  zero:
+    %a2 = mul i64 %a, 31
+    br label %next
+  two:
+    %a3 = xor i64 %a, %b
+    br label %next
+  next:
+    %acc = phi i64 [ %a, %loop ], [ %a2, %zero ], [ %a3, %two ]
+    %i.next = add i32 %i, 1
+    %done = icmp uge i32 %i.next, 7
+    br i1 %done, label %exit, label %loop
+
+  exit:
+    %h0 = add i64 %acc, %b
+    %e1 = zext i32 %sel to i64
+    %e2 = zext i32 %u to i64
+    %e3 = zext i32 %min to i64
+    %e4 = zext i32 %sh to i64
+    %e5 = zext i32 %ase to i64
+    %e6 = zext i32 %bits to i64
+    %e7 = zext i1 %olt to i64
+    %e8 = zext i24 %odd.v to i64
+    %e9 = zext i1 %flag.v to i64
+    %h1 = mul i64 %h0, 1000003
+    %h2 = xor i64 %h1, %e1
+    %h3 = mul i64 %h2, 1000003
+    %h4 = xor i64 %h3, %e2
+    %h5 = mul i64 %h4, 1000003
+    %h6 = xor i64 %h5, %e3
+    %h7 = add i64 %h6, %e4
+    %h8 = mul i64 %h7, 1000003
+    %h9 = xor i64 %h8, %e5
+    %h10 = add i64 %h9, %e6
+    %h11 = mul i64 %h10, 1000003
+    %h12 = add i64 %h11, %e7
+    %h13 = xor i64 %h12, %e8
+    %h14 = add i64 %h13, %e9
+    %h15 = xor i64 %h14, %v1
+    %h16 = add i64 %h15, %s8
+    %h17 = xor i64 %h16, %scr
+    ret i64 %h17
+  }
+
+  @scratch = global i64 0
+
+  declare void @llvm.memset.p0i8.i64(i8*, i8, i64, i1)
+  declare void @llvm.memcpy.p0i8.p0i8.i64(i8*, i8*, i64, i1)
+
+  ; Calls between bytecode and IR frames: @bitsum can't be decoded because of
+  ; the ctpop, and calls @addone, which can.
+  define i32 @addone(i32 %x) {
+    %r = add i32 %x, 1
+    ret i32 %r
+  }
+
+  define i32 @bitsum(i32 %n) {
+  entry:
+    %done = icmp eq i32 %n, 0
+    br i1 %done, label %exit, label %recurse
+  recurse:
+    %m = sub i32 %n, 1
+    %rest = call i32 @mixed(i32 %m)
+    %bits = call i32 @llvm.ctpop.i32(i32 %n)
+    %one = call i32 @addone(i32 %bits)
+    %r = add i32 %rest, %one
+    ret i32 %r
+  exit:
+    ret i32 0
+  }
+
+  define i32 @mixed(i32 %n) {
+    %fp = select i1 true, i32 (i32)* @bitsum, i32 (i32)* @addone
+    %r = call i32 %fp(i32 %n)
+    ret i32 %r
+  }
+)";
+
+class InterpreterTest : public testing::Test {
+private:
+  llvm_shutdown_obj Y; // Call llvm_shutdown() on exit.
+
+protected:
+  void SetUp() override {
+    SMDiagnostic Err;
+    std::unique_ptr<Module> Owner =
+        parseAssemblyString(InterpreterTestIR, Err, Context);
+    ASSERT_TRUE(Owner != nullptr) << Err.getMessage().str();
+    M = Owner.get();
+    Engine.reset(EngineBuilder(std::move(Owner))
+                     .setEngineKind(EngineKind::Interpreter)
+                     .setErrorStr(&Error)
+                     .create());
+    ASSERT_TRUE(Engine != nullptr) << "EngineBuilder returned error: '"
+                                   << Error << "'";
+  }
+
+  GenericValue call(StringRef Name, uint64_t Arg) {
+    GenericValue GV;
+    GV.IntVal = APInt(32, Arg);
+    return Engine->runFunction(M->getFunction(Name), GV);
+  }
+
+  std::string Error;
+  LLVMContext Context;
+  Module *M; // Owned by ExecutionEngine.
+  std::unique_ptr<ExecutionEngine> Engine;
+};
+
+// Every frame of a recursive function gets its own allocas.
+TEST_F(InterpreterTest, RecursiveAllocas) {
+  EXPECT_EQ(500500u, call("sum", 1000).IntVal.getZExtValue());
+}
+
+// Allocas are released when their frame returns, so the next call reuses the
+// same memory.
+TEST_F(InterpreterTest, AllocasReleasedOnReturn) {
+  Function *F = M->getFunction("frame_address");
+  uint64_t First = Engine->runFunction(F, None).IntVal.getZExtValue();
+  uint64_t Second = Engine->runFunction(F, None).IntVal.getZExtValue();
+  EXPECT_NE(0u, First);
+  EXPECT_EQ(First, Second);
+}
+
+// Lowering an intrinsic changes the function while frames of it are live.
+TEST_F(InterpreterTest, IntrinsicLoweredInLiveFrames) {
+  // popcount(1) + ... + popcount(8) = 1 + 1 + 2 + 1 + 2 + 2 + 3 + 1.
+  EXPECT_EQ(13u, call("popsum", 8).IntVal.getZExtValue());
+  EXPECT_EQ(13u, call("popsum", 8).IntVal.getZExtValue());
+}
+
+// Removing a module drops what was decoded for its functions, so a function
+// created later at the same address isn't run with stale slots.
+TEST_F(InterpreterTest, RemoveModule) {
+  for (int i = 0; i != 4; ++i) {
+    std::string IR = "define i32 @f(i32 %x) {\n";
+    for (int j = 0; j != i; ++j)
+      IR += "  %v" + std::to_string(j) + " = add i32 %x, 1\n";
+    IR += "  %r = add i32 %x, " + std::to_string(i) + "\n  ret i32 %r\n}\n";
+    SMDiagnostic Err;
+    std::unique_ptr<Module> Owner = parseAssemblyString(IR, Err, Context);
+    ASSERT_TRUE(Owner != nullptr) << Err.getMessage().str();
+    Module *Extra = Owner.get();
+    Engine->addModule(std::move(Owner));
+    GenericValue GV;
+    GV.IntVal = APInt(32, 10);
+    EXPECT_EQ(10u + i, Engine->runFunction(Extra->getFunction("f"), GV)
+                           .IntVal.getZExtValue());
+    ASSERT_TRUE(Engine->removeModule(Extra));
+    delete Extra;
+  }
+}
+
+// A call-heavy function returns the right result; fib(N) makes
+// 2 * fib(N + 1) - 1 calls, each of which pushes and pops a frame.
+TEST_F(InterpreterTest, ManyCalls) {
+  EXPECT_EQ(6765u, call("fib", 20).IntVal.getZExtValue());
+}
+
+// Benchmark: how many calls per second the interpreter makes. It's disabled
+// by default; run it with --gtest_also_run_disabled_tests.
+TEST_F(InterpreterTest, DISABLED_CallsPerSecond) {
+  const unsigned N = 27;
+  const uint64_t NumCalls = 2 * 317811 - 1;
+  auto Start = std::chrono::steady_clock::now();
+  EXPECT_EQ(196418u, call("fib", N).IntVal.getZExtValue());
+  std::chrono::duration<double> Elapsed =
+      std::chrono::steady_clock::now() - Start;
+  outs() << "fib(" << N << "): " << NumCalls << " calls in "
+         << format("%.3f", Elapsed.count()) << "s, "
+         << uint64_t(NumCalls / Elapsed.count()) << " calls per second\n";
+}
+
+// The bytecode computes what the IR interpreter does. A vector instruction,
+// which the bytecode doesn't handle, keeps a copy of @mix out of it.
+TEST(InterpreterBytecodeTest, MatchesIR) {
+  std::string IR = InterpreterTestIR;
+  size_t Begin = IR.find("define i64 @mix(");
+  std::string Copy = IR.substr(Begin, IR.find("\n  }\n", Begin) + 5 - Begin);
+  Copy.replace(Copy.find("@mix("), 5, "@mix.ir(");
+  Copy.insert(Copy.find("entry:\n") + 7,
+              "    %vec = insertelement <1 x i64> undef, i64 %x, i32 0\n");
+  IR += Copy;
+
+  LLVMContext Context;
+  SMDiagnostic Err;
+  std::unique_ptr<Module> Owner = parseAssemblyString(IR, Err, Context);
+  ASSERT_TRUE(Owner != nullptr) << Err.getMessage().str();
+  Module *M = Owner.get();
+  std::unique_ptr<ExecutionEngine> Engine(
+      EngineBuilder(std::move(Owner))
+          .setEngineKind(EngineKind::Interpreter)
+          .create());
+  ASSERT_TRUE(Engine != nullptr);
+
+  const uint64_t Inputs[] = {0, 1, 7, 42, 255, 1000003, 0x80000000,
+                             0xdeadbeefcafe, uint64_t(-1), uint64_t(-12345)};
+  for (uint64_t X : Inputs) {
+    GenericValue GV;
+    GV.IntVal = APInt(64, X);
+    uint64_t Bytecode =
+        Engine->runFunction(M->getFunction("mix"), GV).IntVal.getZExtValue();
+    uint64_t Interpreted =
+        Engine->runFunction(M->getFunction("mix.ir"), GV).IntVal.getZExtValue();
+    EXPECT_EQ(Interpreted, Bytecode) << "for " << X;
+  }
+}
+
+// Bytecode frames call and return to frames run from the IR, directly and
+// through function pointers.
+TEST_F(InterpreterTest, BytecodeCallsIR) {
+  // popcount(1) + ... + popcount(8), plus one for each call.
+  EXPECT_EQ(21u, call("mixed", 8).IntVal.getZExtValue());
+  EXPECT_EQ(21u, call("bitsum", 8).IntVal.getZExtValue());
+}
+
+} // end anonymous namespace
@@ -166,5 +166,61 @@ TEST(MCJITMemoryManagerTest, ManyVariedAllocations) {
   }
 }
 
+TEST(MCJITMemoryManagerTest, SlabAllocations) {
+  std::unique_ptr<SectionMemoryManager> MemMgr(
+      new SectionMemoryManager(nullptr, 0x100000));
+
+  for (unsigned Round = 0; Round < 2; ++Round) {
+    for (unsigned i = 0; i < 1000; ++i) {
+      uint8_t *code = MemMgr->allocateCodeSection(32, 0, i, "");
+      uint8_t *data = MemMgr->allocateDataSection(32, 0, i + 1000, "", true);
+      EXPECT_NE((uint8_t *)nullptr, code);
+      EXPECT_NE((uint8_t *)nullptr, data);
+    }
+
+    std::string Error;
+    EXPECT_FALSE(MemMgr->finalizeMemory(&Error));
+  }
+
+  // Both rounds of each kind of section fit in one slab, and each round is
+  // protected with one call per kind.
+  SectionMemoryManager::MemoryStats Stats = MemMgr->getMemoryStats();
+  EXPECT_EQ(2U, Stats.NumMappings);
+  EXPECT_LE((size_t)0x200000, Stats.MappedBytes);
+  EXPECT_EQ((size_t)4000 * 32, Stats.AllocatedBytes);
+  EXPECT_EQ(4U, Stats.NumProtectCalls);
+  EXPECT_EQ(Stats.MappedBytes,
+            Stats.AllocatedBytes + Stats.FreeBytes + Stats.getWastedBytes());
+}
+
+TEST(MCJITMemoryManagerTest, HugePageSlabAllocations) {
+  // Slabs smaller than a huge page are rounded up to one, since the hint has
+  // no effect on them otherwise.
+  std::unique_ptr<SectionMemoryManager> MemMgr(
+      new SectionMemoryManager(nullptr, 0x100000, true));
+
+  uint8_t *code = MemMgr->allocateCodeSection(32, 0, 0, "");
+  uint8_t *data = MemMgr->allocateDataSection(32, 0, 1, "", true);
+  EXPECT_NE((uint8_t *)nullptr, code);
+  EXPECT_NE((uint8_t *)nullptr, data);
+
+  // A section bigger than a huge page gets a mapping of whole huge pages.
+  uint8_t *big = MemMgr->allocateDataSection(
+      sys::Memory::HugePageSize + 1, 0, 2, "", false);
+  EXPECT_NE((uint8_t *)nullptr, big);
+
+  std::string Error;
+  EXPECT_FALSE(MemMgr->finalizeMemory(&Error));
+
+  SectionMemoryManager::MemoryStats Stats = MemMgr->getMemoryStats();
+  EXPECT_EQ(3U, Stats.NumMappings);
+  EXPECT_EQ((size_t)4 * sys::Memory::HugePageSize, Stats.MappedBytes);
+#if defined(__linux__)
+  EXPECT_EQ(0U, (uintptr_t)code % sys::Memory::HugePageSize);
+  EXPECT_EQ(0U, (uintptr_t)data % sys::Memory::HugePageSize);
+  EXPECT_EQ(0U, (uintptr_t)big % sys::Memory::HugePageSize);
+#endif
+}
+
 } // Namespace
 
@@ -9,8 +9,14 @@
 
 #include "llvm/ExecutionEngine/Orc/CompileOnDemandLayer.h"
 #include "OrcTestCommon.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/Support/ThreadPool.h"
 #include "gtest/gtest.h"
 
+#include <future>
+#include <thread>
+
 using namespace llvm;
 using namespace llvm::orc;
 
@@ -49,6 +55,129 @@ public:
   }
 };
 
+// A compile callback manager whose trampolines are just distinct addresses.
+// Tests enter a stub by calling executeCompileCallback on its trampoline.
+class FakeTrampolineCallbackManager : public orc::JITCompileCallbackManager {
+public:
+  FakeTrampolineCallbackManager(ExecutionSession &ES)
+      : JITCompileCallbackManager(ES, 0) {}
+
+private:
+  Error grow() override {
+    for (unsigned I = 0; I != 16; ++I)
+      AvailableTrampolines.push_back(NextTrampolineAddr++);
+    return Error::success();
+  }
+
+  JITTargetAddress NextTrampolineAddr = 0x1000;
+};
+
+// A stubs manager that just records where each stub points.
+class RecordingStubsManager : public orc::IndirectStubsManager {
+public:
+  Error createStub(StringRef StubName, JITTargetAddress InitAddr,
+                   JITSymbolFlags Flags) override {
+    std::lock_guard<std::mutex> Lock(StubsMutex);
+    Stubs[StubName] = JITEvaluatedSymbol(InitAddr, Flags);
+    return Error::success();
+  }
+
+  Error createStubs(const StubInitsMap &StubInits) override {
+    for (auto &Entry : StubInits)
+      if (auto Err = createStub(Entry.first(), Entry.second.first,
+                                Entry.second.second))
+        return Err;
+    return Error::success();
+  }
+
+  JITEvaluatedSymbol findStub(StringRef Name, bool ExportedStubsOnly) override {
+    std::lock_guard<std::mutex> Lock(StubsMutex);
+    auto I = Stubs.find(Name);
+    if (I == Stubs.end())
+      return nullptr;
+    // The stub itself lives nowhere in particular.
+    return JITEvaluatedSymbol(0xdead0000 + I->second.getAddress(),
+                              I->second.getFlags());
+  }
+
+  JITEvaluatedSymbol findPointer(StringRef Name) override {
+    llvm_unreachable("Not implemented");
+  }
+
+  Error updatePointer(StringRef Name, JITTargetAddress NewAddr) override {
+    std::lock_guard<std::mutex> Lock(StubsMutex);
+    auto I = Stubs.find(Name);
+    assert(I != Stubs.end() && "No stub pointer for symbol");
+    I->second = JITEvaluatedSymbol(NewAddr, I->second.getFlags());
+    return Error::success();
+  }
+
+  JITTargetAddress getPointer(StringRef Name) {
+    std::lock_guard<std::mutex> Lock(StubsMutex);
+    return Stubs.lookup(Name).getAddress();
+  }
+
+private:
+  std::mutex StubsMutex;
+  StringMap<JITEvaluatedSymbol> Stubs;
+};
+
+// A base layer that "compiles" each function to a fixed address, and counts
+// how often each one is compiled.
+class RecordingBaseLayer {
+public:
+  static JITTargetAddress getBodyAddr(StringRef Name) {
+    return StringSwitch<JITTargetAddress>(Name)
+        .Case("foo", 0x100)
+        .Case("bar", 0x200)
+        .Case("baz", 0x300)
+        .Default(0);
+  }
+
+  Error addModule(VModuleKey K, std::unique_ptr<Module> M) {
+    if (OnAddModule)
+      OnAddModule(*M);
+    std::lock_guard<std::mutex> Lock(LayerMutex);
+    for (auto &F : *M)
+      if (!F.isDeclaration()) {
+        Bodies[K][F.getName()] = getBodyAddr(F.getName());
+        ++NumCompiles[F.getName()];
+      }
+    return Error::success();
+  }
+
+  Error removeModule(VModuleKey K) {
+    std::lock_guard<std::mutex> Lock(LayerMutex);
+    Bodies.erase(K);
+    return Error::success();
+  }
+
+  JITSymbol findSymbol(const std::string &Name, bool ExportedSymbolsOnly) {
+    return nullptr;
+  }
+
+  JITSymbol findSymbolIn(VModuleKey K, const std::string &Name,
+                         bool ExportedSymbolsOnly) {
+    std::lock_guard<std::mutex> Lock(LayerMutex);
+    auto I = Bodies[K].find(Name);
+    if (I == Bodies[K].end())
+      return nullptr;
+    return JITSymbol(I->second, JITSymbolFlags::Exported);
+  }
+
+  unsigned getNumCompiles(StringRef Name) {
+    std::lock_guard<std::mutex> Lock(LayerMutex);
+    return NumCompiles.lookup(Name);
+  }
+
+  std::function<void(Module &)> OnAddModule;
+
+private:
+  std::mutex LayerMutex;
+  std::map<VModuleKey, StringMap<JITTargetAddress>> Bodies;
+  StringMap<unsigned> NumCompiles;
+};
+
 TEST(CompileOnDemandLayerTest, FindSymbol) {
   MockBaseLayer<int, std::shared_ptr<Module>> TestBaseLayer;
   TestBaseLayer.findSymbolImpl =
@@ -81,4 +210,97 @@ TEST(CompileOnDemandLayerTest, FindSymbol) {
   EXPECT_TRUE(!!Sym) << "CompileOnDemand::findSymbol should call findSymbol in "
                         "the base layer.";
 }
+
+TEST(CompileOnDemandLayerTest, EnterStubDuringSpeculativeCompile) {
+#if LLVM_ENABLE_THREADS
+  LLVMContext Context;
+  auto M = llvm::make_unique<Module>("speculate", Context);
+  IRBuilder<> Builder(Context);
+  auto *FnTy = FunctionType::get(Builder.getVoidTy(), false);
+  auto CreateFunction = [&](StringRef Name, ArrayRef<Function *> Callees) {
+    auto *F = Function::Create(FnTy, GlobalValue::ExternalLinkage, Name,
+                               M.get());
+    Builder.SetInsertPoint(BasicBlock::Create(Context, "entry", F));
+    for (auto *Callee : Callees)
+      Builder.CreateCall(Callee);
+    Builder.CreateRetVoid();
+    return F;
+  };
+  auto *Bar = CreateFunction("bar", {});
+  auto *Baz = CreateFunction("baz", {});
+  CreateFunction("foo", {Bar, Baz});
+
+  ExecutionSession ES(std::make_shared<SymbolStringPool>());
+  FakeTrampolineCallbackManager CallbackMgr(ES);
+  RecordingBaseLayer BaseLayer;
+  RecordingStubsManager *Stubs = nullptr;
+
+  auto GetResolver = [](orc::VModuleKey) {
+    return std::shared_ptr<orc::SymbolResolver>();
+  };
+  auto SetResolver = [](orc::VModuleKey,
+                        std::shared_ptr<orc::SymbolResolver>) {};
+
+  CompileOnDemandLayer<RecordingBaseLayer, JITCompileCallbackManager,
+                       RecordingStubsManager>
+      COD(ES, BaseLayer, GetResolver, SetResolver,
+          [](Function &F) { return std::set<Function *>{&F}; }, CallbackMgr,
+          [&]() {
+            auto StubsMgr = llvm::make_unique<RecordingStubsManager>();
+            Stubs = StubsMgr.get();
+            return StubsMgr;
+          },
+          false);
+
+  ThreadPool TP(1);
+  COD.setSpeculationDispatcher(
+      [&TP](std::function<void()> Task) { TP.async(std::move(Task)); });
+
+  // Hold up the first speculative compile in the base layer until the test
+  // has entered the stub of the function being compiled.
+  auto MainThread = std::this_thread::get_id();
+  std::promise<std::string> SpeculationStarted;
+  std::promise<void> FinishSpeculation;
+  std::shared_future<void> SpeculationMayFinish =
+      FinishSpeculation.get_future().share();
+  bool SeenSpeculation = false;
+  BaseLayer.OnAddModule = [&](Module &PartM) {
+    if (std::this_thread::get_id() == MainThread || SeenSpeculation)
+      return;
+    SeenSpeculation = true;
+    for (auto &F : PartM)
+      if (!F.isDeclaration())
+        SpeculationStarted.set_value(F.getName());
+    SpeculationMayFinish.wait();
+  };
+
+  cantFail(COD.addModule(ES.allocateVModule(), std::move(M)));
+  ASSERT_NE(Stubs, nullptr);
+
+  // Entering foo compiles it and starts compiling its callees.
+  EXPECT_EQ(CallbackMgr.executeCompileCallback(Stubs->getPointer("foo")),
+            RecordingBaseLayer::getBodyAddr("foo"));
+
+  std::string SpeculatedName = SpeculationStarted.get_future().get();
+  JITTargetAddress Trampoline = Stubs->getPointer(SpeculatedName);
+  JITTargetAddress EnteredAddr = 0;
+  std::thread EnterStub([&]() {
+    EnteredAddr = CallbackMgr.executeCompileCallback(Trampoline);
+  });
+  FinishSpeculation.set_value();
+  EnterStub.join();
+  TP.wait();
+
+  EXPECT_EQ(EnteredAddr, RecordingBaseLayer::getBodyAddr(SpeculatedName))
+      << "Stub entered during its speculative compile returned the wrong "
+         "address";
+  for (StringRef Name : {"foo", "bar", "baz"}) {
+    EXPECT_EQ(BaseLayer.getNumCompiles(Name), 1U)
+        << Name << " should be compiled exactly once";
+    EXPECT_EQ(Stubs->getPointer(Name), RecordingBaseLayer::getBodyAddr(Name))
+        << "Stub for " << Name << " should point at its body";
+  }
+  EXPECT_EQ(COD.getNumSpeculativelyCompiled(), 2U);
+#endif
+}
 }
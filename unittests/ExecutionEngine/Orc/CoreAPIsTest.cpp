@@ -11,8 +11,12 @@
 #include "llvm/Config/llvm-config.h"
 #include "llvm/ExecutionEngine/Orc/Core.h"
 #include "llvm/ExecutionEngine/Orc/OrcError.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
 
+#include <chrono>
 #include <set>
 #include <thread>
 
@@ -713,6 +717,179 @@ TEST(CoreAPIsTest, TestLookupWithThreadedMaterialization) {
 #endif
 }
 
+TEST(CoreAPIsTest, TestLookupWithThreadPoolMaterialization) {
+#if LLVM_ENABLE_THREADS
+  JITEvaluatedSymbol FooSym(0xdeadbeef, JITSymbolFlags::Exported);
+  JITEvaluatedSymbol BarSym(0xcafef00d, JITSymbolFlags::Exported);
+  JITEvaluatedSymbol BazSym(0xbaadf00d, JITSymbolFlags::Exported);
+
+  ExecutionSession ES;
+  // A single thread, so the nested lookup below deadlocks unless the blocked
+  // thread runs Bar's unit itself.
+  ThreadPool TP(1);
+  ES.setDispatchMaterializationToThreadPool(TP);
+
+  auto Foo = ES.getSymbolStringPool().intern("foo");
+  auto Bar = ES.getSymbolStringPool().intern("bar");
+  auto Baz = ES.getSymbolStringPool().intern("baz");
+
+  auto &V = ES.createVSO("V");
+
+  // Foo's materializer needs Bar, the way linking an object needs the
+  // symbols it refers to.
+  cantFail(V.define(llvm::make_unique<SimpleMaterializationUnit>(
+      SymbolFlagsMap({{Foo, FooSym.getFlags()}}),
+      [&](MaterializationResponsibility R) {
+        auto BarResult = lookup({&V}, Bar);
+        EXPECT_TRUE(!!BarResult) << "nested lookup failed";
+        consumeError(BarResult.takeError());
+        R.resolve({{Foo, FooSym}});
+        R.finalize();
+      })));
+  cantFail(V.define(llvm::make_unique<SimpleMaterializationUnit>(
+      SymbolFlagsMap({{Bar, BarSym.getFlags()}}),
+      [&](MaterializationResponsibility R) {
+        R.resolve({{Bar, BarSym}});
+        R.finalize();
+      })));
+  cantFail(V.define(llvm::make_unique<SimpleMaterializationUnit>(
+      SymbolFlagsMap({{Baz, BazSym.getFlags()}}),
+      [&](MaterializationResponsibility R) {
+        R.resolve({{Baz, BazSym}});
+        R.finalize();
+      })));
+
+  auto Result = cantFail(lookup({&V}, {Foo, Baz}));
+  EXPECT_EQ(Result.size(), 2U) << "Unexpected number of results";
+  EXPECT_EQ(Result[Foo].getAddress(), FooSym.getAddress())
+      << "lookup returned an incorrect address for foo";
+  EXPECT_EQ(Result[Baz].getAddress(), BazSym.getAddress())
+      << "lookup returned an incorrect address for baz";
+  TP.wait();
+#endif
+}
+
+TEST(CoreAPIsTest, TestNestedLookupOfQueuedUnitOnThreadPool) {
+#if LLVM_ENABLE_THREADS
+  JITEvaluatedSymbol FooSym(0xdeadbeef, JITSymbolFlags::Exported);
+  JITEvaluatedSymbol BarSym(0xcafef00d, JITSymbolFlags::Exported);
+
+  ExecutionSession ES;
+  ThreadPool TP(1);
+  ES.setDispatchMaterializationToThreadPool(TP);
+
+  auto Foo = ES.getSymbolStringPool().intern("foo");
+  auto Bar = ES.getSymbolStringPool().intern("bar");
+
+  // Foo and Bar live in different VSOs so that Foo's unit is dispatched
+  // first. By the time Foo's materializer looks up Bar, Bar's unit has been
+  // claimed by the outer lookup and is queued behind Foo on the only thread.
+  auto &V1 = ES.createVSO("V1");
+  auto &V2 = ES.createVSO("V2");
+
+  cantFail(V1.define(llvm::make_unique<SimpleMaterializationUnit>(
+      SymbolFlagsMap({{Foo, FooSym.getFlags()}}),
+      [&](MaterializationResponsibility R) {
+        auto BarResult = lookup({&V2}, Bar);
+        EXPECT_TRUE(!!BarResult) << "nested lookup failed";
+        consumeError(BarResult.takeError());
+        R.resolve({{Foo, FooSym}});
+        R.finalize();
+      })));
+  cantFail(V2.define(llvm::make_unique<SimpleMaterializationUnit>(
+      SymbolFlagsMap({{Bar, BarSym.getFlags()}}),
+      [&](MaterializationResponsibility R) {
+        R.resolve({{Bar, BarSym}});
+        R.finalize();
+      })));
+
+  auto Result = cantFail(lookup({&V1, &V2}, {Foo, Bar}));
+  EXPECT_EQ(Result.size(), 2U) << "Unexpected number of results";
+  EXPECT_EQ(Result[Foo].getAddress(), FooSym.getAddress())
+      << "lookup returned an incorrect address for foo";
+  EXPECT_EQ(Result[Bar].getAddress(), BarSym.getAddress())
+      << "lookup returned an incorrect address for bar";
+  TP.wait();
+#endif
+}
+
+#if LLVM_ENABLE_THREADS
+// Define NumUnits units whose materializers spin for Work iterations, the
+// way codegen would, and look them all up from NumClients threads, either
+// one symbol at a time or with a single lookup per thread. Returns the
+// elapsed time in seconds.
+static double timeLazyLookups(ThreadPool *TP, unsigned NumUnits,
+                              unsigned NumClients, bool OneLookupPerClient,
+                              unsigned Work) {
+  ExecutionSession ES;
+  if (TP)
+    ES.setDispatchMaterializationToThreadPool(*TP);
+  auto &V = ES.createVSO("V");
+
+  std::vector<SymbolStringPtr> Names;
+  for (unsigned I = 0; I != NumUnits; ++I) {
+    auto Name = ES.getSymbolStringPool().intern("f" + std::to_string(I));
+    JITEvaluatedSymbol Sym(0x1000 + I, JITSymbolFlags::Exported);
+    cantFail(V.define(llvm::make_unique<SimpleMaterializationUnit>(
+        SymbolFlagsMap({{Name, Sym.getFlags()}}),
+        [Name, Sym, Work](MaterializationResponsibility R) {
+          volatile unsigned Sink = 0;
+          for (unsigned J = 0; J != Work; ++J)
+            Sink += J;
+          R.resolve({{Name, Sym}});
+          R.finalize();
+        })));
+    Names.push_back(Name);
+  }
+
+  auto Start = std::chrono::steady_clock::now();
+  std::vector<std::thread> Clients;
+  for (unsigned C = 0; C != NumClients; ++C)
+    Clients.emplace_back([&, C]() {
+      SymbolNameSet Slice;
+      for (unsigned I = C; I < NumUnits; I += NumClients) {
+        if (OneLookupPerClient)
+          Slice.insert(Names[I]);
+        else
+          cantFail(lookup({&V}, Names[I]));
+      }
+      if (OneLookupPerClient)
+        cantFail(lookup({&V}, std::move(Slice)));
+    });
+  for (std::thread &T : Clients)
+    T.join();
+  std::chrono::duration<double> Elapsed =
+      std::chrono::steady_clock::now() - Start;
+  if (TP)
+    TP->wait();
+  return Elapsed.count();
+}
+#endif
+
+// Benchmark: lazily materialize many units from several threads, with
+// in-place and thread pool dispatch. Units that do no work measure the
+// session's own overhead. It's disabled by default; run it with
+// --gtest_also_run_disabled_tests.
+TEST(CoreAPIsTest, DISABLED_ConcurrentLazyLookupBenchmark) {
+#if LLVM_ENABLE_THREADS
+  const unsigned NumUnits = 512;
+  const unsigned NumClients = 4;
+  ThreadPool TP;
+  for (unsigned Work : {0u, 200000u})
+    for (bool OneLookup : {false, true}) {
+      double InPlace =
+          timeLazyLookups(nullptr, NumUnits, NumClients, OneLookup, Work);
+      double Pooled =
+          timeLazyLookups(&TP, NumUnits, NumClients, OneLookup, Work);
+      outs() << format("%u units, work %u, %u threads, %s: in place %.3fs, "
+                       "thread pool %.3fs\n",
+                       NumUnits, Work, NumClients,
+                       OneLookup ? "one lookup each" : "one symbol at a time",
+                       InPlace, Pooled);
+    }
+#endif
+}
+
 TEST(CoreAPIsTest, TestGetRequestedSymbolsAndDelegate) {
   ExecutionSession ES;
   auto Foo = ES.getSymbolStringPool().intern("foo");
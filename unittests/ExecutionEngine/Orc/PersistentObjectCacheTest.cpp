@@ -0,0 +1,238 @@
+//===- PersistentObjectCacheTest.cpp - On-disk object cache unit tests ----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/Orc/PersistentObjectCache.h"
+#include "OrcTestCommon.h"
+#include "llvm/ExecutionEngine/ExecutionEngine.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+using namespace llvm::orc;
+
+namespace {
+
+class PersistentObjectCacheTest : public testing::Test {
+protected:
+  void SetUp() override {
+    OrcNativeTarget::initialize();
+    TM = createTM();
+    ASSERT_FALSE(sys::fs::createUniqueDirectory("orc-object-cache", CacheDir));
+  }
+
+  void TearDown() override { sys::fs::remove_directories(CacheDir); }
+
+  std::unique_ptr<TargetMachine>
+  createTM(StringRef CPU = "", ArrayRef<std::string> Attrs = None,
+           CodeGenOpt::Level OptLevel = CodeGenOpt::Default,
+           TargetOptions Options = TargetOptions()) {
+    return std::unique_ptr<TargetMachine>(
+        EngineBuilder()
+            .setOptLevel(OptLevel)
+            .setTargetOptions(Options)
+            .selectTarget(Triple(sys::getProcessTriple()), "", CPU,
+                          SmallVector<std::string, 1>(Attrs.begin(),
+                                                      Attrs.end())));
+  }
+
+  std::unique_ptr<Module> createModule(StringRef Name, int Value,
+                                       StringRef Identifier = "") {
+    auto M = llvm::make_unique<Module>(Identifier, Context);
+    M->setSourceFileName("");
+    Type *Int32Ty = IntegerType::get(Context, 32);
+    new GlobalVariable(*M, Int32Ty, false, GlobalValue::ExternalLinkage,
+                       ConstantInt::get(Int32Ty, Value), Name);
+    return M;
+  }
+
+  std::unique_ptr<PersistentObjectCache>
+  createCache(const TargetMachine *CacheTM = nullptr,
+              CachePruningPolicy Policy = CachePruningPolicy()) {
+    auto Cache =
+        PersistentObjectCache::Create(CacheDir, CacheTM ? *CacheTM : *TM,
+                                      Policy);
+    EXPECT_TRUE(!!Cache) << "Failed to create cache";
+    if (!Cache) {
+      consumeError(Cache.takeError());
+      return nullptr;
+    }
+    return std::move(*Cache);
+  }
+
+  LLVMContext Context;
+  std::unique_ptr<TargetMachine> TM;
+  SmallString<128> CacheDir;
+};
+
+TEST_F(PersistentObjectCacheTest, TestHitAcrossInstances) {
+  if (!TM)
+    return;
+
+  auto M = createModule("foo", 42);
+  StringRef Contents = "not really an object file";
+
+  {
+    auto Cache = createCache();
+    ASSERT_TRUE(!!Cache);
+    EXPECT_EQ(Cache->getObject(M.get()), nullptr)
+        << "Empty cache should miss";
+    Cache->notifyObjectCompiled(M.get(), MemoryBufferRef(Contents, "foo"));
+    EXPECT_EQ(Cache->getNumHits(), 0U);
+    EXPECT_EQ(Cache->getNumStores(), 1U);
+  }
+
+  // A second cache on the same directory should find the object compiled for
+  // an identical module.
+  auto Cache = createCache();
+  ASSERT_TRUE(!!Cache);
+  auto Same = createModule("foo", 42);
+  auto Obj = Cache->getObject(Same.get());
+  ASSERT_NE(Obj, nullptr) << "Identical module should hit";
+  EXPECT_EQ(Obj->getBuffer(), Contents);
+  EXPECT_EQ(Cache->getNumHits(), 1U);
+
+  auto Other = createModule("foo", 43);
+  EXPECT_EQ(Cache->getObject(Other.get()), nullptr)
+      << "Different module should miss";
+  EXPECT_EQ(Cache->getNumHits(), 1U);
+
+  // The module identifier doesn't affect the object, so it isn't in the key.
+  auto Renamed = createModule("foo", 42, "renamed");
+  EXPECT_NE(Cache->getObject(Renamed.get()), nullptr)
+      << "Module that only differs in its identifier should hit";
+}
+
+TEST_F(PersistentObjectCacheTest, TestTargetConfigurationInKey) {
+  if (!TM)
+    return;
+
+  auto M = createModule("foo", 42);
+  StringRef Contents = "not really an object file";
+  {
+    auto Cache = createCache();
+    ASSERT_TRUE(!!Cache);
+    EXPECT_EQ(Cache->getObject(M.get()), nullptr);
+    Cache->notifyObjectCompiled(M.get(), MemoryBufferRef(Contents, "foo"));
+  }
+
+  auto ExpectMiss = [&](std::unique_ptr<TargetMachine> OtherTM,
+                        StringRef What) {
+    ASSERT_TRUE(!!OtherTM);
+    auto Cache = createCache(OtherTM.get());
+    ASSERT_TRUE(!!Cache);
+    EXPECT_EQ(Cache->getObject(M.get()), nullptr)
+        << "Cache for a TargetMachine with a different " << What
+        << " should miss";
+  };
+
+  std::string HostCPU = sys::getHostCPUName();
+  if (!HostCPU.empty() && HostCPU != "generic")
+    ExpectMiss(createTM(HostCPU), "CPU");
+
+  StringMap<bool> HostFeatures;
+  if (sys::getHostCPUFeatures(HostFeatures) && !HostFeatures.empty()) {
+    auto &Feature = *HostFeatures.begin();
+    std::string Attr =
+        (Feature.getValue() ? "-" : "+") + Feature.getKey().str();
+    ExpectMiss(createTM("", Attr), "feature string");
+  }
+
+  ExpectMiss(createTM("", None, CodeGenOpt::None), "optimization level");
+
+  TargetOptions Options;
+  Options.UnsafeFPMath = true;
+  ExpectMiss(createTM("", None, CodeGenOpt::Default, Options),
+             "TargetOptions");
+
+  // A TargetMachine configured the same way should still hit.
+  auto SameTM = createTM();
+  ASSERT_TRUE(!!SameTM);
+  auto Cache = createCache(SameTM.get());
+  ASSERT_TRUE(!!Cache);
+  EXPECT_NE(Cache->getObject(M.get()), nullptr)
+      << "Cache for an identically configured TargetMachine should hit";
+}
+
+TEST_F(PersistentObjectCacheTest, TestPruneAfterStores) {
+  if (!TM)
+    return;
+
+  CachePruningPolicy Policy;
+  Policy.Interval = std::chrono::seconds(0);
+  Policy.MaxSizeFiles = 2;
+  auto Cache = createCache(nullptr, Policy);
+  ASSERT_TRUE(!!Cache);
+
+  StringRef Contents = "not really an object file";
+  for (int I = 0; I != 3; ++I) {
+    auto M = createModule("foo", I);
+    EXPECT_EQ(Cache->getObject(M.get()), nullptr);
+    Cache->notifyObjectCompiled(M.get(), MemoryBufferRef(Contents, "foo"));
+  }
+  EXPECT_EQ(Cache->getNumStores(), 3U);
+
+  // The directory was empty when the cache was created, so only pruning
+  // after the stores can have removed anything.
+  unsigned NumEntries = 0;
+  std::error_code EC;
+  for (sys::fs::directory_iterator I(CacheDir, EC), E; I != E && !EC;
+       I.increment(EC))
+    if (sys::path::filename(I->path()).startswith("llvmcache-"))
+      ++NumEntries;
+  EXPECT_FALSE(EC);
+  EXPECT_EQ(NumEntries, 2U) << "Cache should have been pruned to 2 entries";
+}
+
+TEST_F(PersistentObjectCacheTest, TestTruncatedEntry) {
+  if (!TM)
+    return;
+
+  auto M = createModule("foo", 42);
+  StringRef Contents = "not really an object file";
+  {
+    auto Cache = createCache();
+    ASSERT_TRUE(!!Cache);
+    EXPECT_EQ(Cache->getObject(M.get()), nullptr);
+    Cache->notifyObjectCompiled(M.get(), MemoryBufferRef(Contents, "foo"));
+  }
+
+  // Cut the entry short, as a crash or a full disk might.
+  std::error_code EC;
+  sys::fs::directory_iterator I(CacheDir, EC), E;
+  for (; I != E && !EC; I.increment(EC))
+    if (sys::path::filename(I->path()).startswith("llvmcache-"))
+      break;
+  ASSERT_FALSE(EC);
+  ASSERT_TRUE(I != E) << "No cache entry was written";
+  int FD;
+  ASSERT_FALSE(sys::fs::openFileForWrite(
+      I->path(), FD, sys::fs::CD_OpenExisting, sys::fs::F_None));
+  EXPECT_FALSE(sys::fs::resize_file(FD, Contents.size() / 2));
+  sys::Process::SafelyCloseFileDescriptor(FD);
+
+  auto Cache = createCache();
+  ASSERT_TRUE(!!Cache);
+  EXPECT_EQ(Cache->getObject(M.get()), nullptr)
+      << "Truncated entry should miss";
+  EXPECT_EQ(Cache->getNumHits(), 0U);
+
+  // Storing the object again replaces the bad entry.
+  Cache->notifyObjectCompiled(M.get(), MemoryBufferRef(Contents, "foo"));
+  auto Obj = Cache->getObject(M.get());
+  ASSERT_NE(Obj, nullptr) << "Rewritten entry should hit";
+  EXPECT_EQ(Obj->getBuffer(), Contents);
+}
+
+} // end anonymous namespace
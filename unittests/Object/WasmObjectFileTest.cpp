@@ -0,0 +1,172 @@
+//===- WasmObjectFileTest.cpp - Tests for WasmObjectFile ------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Object/Wasm.h"
+#include "gtest/gtest.h"
+#include <string>
+
+using namespace llvm;
+using namespace object;
+
+namespace {
+
+// Build a module holding a single custom section with a Snax name table,
+// with the count header or, for Legacy, in the older headerless format.
+std::string makeTableModule(StringRef SectionName,
+                            ArrayRef<StringRef> Entries, bool Legacy = false) {
+  std::string Payload;
+  Payload += char(SectionName.size());
+  Payload += SectionName;
+  if (!Legacy) {
+    Payload += char(wasm::WASM_SNAX_TABLE_SORTED);
+    Payload += char(Entries.size());
+  }
+  for (StringRef Entry : Entries) {
+    Payload += char(Entry.size());
+    Payload += Entry;
+  }
+  std::string Module("\0asm\1\0\0\0", 8);
+  Module += '\0'; // custom section
+  Module += char(Payload.size());
+  return Module + Payload;
+}
+
+// Build a module exporting a single "apply" function, with the given code
+// section and an ABI section after it.
+std::string makeContract(StringRef CodeSection) {
+  std::string Module("\0asm\1\0\0\0", 8);
+  Module += std::string("\x01\x04\x01\x60\x00\x00", 6);  // type
+  Module += std::string("\x03\x02\x01\x00", 4);            // function
+  Module += std::string("\x07\x09\x01\x05" "apply\x00\x00", 11); // export
+  Module += CodeSection;
+  Module += std::string("\x00\x0d\x09.snax_abi\x02{}", 15);
+  return Module;
+}
+
+std::unique_ptr<WasmObjectFile> parse(const std::string &Data,
+                                      bool Lazy = false) {
+  Expected<std::unique_ptr<WasmObjectFile>> Obj =
+      ObjectFile::createWasmObjectFile(MemoryBufferRef(Data, "test.wasm"),
+                                       Lazy);
+  EXPECT_TRUE(bool(Obj));
+  if (!Obj) {
+    consumeError(Obj.takeError());
+    return nullptr;
+  }
+  return std::move(*Obj);
+}
+
+TEST(WasmObjectFileTest, SortedActionLookup) {
+  std::string Data =
+      makeTableModule(".snax_actions", {"issue", "retire", "transfer"});
+  auto Obj = parse(Data);
+  ASSERT_TRUE(Obj);
+  EXPECT_EQ(3u, Obj->actions().size());
+  EXPECT_EQ(0u, *Obj->findAction("issue"));
+  EXPECT_EQ(2u, *Obj->findAction("transfer"));
+  EXPECT_FALSE(Obj->findAction("open").hasValue());
+  EXPECT_FALSE(Obj->findAction("zzz").hasValue());
+}
+
+TEST(WasmObjectFileTest, UnsortedImportLookup) {
+  std::string Data =
+      makeTableModule(".imports", {"send_inline", "prints", "current_time"});
+  auto Obj = parse(Data);
+  ASSERT_TRUE(Obj);
+  EXPECT_TRUE(Obj->isAllowedImport("prints"));
+  EXPECT_TRUE(Obj->isAllowedImport("current_time"));
+  EXPECT_TRUE(Obj->isAllowedImport("send_inline"));
+  EXPECT_FALSE(Obj->isAllowedImport("printn"));
+  EXPECT_FALSE(Obj->isAllowedImport("send_deferred"));
+  EXPECT_FALSE(Obj->findNotify("prints").hasValue());
+}
+
+TEST(WasmObjectFileTest, LegacyTable) {
+  std::string Data = makeTableModule(
+      ".snax_actions", {"transfer", "issue", "retire"}, /*Legacy=*/true);
+  auto Obj = parse(Data);
+  ASSERT_TRUE(Obj);
+  ASSERT_EQ(3u, Obj->actions().size());
+  EXPECT_EQ("transfer", Obj->actions()[0]);
+  EXPECT_EQ(1u, *Obj->findAction("issue"));
+  EXPECT_EQ(2u, *Obj->findAction("retire"));
+  EXPECT_FALSE(Obj->findAction("open").hasValue());
+}
+
+TEST(WasmObjectFileTest, TruncatedTable) {
+  // Claim one more entry than the table holds.
+  std::string Data = makeTableModule(".imports", {"prints", "printn"});
+  Data[Data.find("\x02\x06prints")] = '\x03';
+  Expected<std::unique_ptr<WasmObjectFile>> Obj =
+      ObjectFile::createWasmObjectFile(MemoryBufferRef(Data, "test.wasm"));
+  ASSERT_FALSE(bool(Obj));
+  EXPECT_EQ("Malformed .imports section", toString(Obj.takeError()));
+
+  // A name running past the end of a headerless table.
+  Data = makeTableModule(".imports", {"prints"}, /*Legacy=*/true);
+  Data[Data.find("\x06prints")] = '\x07';
+  Obj = ObjectFile::createWasmObjectFile(MemoryBufferRef(Data, "test.wasm"));
+  ASSERT_FALSE(bool(Obj));
+  EXPECT_EQ("Malformed .imports section", toString(Obj.takeError()));
+}
+
+TEST(WasmObjectFileTest, LazyParse) {
+  std::string Data = makeContract(StringRef("\x0a\x04\x01\x02\x00\x0b", 6));
+  auto Obj = parse(Data, /*Lazy=*/true);
+  ASSERT_TRUE(Obj);
+  EXPECT_EQ(5u, static_cast<size_t>(std::distance(Obj->section_begin(),
+                                                  Obj->section_end())));
+  ASSERT_FALSE(errorToBool(Obj->parseModuleSections()));
+  EXPECT_EQ("{}", Obj->get_snax_abi());
+  ASSERT_EQ(1u, Obj->exports().size());
+  EXPECT_EQ("apply", Obj->exports()[0].Name);
+  ASSERT_FALSE(errorToBool(Obj->parseAllSections()));
+  ASSERT_EQ(1u, Obj->functions().size());
+  EXPECT_EQ(1u, Obj->functions()[0].Body.size());
+  // Decoding is done once; asking again is a no-op.
+  EXPECT_FALSE(errorToBool(Obj->parseAllSections()));
+  EXPECT_EQ(1u, Obj->exports().size());
+}
+
+TEST(WasmObjectFileTest, LazyParseDefersCodeErrors) {
+  // The code section claims no functions, but the function section has one.
+  std::string Data = makeContract(StringRef("\x0a\x01\x00", 3));
+  Expected<std::unique_ptr<WasmObjectFile>> Eager =
+      ObjectFile::createWasmObjectFile(MemoryBufferRef(Data, "test.wasm"));
+  EXPECT_FALSE(bool(Eager));
+  consumeError(Eager.takeError());
+
+  auto Obj = parse(Data, /*Lazy=*/true);
+  ASSERT_TRUE(Obj);
+  ASSERT_FALSE(errorToBool(Obj->parseModuleSections()));
+  EXPECT_EQ("{}", Obj->get_snax_abi());
+  EXPECT_EQ(1u, Obj->exports().size());
+  EXPECT_TRUE(errorToBool(Obj->parseAllSections()));
+  // The failure sticks rather than decoding the sections a second time.
+  EXPECT_TRUE(errorToBool(Obj->parseAllSections()));
+  EXPECT_FALSE(errorToBool(Obj->parseModuleSections()));
+}
+
+#ifdef GTEST_HAS_DEATH_TEST
+// Reading what hasn't been decoded yet fails in every build, rather than
+// quietly returning an empty table.
+TEST(WasmObjectFileTest, LazyParseRequiresDecode) {
+  std::string Data = makeContract(StringRef("\x0a\x04\x01\x02\x00\x0b", 6));
+  auto Obj = parse(Data, /*Lazy=*/true);
+  ASSERT_TRUE(Obj);
+  EXPECT_DEATH(Obj->exports(), "module sections of a lazy wasm object");
+  ASSERT_FALSE(errorToBool(Obj->parseModuleSections()));
+  EXPECT_DEATH(Obj->symbol_begin(), "sections of a lazy wasm object");
+  SectionRef Code = *std::next(Obj->section_begin(), 3);
+  EXPECT_DEATH(Code.relocation_begin(), "sections of a lazy wasm object");
+  EXPECT_DEATH(Code.relocation_end(), "sections of a lazy wasm object");
+}
+#endif
+
+} // end anonymous namespace
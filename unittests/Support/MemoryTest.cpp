@@ -347,6 +347,32 @@ TEST_P(MappedMemoryTest, UnalignedNear) {
   EXPECT_FALSE(Memory::releaseMappedMemory(M1));
 }
 
+TEST_P(MappedMemoryTest, HugeHint) {
+  // A block that isn't a whole number of huge pages, followed by another
+  // block, to check that trimming the mapping leaves its neighbours alone.
+  std::error_code EC;
+  MemoryBlock M1 = Memory::allocateMappedMemory(
+      Memory::HugePageSize + PageSize, nullptr, Flags | Memory::MF_HUGE_HINT,
+      EC);
+  EXPECT_EQ(std::error_code(), EC);
+  MemoryBlock M2 = Memory::allocateMappedMemory(
+      PageSize, &M1, Flags | Memory::MF_HUGE_HINT, EC);
+  EXPECT_EQ(std::error_code(), EC);
+
+  EXPECT_NE((void*)nullptr, M1.base());
+  EXPECT_LE(Memory::HugePageSize + PageSize, M1.size());
+  EXPECT_NE((void*)nullptr, M2.base());
+  EXPECT_LE(PageSize, M2.size());
+  EXPECT_FALSE(doesOverlap(M1, M2));
+#if defined(__linux__)
+  EXPECT_EQ(0U, (uintptr_t)M1.base() % Memory::HugePageSize)
+      << "Blocks of at least a huge page should be aligned to one";
+#endif
+
+  EXPECT_FALSE(Memory::releaseMappedMemory(M1));
+  EXPECT_FALSE(Memory::releaseMappedMemory(M2));
+}
+
 // Note that Memory::MF_WRITE is not supported exclusively across
 // operating systems and architectures and can imply MF_READ|MF_WRITE
 unsigned MemoryFlags[] = {
@@ -27,11 +27,18 @@ void emitWebAssemblyDisassemblerTables(
   std::map<unsigned,
            std::map<unsigned, std::pair<unsigned, const CodeGenInstruction *>>>
       OpcodeTable;
+  // The operand arrays are sized for the widest instruction we decode, e.g.
+  // memory.copy with its two memory indices and three stack operands.
+  size_t MaxOperands = 0;
   for (unsigned I = 0; I != NumberedInstructions.size(); ++I) {
     auto &CGI = *NumberedInstructions[I];
     auto &Def = *CGI.TheDef;
     if (!Def.getValue("Inst"))
       continue;
+    // Codegen-only variants share their opcode with the instruction the
+    // disassembler should produce.
+    if (CGI.isCodeGenOnly)
+      continue;
     auto &Inst = *Def.getValueAsBitsInit("Inst");
     auto Opc = static_cast<unsigned>(
         reinterpret_cast<IntInit *>(Inst.convertInitializerTo(IntRecTy::get()))
@@ -54,6 +61,11 @@ void emitWebAssemblyDisassemblerTables(
       CGIP = std::make_pair(I, &CGI);
     }
   }
+  for (auto &PrefixPair : OpcodeTable)
+    for (auto &OpcodePair : PrefixPair.second)
+      MaxOperands = std::max(
+          MaxOperands,
+          OpcodePair.second.second->Operands.OperandList.size());
   OS << "#include \"MCTargetDesc/WebAssemblyMCTargetDesc.h\"\n";
   OS << "\n";
   OS << "namespace llvm {\n\n";
@@ -63,7 +75,7 @@ void emitWebAssemblyDisassemblerTables(
   OS << "  uint16_t Opcode;\n";
   OS << "  EntryType ET;\n";
   OS << "  uint8_t NumOperands;\n";
-  OS << "  uint8_t Operands[4];\n";
+  OS << "  uint8_t Operands[" << std::max<size_t>(MaxOperands, 1) << "];\n";
   OS << "};\n\n";
   // Output one table per prefix.
   for (auto &PrefixPair : OpcodeTable) {
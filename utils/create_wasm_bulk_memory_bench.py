@@ -0,0 +1,292 @@
+#!/usr/bin/env python
+"""A memcpy/memset benchmark generator for WebAssembly bulk memory.
+
+This is a python program that creates LLVM IR for a module that copies and
+fills memory blocks of the given sizes in a loop, in the three ways the
+WebAssembly backend can lower llvm.memcpy and llvm.memset:
+
+  - a call to memcpy or memset, for lengths that aren't constant. The module
+    defines both, copying 8 bytes at a time the way a libc would.
+  - an inline load/store sequence, for small constant lengths.
+  - memory.copy and memory.fill, with -mattr=+bulk-memory.
+
+With --run, it also compiles the module with the given llc, once with and
+once without bulk memory, and times every function under node (which must
+support bulk memory, e.g. node 12.5 or later):
+
+  create_wasm_bulk_memory_bench.py --run bin/llc 8 64 1024 65536
+
+The relocatable objects llc writes can be instantiated as they are. The
+driver only adds an export section for the benchmark functions.
+"""
+
+from __future__ import print_function
+
+import argparse
+import json
+import os
+import subprocess
+import tempfile
+
+HEADER = '''\
+target datalayout = "e-m:e-p:32:32-i64:64-n32:64-S128"
+target triple = "wasm32-unknown-unknown"
+
+declare void @llvm.memcpy.p0i8.p0i8.i32(i8* nocapture, i8* nocapture readonly, i32, i1)
+declare void @llvm.memset.p0i8.i32(i8* nocapture, i8, i32, i1)
+
+define i8* @memcpy(i8* %d, i8* %s, i32 %n) noinline {
+entry:
+  %words = lshr i32 %n, 3
+  %nowords = icmp eq i32 %words, 0
+  br i1 %nowords, label %bytes, label %wloop
+wloop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %wloop ]
+  %off = shl i32 %i, 3
+  %sp = getelementptr i8, i8* %s, i32 %off
+  %dp = getelementptr i8, i8* %d, i32 %off
+  %sw = bitcast i8* %sp to i64*
+  %dw = bitcast i8* %dp to i64*
+  %w = load i64, i64* %sw, align 1
+  store i64 %w, i64* %dw, align 1
+  %i.next = add i32 %i, 1
+  %wdone = icmp eq i32 %i.next, %words
+  br i1 %wdone, label %bytes, label %wloop
+bytes:
+  %start = shl i32 %words, 3
+  %nobytes = icmp eq i32 %start, %n
+  br i1 %nobytes, label %done, label %bloop
+bloop:
+  %j = phi i32 [ %start, %bytes ], [ %j.next, %bloop ]
+  %bs = getelementptr i8, i8* %s, i32 %j
+  %bd = getelementptr i8, i8* %d, i32 %j
+  %b = load i8, i8* %bs
+  store i8 %b, i8* %bd
+  %j.next = add i32 %j, 1
+  %bdone = icmp eq i32 %j.next, %n
+  br i1 %bdone, label %done, label %bloop
+done:
+  ret i8* %d
+}
+
+define i8* @memset(i8* %d, i32 %c, i32 %n) noinline {
+entry:
+  %c8 = trunc i32 %c to i8
+  %c64 = zext i8 %c8 to i64
+  %splat = mul i64 %c64, 72340172838076673
+  %words = lshr i32 %n, 3
+  %nowords = icmp eq i32 %words, 0
+  br i1 %nowords, label %bytes, label %wloop
+wloop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %wloop ]
+  %off = shl i32 %i, 3
+  %dp = getelementptr i8, i8* %d, i32 %off
+  %dw = bitcast i8* %dp to i64*
+  store i64 %splat, i64* %dw, align 1
+  %i.next = add i32 %i, 1
+  %wdone = icmp eq i32 %i.next, %words
+  br i1 %wdone, label %bytes, label %wloop
+bytes:
+  %start = shl i32 %words, 3
+  %nobytes = icmp eq i32 %start, %n
+  br i1 %nobytes, label %done, label %bloop
+bloop:
+  %j = phi i32 [ %start, %bytes ], [ %j.next, %bloop ]
+  %bd = getelementptr i8, i8* %d, i32 %j
+  store i8 %c8, i8* %bd
+  %j.next = add i32 %j, 1
+  %bdone = icmp eq i32 %j.next, %n
+  br i1 %bdone, label %done, label %bloop
+done:
+  ret i8* %d
+}
+'''
+
+# Each benchmark function runs its operation %iters (at least 1) times.
+LOOP = '''
+define void @{name}({params}i32 %iters) {{
+entry:
+  br label %loop
+loop:
+  %k = phi i32 [ 0, %entry ], [ %k.next, %loop ]
+  {call}
+  %k.next = add i32 %k, 1
+  %done = icmp eq i32 %k.next, %iters
+  br i1 %done, label %exit, label %loop
+exit:
+  ret void
+}}
+'''
+
+COPY = ('call void @llvm.memcpy.p0i8.p0i8.i32(i8* align 8 %d, '
+        'i8* align 8 %s, i32 {len}, i1 false)')
+FILL = 'call void @llvm.memset.p0i8.i32(i8* align 8 %d, i8 90, i32 {len}, i1 false)'
+
+
+def generate(sizes):
+  """Return the module and the names of its functions, in index order."""
+  funcs = ['memcpy', 'memset']
+  ir = [HEADER]
+  def add(name, params, call):
+    ir.append(LOOP.format(name=name, params=params, call=call))
+    funcs.append(name)
+  add('copy_var', 'i8* %d, i8* %s, i32 %n, ', COPY.format(len='%n'))
+  add('fill_var', 'i8* %d, i32 %n, ', FILL.format(len='%n'))
+  for size in sizes:
+    add('copy_%d' % size, 'i8* %d, i8* %s, ', COPY.format(len=size))
+    add('fill_%d' % size, 'i8* %d, ', FILL.format(len=size))
+  return ''.join(ir), funcs
+
+
+def uleb(value):
+  out = bytearray()
+  while True:
+    byte = value & 0x7f
+    value >>= 7
+    out.append(byte | (0x80 if value else 0))
+    if not value:
+      return bytes(out)
+
+
+def add_exports(obj, funcs):
+  """Insert an export section for funcs before the code section."""
+  payload = bytearray(uleb(len(funcs)))
+  for index, name in enumerate(funcs):
+    payload += uleb(len(name)) + name.encode() + b'\x00' + uleb(index)
+  exports = b'\x07' + uleb(len(payload)) + bytes(payload)
+  pos = 8
+  while pos < len(obj):
+    section, size, start = obj[pos], 0, pos + 1
+    shift = 0
+    while True:
+      byte = obj[start]
+      start += 1
+      size |= (byte & 0x7f) << shift
+      shift += 7
+      if not byte & 0x80:
+        break
+    # The export section goes after the global section (6) and before the
+    # start, element and code sections.
+    if section != 0 and section > 7:
+      return obj[:pos] + exports + obj[pos:]
+    pos = start + size
+  return obj + exports
+
+
+DRIVER = '''
+const fs = require('fs');
+const [file, spec] = process.argv.slice(2);
+const wasm = new WebAssembly.Module(fs.readFileSync(file));
+const cases = JSON.parse(spec);
+const pages = Math.ceil((cases.base + 2 * cases.max) / 65536) + 1;
+const env = {
+  __linear_memory: new WebAssembly.Memory({initial: pages}),
+  __indirect_function_table: new WebAssembly.Table({initial: 0,
+                                                    element: 'anyfunc'}),
+  __stack_pointer: new WebAssembly.Global({value: 'i32', mutable: true},
+                                          pages * 65536),
+};
+const imports = {env: {}};
+for (const i of WebAssembly.Module.imports(wasm))
+  imports.env[i.name] = env[i.name];
+const funcs = new WebAssembly.Instance(wasm, imports).exports;
+const results = [];
+for (const [name, args] of cases.runs) {
+  funcs[name](...args.slice(0, -1), 1000);
+  const start = process.hrtime.bigint();
+  funcs[name](...args);
+  results.push(Number(process.hrtime.bigint() - start) / args[args.length - 1]);
+}
+console.log(JSON.stringify(results));
+'''
+
+
+def compile_module(llc, ir, flags, tmp, tag):
+  src = os.path.join(tmp, tag + '.ll')
+  with open(src, 'w') as f:
+    f.write(ir)
+  obj = os.path.join(tmp, tag + '.o')
+  asm = os.path.join(tmp, tag + '.s')
+  subprocess.check_call([llc, '-O2', '-filetype=obj', src, '-o', obj] + flags)
+  subprocess.check_call([llc, '-O2', src, '-o', asm] + flags)
+  return obj, asm
+
+
+def calls_libc(asm, name):
+  """Whether the function name in asm still calls memcpy or memset."""
+  body = asm.split('\n%s:' % name, 1)[1].split('.Lfunc_end', 1)[0]
+  return 'memcpy@FUNCTION' in body or 'memset@FUNCTION' in body
+
+
+def run(args, ir, funcs):
+  tmp = tempfile.mkdtemp()
+  driver = os.path.join(tmp, 'driver.cjs')
+  with open(driver, 'w') as f:
+    f.write(DRIVER)
+  base, max_size = 4096, max(args.sizes)
+  dst, src = base, base + max_size
+
+  def iters(size):
+    return max(1000, args.bytes // size)
+
+  def measure(obj, runs):
+    wasm = obj + '.wasm'
+    with open(obj, 'rb') as f:
+      data = add_exports(bytearray(f.read()), funcs)
+    with open(wasm, 'wb') as f:
+      f.write(data)
+    spec = json.dumps({'base': base, 'max': max_size, 'runs': runs})
+    out = subprocess.check_output([args.node, driver, wasm, spec])
+    return json.loads(out.decode())
+
+  plain, plain_asm = compile_module(args.run, ir, [], tmp, 'plain')
+  bulk, _ = compile_module(args.run, ir,
+                           ['-mattr=+bulk-memory',
+                            '-wasm-bulk-memory-inline-stores=0'], tmp, 'bulk')
+  with open(plain_asm) as f:
+    plain_asm = f.read()
+
+  print('ns per operation; "-" where llc calls the libc function instead of '
+        'inlining')
+  print('%8s  %-4s %10s %10s %12s' % ('size', 'op', 'libcall', 'inline',
+                                      'bulk memory'))
+  for op in ('copy', 'fill'):
+    def args_for(size, var):
+      n = iters(size)
+      prefix = [dst, src] if op == 'copy' else [dst]
+      return prefix + ([size] if var else []) + [n]
+    var_runs = [[op + '_var', args_for(size, True)] for size in args.sizes]
+    const_runs = [['%s_%d' % (op, size), args_for(size, False)]
+                  for size in args.sizes]
+    libcall = measure(plain, var_runs)
+    inline = measure(plain, const_runs)
+    memory = measure(bulk, var_runs)
+    for i, size in enumerate(args.sizes):
+      inlined = not calls_libc(plain_asm, const_runs[i][0])
+      print('%8d  %-4s %10.2f %10s %12.2f' %
+            (size, op, libcall[i],
+             '%.2f' % inline[i] if inlined else '-', memory[i]))
+
+
+def main():
+  parser = argparse.ArgumentParser(
+      description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+  parser.add_argument('sizes', type=int, nargs='*',
+                      default=[8, 16, 32, 64, 256, 1024, 4096, 65536],
+                      help="Block sizes in bytes")
+  parser.add_argument('--run', metavar='LLC',
+                      help="Compile with this llc and time the functions")
+  parser.add_argument('--node', default='node', help="The node to run with")
+  parser.add_argument('--bytes', type=int, default=1 << 28,
+                      help="Bytes each timed loop copies or fills")
+  args = parser.parse_args()
+
+  ir, funcs = generate(args.sizes)
+  if not args.run:
+    print(ir, end='')
+    return
+  run(args, ir, funcs)
+
+
+if __name__ == '__main__':
+  main()
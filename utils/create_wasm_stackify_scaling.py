@@ -0,0 +1,75 @@
+#!/usr/bin/env python
+"""A large straight-line function generator for WebAssembly RegStackify.
+
+This is a python program that creates LLVM IR for a function with a single
+basic block of roughly 'size' instructions. Each value is loaded well before
+its uses, with unrelated loads and arithmetic in between, and every 'stride'
+steps a store or a call (alternately) clobbers memory. This is the shape of
+machine-generated code (e.g. from other compilers targeting wasm) where
+checking whether a def can be moved down to its use, or whether one use of a
+value comes before the others, used to walk the whole block for every operand.
+
+One good use of this program is to test whether the register stackifier is
+really behaving linearly:
+
+  for n in 1000 2000 4000 8000 16000; do
+    create_wasm_stackify_scaling.py $n > big.ll
+    llc -O2 -time-passes big.ll -o /dev/null 2>&1 | grep 'Register Stackify'
+  done
+"""
+
+from __future__ import print_function
+
+import argparse
+
+def main():
+  parser = argparse.ArgumentParser(description=__doc__)
+  parser.add_argument('size', type=int,
+                      help="Approximate number of instructions in the block")
+  parser.add_argument('--distance', type=int, default=64,
+                      help="How many steps a loaded value waits for its uses")
+  parser.add_argument('--uses', type=int, default=2,
+                      help="How many times each loaded value is used")
+  parser.add_argument('--stride', type=int, default=16,
+                      help="Emit a store or a call to clobber memory every "
+                           "this many steps (0 disables them)")
+  args = parser.parse_args()
+
+  uses = max(args.uses, 1)
+  steps = max(args.size // (2 + uses), args.distance + 1)
+  print('target datalayout = "e-m:e-p:32:32-i64:64-n32:64-S128"')
+  print('target triple = "wasm32-unknown-unknown"')
+  print('')
+  print('declare void @clobber()')
+  print('')
+  print('define i32 @scaling(i32* %src, i32* %dst) {')
+  print('entry:')
+
+  acc = ['0']
+  def accumulate(j):
+    # Fold every use of %v<j> into the running sum.
+    for u in range(uses):
+      name = '%%acc%d.%d' % (j, u)
+      op = 'add' if u % 2 == 0 else 'mul'
+      print('  %s = %s i32 %s, %%v%d' % (name, op, acc[0], j))
+      acc[0] = name
+
+  for i in range(steps):
+    print('  %%p%d = getelementptr inbounds i32, i32* %%src, i32 %d' % (i, i))
+    print('  %%v%d = load i32, i32* %%p%d' % (i, i))
+    if i >= args.distance:
+      accumulate(i - args.distance)
+    if args.stride and i % args.stride == args.stride - 1:
+      if (i // args.stride) % 2 == 0:
+        print('  %%q%d = getelementptr inbounds i32, i32* %%dst, i32 %d' %
+              (i, i))
+        print('  store i32 %d, i32* %%q%d' % (i, i))
+      else:
+        print('  call void @clobber()')
+  for j in range(steps - args.distance, steps):
+    accumulate(j)
+  print('  ret i32 %s' % acc[0])
+  print('}')
+
+if __name__ == '__main__':
+  main()
@@ -0,0 +1,82 @@
+#!/usr/bin/env python
+"""A state machine generator for WebAssembly irreducible control flow.
+
+This is a python program that creates LLVM IR for a function implementing a
+state machine with 'size' states. The function can start in any state, and
+each state moves to one of a few other states depending on its input, so the
+loop over the states has many entries and its control flow is irreducible.
+This is the shape of interpreters and lexers compiled with computed gotos or
+jump tables, and of code produced by other compilers targeting wasm.
+
+One good use of this program is to compare the code produced by splitting
+nodes against the br_table dispatcher:
+
+  create_wasm_state_machine.py 4 --entries=2 --fanout=1 > sm.ll
+  llc -O2 -filetype=obj sm.ll -o split.o
+  llc -O2 -filetype=obj -wasm-irreducible-duplication-budget=0 sm.ll -o dispatch.o
+  ls -l split.o dispatch.o
+
+Splitting only applies while the duplicated code fits in the budget, so with
+the default budget, machines of more than a handful of states with a fanout
+above one get the dispatcher either way and produce identical objects.
+"""
+
+from __future__ import print_function
+
+import argparse
+
+def main():
+  parser = argparse.ArgumentParser(description=__doc__)
+  parser.add_argument('size', type=int, help="Number of states")
+  parser.add_argument('--entries', type=int, default=0,
+                      help="Number of states the machine can start in "
+                           "(0 means all of them)")
+  parser.add_argument('--fanout', type=int, default=2,
+                      help="Number of states each state can move to")
+  args = parser.parse_args()
+
+  n = max(args.size, 2)
+  entries = args.entries if args.entries > 0 else n
+  entries = min(entries, n)
+  fanout = min(max(args.fanout, 1), n - 1)
+
+  # States reached from each state, and the edges into each state.
+  succs = [[(i + 1 + k * (k + 1) // 2) % n for k in range(fanout)]
+           for i in range(n)]
+  preds = [[] for i in range(n)]
+  for i in range(n):
+    for s in succs[i]:
+      preds[s].append(i)
+
+  print('target datalayout = "e-m:e-p:32:32-i64:64-n32:64-S128"')
+  print('target triple = "wasm32-unknown-unknown"')
+  print('')
+  print('define i32 @state_machine(i32 %start, i8* %input) {')
+  print('entry:')
+  print('  switch i32 %start, label %s0 [')
+  for i in range(1, entries):
+    print('    i32 %d, label %%s%d' % (i, i))
+  print('  ]')
+  for i in range(n):
+    print('')
+    print('s%d:' % i)
+    incoming = ['[ %%n%d, %%s%d ]' % (p, p) for p in sorted(set(preds[i]))]
+    if i < entries:
+      incoming.insert(0, '[ 0, %entry ]')
+    print('  %%i%d = phi i32 %s' % (i, ', '.join(incoming)))
+    print('  %%p%d = getelementptr inbounds i8, i8* %%input, i32 %%i%d' % (i, i))
+    print('  %%c%d = load i8, i8* %%p%d' % (i, i))
+    print('  %%n%d = add i32 %%i%d, 1' % (i, i))
+    print('  switch i8 %%c%d, label %%done [' % i)
+    for k, s in enumerate(succs[i]):
+      print('    i8 %d, label %%s%d' % (k + 1, s))
+    print('  ]')
+  print('')
+  print('done:')
+  incoming = ['[ %%i%d, %%s%d ]' % (i, i) for i in range(n)]
+  print('  %%r = phi i32 %s' % ', '.join(incoming))
+  print('  ret i32 %r')
+  print('}')
+
+if __name__ == '__main__':
+  main()